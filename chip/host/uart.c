@@ -20,6 +20,7 @@
 
 static int stopped = 1;
 static int init_done;
+static int tx_held;
 
 #ifndef TEST_FUZZ
 static pthread_t input_thread;
@@ -61,6 +62,11 @@ const char *test_get_captured_console(void)
 	return (const char *)capture_buf;
 }
 
+void test_hold_uart_output(int hold)
+{
+	tx_held = hold;
+}
+
 static void uart_interrupt(void)
 {
 	uart_process_input();
@@ -75,7 +81,8 @@ int uart_init_done(void)
 void uart_tx_start(void)
 {
 	stopped = 0;
-	task_trigger_test_interrupt(uart_interrupt);
+	if (!tx_held)
+		task_trigger_test_interrupt(uart_interrupt);
 }
 
 void uart_tx_stop(void)
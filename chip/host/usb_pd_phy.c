@@ -34,6 +34,7 @@ static struct pd_physical {
 	int has_msg;
 	int last_edge_written;
 	uint8_t out_msg[PD_BIT_LEN / 5];
+	int out_len;
 	int verified_idx;
 } pd_phy[CONFIG_USB_PD_PORT_MAX_COUNT];
 
@@ -60,6 +61,7 @@ static void pd_test_reset_phy(int port)
 	pd_phy[port].preamble_written = 0;
 	pd_phy[port].has_msg = 0;
 	pd_phy[port].last_edge_written = 0;
+	pd_phy[port].out_len = 0;
 	pd_phy[port].verified_idx = 0;
 }
 
@@ -138,6 +140,17 @@ void pd_test_rx_msg_append_word(int port, uint32_t val)
 	pd_test_rx_msg_append_short(port, val >> 16);
 }
 
+void pd_test_rx_msg_from_tx(int port)
+{
+	int i;
+
+	pd_test_rx_set_preamble(port, 1);
+	for (i = 0; i < pd_phy[port].out_len; i++)
+		pd_test_rx_msg_append_bits(port, pd_phy[port].out_msg[i], 5);
+	pd_test_rx_msg_append_last_edge(port);
+	pd_phy[port].rx_started = 1;
+}
+
 void pd_simulate_rx(int port)
 {
 	if (!pd_phy[port].rx_monitoring)
@@ -273,6 +286,7 @@ int pd_write_sym(int port, int bit_off, uint32_t val10)
 int pd_write_last_edge(int port, int bit_off)
 {
 	pd_phy[port].last_edge_written = 1;
+	pd_phy[port].out_len = bit_off;
 	return bit_off;
 }
 
@@ -77,6 +77,25 @@ static struct charge_port_info available_charge[CHARGE_SUPPLIER_COUNT]
 /* Keep track of when the supplier on each port is registered. */
 static timestamp_t registration_time[CHARGE_PORT_COUNT];
 
+/*
+ * Best supplier on each port, by priority then power. On a tie, 'first' is
+ * the lowest supplier index and 'last' the highest, which the active charge
+ * port uses so that it keeps its supplier. charge_manager_refresh() only
+ * looks again at the ports flagged in port_best_dirty.
+ */
+struct port_best {
+	int8_t first;
+	int8_t last;
+};
+static struct port_best port_best[CHARGE_PORT_COUNT];
+static uint32_t port_best_dirty;
+BUILD_ASSERT(CHARGE_PORT_COUNT < 32);
+BUILD_ASSERT(CHARGE_SUPPLIER_COUNT <= INT8_MAX);
+
+#ifdef TEST_BUILD
+int charge_manager_supplier_scans;
+#endif
+
 /*
  * Charge current ceiling (mA) for ports. This can be set to temporarily limit
  * the charge pulled from a port, without influencing the port selection logic.
@@ -225,6 +244,7 @@ static void charge_manager_init(void)
 		if (is_pd_port(i))
 			source_port_rp[i] = CONFIG_USB_PD_PULLUP;
 	}
+	port_best_dirty = BIT(CHARGE_PORT_COUNT) - 1;
 }
 DECLARE_HOOK(HOOK_INIT, charge_manager_init, HOOK_PRIO_CHARGE_MANAGER_INIT);
 
@@ -560,14 +580,56 @@ static int charge_manager_get_ceil(int port)
 	return ceil;
 }
 
+/**
+ * Find the best supplier of a port, by priority then power.
+ *
+ * @param port	Charge port.
+ * @param best	Best supplier on ties by lowest and by highest index, or
+ *		CHARGE_SUPPLIER_NONE if the port has no charge.
+ */
+static void find_port_best(int port, struct port_best *best)
+{
+	int best_power = -1, power;
+	int i;
+
+	best->first = CHARGE_SUPPLIER_NONE;
+	best->last = CHARGE_SUPPLIER_NONE;
+
+	for (i = 0; i < CHARGE_SUPPLIER_COUNT; ++i) {
+#ifdef TEST_BUILD
+		charge_manager_supplier_scans++;
+#endif
+		/* Skip this supplier if there is no available charge. */
+		if (available_charge[i][port].current == 0 ||
+		    available_charge[i][port].voltage == 0)
+			continue;
+
+		power = POWER(available_charge[i][port]);
+		if (best->first == CHARGE_SUPPLIER_NONE ||
+		    supplier_priority[i] < supplier_priority[best->first] ||
+		    (supplier_priority[i] == supplier_priority[best->first] &&
+		     power > best_power)) {
+			best->first = i;
+			best->last = i;
+			best_power = power;
+		} else if (supplier_priority[i] ==
+			   supplier_priority[best->first] &&
+			   power == best_power) {
+			best->last = i;
+		}
+	}
+}
+
 /**
  * Select the 'best' charge port, as defined by the supplier heirarchy and the
  * ability of the port to provide power.
  *
+ * @param best		Best supplier of each port, see find_port_best().
  * @param new_port	Pointer to the best charge port by definition.
  * @param new_supplier	Pointer to the best charge supplier by definition.
  */
-static void charge_manager_get_best_charge_port(int *new_port,
+static void charge_manager_get_best_charge_port(const struct port_best *best,
+						int *new_port,
 						int *new_supplier)
 {
 	int supplier = CHARGE_SUPPLIER_NONE;
@@ -583,71 +645,67 @@ static void charge_manager_get_best_charge_port(int *new_port,
 		 * 2. Prefer higher power over lower in case priority is tied.
 		 * 3. Prefer current charge port over new port in case (1)
 		 *    and (2) are tied.
+		 * 4. Prefer the lower supplier index, then the lower port
+		 *    number, in case (1) to (3) are tied.
 		 * available_charge can be changed at any time by other tasks,
 		 * so make no assumptions about its consistency.
 		 */
-		for (i = 0; i < CHARGE_SUPPLIER_COUNT; ++i)
-			for (j = 0; j < CHARGE_PORT_COUNT; ++j) {
-				/* Skip this port if it is not valid. */
-				if (!is_valid_port(j))
-					continue;
-
-				/*
-				 * Skip this supplier if there is no
-				 * available charge.
-				 */
-				if (available_charge[i][j].current == 0 ||
-				    available_charge[i][j].voltage == 0)
-					continue;
-
-				/*
-				 * Don't select this port if we have a
-				 * charge on another override port.
-				 */
-				if (override_port != OVERRIDE_OFF &&
-				    override_port == port &&
-				    override_port != j)
-					continue;
+		for (j = 0; j < CHARGE_PORT_COUNT; ++j) {
+			/* Skip this port if it is not valid. */
+			if (!is_valid_port(j))
+				continue;
+
+			/* Skip this port if there is no available charge. */
+			i = (j == charge_port) ? best[j].last : best[j].first;
+			if (i == CHARGE_SUPPLIER_NONE)
+				continue;
+
+			/*
+			 * Don't select this port if we have a charge on
+			 * another override port.
+			 */
+			if (override_port != OVERRIDE_OFF &&
+			    override_port == port)
+				continue;
 
 #ifndef CONFIG_CHARGE_MANAGER_DRP_CHARGING
-				/*
-				 * Don't charge from a dual-role port unless
-				 * it is our override port.
-				 */
-				if (dualrole_capability[j] != CAP_DEDICATED &&
-				    override_port != j &&
-				    !charge_manager_spoof_dualrole_capability())
-					continue;
+			/*
+			 * Don't charge from a dual-role port unless it is our
+			 * override port.
+			 */
+			if (dualrole_capability[j] != CAP_DEDICATED &&
+			    override_port != j &&
+			    !charge_manager_spoof_dualrole_capability())
+				continue;
 #endif
 
-				candidate_port_power =
-					POWER(available_charge[i][j]);
-
-				/* Select if no supplier chosen yet. */
-				if (supplier == CHARGE_SUPPLIER_NONE ||
-				/* ..or if supplier priority is higher. */
-				    supplier_priority[i] <
-				    supplier_priority[supplier] ||
-				/* ..or if this is our override port. */
-				   (j == override_port &&
-				    port != override_port) ||
-				/* ..or if priority is tied and.. */
-				   (supplier_priority[i] ==
-				    supplier_priority[supplier] &&
-				/* candidate port can supply more power or.. */
-				   (candidate_port_power > best_port_power ||
-				/*
-				 * candidate port is the active port and can
-				 * supply the same amount of power.
-				 */
-				   (candidate_port_power == best_port_power &&
-				    charge_port == j)))) {
-					supplier = i;
-					port = j;
-					best_port_power = candidate_port_power;
-				}
+			candidate_port_power = POWER(available_charge[i][j]);
+
+			/* Select if no supplier chosen yet. */
+			if (supplier == CHARGE_SUPPLIER_NONE ||
+			/* ..or if supplier priority is higher. */
+			    supplier_priority[i] <
+			    supplier_priority[supplier] ||
+			/* ..or if this is our override port. */
+			    j == override_port ||
+			/* ..or if priority is tied and.. */
+			    (supplier_priority[i] ==
+			     supplier_priority[supplier] &&
+			/* candidate port can supply more power or.. */
+			     (candidate_port_power > best_port_power ||
+			/*
+			 * candidate port is the active port and can supply
+			 * the same amount of power, or neither is active and
+			 * the candidate has the lower supplier index.
+			 */
+			      (candidate_port_power == best_port_power &&
+			       (charge_port == j ||
+				(charge_port != port && i < supplier)))))) {
+				supplier = i;
+				port = j;
+				best_port_power = candidate_port_power;
 			}
-
+		}
 	}
 
 #ifdef CONFIG_BATTERY
@@ -684,10 +742,18 @@ static void charge_manager_refresh(void)
 	int updated_old_port = CHARGE_PORT_NONE;
 	int ceil;
 	int power_changed = 0;
+	uint32_t dirty;
+
+	/* Only look again at the ports whose available charge changed */
+	dirty = deprecated_atomic_read_clear(&port_best_dirty);
+	for (i = 0; i < CHARGE_PORT_COUNT; ++i)
+		if (dirty & BIT(i))
+			find_port_best(i, &port_best[i]);
 
 	/* Hunt for an acceptable charge port */
 	while (1) {
-		charge_manager_get_best_charge_port(&new_port, &new_supplier);
+		charge_manager_get_best_charge_port(port_best, &new_port,
+						    &new_supplier);
 
 		if (!left_safe_mode && new_port == CHARGE_PORT_NONE)
 			return;
@@ -716,6 +782,7 @@ static void charge_manager_refresh(void)
 			available_charge[i][new_port].current = 0;
 			available_charge[i][new_port].voltage = 0;
 		}
+		find_port_best(new_port, &port_best[new_port]);
 	}
 
 	active_charge_port_initialized = 1;
@@ -944,6 +1011,7 @@ static void charge_manager_make_change(enum charge_manager_change_type change,
 		available_charge[supplier][port].current = charge->current;
 		available_charge[supplier][port].voltage = charge->voltage;
 		registration_time[port] = get_time();
+		deprecated_atomic_or(&port_best_dirty, BIT(port));
 
 		/*
 		 * After CHARGE_DETECT_DELAY, inform the host that charger
@@ -1165,9 +1233,17 @@ int charge_manager_get_active_charge_port(void)
 
 int charge_manager_get_selected_charge_port(void)
 {
+	struct port_best best[CHARGE_PORT_COUNT];
 	int port, supplier;
 
-	charge_manager_get_best_charge_port(&port, &supplier);
+	/*
+	 * This may be called by the PD tasks right after a change, before
+	 * charge_manager_refresh() ran, so don't rely on port_best.
+	 */
+	for (port = 0; port < CHARGE_PORT_COUNT; ++port)
+		find_port_best(port, &best[port]);
+
+	charge_manager_get_best_charge_port(best, &port, &supplier);
 	return port;
 }
 
@@ -7,6 +7,8 @@
 
 #include "clock.h"
 #include "console.h"
+#include "console_batch.h"
+#include "console_binlog.h"
 #ifdef CONFIG_EXPERIMENTAL_CONSOLE
 #include "crc8.h"
 #endif /* defined(CONFIG_EXPERIMENTAL_CONSOLE) */
@@ -126,28 +128,38 @@ static int split_words(char *input, int *argc, char **argv)
  *
  * @return A pointer to the command structure, or NULL if no match found.
  */
-static const struct console_command *find_command(char *name)
+test_export_static const struct console_command *find_command(char *name)
 {
-	const struct console_command *cmd, *match = NULL;
+	const struct console_command *lo = __cmds, *hi = __cmds_end, *mid;
 	int match_length = strlen(name);
 
-	for (cmd = __cmds; cmd < __cmds_end; cmd++) {
-		if (!strncasecmp(name, cmd->name, match_length)) {
-			if (match)
-				return NULL;
-			/*
-			 * Check if 'cmd->name' is of the same length as
-			 * 'name'. If yes, then we have a full match.
-			 */
-			if (cmd->name[match_length] == '\0')
-				return cmd;
-			match = cmd;
-		}
+	/*
+	 * Commands are sorted by name at link time, so the commands starting
+	 * with 'name' are next to each other, from the first command which
+	 * doesn't sort before 'name'.
+	 */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (strcasecmp(mid->name, name) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
 
-	return match;
-}
+	if (lo == __cmds_end || strncasecmp(name, lo->name, match_length))
+		return NULL;
 
+	/* A full match sorts first, and wins over longer names */
+	if (lo->name[match_length] == '\0')
+		return lo;
+
+	/* Otherwise the next command must not match too */
+	if (lo + 1 < __cmds_end &&
+	    !strncasecmp(name, lo[1].name, match_length))
+		return NULL;
+
+	return lo;
+}
 
 static const char *const errmsgs[] = {
 	"OK",
@@ -162,6 +174,55 @@ static const char *const errmsgs[] = {
 	"Not Calibrated",
 };
 
+/**
+ * Run a command which has been split into words.
+ *
+ * @param argc		Number of words.
+ * @param argv		Words; the first one is the command name.
+ *
+ * @return EC_SUCCESS, or non-zero if error.
+ */
+static int run_command(int argc, char **argv)
+{
+	const struct console_command *cmd;
+	int rv;
+
+	/* If no command, nothing to do */
+	if (!argc)
+		return EC_SUCCESS;
+
+	cmd = find_command(argv[0]);
+	if (!cmd) {
+		ccprintf("Command '%s' not found or ambiguous.\n", argv[0]);
+		return EC_ERROR_UNKNOWN;
+	}
+
+#ifdef CONFIG_RESTRICTED_CONSOLE_COMMANDS
+	if (console_is_restricted() && cmd->flags & CMD_FLAG_RESTRICTED)
+		rv = EC_ERROR_ACCESS_DENIED;
+	else
+#endif
+	rv = cmd->handler(argc, argv);
+	if (rv == EC_SUCCESS)
+		return rv;
+
+	/* Print more info for errors */
+	if (rv < ARRAY_SIZE(errmsgs))
+		ccprintf("%s\n", errmsgs[rv]);
+	else if (rv >= EC_ERROR_PARAM1 && rv < EC_ERROR_PARAM_COUNT)
+		ccprintf("Parameter %d invalid\n", rv - EC_ERROR_PARAM1 + 1);
+	else if (rv == EC_ERROR_PARAM_COUNT)
+		ccputs("Wrong number of params\n");
+	else if (rv != EC_SUCCESS)
+		ccprintf("Command returned error %d\n", rv);
+
+#ifdef CONFIG_CONSOLE_CMDHELP
+	if (cmd->argdesc)
+		ccprintf("Usage: %s %s\n", cmd->name, cmd->argdesc);
+#endif
+	return rv;
+}
+
 /**
  * Handle a line of input containing a single command.
  *
@@ -171,10 +232,8 @@ static const char *const errmsgs[] = {
  */
 static int handle_command(char *input)
 {
-	const struct console_command *cmd;
 	char *argv[MAX_ARGS_PER_COMMAND];
 	int argc = 0;
-	int rv;
 #ifdef CONFIG_EXPERIMENTAL_CONSOLE
 	char *e = NULL;
 	int i = 0;
@@ -230,41 +289,19 @@ command_has_error:
 	split_words(input, &argc, argv);
 #endif /* defined(CONFIG_EXPERIMENTAL_CONSOLE) */
 
-	/* If no command, nothing to do */
-	if (!argc)
-		return EC_SUCCESS;
-
-	cmd = find_command(argv[0]);
-	if (!cmd) {
-		ccprintf("Command '%s' not found or ambiguous.\n", argv[0]);
-		return EC_ERROR_UNKNOWN;
-	}
-
-#ifdef CONFIG_RESTRICTED_CONSOLE_COMMANDS
-	if (console_is_restricted() && cmd->flags & CMD_FLAG_RESTRICTED)
-		rv = EC_ERROR_ACCESS_DENIED;
-	else
-#endif
-	rv = cmd->handler(argc, argv);
-	if (rv == EC_SUCCESS)
-		return rv;
+	return run_command(argc, argv);
+}
 
-	/* Print more info for errors */
-	if (rv < ARRAY_SIZE(errmsgs))
-		ccprintf("%s\n", errmsgs[rv]);
-	else if (rv >= EC_ERROR_PARAM1 && rv < EC_ERROR_PARAM_COUNT)
-		ccprintf("Parameter %d invalid\n", rv - EC_ERROR_PARAM1 + 1);
-	else if (rv == EC_ERROR_PARAM_COUNT)
-		ccputs("Wrong number of params\n");
-	else if (rv != EC_SUCCESS)
-		ccprintf("Command returned error %d\n", rv);
+#ifdef CONFIG_CONSOLE_BATCH
+int console_run_command(char *input)
+{
+	char *argv[MAX_ARGS_PER_COMMAND];
+	int argc = 0;
 
-#ifdef CONFIG_CONSOLE_CMDHELP
-	if (cmd->argdesc)
-		ccprintf("Usage: %s %s\n", cmd->name, cmd->argdesc);
-#endif
-	return rv;
+	split_words(input, &argc, argv);
+	return run_command(argc, argv);
 }
+#endif
 
 static void console_init(void)
 {
@@ -528,6 +565,9 @@ static void console_handle_char(int c)
 #endif
 
 		/* Handle command */
+#ifdef CONFIG_CONSOLE_BATCH
+		if (console_batch_queue_line(input_buf) != EC_SUCCESS)
+#endif
 		handle_command(input_buf);
 
 		/* Start new line */
@@ -669,6 +709,15 @@ void console_task(void *u)
 			console_handle_char(c);
 		}
 
+#ifdef CONFIG_CONSOLE_BINLOG
+		/* Format lines logged by other tasks */
+		console_binlog_flush();
+#endif
+
+#ifdef CONFIG_CONSOLE_BATCH
+		console_batch_run();
+#endif
+
 		task_wait_event(-1);  /* Wait for more input */
 	}
 }
@@ -0,0 +1,426 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Console batch mode.
+ *
+ * A batch is a block of command lines, collected from the console ('batch
+ * start', then the lines, then 'batch run') or over the host interface
+ * (EC_CMD_CONSOLE_BATCH). The console task runs the lines back to back,
+ * capturing the command channel output of each line in a frame: a struct
+ * ec_console_batch_frame giving the size of the output and the result of the
+ * command, followed by the output.
+ *
+ * The frames of a batch run from the console are printed as they complete.
+ * Those of a batch run by the host are kept in the output buffer until the
+ * host reads them, and read space is reused as the batch runs. While the
+ * output waits for the host, the console task goes back to its other work and
+ * picks up the batch again after the next read.
+ *
+ * The host can't run a batch while the system is locked, as the batch may run
+ * any console command.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "console_batch.h"
+#include "ec_commands.h"
+#include "hooks.h"
+#include "host_command.h"
+#include "printf.h"
+#include "system.h"
+#include "task.h"
+#include "timer.h"
+#include "util.h"
+
+/* How long a batch run by the host waits for the host to read its output */
+#define READ_TIMEOUT SECOND
+/* How long the host can leave a batch it is adding lines to before running */
+#define IDLE_TIMEOUT (5 * SECOND)
+
+enum batch_state {
+	BATCH_IDLE,		/* Collecting lines */
+	BATCH_PENDING,		/* Waiting for the console task */
+	BATCH_RUNNING,
+	BATCH_DONE,
+};
+
+enum batch_owner {
+	OWNER_NONE,
+	OWNER_CONSOLE,
+	OWNER_HOST,
+};
+
+/* Command lines, separated by newlines; one byte is kept for a null */
+static char batch_in[CONFIG_CONSOLE_BATCH_BUF_SIZE];
+static int in_len;
+/* Next line to run, and number of lines run, while the batch runs */
+static int in_pos;
+static int lines_run;
+
+/*
+ * Frames. Those before out_done are complete, and read by the host from
+ * out_read on; the running command writes its frame from out_done to out_len.
+ */
+static uint8_t batch_out[CONFIG_CONSOLE_BATCH_BUF_SIZE];
+static int out_read, out_done, out_len;
+static uint8_t frame_flags;
+
+static enum batch_state state;
+static enum batch_owner owner;
+static uint8_t batch_flags;	/* EC_CONSOLE_BATCH_* */
+static int capturing;
+/* When to stop waiting for the host to read; 0 if not waiting */
+static timestamp_t read_deadline;
+
+/* Protects the above against the console and host command tasks racing */
+static struct mutex batch_lock;
+
+/*
+ * Discard the batch, if it isn't running, and collect a new one. batch_lock
+ * must be held.
+ */
+static int batch_reset(enum batch_owner new_owner)
+{
+	if (state == BATCH_PENDING || state == BATCH_RUNNING ||
+	    (state == BATCH_IDLE && owner != OWNER_NONE &&
+	     owner != new_owner))
+		return EC_ERROR_BUSY;
+
+	if (state == BATCH_DONE || owner == OWNER_NONE) {
+		state = BATCH_IDLE;
+		owner = new_owner;
+		batch_flags = 0;
+		in_len = 0;
+		out_read = out_done = out_len = 0;
+	}
+	return EC_SUCCESS;
+}
+
+/* Add lines to the batch being collected; batch_lock must be held. */
+static int batch_add(const char *lines, int len)
+{
+	if (in_len + len > sizeof(batch_in) - 1)
+		return EC_ERROR_OVERFLOW;
+
+	memcpy(batch_in + in_len, lines, len);
+	in_len += len;
+	return EC_SUCCESS;
+}
+
+/* Release a batch the host stopped adding lines to without running it. */
+static void batch_idle_timeout(void)
+{
+	mutex_lock(&batch_lock);
+	if (state == BATCH_IDLE && owner == OWNER_HOST)
+		owner = OWNER_NONE;
+	mutex_unlock(&batch_lock);
+}
+DECLARE_DEFERRED(batch_idle_timeout);
+
+int console_batch_queue_line(const char *line)
+{
+	const char *s = line;
+	int rv;
+
+	/* Let 'batch' commands through, to run the batch */
+	while (isspace(*s))
+		s++;
+	if (!strncasecmp(s, "batch", 5) && (!s[5] || isspace(s[5])))
+		return EC_ERROR_UNKNOWN;
+
+	mutex_lock(&batch_lock);
+	if (state != BATCH_IDLE || owner != OWNER_CONSOLE) {
+		mutex_unlock(&batch_lock);
+		return EC_ERROR_UNKNOWN;
+	}
+	rv = batch_add(line, strlen(line)) || batch_add("\n", 1);
+	/* The line is gone either way; the run reports it */
+	if (rv)
+		batch_flags |= EC_CONSOLE_BATCH_OVERFLOW;
+	mutex_unlock(&batch_lock);
+
+	if (rv)
+		ccputs("Batch full, line dropped\n");
+
+	return EC_SUCCESS;
+}
+
+int console_batch_capturing(void)
+{
+	return capturing && !in_interrupt_context() &&
+		task_get_current() == TASK_ID_CONSOLE;
+}
+
+static int batch_addstr(void *context, const char *s, int len)
+{
+	int n = MIN(len, sizeof(batch_out) - out_len);
+
+	memcpy(batch_out + out_len, s, n);
+	out_len += n;
+	if (n < len) {
+		frame_flags |= EC_CONSOLE_BATCH_FRAME_TRUNCATED;
+		return 1;
+	}
+	return 0;
+}
+
+int console_batch_vprintf(const char *format, va_list args)
+{
+	return vfnprintf_bulk(batch_addstr, NULL, format, args);
+}
+
+static void batch_wake(void)
+{
+	task_wake(TASK_ID_CONSOLE);
+}
+DECLARE_DEFERRED(batch_wake);
+
+/*
+ * Whether to wait for the host to read output before running the next
+ * command, so that each command gets at least half of the buffer.
+ */
+static int wait_for_read(void)
+{
+	if (out_done - out_read <= sizeof(batch_out) / 2) {
+		read_deadline.val = 0;
+		return 0;
+	}
+
+	if (!read_deadline.val) {
+		read_deadline.val = get_time().val + READ_TIMEOUT;
+		hook_call_deferred(&batch_wake_data, READ_TIMEOUT);
+	}
+
+	/* Run regardless if the host doesn't read in time */
+	if (timestamp_expired(read_deadline, NULL)) {
+		read_deadline.val = 0;
+		return 0;
+	}
+	return 1;
+}
+
+/* Make room for the frame of the next command; return 0 if there is none. */
+static int frame_start(void)
+{
+	mutex_lock(&batch_lock);
+	if (out_read) {
+		memmove(batch_out, batch_out + out_read, out_done - out_read);
+		out_done -= out_read;
+		out_read = 0;
+	}
+	mutex_unlock(&batch_lock);
+
+	if (out_done + sizeof(struct ec_console_batch_frame) >
+	    sizeof(batch_out))
+		return 0;
+
+	out_len = out_done + sizeof(struct ec_console_batch_frame);
+	frame_flags = 0;
+	return 1;
+}
+
+static void frame_end(int rv)
+{
+	struct ec_console_batch_frame f = {
+		.size = out_len - out_done - sizeof(f),
+		.flags = frame_flags,
+		.result = MIN(rv, UINT8_MAX),
+	};
+
+	memcpy(batch_out + out_done, &f, sizeof(f));
+
+	mutex_lock(&batch_lock);
+	out_done = out_len;
+	mutex_unlock(&batch_lock);
+}
+
+/* Print the frames of a batch run from the console, and drop them. */
+static void print_frames(void)
+{
+	struct ec_console_batch_frame f;
+
+	while (out_read < out_done) {
+		memcpy(&f, batch_out + out_read, sizeof(f));
+		out_read += sizeof(f);
+		ccprintf("@@ %d %d %d%s\n", lines_run++, f.result, f.size,
+			 f.flags & EC_CONSOLE_BATCH_FRAME_TRUNCATED ?
+			 " truncated" : "");
+		ccprintf("%.*s", f.size, batch_out + out_read);
+		out_read += f.size;
+		cflush();
+	}
+}
+
+void console_batch_run(void)
+{
+	char *line, *end;
+	int running, rv;
+
+	mutex_lock(&batch_lock);
+	if (state == BATCH_PENDING) {
+		state = BATCH_RUNNING;
+		batch_in[in_len] = '\0';
+		in_pos = 0;
+		lines_run = 0;
+		read_deadline.val = 0;
+	}
+	running = state == BATCH_RUNNING;
+	mutex_unlock(&batch_lock);
+
+	if (!running)
+		return;
+
+	while (in_pos < in_len) {
+		/* Come back after the host reads, or on timeout */
+		if (wait_for_read())
+			return;
+
+		line = batch_in + in_pos;
+		end = memchr(line, '\n', batch_in + in_len - line);
+		if (!end)
+			end = batch_in + in_len;
+		*end = '\0';
+		in_pos = end + 1 - batch_in;
+
+		if (!frame_start()) {
+			mutex_lock(&batch_lock);
+			batch_flags |= EC_CONSOLE_BATCH_OVERFLOW;
+			mutex_unlock(&batch_lock);
+			break;
+		}
+
+		capturing = 1;
+		rv = console_run_command(line);
+		capturing = 0;
+
+		frame_end(rv);
+		if (owner == OWNER_CONSOLE)
+			print_frames();
+	}
+
+	if (owner == OWNER_CONSOLE && (batch_flags & EC_CONSOLE_BATCH_OVERFLOW))
+		ccputs("@@ overflow, some lines were not run\n");
+
+	mutex_lock(&batch_lock);
+	in_len = 0;
+	state = BATCH_DONE;
+	if (owner == OWNER_CONSOLE)
+		owner = OWNER_NONE;
+	mutex_unlock(&batch_lock);
+}
+
+/*****************************************************************************/
+/* Console commands */
+
+static int command_batch(int argc, char **argv)
+{
+	int rv;
+
+	if (argc != 2)
+		return EC_ERROR_PARAM_COUNT;
+
+	if (!strcasecmp(argv[1], "start")) {
+		mutex_lock(&batch_lock);
+		rv = batch_reset(OWNER_CONSOLE);
+		mutex_unlock(&batch_lock);
+		if (rv == EC_SUCCESS)
+			ccputs("Collecting lines, 'batch run' to run them\n");
+		return rv;
+	}
+
+	mutex_lock(&batch_lock);
+	if (state != BATCH_IDLE || owner != OWNER_CONSOLE) {
+		rv = EC_ERROR_BUSY;
+	} else if (!strcasecmp(argv[1], "run")) {
+		/* The console task runs the batch once we return */
+		state = BATCH_PENDING;
+		rv = EC_SUCCESS;
+	} else if (!strcasecmp(argv[1], "abort")) {
+		owner = OWNER_NONE;
+		rv = EC_SUCCESS;
+	} else {
+		rv = EC_ERROR_PARAM1;
+	}
+	mutex_unlock(&batch_lock);
+
+	return rv;
+}
+DECLARE_CONSOLE_COMMAND(batch, command_batch,
+			"start | run | abort",
+			"Collect command lines, then run them with framed output");
+
+/*****************************************************************************/
+/* Host commands */
+
+static enum ec_status
+host_command_console_batch(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_console_batch *p = args->params;
+	struct ec_response_console_batch *r = args->response;
+	const int len = args->params_size - sizeof(*p);
+	int n, running, rv;
+
+	if (args->params_size < sizeof(*p))
+		return EC_RES_INVALID_PARAM;
+
+	switch (p->subcmd) {
+	case CONSOLE_BATCH_ADD:
+	case CONSOLE_BATCH_RUN:
+		if (system_is_locked())
+			return EC_RES_ACCESS_DENIED;
+
+		mutex_lock(&batch_lock);
+		if (batch_reset(OWNER_HOST))
+			rv = EC_RES_BUSY;
+		else if (batch_add(p->commands, len))
+			rv = EC_RES_OVERFLOW;
+		else
+			rv = EC_RES_SUCCESS;
+		if (!rv && p->subcmd == CONSOLE_BATCH_RUN)
+			state = BATCH_PENDING;
+		mutex_unlock(&batch_lock);
+
+		if (rv)
+			return rv;
+		if (p->subcmd == CONSOLE_BATCH_RUN)
+			task_wake(TASK_ID_CONSOLE);
+		else
+			hook_call_deferred(&batch_idle_timeout_data,
+					   IDLE_TIMEOUT);
+		return EC_RES_SUCCESS;
+
+	case CONSOLE_BATCH_READ:
+		if (args->response_max < sizeof(*r))
+			return EC_RES_RESPONSE_TOO_BIG;
+
+		mutex_lock(&batch_lock);
+		if (owner != OWNER_HOST) {
+			mutex_unlock(&batch_lock);
+			return EC_RES_ACCESS_DENIED;
+		}
+		n = MIN(out_done - out_read,
+			args->response_max - (int)sizeof(*r));
+		memcpy(r->data, batch_out + out_read, n);
+		out_read += n;
+		r->flags = batch_flags;
+		if (state == BATCH_DONE && out_read == out_done)
+			r->flags |= EC_CONSOLE_BATCH_DONE;
+		running = state == BATCH_RUNNING;
+		mutex_unlock(&batch_lock);
+
+		/* The batch may be waiting for this read */
+		if (n && running)
+			task_wake(TASK_ID_CONSOLE);
+
+		args->response_size = sizeof(*r) + n;
+		return EC_RES_SUCCESS;
+	}
+
+	return EC_RES_INVALID_PARAM;
+}
+DECLARE_HOST_COMMAND(EC_CMD_CONSOLE_BATCH,
+		     host_command_console_batch,
+		     EC_VER_MASK(0));
@@ -0,0 +1,695 @@
+/* Copyright 2020 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Deferred (binary) console logging.
+ *
+ * Instead of running vfnprintf() in the caller's context, cprintf() and
+ * friends store a compact record in a ring of 32-bit words:
+ *
+ *   word 0       header: record length in words, channel and flags
+ *   word 1       offset of the format string from binlog_fmt_base
+ *   [word 2-3]   timestamp, for cprints()
+ *   ...          raw arguments, in the order the format consumes them
+ *
+ * Only formats in read-only data are stored this way; callers which print
+ * from a buffer are formatted directly.
+ *
+ * The console task formats pending records later. Formatted records are kept
+ * in the ring as history, until new records need the space. The history can
+ * be dumped with the 'binlog' console command, and decoded on the host by
+ * util/ec_binlog_decode with the help of the EC image's symbol table.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "console_binlog.h"
+#include "link_defs.h"
+#include "printf.h"
+#include "task.h"
+#include "timer.h"
+#include "uart.h"
+#include "usb_console.h"
+#include "util.h"
+
+/* Maximum chars in a single format field; matches vfnprintf() */
+#define MAX_FORMAT 1024
+
+/* Ring of words; counters are free-running and masked on access */
+#define RING_WORDS (CONFIG_CONSOLE_BINLOG_BUF_SIZE / sizeof(uint32_t))
+#define RING_MASK (RING_WORDS - 1)
+BUILD_ASSERT(POWER_OF_TWO(RING_WORDS));
+
+/* Largest record, in words. Records are built on the caller's stack. */
+#define RECORD_MAX_WORDS 32
+BUILD_ASSERT(RECORD_MAX_WORDS < RING_WORDS);
+
+/*
+ * Longest conversion we store, e.g. "%-+0255.255llx". Each '*' expands to at
+ * most 4 digits when the conversion is rebuilt for formatting.
+ */
+#define SPEC_MAX_LEN 16
+
+/* Record header */
+#define HDR_WORDS(h)		((h) & 0xff)
+#define HDR_CHANNEL(h)		(((h) >> 8) & 0xff)
+#define HDR_FLAGS(h)		(((h) >> 16) & 0xff)
+#define HDR(words, chan, flags)	((words) | ((chan) << 8) | ((flags) << 16))
+
+/* Argument types, as found by parse_conversion() */
+enum arg_type {
+	ARG_NONE,	/* "%%" */
+	ARG_INT,	/* 32-bit integer or character */
+	ARG_INT64,	/* 64-bit integer */
+	ARG_STR,	/* string; stored as length and bytes */
+	ARG_TIME,	/* %pT; stored as 64-bit value */
+	ARG_HEX,	/* %ph; stored as length and bytes */
+	ARG_PTR,	/* %pP; stored as 64-bit value */
+	ARG_BIN,	/* %pb; stored as value and count */
+};
+
+struct conversion {
+	/* Points past the conversion in the format string */
+	const char *end;
+	enum arg_type type;
+	/* Number of '*' width/precision arguments */
+	int stars;
+	/* Whether the last '*' is the precision */
+	int precision_star;
+	/* Precision, if given as digits; -1 otherwise */
+	int precision;
+};
+
+/* Format strings are stored as an offset from this symbol */
+const char binlog_fmt_base[] = "";
+
+static uint32_t ring[RING_WORDS];
+
+/*
+ * "head" is the oldest record kept as history, "fmt" the next record to be
+ * formatted, "tail" the end of the last record. Records between "fmt" and
+ * "tail" are pending, and records between "busy" and "fmt" are being
+ * formatted. Neither are ever overwritten: callers format directly when there
+ * is no room for them.
+ */
+static uint32_t head;
+static uint32_t busy;
+static uint32_t fmt;
+static uint32_t tail;
+
+/* Number of contexts formatting records; interrupts may nest */
+static int formatters;
+/* Set once the console task has been woken for pending records */
+static int wake_pending;
+
+/* Statistics */
+static uint32_t records;
+static uint32_t overflows;
+static uint32_t fallbacks;
+
+/**
+ * Parse a conversion the way vfnprintf() does.
+ *
+ * @param format	Format string, just past the '%'
+ * @param c		Output: conversion found
+ * @return EC_SUCCESS, or EC_ERROR_UNIMPLEMENTED if the conversion can't be
+ *	   stored (the caller should format directly instead).
+ */
+static int parse_conversion(const char *format, struct conversion *c)
+{
+	int ch = *format++;
+
+	c->type = ARG_INT;
+	c->stars = 0;
+	c->precision_star = 0;
+	c->precision = -1;
+
+	if (ch == '%') {
+		c->type = ARG_NONE;
+		c->end = format;
+		return EC_SUCCESS;
+	}
+	if (ch == 'c') {
+		c->end = format;
+		return EC_SUCCESS;
+	}
+
+	if (ch == '-')
+		ch = *format++;
+	if (ch == '+')
+		ch = *format++;
+	if (ch == '0')
+		ch = *format++;
+
+	if (ch == '*') {
+		c->stars++;
+		ch = *format++;
+	} else {
+		while (ch >= '0' && ch <= '9')
+			ch = *format++;
+	}
+
+	if (ch == '.') {
+		ch = *format++;
+		if (ch == '*') {
+			c->stars++;
+			c->precision_star = 1;
+			ch = *format++;
+		} else {
+			c->precision = 0;
+			while (ch >= '0' && ch <= '9') {
+				c->precision = 10 * c->precision + ch - '0';
+				ch = *format++;
+			}
+		}
+	}
+
+	if (ch == 's') {
+		c->type = ARG_STR;
+		c->end = format;
+		return EC_SUCCESS;
+	}
+
+	if (ch == 'l') {
+		ch = *format++;
+		if (ch == 'l') {
+			c->type = ARG_INT64;
+			ch = *format++;
+		} else if (sizeof(long) == sizeof(uint64_t)) {
+			c->type = ARG_INT64;
+		} else {
+			/* Deprecated %l; let vfnprintf() report it */
+			return EC_ERROR_UNIMPLEMENTED;
+		}
+	} else if (ch == 'z') {
+		if (sizeof(size_t) == sizeof(uint64_t))
+			c->type = ARG_INT64;
+		ch = *format++;
+	}
+
+	if (ch == 'p') {
+		ch = *format++;
+		if (ch == 'T')
+			c->type = ARG_TIME;
+		else if (ch == 'h')
+			c->type = ARG_HEX;
+		else if (ch == 'P')
+			c->type = ARG_PTR;
+		else if (ch == 'b')
+			c->type = ARG_BIN;
+		else
+			return EC_ERROR_UNIMPLEMENTED;
+		c->end = format;
+		return EC_SUCCESS;
+	}
+
+	switch (ch) {
+#ifdef CONFIG_PRINTF_LEGACY_LI_FORMAT
+	case 'i':
+#endif
+	case 'd':
+	case 'u':
+	case 'x':
+	case 'X':
+		c->end = format;
+		return EC_SUCCESS;
+	default:
+		return EC_ERROR_UNIMPLEMENTED;
+	}
+}
+
+/* Find the next '%' in a format string, or NULL if there is none. */
+static const char *next_conversion(const char *format)
+{
+	for (; *format; format++) {
+		if (*format == '%')
+			return format;
+	}
+	return NULL;
+}
+
+/* Record under construction */
+struct record {
+	uint32_t w[RECORD_MAX_WORDS];
+	int len;
+};
+
+static int put_word(struct record *r, uint32_t v)
+{
+	if (r->len >= RECORD_MAX_WORDS)
+		return EC_ERROR_OVERFLOW;
+	r->w[r->len++] = v;
+	return EC_SUCCESS;
+}
+
+static int put_u64(struct record *r, uint64_t v)
+{
+	if (put_word(r, (uint32_t)v))
+		return EC_ERROR_OVERFLOW;
+	return put_word(r, (uint32_t)(v >> 32));
+}
+
+/* Store a length word followed by the bytes, padded to a word. */
+static int put_bytes(struct record *r, const void *data, int len)
+{
+	int words = DIV_ROUND_UP(len, sizeof(uint32_t));
+
+	if (r->len + 1 + words > RECORD_MAX_WORDS)
+		return EC_ERROR_OVERFLOW;
+	r->w[r->len++] = len;
+	if (words)
+		r->w[r->len + words - 1] = 0;
+	memcpy(&r->w[r->len], data, len);
+	r->len += words;
+	return EC_SUCCESS;
+}
+
+/* Store a string, limited to precision characters if precision >= 0. */
+static int put_string(struct record *r, const char *s, int precision)
+{
+	int room = (RECORD_MAX_WORDS - r->len - 1) * sizeof(uint32_t);
+	int len;
+
+	if (s == NULL)
+		s = "(NULL)";
+	if (precision >= 0 && precision <= room)
+		len = strnlen(s, precision);
+	else if ((len = strnlen(s, room + 1)) > room)
+		return EC_ERROR_OVERFLOW;
+	return put_bytes(r, s, len);
+}
+
+/**
+ * Build a record for a format and its arguments.
+ *
+ * @return EC_SUCCESS, or an error if the line should be formatted directly.
+ */
+static int build_record(struct record *r, enum console_channel channel,
+			int flags, const char *format, va_list args)
+{
+	intptr_t offset = (uintptr_t)format - (uintptr_t)binlog_fmt_base;
+	struct conversion c;
+
+	/*
+	 * Only a format in read-only data is still there when the record is
+	 * formatted; some callers print a buffer they reuse.
+	 */
+	if (format < __rodata_start || format >= __rodata_end ||
+	    offset != (int32_t)offset)
+		return EC_ERROR_UNIMPLEMENTED;
+
+	r->len = 2;
+	r->w[1] = offset;
+	if (flags & CONSOLE_BINLOG_TIMESTAMP)
+		put_u64(r, get_time().val);
+
+	while ((format = next_conversion(format)) != NULL) {
+		int precision;
+		int i;
+
+		if (parse_conversion(format + 1, &c) ||
+		    c.end - format > SPEC_MAX_LEN)
+			return EC_ERROR_UNIMPLEMENTED;
+		format = c.end;
+
+		precision = c.precision;
+		for (i = 0; i < c.stars; i++) {
+			int v = va_arg(args, int);
+
+			if (v < 0 || v > MAX_FORMAT)
+				return EC_ERROR_UNIMPLEMENTED;
+			if (c.precision_star && i == c.stars - 1)
+				precision = v;
+			if (put_word(r, v))
+				return EC_ERROR_OVERFLOW;
+		}
+
+		switch (c.type) {
+		case ARG_NONE:
+			break;
+		case ARG_INT:
+			if (put_word(r, va_arg(args, uint32_t)))
+				return EC_ERROR_OVERFLOW;
+			break;
+		case ARG_INT64:
+			if (put_u64(r, va_arg(args, uint64_t)))
+				return EC_ERROR_OVERFLOW;
+			break;
+		case ARG_STR:
+			if (put_string(r, va_arg(args, const char *),
+				       precision))
+				return EC_ERROR_OVERFLOW;
+			break;
+		case ARG_TIME: {
+			const uint64_t *t = va_arg(args, const uint64_t *);
+
+			if (put_u64(r, t == PRINTF_TIMESTAMP_NOW ?
+					 get_time().val : *t))
+				return EC_ERROR_OVERFLOW;
+			break;
+		}
+		case ARG_HEX: {
+			const struct hex_buffer_params *hex =
+				va_arg(args, const struct hex_buffer_params *);
+
+			if (hex == NULL ||
+			    put_bytes(r, hex->buffer, hex->size))
+				return EC_ERROR_UNIMPLEMENTED;
+			break;
+		}
+		case ARG_PTR:
+			if (put_u64(r, (uintptr_t)va_arg(args, void *)))
+				return EC_ERROR_OVERFLOW;
+			break;
+		case ARG_BIN: {
+			const struct binary_print_params *bin =
+				va_arg(args, const struct binary_print_params *);
+
+			if (bin == NULL || put_word(r, bin->value) ||
+			    put_word(r, bin->count))
+				return EC_ERROR_UNIMPLEMENTED;
+			break;
+		}
+		}
+	}
+
+	r->w[0] = HDR(r->len, channel, flags);
+	return EC_SUCCESS;
+}
+
+/**
+ * Append a record to the ring, dropping history as needed.
+ *
+ * @param r		Record to add
+ * @param wake		Output: whether the console task needs a wake
+ * @return EC_SUCCESS, or EC_ERROR_OVERFLOW if there is no room.
+ */
+static int ring_add(const struct record *r, int *wake)
+{
+	int i;
+
+	/* --- critical section : reserve and fill queue space --- */
+	interrupt_disable();
+	if (RING_WORDS - (tail - busy) < r->len) {
+		overflows++;
+		interrupt_enable();
+		return EC_ERROR_OVERFLOW;
+	}
+	while (RING_WORDS - (tail - head) < r->len)
+		head += HDR_WORDS(ring[head & RING_MASK]);
+	for (i = 0; i < r->len; i++)
+		ring[(tail + i) & RING_MASK] = r->w[i];
+	tail += r->len;
+	records++;
+	*wake = !wake_pending;
+	wake_pending = 1;
+	interrupt_enable();
+	/* --- end of critical section --- */
+
+	return EC_SUCCESS;
+}
+
+/* Set when output of the record being formatted didn't fit */
+static int emit_overflow;
+
+/* Like cprintf(), without the channel filter. */
+static int __attribute__((__format__(__printf__, 1, 2)))
+emit(const char *format, ...)
+{
+	int rv1, rv2;
+	va_list args;
+
+	usb_va_start(args, format);
+	rv1 = usb_vprintf(format, args);
+	usb_va_end(args);
+
+	va_start(args, format);
+	rv2 = uart_vprintf(format, args);
+	va_end(args);
+
+	if (rv1 == EC_ERROR_OVERFLOW || rv2 == EC_ERROR_OVERFLOW)
+		emit_overflow = 1;
+
+	return rv1 == EC_SUCCESS ? rv2 : rv1;
+}
+
+static void emit_literal(const char *s, int len)
+{
+	while (len > 0) {
+		int n = MIN(len, MAX_FORMAT);
+
+		emit("%.*s", n, s);
+		s += n;
+		len -= n;
+	}
+}
+
+static uint64_t ring_u64(uint32_t pos)
+{
+	return ring[pos & RING_MASK] |
+		(uint64_t)ring[(pos + 1) & RING_MASK] << 32;
+}
+
+/* Copy a length-prefixed byte argument out of the ring. */
+static int ring_bytes(uint32_t pos, char *buf)
+{
+	int len = ring[pos & RING_MASK];
+	int i;
+
+	for (i = 0; i < len; i += sizeof(uint32_t)) {
+		uint32_t w = ring[(pos + 1 + i / sizeof(uint32_t)) & RING_MASK];
+
+		memcpy(buf + i, &w, sizeof(w));
+	}
+	buf[len] = '\0';
+	return len;
+}
+
+/* Format the record at "pos". */
+static void format_record(uint32_t pos)
+{
+	const uint32_t hdr = ring[pos & RING_MASK];
+	const char *format = binlog_fmt_base + (int32_t)ring[(pos + 1) &
+							      RING_MASK];
+	char buf[RECORD_MAX_WORDS * sizeof(uint32_t) + 1];
+	char spec[SPEC_MAX_LEN + 2 * 3 + 1];
+	struct conversion c;
+	const char *next;
+
+	emit_overflow = 0;
+	pos += 2;
+	if (HDR_FLAGS(hdr) & CONSOLE_BINLOG_TIMESTAMP) {
+		uint64_t t = ring_u64(pos);
+
+		emit("[%pT ", &t);
+		pos += 2;
+	}
+
+	while ((next = next_conversion(format)) != NULL) {
+		const char *p;
+		int n = 0;
+
+		emit_literal(format, next - format);
+		/* Recorded records only hold conversions we can parse */
+		parse_conversion(next + 1, &c);
+		format = c.end;
+
+		/* Rebuild the conversion, with '*' replaced by its value */
+		for (p = next; p < c.end; p++) {
+			if (*p == '*')
+				n += snprintf(spec + n, sizeof(spec) - n, "%d",
+					      (int)ring[pos++ & RING_MASK]);
+			else
+				spec[n++] = *p;
+		}
+		spec[n] = '\0';
+
+		switch (c.type) {
+		case ARG_NONE:
+			emit("%%");
+			break;
+		case ARG_INT:
+			emit(spec, ring[pos & RING_MASK]);
+			pos++;
+			break;
+		case ARG_INT64:
+			emit(spec, ring_u64(pos));
+			pos += 2;
+			break;
+		case ARG_STR:
+			n = ring_bytes(pos, buf);
+			emit(spec, buf);
+			pos += 1 + DIV_ROUND_UP(n, sizeof(uint32_t));
+			break;
+		case ARG_TIME: {
+			uint64_t t = ring_u64(pos);
+
+			emit(spec, &t);
+			pos += 2;
+			break;
+		}
+		case ARG_HEX:
+			n = ring_bytes(pos, buf);
+			emit(spec, HEX_BUF(buf, n));
+			pos += 1 + DIV_ROUND_UP(n, sizeof(uint32_t));
+			break;
+		case ARG_PTR:
+			emit(spec, (void *)(uintptr_t)ring_u64(pos));
+			pos += 2;
+			break;
+		case ARG_BIN:
+			emit(spec, BINARY_VALUE(ring[pos & RING_MASK],
+						ring[(pos + 1) & RING_MASK]));
+			pos += 2;
+			break;
+		}
+	}
+	emit_literal(format, strlen(format));
+
+	if (HDR_FLAGS(hdr) & CONSOLE_BINLOG_TIMESTAMP)
+		emit("]\n");
+
+#ifdef CONFIG_CONSOLE_CHANNEL_RATE_LIMIT
+	if (emit_overflow)
+		console_channel_dropped(HDR_CHANNEL(hdr));
+#endif
+}
+
+void console_binlog_flush(void)
+{
+	uint32_t pos;
+
+	while (1) {
+		/* --- critical section : claim the next pending record --- */
+		interrupt_disable();
+		if (fmt == tail) {
+			wake_pending = 0;
+			interrupt_enable();
+			return;
+		}
+		pos = fmt;
+		fmt += HDR_WORDS(ring[pos & RING_MASK]);
+		formatters++;
+		interrupt_enable();
+		/* --- end of critical section --- */
+
+		/*
+		 * Claimed records aren't overwritten, so no lock here. A
+		 * context which interrupts us formats the records after this
+		 * one before printing its own output, so records stay in order.
+		 */
+		format_record(pos);
+
+		interrupt_disable();
+		if (--formatters == 0)
+			busy = fmt;
+		interrupt_enable();
+	}
+}
+
+/* Whether the caller should format directly, as without the binary log. */
+static int format_directly(void)
+{
+	return !task_start_called() ||
+		(!in_interrupt_context() &&
+		 task_get_current() == TASK_ID_CONSOLE);
+}
+
+int console_binlog_vprintf(enum console_channel channel, int flags,
+			   const char *format, va_list args)
+{
+	struct record r;
+	int wake;
+
+	if (format_directly()) {
+		/* Keep the output in order */
+		console_binlog_flush();
+		return EC_ERROR_UNIMPLEMENTED;
+	}
+
+	if (build_record(&r, channel, flags, format, args) ||
+	    ring_add(&r, &wake)) {
+		fallbacks++;
+		console_binlog_flush();
+		return EC_ERROR_UNIMPLEMENTED;
+	}
+
+	if (wake)
+		task_wake(TASK_ID_CONSOLE);
+	return EC_SUCCESS;
+}
+
+int console_binlog_printf(enum console_channel channel, int flags,
+			  const char *format, ...)
+{
+	va_list args;
+	int rv;
+
+	va_start(args, format);
+	rv = console_binlog_vprintf(channel, flags, format, args);
+	va_end(args);
+
+	return rv;
+}
+
+/*****************************************************************************/
+/* Console commands */
+
+static int command_binlog(int argc, char **argv)
+{
+	uint32_t rec[RECORD_MAX_WORDS];
+	uint32_t pos, end, words, i;
+
+	if (argc < 2) {
+		ccprintf("size:     %d words\n", (int)RING_WORDS);
+		ccprintf("used:     %d words\n", tail - head);
+		ccprintf("pending:  %d words\n", tail - fmt);
+		ccprintf("records:  %d\n", records);
+		ccprintf("overflow: %d\n", overflows);
+		ccprintf("direct:   %d\n", fallbacks);
+		ccprintf("fmt_base: %pP\n", binlog_fmt_base);
+		return EC_SUCCESS;
+	}
+
+	if (strcasecmp(argv[1], "dump"))
+		return EC_ERROR_PARAM1;
+
+	/*
+	 * One record per line, as hex words, up to the end seen now. Writers
+	 * overwrite the oldest records while we print, so each record is
+	 * copied out under the lock, and the dump stops once the next one has
+	 * been overwritten.
+	 */
+	console_binlog_flush();
+	interrupt_disable();
+	pos = head;
+	end = tail;
+	interrupt_enable();
+	while (pos != end) {
+		interrupt_disable();
+		words = HDR_WORDS(ring[pos & RING_MASK]);
+		if ((int32_t)(pos - head) < 0 || !words ||
+		    words > RECORD_MAX_WORDS ||
+		    (int32_t)(end - pos - words) < 0) {
+			interrupt_enable();
+			ccputs("binlog: overwritten\n");
+			break;
+		}
+		for (i = 0; i < words; i++)
+			rec[i] = ring[(pos + i) & RING_MASK];
+		interrupt_enable();
+
+		ccputs("binlog:");
+		for (i = 0; i < words; i++)
+			ccprintf(" %08x", rec[i]);
+		ccputs("\n");
+		cflush();
+		pos += words;
+	}
+	return EC_SUCCESS;
+}
+DECLARE_SAFE_CONSOLE_COMMAND(binlog, command_binlog,
+			     "[dump]",
+			     "Print or dump the binary console log");
@@ -5,7 +5,13 @@
 
 /* Console output module for Chrome EC */
 
+#include "atomic.h"
 #include "console.h"
+#include "console_batch.h"
+#include "console_binlog.h"
+#include "host_command.h"
+#include "task.h"
+#include "timer.h"
 #include "uart.h"
 #include "usb_console.h"
 #include "util.h"
@@ -37,18 +43,125 @@ BUILD_ASSERT(ARRAY_SIZE(channel_names) == CC_CHANNEL_COUNT);
 BUILD_ASSERT(CC_CHANNEL_COUNT <= 8*sizeof(uint32_t));
 #endif /* CONFIG_CONSOLE_CHANNEL */
 
+#ifdef CONFIG_CONSOLE_CHANNEL_RATE_LIMIT
+/*
+ * Token bucket and line counters of a channel.
+ *
+ * Rather than counting tokens, the bucket keeps the time at which it will be
+ * full again, so it never needs refilling: at time t it holds
+ * burst - (full_at - t) / interval tokens, and a line moves full_at one
+ * interval later.
+ *
+ * A line may be output by several calls: only its first piece takes a
+ * token, and the rest of the line goes the same way as that piece.
+ */
+struct channel_stats {
+	uint64_t full_at;	/* Time the bucket is full again */
+	uint16_t rate;		/* Lines per second, 0 if not limited */
+	uint16_t burst;		/* Bucket size, in lines */
+	uint8_t in_line;	/* Last output didn't end the line */
+	uint8_t line_ok;	/* Current line is within the limit */
+	uint32_t suppressed;	/* Lines over the rate limit */
+	uint32_t dropped;	/* Lines lost to a full output buffer */
+};
+
+static struct channel_stats channel_stats[CC_CHANNEL_COUNT] = {
+	[0 ... (CC_CHANNEL_COUNT - 1)] = {
+		.rate = CONFIG_CONSOLE_CHANNEL_RATE_LIMIT,
+		.burst = CONFIG_CONSOLE_CHANNEL_RATE_BURST,
+	},
+};
+BUILD_ASSERT(CONFIG_CONSOLE_CHANNEL_RATE_BURST > 0);
+
+/* Return non-zero if the output ends with a newline. */
+static int ends_line(const char *s)
+{
+	int len = strlen(s);
+
+	return len && s[len - 1] == '\n';
+}
+
+/*
+ * Take a token for a line on the channel; return 0 if there is none left.
+ *
+ * "whole_line" is set for output which is a line of its own, and "ends_line"
+ * when the output ends with a newline.
+ */
+static int channel_rate_ok(enum console_channel channel, int whole_line,
+			   int ends_line)
+{
+	struct channel_stats *s = &channel_stats[channel];
+	uint64_t now, interval;
+	int ok;
+
+	/* Command output is what was asked for, so is never limited */
+	if (!s->rate || channel == CC_COMMAND)
+		return 1;
+
+	interval = SECOND / s->rate;
+	now = get_time().val;
+
+	interrupt_disable();
+	if (s->in_line && !whole_line) {
+		/* Rest of a line */
+		ok = s->line_ok;
+	} else {
+		if (s->full_at < now)
+			s->full_at = now;
+		ok = s->full_at - now <= (s->burst - 1) * interval;
+		if (ok)
+			s->full_at += interval;
+		else
+			s->suppressed++;
+	}
+	s->in_line = !ends_line;
+	s->line_ok = ok;
+	interrupt_enable();
+	/* --- end of critical section --- */
+
+	return ok;
+}
+
+void console_channel_dropped(enum console_channel channel)
+{
+	deprecated_atomic_add(&channel_stats[channel].dropped, 1);
+}
+#endif /* CONFIG_CONSOLE_CHANNEL_RATE_LIMIT */
+
 /*****************************************************************************/
 /* Channel-based console output */
 
-int cputs(enum console_channel channel, const char *outstr)
+/*
+ * Return 1 if output to the channel is enabled and within its rate limit.
+ * "text" is the string or format being output, or NULL for a whole line.
+ */
+static int channel_active(enum console_channel channel, const char *text)
 {
-	int rv1, rv2;
-
 #ifdef CONFIG_CONSOLE_CHANNEL
-	/* Filter out inactive channels */
 	if (!(CC_MASK(channel) & channel_mask))
-		return EC_SUCCESS;
+		return 0;
+#endif
+#ifdef CONFIG_CONSOLE_CHANNEL_RATE_LIMIT
+	if (!channel_rate_ok(channel, !text, !text || ends_line(text)))
+		return 0;
 #endif
+	return 1;
+}
+
+/* Account for a line that didn't fit in the output buffer. */
+static int check_dropped(enum console_channel channel, int rv)
+{
+#ifdef CONFIG_CONSOLE_CHANNEL_RATE_LIMIT
+	if (rv == EC_ERROR_OVERFLOW)
+		console_channel_dropped(channel);
+#endif
+	return rv;
+}
+
+/* Output to all consoles, bypassing the channel filter and binary log. */
+static int __cputs(const char *outstr)
+{
+	int rv1, rv2;
 
 	rv1 = usb_puts(outstr);
 	rv2 = uart_puts(outstr);
@@ -56,14 +169,80 @@ int cputs(enum console_channel channel, const char *outstr)
 	return rv1 == EC_SUCCESS ? rv2 : rv1;
 }
 
+static int __attribute__((__format__(__printf__, 1, 2)))
+__cprintf(const char *format, ...)
+{
+	int rv1, rv2;
+	va_list args;
+
+	usb_va_start(args, format);
+	rv1 = usb_vprintf(format, args);
+	usb_va_end(args);
+
+	va_start(args, format);
+	rv2 = uart_vprintf(format, args);
+	va_end(args);
+
+	return rv1 == EC_SUCCESS ? rv2 : rv1;
+}
+
+#ifdef CONFIG_CONSOLE_BATCH
+static int __attribute__((__format__(__printf__, 1, 2)))
+batch_printf(const char *format, ...)
+{
+	va_list args;
+	int rv;
+
+	va_start(args, format);
+	rv = console_batch_vprintf(format, args);
+	va_end(args);
+
+	return rv;
+}
+#endif
+
+int cputs(enum console_channel channel, const char *outstr)
+{
+	/* Filter out inactive and rate limited channels */
+	if (!channel_active(channel, outstr))
+		return EC_SUCCESS;
+
+#ifdef CONFIG_CONSOLE_BATCH
+	if (channel == CC_COMMAND && console_batch_capturing())
+		return batch_printf("%s", outstr);
+#endif
+
+#ifdef CONFIG_CONSOLE_BINLOG
+	if (console_binlog_printf(channel, 0, "%s", outstr) == EC_SUCCESS)
+		return EC_SUCCESS;
+#endif
+
+	return check_dropped(channel, __cputs(outstr));
+}
+
 int cprintf(enum console_channel channel, const char *format, ...)
 {
 	int rv1, rv2;
 	va_list args;
 
-#ifdef CONFIG_CONSOLE_CHANNEL
-	/* Filter out inactive channels */
-	if (!(CC_MASK(channel) & channel_mask))
+	/* Filter out inactive and rate limited channels */
+	if (!channel_active(channel, format))
+		return EC_SUCCESS;
+
+#ifdef CONFIG_CONSOLE_BATCH
+	if (channel == CC_COMMAND && console_batch_capturing()) {
+		va_start(args, format);
+		rv1 = console_batch_vprintf(format, args);
+		va_end(args);
+		return rv1;
+	}
+#endif
+
+#ifdef CONFIG_CONSOLE_BINLOG
+	va_start(args, format);
+	rv1 = console_binlog_vprintf(channel, 0, format, args);
+	va_end(args);
+	if (rv1 == EC_SUCCESS)
 		return EC_SUCCESS;
 #endif
 
@@ -75,7 +254,7 @@ int cprintf(enum console_channel channel, const char *format, ...)
 	rv2 = uart_vprintf(format, args);
 	va_end(args);
 
-	return rv1 == EC_SUCCESS ? rv2 : rv1;
+	return check_dropped(channel, rv1 == EC_SUCCESS ? rv2 : rv1);
 }
 
 int cprints(enum console_channel channel, const char *format, ...)
@@ -83,13 +262,31 @@ int cprints(enum console_channel channel, const char *format, ...)
 	int r, rv;
 	va_list args;
 
-#ifdef CONFIG_CONSOLE_CHANNEL
-	/* Filter out inactive channels */
-	if (!(CC_MASK(channel) & channel_mask))
+	/* Filter out inactive and rate limited channels */
+	if (!channel_active(channel, NULL))
+		return EC_SUCCESS;
+
+#ifdef CONFIG_CONSOLE_BATCH
+	if (channel == CC_COMMAND && console_batch_capturing()) {
+		batch_printf("[%pT ", PRINTF_TIMESTAMP_NOW);
+		va_start(args, format);
+		rv = console_batch_vprintf(format, args);
+		va_end(args);
+		r = batch_printf("]\n");
+		return r ? r : rv;
+	}
+#endif
+
+#ifdef CONFIG_CONSOLE_BINLOG
+	va_start(args, format);
+	rv = console_binlog_vprintf(channel, CONSOLE_BINLOG_TIMESTAMP, format,
+				    args);
+	va_end(args);
+	if (rv == EC_SUCCESS)
 		return EC_SUCCESS;
 #endif
 
-	rv = cprintf(channel, "[%pT ", PRINTF_TIMESTAMP_NOW);
+	rv = __cprintf("[%pT ", PRINTF_TIMESTAMP_NOW);
 
 	va_start(args, format);
 	r = uart_vprintf(format, args);
@@ -103,12 +300,15 @@ int cprints(enum console_channel channel, const char *format, ...)
 		rv = r;
 	usb_va_end(args);
 
-	r = cputs(channel, "]\n");
-	return r ? r : rv;
+	r = __cputs("]\n");
+	return check_dropped(channel, r ? r : rv);
 }
 
 void cflush(void)
 {
+#ifdef CONFIG_CONSOLE_BINLOG
+	console_binlog_flush();
+#endif
 	uart_flush_output();
 }
 
@@ -116,12 +316,70 @@ void cflush(void)
 /* Console commands */
 
 #ifdef CONFIG_CONSOLE_CHANNEL
+#ifdef CONFIG_CONSOLE_CHANNEL_RATE_LIMIT
+/* Find a channel by name or number; return -1 if there is none. */
+static int find_channel(const char *name)
+{
+	char *e;
+	int i;
+
+	for (i = 0; i < CC_CHANNEL_COUNT; i++)
+		if (strcasecmp(name, channel_names[i]) == 0)
+			return i;
+
+	i = strtoi(name, &e, 0);
+	if (*e || i < 0 || i >= CC_CHANNEL_COUNT)
+		return -1;
+	return i;
+}
+
+/* Set the rate limit of a channel */
+static int command_ch_rate(int argc, char **argv)
+{
+	struct channel_stats *s;
+	int channel, rate, burst;
+	char *e;
+
+	if (argc < 4 || argc > 5)
+		return EC_ERROR_PARAM_COUNT;
+
+	channel = find_channel(argv[2]);
+	if (channel < 0 || channel == CC_COMMAND)
+		return EC_ERROR_PARAM2;
+
+	rate = strtoi(argv[3], &e, 0);
+	if (*e || rate < 0 || rate > UINT16_MAX)
+		return EC_ERROR_PARAM3;
+
+	burst = CONFIG_CONSOLE_CHANNEL_RATE_BURST;
+	if (argc == 5) {
+		burst = strtoi(argv[4], &e, 0);
+		if (*e || burst < 1 || burst > UINT16_MAX)
+			return EC_ERROR_PARAM4;
+	}
+
+	s = &channel_stats[channel];
+	interrupt_disable();
+	s->rate = rate;
+	s->burst = burst;
+	s->full_at = 0;
+	interrupt_enable();
+
+	return EC_SUCCESS;
+}
+#endif /* CONFIG_CONSOLE_CHANNEL_RATE_LIMIT */
+
 /* Set active channels */
 static int command_ch(int argc, char **argv)
 {
 	int i;
 	char *e;
 
+#ifdef CONFIG_CONSOLE_CHANNEL_RATE_LIMIT
+	if (argc > 1 && strcasecmp(argv[1], "rate") == 0)
+		return command_ch_rate(argc, argv);
+#endif
+
 	/* If one arg, save / restore, or set the mask */
 	if (argc == 2) {
 		if (strcasecmp(argv[1], "save") == 0) {
@@ -145,17 +403,69 @@ static int command_ch(int argc, char **argv)
 	}
 
 	/* Print the list of channels */
+#ifdef CONFIG_CONSOLE_CHANNEL_RATE_LIMIT
+	ccputs(" # Mask     E Channel        Rate Burst Suppressed    Dropped\n");
+#else
 	ccputs(" # Mask     E Channel\n");
+#endif
 	for (i = 0; i < CC_CHANNEL_COUNT; i++) {
+#ifdef CONFIG_CONSOLE_CHANNEL_RATE_LIMIT
+		const struct channel_stats *s = &channel_stats[i];
+
+		ccprintf("%2d %08x %c %-13s %5d %5d %10u %10u\n",
+			 i, CC_MASK(i),
+			 (channel_mask & CC_MASK(i)) ? '*' : ' ',
+			 channel_names[i],
+			 i == CC_COMMAND ? 0 : s->rate, s->burst,
+			 s->suppressed, s->dropped);
+#else
 		ccprintf("%2d %08x %c %s\n",
 			 i, CC_MASK(i),
 			 (channel_mask & CC_MASK(i)) ? '*' : ' ',
 			 channel_names[i]);
+#endif
 		cflush();
 	}
 	return EC_SUCCESS;
 };
 DECLARE_SAFE_CONSOLE_COMMAND(chan, command_ch,
+#ifdef CONFIG_CONSOLE_CHANNEL_RATE_LIMIT
+			     "[ save | restore | <mask> | "
+			     "rate <channel> <lines/s> [burst] ]",
+			     "Save, restore, get or set console channel mask, "
+			     "or set a channel rate limit (0 for none)");
+#else
 			     "[ save | restore | <mask> ]",
 			     "Save, restore, get or set console channel mask");
+#endif
+
+#ifdef CONFIG_CONSOLE_CHANNEL_RATE_LIMIT
+static enum ec_status
+host_command_console_channel_stats(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_console_channel_stats *p = args->params;
+	struct ec_response_console_channel_stats *r = args->response;
+	const struct channel_stats *s;
+
+	if (p->channel >= CC_CHANNEL_COUNT)
+		return EC_RES_INVALID_PARAM;
+	s = &channel_stats[p->channel];
+
+	memset(r, 0, sizeof(*r));
+	strzcpy(r->name, channel_names[p->channel], sizeof(r->name));
+	r->channel_count = CC_CHANNEL_COUNT;
+	if (channel_mask & CC_MASK(p->channel))
+		r->flags |= EC_CONSOLE_CHANNEL_ENABLED;
+	r->rate = p->channel == CC_COMMAND ? 0 : s->rate;
+	r->burst = s->burst;
+	r->suppressed = s->suppressed;
+	r->dropped = s->dropped;
+
+	args->response_size = sizeof(*r);
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_CONSOLE_CHANNEL_STATS,
+		     host_command_console_channel_stats,
+		     EC_VER_MASK(0));
+#endif /* CONFIG_CONSOLE_CHANNEL_RATE_LIMIT */
 #endif /* CONFIG_CONSOLE_CHANNEL */
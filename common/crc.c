@@ -90,11 +90,17 @@ void crc32_ctx_hash8(uint32_t *crc, uint8_t val)
 	*crc = crc32_hash(*crc, &val, sizeof(val));
 }
 
+void crc32_ctx_hash(uint32_t *crc, const void *buf, int size)
+{
+	*crc = crc32_hash(*crc, buf, size);
+}
+
 uint32_t crc32_ctx_result(uint32_t *crc)
 {
 	return *crc ^ 0xFFFFFFFF;
 }
 
+#ifndef CONFIG_HW_CRC
 /* Accumulator for the CRC */
 static uint32_t crc_;
 
@@ -117,3 +123,4 @@ uint32_t crc32_result(void)
 {
 	return crc32_ctx_result(&crc_);
 }
+#endif /* !CONFIG_HW_CRC */
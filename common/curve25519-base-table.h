@@ -0,0 +1 @@
+../third_party/boringssl/common/curve25519-base-table.h
\ No newline at end of file
@@ -13,8 +13,10 @@
 #include "host_command.h"
 #include "otp.h"
 #include "rwsig.h"
+#include "sha256.h"
 #include "shared_mem.h"
 #include "system.h"
+#include "task.h"
 #include "util.h"
 #include "vboot_hash.h"
 
@@ -563,47 +565,94 @@ static int flash_write_pstate(uint32_t flags)
 #endif /* !CONFIG_FLASH_PSTATE_BANK */
 #endif /* CONFIG_FLASH_PSTATE */
 
-int flash_is_erased(uint32_t offset, int size)
+/* Erased value in each 32-bit half of a native word */
+#define FLASH_ERASED_WORD ((uintptr_t)CONFIG_FLASH_ERASED_VALUE32 * \
+			   (UINTPTR_MAX / UINT32_MAX))
+
+/* Bytes read at a time by flash_is_erased() without mapped storage */
+#define FLASH_ERASED_READ_SIZE 1024
+
+/*
+ * Return 1 if size bytes (word-aligned) at p are erased. The bulk is checked
+ * a native word at a time (64 bits on the host), four words per branch.
+ */
+static int flash_words_erased(const uint32_t *p, int size)
 {
-	const uint32_t *ptr;
+	const uintptr_t *w;
 
-#ifdef CONFIG_MAPPED_STORAGE
-	/* Use pointer directly to flash */
-	if (flash_dataptr(offset, size, sizeof(uint32_t),
-			  (const char **)&ptr) < 0)
-		return 0;
+	for (; size >= sizeof(*p) && (uintptr_t)p % sizeof(*w);
+	     size -= sizeof(*p), p++)
+		if (*p != CONFIG_FLASH_ERASED_VALUE32)
+			return 0;
 
-	flash_lock_mapped_storage(1);
-	for (size /= sizeof(uint32_t); size > 0; size--, ptr++)
-		if (*ptr != CONFIG_FLASH_ERASED_VALUE32) {
-			flash_lock_mapped_storage(0);
+	for (w = (const uintptr_t *)p; size >= 4 * sizeof(*w);
+	     size -= 4 * sizeof(*w), w += 4)
+		if ((w[0] ^ FLASH_ERASED_WORD) | (w[1] ^ FLASH_ERASED_WORD) |
+		    (w[2] ^ FLASH_ERASED_WORD) | (w[3] ^ FLASH_ERASED_WORD))
 			return 0;
-	}
 
-	flash_lock_mapped_storage(0);
-#else
-	/* Read flash a chunk at a time */
-	uint32_t buf[8];
-	int bsize;
+	for (p = (const uint32_t *)w; size >= sizeof(*p);
+	     size -= sizeof(*p), p++)
+		if (*p != CONFIG_FLASH_ERASED_VALUE32)
+			return 0;
 
-	while (size) {
-		bsize = MIN(size, sizeof(buf));
+	return 1;
+}
 
-		if (flash_read(offset, bsize, (char *)buf))
-			return 0;
+#if !defined(CONFIG_MAPPED_STORAGE) || defined(TEST_BUILD)
+/*
+ * Read flash a chunk at a time: FLASH_ERASED_READ_SIZE bytes if shared
+ * memory is free, so SPI flash is read in few transactions, or else a small
+ * chunk on the stack.
+ */
+test_export_static int flash_is_erased_read(uint32_t offset, int size)
+{
+	uint32_t stack_buf[8];
+	uint32_t *buf = stack_buf;
+	int buf_size = sizeof(stack_buf);
+	int bsize;
+	int rv = 1;
 
-		size -= bsize;
-		offset += bsize;
+	if (size > sizeof(stack_buf) &&
+	    shared_mem_acquire(FLASH_ERASED_READ_SIZE, (char **)&buf) ==
+	    EC_SUCCESS)
+		buf_size = FLASH_ERASED_READ_SIZE;
 
-		ptr = buf;
-		for (bsize /= sizeof(uint32_t); bsize > 0; bsize--, ptr++)
-			if (*ptr != CONFIG_FLASH_ERASED_VALUE32)
-				return 0;
+	for (; size; size -= bsize, offset += bsize) {
+		bsize = MIN(size, buf_size);
 
+		if (flash_read(offset, bsize, (char *)buf) ||
+		    !flash_words_erased(buf, bsize)) {
+			rv = 0;
+			break;
+		}
 	}
+
+	if (buf != stack_buf)
+		shared_mem_release(buf);
+	return rv;
+}
 #endif
 
-	return 1;
+int flash_is_erased(uint32_t offset, int size)
+{
+#ifdef CONFIG_MAPPED_STORAGE
+	const uint32_t *ptr;
+	int rv;
+
+	/* Use pointer directly to flash */
+	if (flash_dataptr(offset, size, sizeof(uint32_t),
+			  (const char **)&ptr) < 0)
+		return 0;
+
+	flash_lock_mapped_storage(1);
+	rv = flash_words_erased(ptr, size);
+	flash_lock_mapped_storage(0);
+
+	return rv;
+#else
+	return flash_is_erased_read(offset, size);
+#endif
 }
 
 int flash_read(int offset, int size, char *data)
@@ -629,6 +678,8 @@ static void flash_abort_or_invalidate_hash(int offset, int size)
 	if (vboot_hash_in_progress()) {
 		/* Abort hash calculation when flash update is in progress. */
 		vboot_hash_abort();
+		/* Block digests already computed may be stale too */
+		vboot_hash_invalidate(offset, size);
 		return;
 	}
 
@@ -636,10 +687,13 @@ static void flash_abort_or_invalidate_hash(int offset, int size)
 	/*
 	 * If EC executes in RAM and is currently in RW, we keep the current
 	 * hash. On the next hash check, AP will catch hash mismatch between the
-	 * flash copy and the RAM copy, then take necessary actions.
+	 * flash copy and the RAM copy, then take necessary actions. The block
+	 * digests reused by the next tree hash describe the flash, though.
 	 */
-	if (system_is_in_rw())
+	if (system_is_in_rw()) {
+		vboot_hash_invalidate_blocks(offset, size);
 		return;
+	}
 #endif
 
 	/* If EC executes in place, we need to invalidate the cached hash. */
@@ -683,6 +737,203 @@ int flash_erase(int offset, int size)
 	return flash_physical_erase(offset, size);
 }
 
+#ifdef CONFIG_FLASH_WRITE_SESSION
+BUILD_ASSERT(CONFIG_FLASH_WRITE_SESSION % CONFIG_FLASH_WRITE_SIZE == 0);
+
+/*
+ * Write session: data is gathered in a buffer of CONFIG_FLASH_WRITE_SESSION
+ * bytes, aligned to its size in flash, and each buffer is programmed and
+ * read back while its data is still in RAM.
+ */
+static struct {
+	char *buf;	/* Shared memory, NULL if no session */
+	int start;	/* Offset of the start of the session */
+	int end;	/* Offset of the end of the session */
+	int pos;	/* Offset of the next data to append */
+	int buf_len;	/* Bytes in buf, which holds data up to pos */
+} session;
+static struct mutex session_lock;
+
+/*
+ * A session the host stops feeding is aborted after this long, to give the
+ * shared memory back.
+ */
+#define SESSION_TIMEOUT (5 * SECOND)
+
+/* Compare flash with data; return non-zero if they differ. */
+static int flash_verify(int offset, int size, const char *data)
+{
+#ifdef CONFIG_MAPPED_STORAGE
+	const char *src;
+	int rv;
+
+	if (flash_dataptr(offset, size, 1, &src) < 0)
+		return EC_ERROR_INVAL;
+
+	flash_lock_mapped_storage(1);
+	rv = memcmp(src, data, size);
+	flash_lock_mapped_storage(0);
+	return rv;
+#else
+	/* Read flash a chunk at a time */
+	uint32_t buf[8];
+	int bsize;
+
+	for (; size; size -= bsize, offset += bsize, data += bsize) {
+		bsize = MIN(size, sizeof(buf));
+		if (flash_read(offset, bsize, (char *)buf) ||
+		    memcmp(buf, data, bsize))
+			return EC_ERROR_UNKNOWN;
+	}
+	return EC_SUCCESS;
+#endif
+}
+
+static int flash_write_flush(void)
+{
+	int offset = session.pos - session.buf_len;
+	int size = session.buf_len;
+	int rv;
+
+	if (!size)
+		return EC_SUCCESS;
+
+	/* Protection may have been enabled since the session began */
+	if (!flash_range_ok(offset, size, CONFIG_FLASH_WRITE_SIZE) ||
+	    (flash_get_protect() & EC_FLASH_PROTECT_ALL_NOW))
+		return EC_ERROR_ACCESS_DENIED;
+#ifdef CONFIG_INTERNAL_STORAGE
+	if (system_unsafe_to_overwrite(offset, size))
+		return EC_ERROR_ACCESS_DENIED;
+#endif
+
+	session.buf_len = 0;
+	rv = flash_physical_write(offset, size, session.buf);
+	if (rv)
+		return rv;
+
+	return flash_verify(offset, size, session.buf) ?
+		EC_ERROR_HW_INTERNAL : EC_SUCCESS;
+}
+
+/* End the session, if any; session_lock must be held. */
+static void flash_write_end(void)
+{
+	if (!session.buf)
+		return;
+
+	shared_mem_release(session.buf);
+	session.buf = NULL;
+
+	/*
+	 * Whatever part of the session was programmed, a hash computed during
+	 * it may be stale.
+	 */
+	flash_abort_or_invalidate_hash(session.start,
+				       session.end - session.start);
+}
+
+static void flash_write_timeout(void)
+{
+	mutex_lock(&session_lock);
+	flash_write_end();
+	mutex_unlock(&session_lock);
+}
+DECLARE_DEFERRED(flash_write_timeout);
+
+int flash_write_begin(int offset, int size)
+{
+	int rv;
+
+	mutex_lock(&session_lock);
+	flash_write_end();
+
+	if (!flash_range_ok(offset, size, CONFIG_FLASH_WRITE_SIZE)) {
+		rv = EC_ERROR_INVAL;  /* Invalid range */
+		goto out;
+	}
+
+	rv = shared_mem_acquire(CONFIG_FLASH_WRITE_SESSION, &session.buf);
+	if (rv) {
+		session.buf = NULL;
+		goto out;
+	}
+
+	flash_abort_or_invalidate_hash(offset, size);
+
+	session.start = session.pos = offset;
+	session.end = offset + size;
+	session.buf_len = 0;
+	hook_call_deferred(&flash_write_timeout_data, SESSION_TIMEOUT);
+out:
+	mutex_unlock(&session_lock);
+	return rv;
+}
+
+int flash_write_append(int offset, const char *data, int size)
+{
+	int n, rv = EC_SUCCESS;
+
+	mutex_lock(&session_lock);
+	if (!session.buf || offset != session.pos || size < 0 ||
+	    size > session.end - session.pos) {
+		flash_write_end();
+		rv = EC_ERROR_INVAL;
+		goto out;
+	}
+
+	while (size) {
+		/* Fill up to the end of the buffer's window in flash */
+		n = CONFIG_FLASH_WRITE_SESSION -
+			session.pos % CONFIG_FLASH_WRITE_SESSION;
+		n = MIN(n, size);
+		memcpy(session.buf + session.buf_len, data, n);
+		session.buf_len += n;
+		session.pos += n;
+		data += n;
+		size -= n;
+
+		if (session.pos % CONFIG_FLASH_WRITE_SESSION)
+			continue;
+
+		rv = flash_write_flush();
+		if (rv) {
+			flash_write_end();
+			goto out;
+		}
+	}
+
+	hook_call_deferred(&flash_write_timeout_data, SESSION_TIMEOUT);
+out:
+	mutex_unlock(&session_lock);
+	return rv;
+}
+
+int flash_write_commit(void)
+{
+	int rv;
+
+	mutex_lock(&session_lock);
+	if (!session.buf)
+		rv = EC_ERROR_INVAL;
+	else if (session.pos != session.end)
+		rv = EC_ERROR_INVAL;  /* Data missing, don't program any */
+	else
+		rv = flash_write_flush();
+
+	flash_write_end();
+	mutex_unlock(&session_lock);
+	return rv;
+}
+
+void flash_write_abort(void)
+{
+	mutex_lock(&session_lock);
+	flash_write_end();
+	mutex_unlock(&session_lock);
+}
+#endif /* CONFIG_FLASH_WRITE_SESSION */
+
 int flash_protect_at_boot(uint32_t new_flags)
 {
 #ifdef CONFIG_FLASH_PSTATE
@@ -1335,17 +1586,144 @@ DECLARE_HOST_COMMAND(EC_CMD_FLASH_READ,
 		     flash_command_read,
 		     EC_VER_MASK(0));
 
+#ifdef CONFIG_FLASH_BLOCK_HASH
+static int flash_hash_block(int offset, int size, uint8_t *digest)
+{
+	struct sha256_ctx ctx;
+#ifdef CONFIG_MAPPED_STORAGE
+	const char *src;
+
+	if (flash_dataptr(offset, size, 1, &src) < 0)
+		return EC_ERROR_INVAL;
+
+	SHA256_init(&ctx);
+	flash_lock_mapped_storage(1);
+	SHA256_update(&ctx, (const uint8_t *)src, size);
+	flash_lock_mapped_storage(0);
+#else
+	/* Read flash a SHA-256 block at a time */
+	uint32_t buf[SHA256_BLOCK_SIZE / sizeof(uint32_t)];
+	int bsize;
+
+	SHA256_init(&ctx);
+	for (; size; size -= bsize, offset += bsize) {
+		bsize = MIN(size, sizeof(buf));
+		if (flash_read(offset, bsize, (char *)buf))
+			return EC_ERROR_UNKNOWN;
+		SHA256_update(&ctx, (const uint8_t *)buf, bsize);
+	}
+#endif
+	memcpy(digest, SHA256_final(&ctx), SHA256_DIGEST_SIZE);
+	return EC_SUCCESS;
+}
+
+/*
+ * Hash flash block by block, so the host can skip the blocks that already
+ * hold the data it means to write. Returns as many digests as fit.
+ */
+static enum ec_status
+flash_command_block_hash(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_flash_block_hash *p = args->params;
+	uint32_t offset = p->offset + EC_FLASH_REGION_START;
+	uint8_t *digest = args->response;
+	int blocks, size, i;
+
+	if (args->params_size < sizeof(*p) || !p->block_size ||
+	    p->block_size > EC_FLASH_BLOCK_HASH_MAX_BLOCK_SIZE ||
+	    !flash_range_ok(offset, p->size, 1))
+		return EC_RES_INVALID_PARAM;
+
+	/* Bound the time the host command task spends hashing */
+	blocks = DIV_ROUND_UP(p->size, p->block_size);
+	blocks = MIN(blocks, args->response_max / EC_FLASH_BLOCK_HASH_SIZE);
+	blocks = MIN(blocks, MAX(EC_FLASH_BLOCK_HASH_MAX_SIZE / p->block_size,
+				 1));
+
+	for (i = 0; i < blocks; i++) {
+		size = MIN(p->block_size, p->size - i * p->block_size);
+		if (flash_hash_block(offset + i * p->block_size, size, digest))
+			return EC_RES_ERROR;
+		digest += EC_FLASH_BLOCK_HASH_SIZE;
+	}
+
+	args->response_size = blocks * EC_FLASH_BLOCK_HASH_SIZE;
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_FLASH_BLOCK_HASH,
+		     flash_command_block_hash,
+		     EC_VER_MASK(0));
+#endif
+
 /**
  * Flash write command
  *
  * Version 0 and 1 are equivalent from the EC-side; the only difference is
  * that the host can only send 64 bytes of data at a time in version 0.
+ * Version 2 writes in a session (CONFIG_FLASH_WRITE_SESSION).
  */
+#ifdef CONFIG_FLASH_WRITE_SESSION
+/*
+ * Version 2 writes in a session: protection is checked, and the hash
+ * invalidated, once for the whole range, and data is programmed a buffer at
+ * a time.
+ */
+static enum ec_status
+flash_command_write_session(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_flash_write_v2 *p = args->params;
+	uint32_t offset = p->offset + EC_FLASH_REGION_START;
+	int rv;
+
+	if (args->params_size < sizeof(*p))
+		return EC_RES_INVALID_PARAM;
+
+	if (p->flags & EC_FLASH_WRITE_BEGIN) {
+		flash_write_abort();
+
+		if (flash_get_protect() & EC_FLASH_PROTECT_ALL_NOW)
+			return EC_RES_ACCESS_DENIED;
+
+#ifdef CONFIG_INTERNAL_STORAGE
+		if (system_unsafe_to_overwrite(offset, p->size))
+			return EC_RES_ACCESS_DENIED;
+#endif
+
+		/* Begin takes the size of the whole update, and no data */
+		if (flash_write_begin(offset, p->size))
+			return EC_RES_ERROR;
+		return EC_RES_SUCCESS;
+	}
+
+	if (p->size + sizeof(*p) > args->params_size) {
+		flash_write_abort();
+		return EC_RES_INVALID_PARAM;
+	}
+
+	/* Data goes right after the data already sent */
+	rv = flash_write_append(offset, (const char *)(p + 1), p->size);
+	if (rv == EC_ERROR_INVAL)
+		return EC_RES_INVALID_PARAM;
+	if (rv)
+		return EC_RES_ERROR;
+
+	if ((p->flags & EC_FLASH_WRITE_COMMIT) && flash_write_commit())
+		return EC_RES_ERROR;
+
+	return EC_RES_SUCCESS;
+}
+#endif
+
 static enum ec_status flash_command_write(struct host_cmd_handler_args *args)
 {
 	const struct ec_params_flash_write *p = args->params;
 	uint32_t offset = p->offset + EC_FLASH_REGION_START;
 
+#ifdef CONFIG_FLASH_WRITE_SESSION
+	if (args->version == EC_VER_FLASH_WRITE_SESSION)
+		return flash_command_write_session(args);
+#endif
+
 	if (flash_get_protect() & EC_FLASH_PROTECT_ALL_NOW)
 		return EC_RES_ACCESS_DENIED;
 
@@ -1362,9 +1740,16 @@ static enum ec_status flash_command_write(struct host_cmd_handler_args *args)
 
 	return EC_RES_SUCCESS;
 }
+#ifdef CONFIG_FLASH_WRITE_SESSION
+DECLARE_HOST_COMMAND(EC_CMD_FLASH_WRITE,
+		     flash_command_write,
+		     EC_VER_MASK(0) | EC_VER_MASK(EC_VER_FLASH_WRITE) |
+		     EC_VER_MASK(EC_VER_FLASH_WRITE_SESSION));
+#else
 DECLARE_HOST_COMMAND(EC_CMD_FLASH_WRITE,
 		     flash_command_write,
 		     EC_VER_MASK(0) | EC_VER_MASK(EC_VER_FLASH_WRITE));
+#endif
 
 #ifndef CONFIG_FLASH_MULTIPLE_REGION
 /*
@@ -239,8 +239,9 @@ int aes_gcm_encrypt(const uint8_t *key, int key_size,
 	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
 	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, nonce_size);
 	/* CRYPTO functions return 1 on success, 0 on error. */
-	res = CRYPTO_gcm128_encrypt(&ctx, &aes_key, plaintext, ciphertext,
-				    text_size);
+	res = CRYPTO_gcm128_encrypt_ctr32(&ctx, &aes_key, plaintext,
+					  ciphertext, text_size,
+					  (ctr128_f)AES_ctr32_encrypt_blocks);
 	if (!res) {
 		CPRINTS("Failed to encrypt: %d", res);
 		return EC_ERROR_UNKNOWN;
@@ -271,8 +272,9 @@ int aes_gcm_decrypt(const uint8_t *key, int key_size, uint8_t *plaintext,
 	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
 	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, nonce_size);
 	/* CRYPTO functions return 1 on success, 0 on error. */
-	res = CRYPTO_gcm128_decrypt(&ctx, &aes_key, ciphertext, plaintext,
-				    text_size);
+	res = CRYPTO_gcm128_decrypt_ctr32(&ctx, &aes_key, ciphertext,
+					  plaintext, text_size,
+					  (ctr128_f)AES_ctr32_encrypt_blocks);
 	if (!res) {
 		CPRINTS("Failed to decrypt: %d", res);
 		return EC_ERROR_UNKNOWN;
@@ -0,0 +1,366 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Crash log.
+ *
+ * On panic, the time, the state and the top of the stack of each task, and
+ * the newest console output are saved to a region kept across the reset
+ * (with CONFIG_PRESERVE_LOGS). Console output is mostly repeated text, so it
+ * is compressed, and the region holds several times its size of output. See
+ * struct panic_log_header for the format; util/ec_parse_panicinfo decodes it.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "hooks.h"
+#include "host_command.h"
+#include "hwtimer.h"
+#include "link_defs.h"
+#include "panic.h"
+#include "shared_mem.h"
+#include "task.h"
+#include "timer.h"
+#include "uart.h"
+#include "util.h"
+
+BUILD_ASSERT(CONFIG_PANIC_LOG > sizeof(struct panic_log_header));
+BUILD_ASSERT(CONFIG_PANIC_LOG <= UINT16_MAX);
+/* Positions in the console output are kept in 16 bits while compressing */
+BUILD_ASSERT(CONFIG_UART_TX_BUF_SIZE < UINT16_MAX);
+
+/* Size of the table of recent positions used to find matches */
+#define LZ_HASH_SIZE 64
+
+/* After the other preserved logs, so that it doesn't move them */
+static uint32_t panic_log[CONFIG_PANIC_LOG / 4]
+	__preserved_logs_tail(panic_log);
+static struct panic_log_header * const header = (void *)panic_log;
+
+/* Console output being compressed: two spans of the transmit buffer */
+static const char *src[2];
+static int src_len[2];
+
+__overridable int task_get_stack(task_id_t tskid, const uint32_t **sp,
+				 const uint32_t **end)
+{
+	return EC_ERROR_UNIMPLEMENTED;
+}
+
+static int log_valid(void)
+{
+	return header->magic == PANIC_LOG_MAGIC &&
+	       header->version == PANIC_LOG_VERSION &&
+	       header->size <= sizeof(panic_log) - sizeof(*header);
+}
+
+/* Space left for the data of a new record */
+static int log_space(void)
+{
+	return sizeof(panic_log) - sizeof(*header) - header->size -
+		sizeof(struct panic_log_record);
+}
+
+/* Return the data of a new record of the given size, or NULL. */
+static void *log_add(enum panic_log_type type, int size)
+{
+	uint8_t *p = (uint8_t *)(header + 1) + header->size;
+	struct panic_log_record *r = (void *)p;
+
+	if (size > log_space())
+		return NULL;
+
+	r->type = type;
+	r->reserved = 0;
+	r->size = size;
+	header->size += sizeof(*r) + PANIC_LOG_PADDED(size);
+	return r + 1;
+}
+
+static void save_time(void)
+{
+	struct panic_log_time *t = log_add(PANIC_LOG_TIME, sizeof(*t));
+
+	if (!t)
+		return;
+	t->now = get_time().val;
+	t->hw_clock = __hw_clock_source_read();
+}
+
+static void save_task(task_id_t id)
+{
+	const uint32_t *sp, *end;
+	struct panic_log_task *t;
+	int words = 0;
+
+	if (task_get_stack(id, &sp, &end) == EC_SUCCESS && sp < end)
+		words = MIN(end - sp, CONFIG_PANIC_LOG_STACK_WORDS);
+
+	t = log_add(PANIC_LOG_TASK, sizeof(*t) + words * sizeof(uint32_t));
+	if (!t)
+		return;
+
+	memset(t, 0, sizeof(*t));
+	t->id = id;
+	strncpy(t->name, task_get_name(id), sizeof(t->name));
+	t->events = *task_get_event_bitmap(id);
+	if (words) {
+		t->sp = (uintptr_t)sp;
+		memcpy(t->stack, sp, words * sizeof(uint32_t));
+	}
+}
+
+static inline uint8_t src_at(int i)
+{
+	return i < src_len[0] ? src[0][i] : src[1][i - src_len[0]];
+}
+
+/* Write out the literals from start to end; return the new output size. */
+static int put_literals(uint8_t *out, int o, int out_size, int start, int end)
+{
+	int n;
+
+	while (start < end) {
+		n = MIN(end - start, PANIC_LOG_LZ_MAX_LITERAL);
+		if (o + 1 + n > out_size)
+			return -1;
+		out[o++] = n - 1;
+		while (n--)
+			out[o++] = src_at(start++);
+	}
+	return o;
+}
+
+/* Hash of the shortest match starting at pos */
+static int lz_hash(int pos)
+{
+	return (src_at(pos) * 31 * 31 + src_at(pos + 1) * 31 +
+		src_at(pos + 2)) & (LZ_HASH_SIZE - 1);
+}
+
+/* Remember pos as the last place its hash was seen. */
+static void lz_insert(uint16_t *last, int pos, int end)
+{
+	if (pos + PANIC_LOG_LZ_MIN_MATCH <= end)
+		last[lz_hash(pos)] = pos + 1;
+}
+
+/*
+ * Compress the source from start to end. This runs in the watchdog interrupt,
+ * on the way to a reset which won't wait, so it only tries one match at each
+ * byte: the last position with the same hash.
+ *
+ * @return Size of the compressed output, or -1 if it didn't fit.
+ */
+static int compress(int start, int end, uint8_t *out, int out_size)
+{
+	/* Last position + 1 of each hash; 0 if none */
+	uint16_t last[LZ_HASH_SIZE];
+	int pos = start, literals = start;
+	int o = 0;
+	int match, n, i;
+
+	memset(last, 0, sizeof(last));
+	while (pos < end) {
+		n = 0;
+		if (pos + PANIC_LOG_LZ_MIN_MATCH <= end) {
+			match = last[lz_hash(pos)] - 1;
+			if (match >= 0 && pos - match <= PANIC_LOG_LZ_WINDOW)
+				for (; n < PANIC_LOG_LZ_MAX_MATCH &&
+				     pos + n < end &&
+				     src_at(pos + n) == src_at(match + n); n++)
+					;
+		}
+
+		if (n < PANIC_LOG_LZ_MIN_MATCH) {
+			lz_insert(last, pos++, end);
+			continue;
+		}
+
+		o = put_literals(out, o, out_size, literals, pos);
+		if (o < 0 || o + 2 > out_size)
+			return -1;
+		out[o++] = 0x80 | (n - PANIC_LOG_LZ_MIN_MATCH);
+		out[o++] = pos - match - 1;
+		for (i = 0; i < n; i++)
+			lz_insert(last, pos + i, end);
+		pos += n;
+		literals = pos;
+	}
+
+	return put_literals(out, o, out_size, literals, end);
+}
+
+static void save_console(void)
+{
+	struct panic_log_console *c;
+	int start = 0, end, space, n;
+
+	uart_get_buffer(&src[0], &src_len[0], &src[1], &src_len[1]);
+	end = src_len[0] + src_len[1];
+
+	/* Bytes never written come first */
+	while (start < end && !src_at(start))
+		start++;
+
+	space = log_space() - (int)sizeof(*c);
+	if (space <= 0 || start == end)
+		return;
+
+	/* Drop the oldest output until the rest fits */
+	c = (void *)((uint8_t *)(header + 1) + header->size +
+		     sizeof(struct panic_log_record));
+	while ((n = compress(start, end, c->data, space)) < 0)
+		start += MAX((end - start) / 4, 1);
+
+	c = log_add(PANIC_LOG_CONSOLE, sizeof(*c) + n);
+	c->raw_size = end - start;
+	c->reserved = 0;
+}
+
+void panic_log_save(void)
+{
+	int i;
+
+	header->magic = 0;
+	header->size = 0;
+	header->version = PANIC_LOG_VERSION;
+	header->reserved = 0;
+
+	save_time();
+	for (i = 0; i < TASK_ID_COUNT; i++)
+		save_task(i);
+	/* Console output takes the rest of the space */
+	save_console();
+
+	header->magic = PANIC_LOG_MAGIC;
+}
+
+static void panic_log_init(void)
+{
+	if (!log_valid())
+		memset(panic_log, 0, sizeof(panic_log));
+}
+DECLARE_HOOK(HOOK_INIT, panic_log_init, HOOK_PRIO_FIRST);
+
+/*****************************************************************************/
+/* Console commands */
+
+/* Decompress console output; return the size of the output. */
+static int decompress(const uint8_t *in, int len, char *out, int out_size)
+{
+	const uint8_t *in_end = in + len;
+	int o = 0;
+	int n, dist;
+
+	while (in < in_end) {
+		if (*in < 0x80) {
+			n = *in++ + 1;
+			if (n > in_end - in || o + n > out_size)
+				break;
+			memcpy(out + o, in, n);
+			in += n;
+		} else {
+			n = (*in++ & 0x7f) + PANIC_LOG_LZ_MIN_MATCH;
+			if (in == in_end)
+				break;
+			dist = *in++ + 1;
+			if (dist > o || o + n > out_size)
+				break;
+			/* Byte by byte, as the copy may overlap itself */
+			for (; n; n--, o++)
+				out[o] = out[o - dist];
+			continue;
+		}
+		o += n;
+	}
+	return o;
+}
+
+static void print_console(const struct panic_log_console *c, int size)
+{
+	char *out;
+	int n, i;
+
+	if (shared_mem_acquire(c->raw_size, &out) != EC_SUCCESS) {
+		ccprintf("Console output: %d bytes, out of memory\n",
+			 c->raw_size);
+		return;
+	}
+
+	n = decompress(c->data, size - sizeof(*c), out, c->raw_size);
+	ccprintf("Console output (%d bytes, %d compressed):\n", c->raw_size,
+		 size - (int)sizeof(*c));
+	for (i = 0; i < n; i += 64) {
+		ccprintf("%.*s", MIN(n - i, 64), out + i);
+		cflush();
+	}
+	ccputs("\n");
+
+	shared_mem_release(out);
+}
+
+static int command_paniclog(int argc, char **argv)
+{
+	const uint8_t *p = (const uint8_t *)(header + 1);
+	const uint8_t *end = p + header->size;
+	const struct panic_log_record *r;
+	const struct panic_log_time *t;
+	const struct panic_log_task *k;
+
+	if (!log_valid() || !header->size) {
+		ccputs("No crash log\n");
+		return EC_SUCCESS;
+	}
+
+	for (; p + sizeof(*r) <= end; p += sizeof(*r) + PANIC_LOG_PADDED(r->size)) {
+		r = (const void *)p;
+		switch (r->type) {
+		case PANIC_LOG_TIME:
+			t = (const void *)(r + 1);
+			ccprintf("Time %.6lld, clock %08x\n", (long long)t->now,
+				 t->hw_clock);
+			break;
+		case PANIC_LOG_TASK:
+			k = (const void *)(r + 1);
+			ccprintf("Task %2d %-8.8s events %08x sp %08x\n",
+				 k->id, k->name, k->events, k->sp);
+			break;
+		case PANIC_LOG_CONSOLE:
+			print_console((const void *)(r + 1), r->size);
+			break;
+		}
+		cflush();
+	}
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(paniclog, command_paniclog,
+			NULL,
+			"Print the crash log of the last panic");
+
+/*****************************************************************************/
+/* Host commands */
+
+static enum ec_status
+host_command_get_panic_log(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_get_panic_log *p = args->params;
+	int size = log_valid() ? sizeof(*header) + header->size : 0;
+
+	if (args->params_size < sizeof(*p))
+		return EC_RES_INVALID_PARAM;
+
+	if (p->offset < size) {
+		args->response_size = MIN(size - p->offset,
+					  args->response_max);
+		memcpy(args->response, (uint8_t *)panic_log + p->offset,
+		       args->response_size);
+	}
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_GET_PANIC_LOG,
+		     host_command_get_panic_log,
+		     EC_VER_MASK(0));
@@ -110,6 +110,9 @@ void panic_printf(const char *format, ...)
  */
 void panic_reboot(void)
 {
+#ifdef CONFIG_PANIC_LOG
+	panic_log_save();
+#endif
 	panic_puts("\n\nRebooting...\n");
 	system_reset(0);
 }
@@ -15,36 +15,23 @@ static const char error_str[] = "ERROR";
 #define MAX_FORMAT 1024  /* Maximum chars in a single format field */
 
 #ifndef CONFIG_DEBUG_PRINTF
-static inline int divmod(uint64_t *n, int d)
-{
-	return uint64divmod(n, d);
-}
-
+typedef uint64_t printf_uint_t;
 #else /* CONFIG_DEBUG_PRINTF */
 /* if we are optimizing for size, remove the 64-bit support */
 #define NO_UINT64_SUPPORT
-static inline int divmod(uint32_t *n, int d)
-{
-	int r = *n % d;
-	*n /= d;
-	return r;
-}
+typedef uint32_t printf_uint_t;
 #endif
 
-/**
- * Convert the lowest nibble of a number to hex
- *
- * @param c	Number to extract lowest nibble from
- *
- * @return The corresponding ASCII character ('0' - 'f').
- */
-static int hexdigit(int c)
-{
-	/* Strip off just the last nibble */
-	c &= 0x0f;
+static const char hex_lower[] = "0123456789abcdef";
+static const char hex_upper[] = "0123456789ABCDEF";
 
-	return c > 9 ? (c + 'a' - 10) : (c + '0');
-}
+/* "00" to "99", so that decimal numbers are converted two digits at a time */
+static const char dec_pairs[200] =
+	"00010203040506070809" "10111213141516171819"
+	"20212223242526272829" "30313233343536373839"
+	"40414243444546474849" "50515253545556575859"
+	"60616263646566676869" "70717273747576777879"
+	"80818283848586878889" "90919293949596979899";
 
 /* Flags for vfnprintf() flags */
 #define PF_LEFT		BIT(0)  /* Left-justify */
@@ -58,16 +45,176 @@ static int hexdigit(int c)
 #define PF_64BIT	BIT(3)  /* Number is 64-bit */
 #endif
 
+/*
+ * Output of vfnprintf(). Characters are collected in buf, and handed to
+ * addstr() (or addchar(), one at a time) when it fills up. Runs of the format
+ * string and long strings bypass buf.
+ */
+struct printf_output {
+	int (*addchar)(void *context, int c);
+	int (*addstr)(void *context, const char *s, int len);
+	void *context;
+	int len;
+	char buf[32];
+};
+
+static int out_write(struct printf_output *out, const char *s, int len)
+{
+	if (out->addstr)
+		return out->addstr(out->context, s, len) ?
+			EC_ERROR_OVERFLOW : EC_SUCCESS;
+
+	while (len--) {
+		if (out->addchar(out->context, *s++))
+			return EC_ERROR_OVERFLOW;
+	}
+	return EC_SUCCESS;
+}
+
+static int out_flush(struct printf_output *out)
+{
+	int len = out->len;
+
+	out->len = 0;
+	return len ? out_write(out, out->buf, len) : EC_SUCCESS;
+}
+
+static int out_str(struct printf_output *out, const char *s, int len)
+{
+	if (out->len + len <= sizeof(out->buf)) {
+		memcpy(out->buf + out->len, s, len);
+		out->len += len;
+		return EC_SUCCESS;
+	}
+
+	if (out_flush(out))
+		return EC_ERROR_OVERFLOW;
+	if (len >= sizeof(out->buf))
+		return out_write(out, s, len);
+	memcpy(out->buf, s, len);
+	out->len = len;
+	return EC_SUCCESS;
+}
+
+static int out_char(struct printf_output *out, int c)
+{
+	if (out->len == sizeof(out->buf) && out_flush(out))
+		return EC_ERROR_OVERFLOW;
+	out->buf[out->len++] = c;
+	return EC_SUCCESS;
+}
+
+/* Output c, n times */
+static int out_fill(struct printf_output *out, int c, int n)
+{
+	while (n > 0) {
+		int chunk;
+
+		if (out->len == sizeof(out->buf) && out_flush(out))
+			return EC_ERROR_OVERFLOW;
+		chunk = MIN(n, sizeof(out->buf) - out->len);
+		memset(out->buf + out->len, c, chunk);
+		out->len += chunk;
+		n -= chunk;
+	}
+	return EC_SUCCESS;
+}
+
+/**
+ * Convert a 32-bit number to decimal, two digits at a time. Division by the
+ * constant 100 compiles to a multiplication by its reciprocal.
+ *
+ * @param end		End of the output; digits are written backwards
+ * @param v		Number to convert
+ * @param min_digits	Pad with leading zeros to this many digits
+ * @return The first digit.
+ */
+static char *u32_to_dec(char *end, uint32_t v, int min_digits)
+{
+	char *first = end - min_digits;
+
+	while (v >= 100) {
+		end -= 2;
+		memcpy(end, dec_pairs + 2 * (v % 100), 2);
+		v /= 100;
+	}
+	if (v >= 10) {
+		end -= 2;
+		memcpy(end, dec_pairs + 2 * v, 2);
+	} else {
+		*(--end) = '0' + v;
+	}
+
+	while (end > first)
+		*(--end) = '0';
+	return end;
+}
+
+/* Convert a number to decimal, writing backwards from end. */
+static char *to_dec(char *end, printf_uint_t v)
+{
+#ifndef NO_UINT64_SUPPORT
+	/*
+	 * Peel off 9 digits at a time while the number doesn't fit in 32 bits,
+	 * so that the 64-bit division is done at most twice.
+	 */
+	while (v > UINT32_MAX)
+		end = u32_to_dec(end, uint64divmod(&v, 1000000000), 9);
+#endif
+	return u32_to_dec(end, v, 0);
+}
+
+/* Convert a number to hex, writing backwards from end. */
+static char *to_hex(char *end, printf_uint_t v, const char *digits)
+{
+	uint32_t lo = v;
+
+#ifndef NO_UINT64_SUPPORT
+	/* Work on 32-bit halves; 64-bit shifts are slow on 32-bit cores */
+	if (v >> 32) {
+		int i;
+
+		for (i = 0; i < 8; i++, lo >>= 4)
+			*(--end) = digits[lo & 0xf];
+		lo = v >> 32;
+	}
+#endif
+	do {
+		*(--end) = digits[lo & 0xf];
+		lo >>= 4;
+	} while (lo);
+
+	return end;
+}
+
+static inline int divmod(printf_uint_t *n, int d)
+{
+#ifdef NO_UINT64_SUPPORT
+	int r = *n % d;
+	*n /= d;
+	return r;
+#else
+	return uint64divmod(n, d);
+#endif
+}
+
+/* Convert a number to any base, one digit at a time. */
+static char *to_base(char *end, printf_uint_t v, int base, const char *digits)
+{
+	do {
+		*(--end) = digits[divmod(&v, base)];
+	} while (v);
+	return end;
+}
+
 /*
  * Print the buffer as a string of bytes in hex.
  * Returns 0 on success or an error on failure.
  */
-static int print_hex_buffer(int (*addchar)(void *context, int c),
-			    void *context, const char *vstr, int precision,
-			    int pad_width, int flags)
+static int print_hex_buffer(struct printf_output *out, const char *vstr,
+			    int precision, int pad_width, int flags)
 
 {
-
 	/*
 	 * Divide pad_width instead of multiplying precision to avoid overflow
 	 * error in the condition. The "/2" and "2*" can be optimized by
@@ -79,37 +226,37 @@ static int print_hex_buffer(int (*addchar)(void *context, int c),
 	else
 		pad_width = 0;
 
-	while (pad_width > 0 && !(flags & PF_LEFT)) {
-		if (addchar(context, flags & PF_PADZERO ? '0' : ' '))
-			return EC_ERROR_OVERFLOW;
-		pad_width--;
-	}
+	if (!(flags & PF_LEFT) &&
+	    out_fill(out, flags & PF_PADZERO ? '0' : ' ', pad_width))
+		return EC_ERROR_OVERFLOW;
 
 	for (; precision; precision--, vstr++) {
-		if (addchar(context, hexdigit(*vstr >> 4)) ||
-		    addchar(context, hexdigit(*vstr)))
-			return EC_ERROR_OVERFLOW;
-	}
+		char pair[2] = {
+			hex_lower[(*vstr >> 4) & 0xf],
+			hex_lower[*vstr & 0xf],
+		};
 
-	while (pad_width > 0 && (flags & PF_LEFT)) {
-		if (addchar(context, ' '))
+		if (out_str(out, pair, 2))
 			return EC_ERROR_OVERFLOW;
-		pad_width--;
 	}
 
+	if ((flags & PF_LEFT) && out_fill(out, ' ', pad_width))
+		return EC_ERROR_OVERFLOW;
+
 	return EC_SUCCESS;
 }
 
-int vfnprintf(int (*addchar)(void *context, int c), void *context,
-	      const char *format, va_list args)
+static int vfnprintf_out(struct printf_output *out, const char *format,
+			 va_list args)
 {
 	/*
 	 * Longest uint64 in decimal = 20
 	 * Longest uint32 in binary  = 32
+	 * Longest fixed-point number = 31 digits + "0."
 	 * + sign bit
 	 * + terminating null
 	 */
-	char intbuf[34];
+	char intbuf[36];
 	int flags;
 	int pad_width;
 	int precision;
@@ -117,15 +264,18 @@ int vfnprintf(int (*addchar)(void *context, int c), void *context,
 	int vlen;
 
 	while (*format) {
-		int c = *format++;
+		const char *run = format;
+		int c;
 		char sign = 0;
 
 		/* Copy normal characters */
-		if (c != '%') {
-			if (addchar(context, c))
-				return EC_ERROR_OVERFLOW;
-			continue;
-		}
+		while (*format && *format != '%')
+			format++;
+		if (format != run && out_str(out, run, format - run))
+			return EC_ERROR_OVERFLOW;
+		if (!*format)
+			break;
+		format++;
 
 		/* Zero flags, now that we're in a format */
 		flags = 0;
@@ -135,7 +285,7 @@ int vfnprintf(int (*addchar)(void *context, int c), void *context,
 
 		/* Send "%" for "%%" input */
 		if (c == '%' || c == '\0') {
-			if (addchar(context, '%'))
+			if (out_char(out, '%'))
 				return EC_ERROR_OVERFLOW;
 
 			if (c == '\0')
@@ -147,7 +297,7 @@ int vfnprintf(int (*addchar)(void *context, int c), void *context,
 		/* Handle %c */
 		if (c == 'c') {
 			c = va_arg(args, int);
-			if (addchar(context, c))
+			if (out_char(out, c))
 				return EC_ERROR_OVERFLOW;
 			continue;
 		}
@@ -215,11 +365,7 @@ int vfnprintf(int (*addchar)(void *context, int c), void *context,
 
 		} else {
 			int base = 10;
-#ifdef NO_UINT64_SUPPORT
-			uint32_t v;
-#else
-			uint64_t v;
-#endif
+			printf_uint_t v;
 			int ptrspec;
 			void *ptrval;
 
@@ -296,8 +442,7 @@ int vfnprintf(int (*addchar)(void *context, int c), void *context,
 						ptrval;
 					int rc;
 
-					rc = print_hex_buffer(addchar,
-							      context,
+					rc = print_hex_buffer(out,
 							      hexbuf->buffer,
 							      hexbuf->size,
 							      0,
@@ -327,6 +472,8 @@ int vfnprintf(int (*addchar)(void *context, int c), void *context,
 					base = 2;
 
 				} else {
+					/* Keep the output so far */
+					out_flush(out);
 					return EC_ERROR_INVAL;
 				}
 
@@ -390,29 +537,49 @@ int vfnprintf(int (*addchar)(void *context, int c), void *context,
 			 * Fixed-point precision must fit in our buffer.
 			 * Leave space for "0." and the terminating null.
 			 */
-			if (precision > (int)(sizeof(intbuf) - 3))
-				precision = sizeof(intbuf) - 3;
+			if (precision > (int)(sizeof(intbuf) - 5))
+				precision = sizeof(intbuf) - 5;
 
-			/*
-			 * Handle digits to right of decimal for fixed point
-			 * numbers.
-			 */
-			for (vlen = 0; vlen < precision; vlen++)
-				*(--vstr) = '0' + divmod(&v, 10);
-			if (precision >= 0)
+			if (precision >= 0 && base != 10) {
+				/*
+				 * Digits to the right of the decimal point
+				 * are decimal, whatever the base.
+				 */
+				for (vlen = 0; vlen < precision; vlen++)
+					*(--vstr) = '0' + divmod(&v, 10);
 				*(--vstr) = '.';
-
-			if (!v)
-				*(--vstr) = '0';
-
-			while (v) {
-				int digit = divmod(&v, base);
-				if (digit < 10)
-					*(--vstr) = '0' + digit;
-				else if (c == 'X')
-					*(--vstr) = 'A' + digit - 10;
+				if (v)
+					vstr = to_base(vstr, v, base,
+						       c == 'X' ? hex_upper :
+								  hex_lower);
 				else
-					*(--vstr) = 'a' + digit - 10;
+					*(--vstr) = '0';
+			} else if (base == 10) {
+				vstr = to_dec(vstr, v);
+				if (precision >= 0) {
+					/*
+					 * Fixed point: move the last precision
+					 * digits right by one for the decimal
+					 * point, zero-padding as needed.
+					 */
+					vlen = intbuf + sizeof(intbuf) - 1 -
+						vstr;
+					if (vlen <= precision) {
+						vstr -= precision + 1 - vlen;
+						memset(vstr, '0',
+						       precision + 1 - vlen);
+						vlen = precision + 1;
+					}
+					memmove(vstr - 1, vstr,
+						vlen - precision);
+					vstr--;
+					vstr[vlen - precision] = '.';
+				}
+			} else if (base == 16) {
+				vstr = to_hex(vstr, v,
+					      c == 'X' ? hex_upper : hex_lower);
+			} else {
+				vstr = to_base(vstr, v, base, hex_lower);
 			}
 
 			if (sign)
@@ -432,7 +599,6 @@ int vfnprintf(int (*addchar)(void *context, int c), void *context,
 		if (precision < 0) {
 			/* If precision is unset, print everything */
 			vlen = strlen(vstr);
-			precision = MAX(vlen, pad_width);
 		} else {
 			/*
 			 * If precision is set, ensure that we do not
@@ -441,24 +607,40 @@ int vfnprintf(int (*addchar)(void *context, int c), void *context,
 			vlen = strnlen(vstr, precision);
 		}
 
-
-		while (vlen < pad_width && !(flags & PF_LEFT)) {
-			if (addchar(context, flags & PF_PADZERO ? '0' : ' '))
-				return EC_ERROR_OVERFLOW;
-			vlen++;
-		}
-		while (--precision >= 0 && *vstr)
-			if (addchar(context, *vstr++))
-				return EC_ERROR_OVERFLOW;
-		while (vlen < pad_width && flags & PF_LEFT) {
-			if (addchar(context, ' '))
-				return EC_ERROR_OVERFLOW;
-			vlen++;
-		}
+		if (!(flags & PF_LEFT) &&
+		    out_fill(out, flags & PF_PADZERO ? '0' : ' ',
+			     pad_width - vlen))
+			return EC_ERROR_OVERFLOW;
+		if (out_str(out, vstr, vlen))
+			return EC_ERROR_OVERFLOW;
+		if ((flags & PF_LEFT) && out_fill(out, ' ', pad_width - vlen))
+			return EC_ERROR_OVERFLOW;
 	}
 
 	/* If we're still here, we consumed all output */
-	return EC_SUCCESS;
+	return out_flush(out);
+}
+
+int vfnprintf(int (*addchar)(void *context, int c), void *context,
+	      const char *format, va_list args)
+{
+	struct printf_output out = {
+		.addchar = addchar,
+		.context = context,
+	};
+
+	return vfnprintf_out(&out, format, args);
+}
+
+int vfnprintf_bulk(int (*addstr)(void *context, const char *s, int len),
+		   void *context, const char *format, va_list args)
+{
+	struct printf_output out = {
+		.addstr = addstr,
+		.context = context,
+	};
+
+	return vfnprintf_out(&out, format, args);
 }
 
 /* Context for snprintf() */
@@ -468,22 +650,22 @@ struct snprintf_context {
 };
 
 /**
- * Add a character to the string context.
+ * Add characters to the string context.
  *
- * @param context	Context receiving character
- * @param c		Character to add
- * @return 0 if character added, 1 if character dropped because no space.
+ * @param context	Context receiving characters
+ * @param s		Characters to add
+ * @param len		Number of characters
+ * @return 0 if all characters added, 1 if some were dropped because no space.
  */
-static int snprintf_addchar(void *context, int c)
+static int snprintf_addstr(void *context, const char *s, int len)
 {
 	struct snprintf_context *ctx = (struct snprintf_context *)context;
+	int n = MIN(len, ctx->size);
 
-	if (!ctx->size)
-		return 1;
-
-	*(ctx->str++) = c;
-	ctx->size--;
-	return 0;
+	memcpy(ctx->str, s, n);
+	ctx->str += n;
+	ctx->size -= n;
+	return n < len;
 }
 
 int snprintf(char *str, int size, const char *format, ...)
@@ -509,7 +691,7 @@ int vsnprintf(char *str, int size, const char *format, va_list args)
 	ctx.str = str;
 	ctx.size = size - 1;  /* Reserve space for terminating '\0' */
 
-	rv = vfnprintf(snprintf_addchar, &ctx, format, args);
+	rv = vfnprintf_bulk(snprintf_addstr, &ctx, format, args);
 
 	/* Terminate string */
 	*ctx.str = '\0';
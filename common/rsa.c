@@ -44,6 +44,9 @@ static int ge_mod(const struct rsa_public_key *key, const uint32_t *a)
 
 /**
  * Montgomery c[] += a * b[] / R % mod
+ *
+ * Each step is a multiply with two additions, which mulaa32() does in one
+ * UMAAL instruction where there is one. The loop goes two words at a time.
  */
 static void mont_mul_add(const struct rsa_public_key *key,
 			 uint32_t *c,
@@ -55,10 +58,19 @@ static void mont_mul_add(const struct rsa_public_key *key,
 	uint64_t B = mula32(d0, key->n[0], A);
 	uint32_t i;
 
-	for (i = 1; i < RSANUMWORDS; ++i) {
+	BUILD_ASSERT(RSANUMWORDS % 2 == 0);
+
+	A = mulaa32(a, b[1], c[1], A >> 32);
+	B = mulaa32(d0, key->n[1], A, B >> 32);
+	c[0] = (uint32_t)B;
+
+	for (i = 2; i < RSANUMWORDS; i += 2) {
 		A = mulaa32(a, b[i], c[i], A >> 32);
 		B = mulaa32(d0, key->n[i], A, B >> 32);
 		c[i - 1] = (uint32_t)B;
+		A = mulaa32(a, b[i + 1], c[i + 1], A >> 32);
+		B = mulaa32(d0, key->n[i + 1], A, B >> 32);
+		c[i] = (uint32_t)B;
 	}
 
 	A = (A >> 32) + (B >> 32);
@@ -149,7 +161,10 @@ static void mod_pow(const struct rsa_public_key *key, uint8_t *inout,
 		a[i] = tmp;
 	}
 
-	/* TODO(drinkcat): This operation could be precomputed to save time. */
+	/*
+	 * This depends on the signature, so can't be precomputed: RR and
+	 * n0inv, which come with the key, are all there is to precompute.
+	 */
 	mont_mul(key, a_r, a, key->rr);  /* a_r = a * RR / R mod M */
 #ifdef CONFIG_RSA_EXPONENT_3
 	mont_mul(key, aa_r, a_r, a_r);
@@ -227,18 +242,20 @@ static int check_padding(const uint8_t *sig)
 }
 
 /*
- * Verify a SHA256WithRSA PKCS#1 v1.5 signature against an expected
- * SHA256 hash.
+ * Recover the SHA-256 digest signed in a SHA256WithRSA PKCS#1 v1.5
+ * signature. This is all of the verification that doesn't depend on the
+ * signed data.
  *
  * @param key           RSA public key
  * @param signature     RSA signature
- * @param sha           SHA-256 digest of the content to verify
+ * @param sha           Output: SHA-256 digest signed
  * @param workbuf32     Work buffer; caller must verify this is
  *                      3 x RSANUMWORDS elements long.
  * @return 0 on failure, 1 on success.
  */
-int rsa_verify(const struct rsa_public_key *key, const uint8_t *signature,
-	       const uint8_t *sha, uint32_t *workbuf32)
+int rsa_recover_digest(const struct rsa_public_key *key,
+		       const uint8_t *signature, uint8_t *sha,
+		       uint32_t *workbuf32)
 {
 	uint8_t buf[RSANUMBYTES];
 
@@ -251,8 +268,31 @@ int rsa_verify(const struct rsa_public_key *key, const uint8_t *signature,
 	if (check_padding(buf) != 0)
 		return 0;
 
+	memcpy(sha, buf + PKCS_PAD_SIZE, SHA256_DIGEST_SIZE);
+	return 1;
+}
+
+/*
+ * Verify a SHA256WithRSA PKCS#1 v1.5 signature against an expected
+ * SHA256 hash.
+ *
+ * @param key           RSA public key
+ * @param signature     RSA signature
+ * @param sha           SHA-256 digest of the content to verify
+ * @param workbuf32     Work buffer; caller must verify this is
+ *                      3 x RSANUMWORDS elements long.
+ * @return 0 on failure, 1 on success.
+ */
+int rsa_verify(const struct rsa_public_key *key, const uint8_t *signature,
+	       const uint8_t *sha, uint32_t *workbuf32)
+{
+	uint8_t signed_sha[SHA256_DIGEST_SIZE];
+
+	if (!rsa_recover_digest(key, signature, signed_sha, workbuf32))
+		return 0;
+
 	/* Check the digest. */
-	if (memcmp(buf + PKCS_PAD_SIZE, sha, SHA256_DIGEST_SIZE) != 0)
+	if (memcmp(signed_sha, sha, SHA256_DIGEST_SIZE) != 0)
 		return 0;
 
 	return 1;  /* All checked out OK. */
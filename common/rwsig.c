@@ -18,6 +18,7 @@
 #include "shared_mem.h"
 #include "system.h"
 #include "task.h"
+#include "timer.h"
 #include "usb_pd.h"
 #include "util.h"
 #include "vb21_struct.h"
@@ -98,7 +99,10 @@ int rwsig_check_signature(void)
 	const struct rsa_public_key *key;
 	const uint8_t *sig;
 	uint8_t *hash;
+	uint8_t signed_hash[SHA256_DIGEST_SIZE];
 	uint32_t *rsa_workbuf = NULL;
+	timestamp_t start;
+	int rsa_us;
 	const uint8_t *rwdata = (uint8_t *)CONFIG_PROGRAM_MEMORY_BASE
 					+ CONFIG_RW_MEM_OFF;
 	int good = 0;
@@ -175,6 +179,19 @@ int rwsig_check_signature(void)
 	rwlen = vb21_sig->data_size;
 #endif
 
+	/*
+	 * The RSA exponentiation doesn't depend on the image, so do it first:
+	 * a bad signature fails without hashing the image, and only the
+	 * digest compare is left after the hash.
+	 */
+	start = get_time();
+	good = rsa_recover_digest(key, sig, signed_hash, rsa_workbuf);
+	rsa_us = time_since32(start);
+	if (!good) {
+		CPRINTS("Invalid signature.");
+		goto out;
+	}
+
 	/*
 	 * Check that unverified RW region is actually filled with ones.
 	 */
@@ -186,11 +203,14 @@ int rwsig_check_signature(void)
 	}
 
 	/* SHA-256 Hash of the RW firmware */
+	start = get_time();
 	SHA256_init(&ctx);
 	SHA256_update(&ctx, rwdata, rwlen);
 	hash = SHA256_final(&ctx);
+	CPRINTS("RW verify: RSA %d us, hash %d us", rsa_us,
+		time_since32(start));
 
-	good = rsa_verify(key, sig, hash, rsa_workbuf);
+	good = !memcmp(hash, signed_hash, SHA256_DIGEST_SIZE);
 	if (!good)
 		goto out;
 
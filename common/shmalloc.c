@@ -4,10 +4,22 @@
  * found in the LICENSE file.
  */
 
-/* Malloc/free memory module for Chrome EC */
+/*
+ * Malloc/free memory module for Chrome EC
+ *
+ * Free buffers are kept in segregated lists, one per power-of-two size class,
+ * with a bitmap of the lists which are not empty. An allocation looks for the
+ * best fit in the list of its own class, else takes the first buffer of the
+ * next non-empty larger class, which is sure to fit. The low bits of the size
+ * of each buffer and a copy of the size at the end of free buffers (boundary
+ * tags) let a release merge the buffer with its free neighbors directly,
+ * without walking any list. An allocated buffer doesn't use its list
+ * pointers, so they hold check values which a release verifies.
+ */
 #include <stdint.h>
 
 #include "common.h"
+#include "console.h"
 #include "hooks.h"
 #include "link_defs.h"
 #include "shared_mem.h"
@@ -24,265 +36,238 @@ static struct mutex shmem_lock;
 #define TEST_GLOBAL
 #endif
 
-/*
- * At the beginning there is a single free memory chunk which includes all
- * memory available in the system. It then gets fragmented/defragmented based
- * on actual allocations/releases.
- */
-TEST_GLOBAL struct shm_buffer *free_buf_chain;
+/* Buffer sizes and addresses are multiples of this */
+#define SHM_ALIGN sizeof(size_t)
+
+/* Smallest buffer: the header, and the size at the end when free */
+#define SHM_MIN_BUF ((sizeof(struct shm_buffer) + sizeof(size_t) + \
+		      SHM_ALIGN - 1) & ~(SHM_ALIGN - 1))
+
+BUILD_ASSERT(SHM_ALIGN > SHM_BUF_FLAGS);
+BUILD_ASSERT(SHM_MIN_BUF >= 16);
 
-/* At the beginning there is no allocated buffers */
-TEST_GLOBAL struct shm_buffer *allocced_buf_chain;
+/* Free buffers of each size class, and a bitmap of the non-empty lists. */
+TEST_GLOBAL struct shm_buffer *free_lists[SHM_SIZE_CLASSES];
+TEST_GLOBAL uint32_t free_lists_map;
+
+/* Bounds of the memory managed, which starts as a single free buffer. */
+TEST_GLOBAL struct shm_buffer *shm_start;
+TEST_GLOBAL struct shm_buffer *shm_end;
 
 /* The size of the biggest ever allocated buffer. */
 static int max_allocated_size;
 
+/* Counts of allocations, and of allocations which failed. */
+static int allocations;
+static int allocation_failures;
+
+static inline size_t buf_size(const struct shm_buffer *buf)
+{
+	return buf->buffer_size & ~SHM_BUF_FLAGS;
+}
+
+static inline struct shm_buffer *buf_next(struct shm_buffer *buf)
+{
+	return (struct shm_buffer *)((uintptr_t)buf + buf_size(buf));
+}
+
+static inline size_t *buf_tag(struct shm_buffer *buf)
+{
+	return (size_t *)buf_next(buf) - 1;
+}
+
+static int size_class(size_t size)
+{
+	return MIN(__fls(size) - 4, SHM_SIZE_CLASSES - 1);
+}
+
+/* Put a free buffer in its list, and tag its end with its size. */
+static void list_add(struct shm_buffer *buf)
+{
+	int c = size_class(buf_size(buf));
+
+	buf->prev_buffer = NULL;
+	buf->next_buffer = free_lists[c];
+	if (free_lists[c])
+		free_lists[c]->prev_buffer = buf;
+	free_lists[c] = buf;
+	free_lists_map |= BIT(c);
+
+	*buf_tag(buf) = buf_size(buf);
+}
+
+static void list_remove(struct shm_buffer *buf)
+{
+	int c = size_class(buf_size(buf));
+
+	if (buf->prev_buffer) {
+		set_map_bit(BIT(0));
+		buf->prev_buffer->next_buffer = buf->next_buffer;
+	} else if (buf->next_buffer) {
+		set_map_bit(BIT(1));
+		free_lists[c] = buf->next_buffer;
+	} else {
+		set_map_bit(BIT(2));
+		free_lists[c] = NULL;
+		free_lists_map &= ~BIT(c);
+	}
+	if (buf->next_buffer)
+		buf->next_buffer->prev_buffer = buf->prev_buffer;
+}
+
+/* Mark a buffer allocated, and set its check values. */
+static void mark_allocated(struct shm_buffer *buf)
+{
+	buf->buffer_size |= SHM_BUF_ALLOCATED;
+	buf->next_buffer = (struct shm_buffer *)~(uintptr_t)buf;
+	buf->prev_buffer = buf_next(buf);
+}
+
+/* Return non-zero if ptr is the header of an allocated buffer. */
+static int is_allocated(struct shm_buffer *ptr)
+{
+	return ptr >= shm_start && ptr < shm_end &&
+	       !((uintptr_t)ptr & (SHM_ALIGN - 1)) &&
+	       (ptr->buffer_size & SHM_BUF_ALLOCATED) &&
+	       buf_size(ptr) >= SHM_MIN_BUF &&
+	       buf_size(ptr) <= (uintptr_t)shm_end - (uintptr_t)ptr &&
+	       ptr->next_buffer == (struct shm_buffer *)~(uintptr_t)ptr &&
+	       ptr->prev_buffer == buf_next(ptr);
+}
+
 static void shared_mem_init(void)
 {
+	uintptr_t start = (uintptr_t)__shared_mem_buf;
+	size_t size;
+
 	/*
 	 * Use all the RAM we can. The shared memory buffer is the last thing
 	 * allocated from the start of RAM, so we can use everything up to the
 	 * jump data at the end of RAM.
 	 */
-	free_buf_chain = (struct shm_buffer *)__shared_mem_buf;
-	free_buf_chain->next_buffer = NULL;
-	free_buf_chain->prev_buffer = NULL;
-	free_buf_chain->buffer_size = system_usable_ram_end() -
-		(uintptr_t)__shared_mem_buf;
+	start = (start + SHM_ALIGN - 1) & ~(SHM_ALIGN - 1);
+	size = (system_usable_ram_end() - start) & ~(SHM_ALIGN - 1);
+
+	shm_start = (struct shm_buffer *)start;
+	shm_end = (struct shm_buffer *)(start + size);
+	shm_start->buffer_size = size;
+	list_add(shm_start);
 }
 DECLARE_HOOK(HOOK_INIT, shared_mem_init, HOOK_PRIO_FIRST);
 
 /* Called with the mutex lock acquired. */
 static void do_release(struct shm_buffer *ptr)
 {
-	struct shm_buffer *pfb;
-	struct shm_buffer *top;
-	size_t released_size;
-
-	/* Take the buffer out of the allocated buffers chain. */
-	if (ptr == allocced_buf_chain) {
-		if (ptr->next_buffer) {
-			set_map_bit(BIT(20));
-			ptr->next_buffer->prev_buffer = NULL;
-		} else {
-			set_map_bit(BIT(21));
-		}
-		allocced_buf_chain = ptr->next_buffer;
-	} else {
-		/*
-		 * Saninty check: verify that the buffer is in the allocated
-		 * buffers chain.
-		 */
-		for (pfb = allocced_buf_chain->next_buffer;
-		     pfb;
-		     pfb = pfb->next_buffer)
-			if (pfb == ptr)
-				break;
-		if (!pfb)
-			return;
-
-		ptr->prev_buffer->next_buffer = ptr->next_buffer;
-		if (ptr->next_buffer) {
-			set_map_bit(BIT(22));
-			ptr->next_buffer->prev_buffer = ptr->prev_buffer;
-		} else {
-			set_map_bit(BIT(23));
-		}
-	}
+	struct shm_buffer *next;
+	struct shm_buffer *prev;
+	size_t size;
 
-	/*
-	 * Let's bring the released buffer back into the fold. Cache its size
-	 * for quick reference.
-	 */
-	released_size = ptr->buffer_size;
-	if (!free_buf_chain) {
-		/*
-		 * All memory had been allocated - this buffer is going to be
-		 * the only available free space.
-		 */
-		set_map_bit(BIT(0));
-		free_buf_chain = ptr;
-		free_buf_chain->buffer_size = released_size;
-		free_buf_chain->next_buffer = NULL;
-		free_buf_chain->prev_buffer = NULL;
-		return;
-	}
-
-	if (ptr < free_buf_chain) {
-		/*
-		 * Insert this buffer in the beginning of the chain, possibly
-		 * merging it with the first buffer of the chain.
-		 */
-		pfb = (struct shm_buffer *)((uintptr_t)ptr + released_size);
-		if (pfb == free_buf_chain) {
-			set_map_bit(BIT(1));
-			/* Merge the two buffers. */
-			ptr->buffer_size = free_buf_chain->buffer_size +
-				released_size;
-			ptr->next_buffer =
-				free_buf_chain->next_buffer;
-		} else {
-			set_map_bit(BIT(2));
-			ptr->buffer_size = released_size;
-			ptr->next_buffer = free_buf_chain;
-			free_buf_chain->prev_buffer = ptr;
-		}
-		if (ptr->next_buffer) {
-			set_map_bit(BIT(3));
-			ptr->next_buffer->prev_buffer = ptr;
-		} else {
-			set_map_bit(BIT(4));
-		}
-		ptr->prev_buffer = NULL;
-		free_buf_chain = ptr;
+	/* Sanity check: ptr must be an allocated buffer. */
+	if (!is_allocated(ptr))
 		return;
-	}
 
+	size = buf_size(ptr);
 	/*
-	 * Need to merge the new free buffer into the existing chain. Find a
-	 * spot for it, it should be above the highest address buffer which is
-	 * still below the new one.
+	 * Mark the header free now: if it merges into the buffer below, it is
+	 * left inside a free buffer, and a second release must not pass.
 	 */
-	pfb = free_buf_chain;
-	while (pfb->next_buffer && (pfb->next_buffer < ptr))
-		pfb = pfb->next_buffer;
-
-	top = (struct shm_buffer *)((uintptr_t)pfb + pfb->buffer_size);
-	if (top == ptr) {
-		/*
-		 * The returned buffer is adjacent to an existing free buffer,
-		 * below it, merge the two buffers.
-		 */
-		pfb->buffer_size += released_size;
-
-		/*
-		 * Is the returned buffer the exact gap between two free
-		 * buffers?
-		 */
-		top = (struct shm_buffer *)((uintptr_t)ptr + released_size);
-		if (top == pfb->next_buffer) {
-			/* Yes, it is. */
-			pfb->buffer_size += pfb->next_buffer->buffer_size;
-			pfb->next_buffer =
-				pfb->next_buffer->next_buffer;
-			if (pfb->next_buffer) {
-				set_map_bit(BIT(5));
-				pfb->next_buffer->prev_buffer = pfb;
-			} else {
-				set_map_bit(BIT(6));
-			}
-		}
-		return;
-	}
-
-	top = (struct shm_buffer *)((uintptr_t)ptr + released_size);
-	if (top == pfb->next_buffer) {
-		/* The new buffer is adjacent with the one right above it. */
-		set_map_bit(BIT(7));
-		ptr->buffer_size = released_size +
-			pfb->next_buffer->buffer_size;
-		ptr->next_buffer = pfb->next_buffer->next_buffer;
+	ptr->buffer_size &= ~SHM_BUF_ALLOCATED;
+
+	/* Merge with the buffer above, if it is free. */
+	next = buf_next(ptr);
+	if (next == shm_end) {
+		set_map_bit(BIT(3));
+	} else if (next->buffer_size & SHM_BUF_ALLOCATED) {
+		set_map_bit(BIT(4));
 	} else {
-		/* Just include the new free buffer into the chain. */
-		set_map_bit(BIT(8));
-		ptr->next_buffer = pfb->next_buffer;
-		ptr->buffer_size = released_size;
+		set_map_bit(BIT(5));
+		list_remove(next);
+		size += buf_size(next);
 	}
-	ptr->prev_buffer = pfb;
-	pfb->next_buffer = ptr;
-	if (ptr->next_buffer) {
-		set_map_bit(BIT(9));
-		ptr->next_buffer->prev_buffer = ptr;
+
+	/* Merge with the buffer below, found by its size tag, if it is free. */
+	if (ptr->buffer_size & SHM_BUF_PREV_FREE) {
+		set_map_bit(BIT(6));
+		prev = (struct shm_buffer *)((uintptr_t)ptr -
+					     ((size_t *)ptr)[-1]);
+		list_remove(prev);
+		size += buf_size(prev);
+		ptr = prev;
 	} else {
-		set_map_bit(BIT(10));
+		set_map_bit(BIT(7));
 	}
+
+	/* No free buffer is next to another, so there is no flag to keep. */
+	ptr->buffer_size = size;
+	list_add(ptr);
+
+	next = buf_next(ptr);
+	if (next != shm_end)
+		next->buffer_size |= SHM_BUF_PREV_FREE;
 }
 
 /* Called with the mutex lock acquired. */
 static int do_acquire(int size, struct shm_buffer **dest_ptr)
 {
-	int headroom = 0x10000000; /* we'll never have this much. */
 	struct shm_buffer *pfb;
-	struct shm_buffer *candidate = 0;
-
-	/* To keep things simple let's align the size. */
-	size = (size + sizeof(int) - 1) & ~(sizeof(int) - 1);
-
-	/* And let's allocate room to fit the buffer header. */
-	size += sizeof(struct shm_buffer);
-
-	pfb = free_buf_chain;
-	while (pfb) {
-		if ((pfb->buffer_size >= size) &&
-		    ((pfb->buffer_size - size) < headroom)) {
-			/* this is a new candidate. */
-			headroom = pfb->buffer_size - size;
+	struct shm_buffer *candidate = NULL;
+	struct shm_buffer *next;
+	size_t need;
+	uint32_t larger;
+	int c;
+
+	/* Room for the header, aligned, and no less than a free buffer. */
+	need = (size + sizeof(struct shm_buffer) + SHM_ALIGN - 1) &
+		~(SHM_ALIGN - 1);
+	need = MAX(need, SHM_MIN_BUF);
+	c = size_class(need);
+
+	/* Buffers of the same class may be too small: pick the best fit. */
+	for (pfb = free_lists[c]; pfb; pfb = pfb->next_buffer) {
+		if (buf_size(pfb) >= need &&
+		    (!candidate || buf_size(pfb) < buf_size(candidate))) {
 			candidate = pfb;
+			if (buf_size(pfb) == need)
+				break;
 		}
-		pfb = pfb->next_buffer;
 	}
 
-	if (!candidate) {
-		set_map_bit(BIT(11));
-		return EC_ERROR_BUSY;
-	}
-
-	*dest_ptr = candidate;
-
-	/* Now let's take the candidate out of the free buffer chain. */
-	if (headroom <= sizeof(struct shm_buffer)) {
-		/*
-		 * The entire buffer should be allocated, there is no need to
-		 * re-define its tail as a new free buffer.
-		 */
-		if (candidate == free_buf_chain) {
-			/*
-			 * The next buffer becomes the head of the free buffer
-			 * chain.
-			 */
-			free_buf_chain = candidate->next_buffer;
-			if (free_buf_chain) {
-				set_map_bit(BIT(12));
-				free_buf_chain->prev_buffer = 0;
-			} else {
-				set_map_bit(BIT(13));
-			}
-		} else {
-			candidate->prev_buffer->next_buffer =
-				candidate->next_buffer;
-			if (candidate->next_buffer) {
-				set_map_bit(BIT(14));
-				candidate->next_buffer->prev_buffer =
-					candidate->prev_buffer;
-			} else {
-				set_map_bit(BIT(15));
-			}
+	if (candidate) {
+		set_map_bit(BIT(8));
+	} else {
+		/* Any buffer of a larger class fits; take the smallest. */
+		larger = c < 31 ? free_lists_map & ~(BIT(c + 1) - 1) : 0;
+		if (!larger) {
+			set_map_bit(BIT(9));
+			return EC_ERROR_BUSY;
 		}
-		return EC_SUCCESS;
+		set_map_bit(BIT(10));
+		candidate = free_lists[__builtin_ctz(larger)];
 	}
 
-	candidate->buffer_size = size;
-
-	/* Candidate's tail becomes a new free buffer. */
-	pfb = (struct shm_buffer *)((uintptr_t)candidate + size);
-	pfb->buffer_size = headroom;
-	pfb->next_buffer = candidate->next_buffer;
-	pfb->prev_buffer = candidate->prev_buffer;
+	list_remove(candidate);
 
-	if (pfb->next_buffer) {
-		set_map_bit(BIT(16));
-		pfb->next_buffer->prev_buffer = pfb;
+	/*
+	 * A free buffer is never right above another, so its only flag to
+	 * keep is ALLOCATED, set now.
+	 */
+	if (buf_size(candidate) - need >= SHM_MIN_BUF) {
+		/* The candidate's tail becomes a new free buffer. */
+		set_map_bit(BIT(11));
+		next = (struct shm_buffer *)((uintptr_t)candidate + need);
+		next->buffer_size = buf_size(candidate) - need;
+		list_add(next);
+		candidate->buffer_size = need;
 	} else {
-		set_map_bit(BIT(17));
+		/* Too little would be left over: allocate the whole buffer. */
+		set_map_bit(BIT(12));
+		next = buf_next(candidate);
+		if (next != shm_end)
+			next->buffer_size &= ~SHM_BUF_PREV_FREE;
 	}
+	mark_allocated(candidate);
 
-	if (candidate == free_buf_chain) {
-		set_map_bit(BIT(18));
-		free_buf_chain = pfb;
-	} else {
-		set_map_bit(BIT(19));
-		pfb->prev_buffer->next_buffer = pfb;
-	}
+	*dest_ptr = candidate;
 	return EC_SUCCESS;
 }
 
@@ -293,18 +278,18 @@ int shared_mem_size(void)
 
 	mutex_lock(&shmem_lock);
 
-	/* Find the maximum available buffer size. */
-	pfb = free_buf_chain;
-	while (pfb) {
-		if (pfb->buffer_size > max_available)
-			max_available = pfb->buffer_size;
-		pfb = pfb->next_buffer;
-	}
+	/* The biggest buffer is in the list of the largest class. */
+	if (free_lists_map)
+		for (pfb = free_lists[__fls(free_lists_map)]; pfb;
+		     pfb = pfb->next_buffer)
+			max_available = MAX(max_available, buf_size(pfb));
 
 	mutex_unlock(&shmem_lock);
+
 	/* Leave room for shmem header */
-	max_available -= sizeof(struct shm_buffer);
-	return max_available;
+	if (max_available < sizeof(struct shm_buffer))
+		return 0;
+	return max_available - sizeof(struct shm_buffer);
 }
 
 int shared_mem_acquire(int size, char **dest_ptr)
@@ -317,23 +302,19 @@ int shared_mem_acquire(int size, char **dest_ptr)
 	if (in_interrupt_context())
 		return EC_ERROR_INVAL;
 
-	if (!free_buf_chain)
+	if (!free_lists_map || size < 0)
 		return EC_ERROR_BUSY;
 
 	mutex_lock(&shmem_lock);
 	rv = do_acquire(size, &new_buf);
 	if (rv == EC_SUCCESS) {
-		new_buf->next_buffer = allocced_buf_chain;
-		new_buf->prev_buffer = NULL;
-		if (allocced_buf_chain)
-			allocced_buf_chain->prev_buffer = new_buf;
-
-		allocced_buf_chain = new_buf;
-
 		*dest_ptr = (void *)(new_buf + 1);
 
+		allocations++;
 		if (size > max_allocated_size)
 			max_allocated_size = size;
+	} else {
+		allocation_failures++;
 	}
 	mutex_unlock(&shmem_lock);
 
@@ -357,26 +338,30 @@ static int command_shmem(int argc, char **argv)
 	size_t allocated_size;
 	size_t free_size;
 	size_t max_free;
+	int free_count[SHM_SIZE_CLASSES] = { 0 };
+	int free_bufs = 0;
 	struct shm_buffer *buf;
+	int c;
 
 	allocated_size = free_size = max_free = 0;
 
 	mutex_lock(&shmem_lock);
 
-	for (buf = free_buf_chain; buf; buf = buf->next_buffer) {
-		size_t buf_room;
+	for (buf = shm_start; buf && buf < shm_end; buf = buf_next(buf)) {
+		size_t buf_room = buf_size(buf);
 
-		buf_room = buf->buffer_size;
+		if (buf->buffer_size & SHM_BUF_ALLOCATED) {
+			allocated_size += buf_room;
+			continue;
+		}
 
 		free_size += buf_room;
+		free_bufs++;
+		free_count[size_class(buf_room)]++;
 		if (buf_room > max_free)
 			max_free = buf_room;
 	}
 
-	for (buf = allocced_buf_chain; buf;
-	     buf = buf->next_buffer)
-		allocated_size += buf->buffer_size;
-
 	mutex_unlock(&shmem_lock);
 
 	ccprintf("Total:         %6zd\n", allocated_size + free_size);
@@ -384,6 +369,17 @@ static int command_shmem(int argc, char **argv)
 	ccprintf("Free:          %6zd\n", free_size);
 	ccprintf("Max free buf:  %6zd\n", max_free);
 	ccprintf("Max allocated: %6d\n", max_allocated_size);
+	ccprintf("Allocations:   %6d (%d failed)\n", allocations,
+		 allocation_failures);
+	/* How much of the free memory is not in the biggest buffer */
+	ccprintf("Free buffers:  %6d, fragmentation %d%%\n", free_bufs,
+		 free_size ? (int)(100 - max_free * 100 / free_size) : 0);
+
+	ccputs("Free by size:");
+	for (c = 0; c < SHM_SIZE_CLASSES; c++)
+		if (free_count[c])
+			ccprintf(" %d+:%d", 1 << (c + 4), free_count[c]);
+	ccputs("\n");
 	return EC_SUCCESS;
 }
 DECLARE_SAFE_CONSOLE_COMMAND(shmem, command_shmem,
@@ -93,6 +93,7 @@ void test_print_result(void)
 		ccprintf("Fail! (%d tests)\n", __test_error_count);
 	else
 		ccprintf("Pass!\n");
+	cflush();
 }
 
 int test_get_error_count(void)
@@ -45,6 +45,12 @@ static volatile char tx_buf[CONFIG_UART_TX_BUF_SIZE]
 			__uncached __preserved_logs(tx_buf);
 static volatile int tx_buf_head __preserved_logs(tx_buf_head);
 static volatile int tx_buf_tail __preserved_logs(tx_buf_tail);
+#ifndef CONFIG_POLLING_UART
+/* End of the space reserved by writers; output up to tx_buf_head is ready */
+static int tx_buf_reserved;
+/* Number of writers copying into reserved space; interrupts may nest */
+static int tx_buf_writers;
+#endif
 static volatile char rx_buf[CONFIG_UART_RX_BUF_SIZE] __uncached;
 static volatile int rx_buf_head;
 static volatile int rx_buf_tail;
@@ -54,6 +60,20 @@ static int tx_last_snapshot_head;
 static int tx_next_snapshot_head;
 static int tx_checksum __preserved_logs(tx_checksum);
 
+#ifdef CONFIG_CONSOLE_READ_CURSORS
+/* Bytes put in the transmit buffer since init, wrapping */
+static uint32_t tx_buf_written;
+
+/* Reader cursors for EC_CMD_CONSOLE_READ v2 */
+static struct console_reader {
+	char name[EC_CONSOLE_READER_NAME_LEN];	/* Empty if unused */
+	uint32_t pos;		/* tx_buf_written at the end of the last read */
+	uint32_t lost;		/* Bytes overwritten since the last read */
+	uint32_t last_used;	/* Read sequence number, to reuse the oldest */
+} readers[CONFIG_CONSOLE_READ_CURSORS];
+static uint32_t reader_seq;
+#endif
+
 static int uart_buffer_calc_checksum(void)
 {
 	return tx_buf_head ^ tx_buf_tail;
@@ -69,62 +89,178 @@ void uart_init_buffer(void)
 		tx_buf_tail = 0;
 		tx_checksum = 0;
 	}
+#ifdef CONFIG_CONSOLE_READ_CURSORS
+	else {
+		/* Preserved logs can be read; unused bytes are skipped */
+		tx_buf_written = CONFIG_UART_TX_BUF_SIZE - 1;
+	}
+#endif
+#ifndef CONFIG_POLLING_UART
+	tx_buf_reserved = tx_buf_head;
+#endif
 }
 
+void uart_get_buffer(const char **first, int *first_len,
+		     const char **second, int *second_len)
+{
+	/* The head is where the next byte goes, over the oldest one */
+	int head = tx_buf_head;
+
+	*first = (const char *)tx_buf + head;
+	*first_len = CONFIG_UART_TX_BUF_SIZE - head;
+	*second = (const char *)tx_buf;
+	*second_len = head;
+}
+
+#ifndef CONFIG_POLLING_UART
 /**
- * Put a single character into the transmit buffer.
+ * Copy a run of characters into the transmit buffer at head, splitting the
+ * copy where the buffer wraps. The caller has checked there is room.
  *
- * Does not enable the transmit interrupt; assumes that happens elsewhere.
+ * @return The new head.
+ */
+static int tx_buf_copy(int head, const char *out, int len)
+{
+	int first = MIN(len, CONFIG_UART_TX_BUF_SIZE - head);
+
+	memcpy((char *)tx_buf + head, out, first);
+	memcpy((char *)tx_buf, out + first, len - first);
+	return (head + len) & (CONFIG_UART_TX_BUF_SIZE - 1);
+}
+
+/**
+ * Find how much of a block of characters fits in the transmit buffer.
  *
- * @param context	Context; ignored.
- * @param c		Character to write.
- * @return 0 if the character was transmitted, 1 if it was dropped.
+ * @param out		Characters to write
+ * @param len		Number of characters
+ * @param crlf		Translate '\n' to '\r\n'
+ * @param room		Free space in the transmit buffer
+ * @param bytes		Output: number of bytes the characters that fit take
+ * @return Number of characters that fit.
  */
-static int __tx_char_raw(void *context, int c)
+static int tx_buf_fit(const char *out, int len, int crlf, int room,
+		      int *bytes)
 {
-	int tx_buf_next, tx_buf_new_tail;
+	int done = 0;
+
+	*bytes = 0;
+	while (done < len) {
+		const char *nl = crlf ? memchr(out + done, '\n', len - done) :
+					NULL;
+		int run = (nl ? nl - out : len) - done;
+		int n = MIN(run, room - *bytes);
+
+		*bytes += n;
+		done += n;
+		if (n < run || !nl)
+			break;
 
-#if defined CONFIG_POLLING_UART
-	(void) tx_buf_next;
-	(void) tx_buf_new_tail;
-	uart_write_char(c);
-#else
+		if (room - *bytes < 2)
+			break;
+		*bytes += 2;
+		done++;
+	}
+	return done;
+}
+
+/**
+ * Put a block of characters into the transmit buffer.
+ *
+ * Equivalent to writing each character in turn, but copies runs between
+ * newlines at once and only updates the snapshot pointers and checksum once.
+ *
+ * Space is reserved under the interrupt lock and filled without it. The head
+ * only moves once the last writer is done, so the UART never sends a byte
+ * that is still being copied, and a writer that interrupts another one can't
+ * lose its output.
+ *
+ * Does not enable the transmit interrupt; assumes that happens elsewhere.
+ *
+ * @param out		Characters to write
+ * @param len		Number of characters
+ * @param crlf		Translate '\n' to '\r\n'
+ * @return Number of characters consumed; less than len if the buffer filled.
+ */
+static int __tx_buf_put(const char *out, int len, int crlf)
+{
+	const char *nl;
+	int bytes = len;
+	int done = len;
+	int head, written;
+
+	/* Count the bytes needed outside the lock */
+	for (nl = out; crlf && (nl = memchr(nl, '\n', out + len - nl)); nl++)
+		bytes++;
+
+	/* --- critical section : reserve transmit buffer space --- */
+	interrupt_disable();
+	if (bytes > TX_BUF_DIFF(tx_buf_tail, tx_buf_reserved + 1))
+		done = tx_buf_fit(out, len, crlf,
+				  TX_BUF_DIFF(tx_buf_tail, tx_buf_reserved + 1),
+				  &bytes);
+	head = tx_buf_reserved;
+	tx_buf_reserved = (head + bytes) & (CONFIG_UART_TX_BUF_SIZE - 1);
+	tx_buf_writers++;
+	interrupt_enable();
+	/* --- end of critical section --- */
+
+	for (len = 0; len < done; len++) {
+		nl = crlf ? memchr(out + len, '\n', done - len) : NULL;
+		if (!nl) {
+			head = tx_buf_copy(head, out + len, done - len);
+			break;
+		}
+		head = tx_buf_copy(head, out + len, nl - out - len);
+		head = tx_buf_copy(head, "\r\n", 2);
+		len = nl - out;
+	}
 
-	tx_buf_next = TX_BUF_NEXT(tx_buf_head);
-	if (tx_buf_next == tx_buf_tail)
-		return 1;
+	/* --- critical section : publish output once all writers are done --- */
+	interrupt_disable();
+	if (--tx_buf_writers) {
+		interrupt_enable();
+		return done;
+	}
+	head = tx_buf_reserved;
+	written = TX_BUF_DIFF(head, tx_buf_head);
 
 	/*
-	 * If we do a READ_RECENT, the buffer may have wrapped around, and
-	 * we'll drop most of the logs in this case. Make sure the place
-	 * we read from in that case is always ahead of the new tx_buf_head.
-	 *
-	 * We also want to make sure that the next time we snapshot and want
-	 * to READ_RECENT, we don't start reading from a stale tail.
+	 * Snapshot pointers that the new output runs over are pushed ahead of
+	 * the new head, so they never point into output newer than the data
+	 * they mark.
 	 */
-	tx_buf_new_tail = TX_BUF_NEXT(tx_buf_next);
-	if (tx_buf_next == tx_last_snapshot_head &&
-	    tx_last_snapshot_head != tx_snapshot_head)
-		tx_last_snapshot_head = tx_buf_new_tail;
-	if (tx_buf_next == tx_next_snapshot_head)
-		tx_next_snapshot_head = tx_buf_new_tail;
-
-	tx_buf[tx_buf_head] = c;
-	tx_buf_head = tx_buf_next;
+	if (tx_last_snapshot_head != tx_snapshot_head &&
+	    TX_BUF_DIFF(tx_last_snapshot_head, tx_buf_head + 1) < written)
+		tx_last_snapshot_head = TX_BUF_NEXT(head);
+	if (TX_BUF_DIFF(tx_next_snapshot_head, tx_buf_head + 1) < written)
+		tx_next_snapshot_head = TX_BUF_NEXT(head);
+
+	tx_buf_head = head;
+#ifdef CONFIG_CONSOLE_READ_CURSORS
+	tx_buf_written += written;
+#endif
 
 	if (IS_ENABLED(CONFIG_PRESERVE_LOGS))
 		tx_checksum = uart_buffer_calc_checksum();
-#endif
-	return 0;
-}
+	interrupt_enable();
+	/* --- end of critical section --- */
 
-static int __tx_char(void *context, int c)
+	return done;
+}
+#else /* CONFIG_POLLING_UART */
+static int __tx_buf_put(const char *out, int len, int crlf)
 {
-	/* Translate '\n' to '\r\n' */
-	if (c == '\n' && __tx_char_raw(NULL, '\r'))
-		return 1;
-	return __tx_char_raw(context, c);
+	int done;
+
+	for (done = 0; done < len; done++) {
+		/* Translate '\n' to '\r\n' */
+		if (crlf && out[done] == '\n')
+			uart_write_char('\r');
+		uart_write_char(out[done]);
+	}
+	return done;
 }
+#endif /* CONFIG_POLLING_UART */
 
 #ifdef CONFIG_UART_TX_DMA
 
@@ -267,7 +403,8 @@ void uart_clear_input(void)
 
 int uart_putc(int c)
 {
-	int rv = __tx_char(NULL, c);
+	char ch = c;
+	int rv = !__tx_buf_put(&ch, 1, 1);
 
 	uart_tx_start();
 
@@ -276,49 +413,39 @@ int uart_putc(int c)
 
 int uart_puts(const char *outstr)
 {
-	/* Put all characters in the output buffer */
-	while (*outstr) {
-		if (__tx_char(NULL, *outstr++) != 0)
-			break;
-	}
-
-	uart_tx_start();
-
-	/* Successful if we consumed all output */
-	return *outstr ? EC_ERROR_OVERFLOW : EC_SUCCESS;
+	return uart_put(outstr, strlen(outstr));
 }
 
 int uart_put(const char *out, int len)
 {
 	/* Put all characters in the output buffer */
-	while (len--) {
-		if (__tx_char(NULL, *out++) != 0)
-			break;
-	}
+	int done = __tx_buf_put(out, len, 1);
 
 	uart_tx_start();
 
 	/* Successful if we consumed all output */
-	return len ? EC_ERROR_OVERFLOW : EC_SUCCESS;
+	return done < len ? EC_ERROR_OVERFLOW : EC_SUCCESS;
 }
 
 int uart_put_raw(const char *out, int len)
 {
 	/* Put all characters in the output buffer */
-	while (len--) {
-		if (__tx_char_raw(NULL, *out++) != 0)
-			break;
-	}
+	int done = __tx_buf_put(out, len, 0);
 
 	uart_tx_start();
 
 	/* Successful if we consumed all output */
-	return len ? EC_ERROR_OVERFLOW : EC_SUCCESS;
+	return done < len ? EC_ERROR_OVERFLOW : EC_SUCCESS;
+}
+
+static int __tx_str(void *context, const char *s, int len)
+{
+	return __tx_buf_put(s, len, 1) < len;
 }
 
 int uart_vprintf(const char *format, va_list args)
 {
-	int rv = vfnprintf(__tx_char, NULL, format, args);
+	int rv = vfnprintf_bulk(__tx_str, NULL, format, args);
 
 	uart_tx_start();
 
@@ -402,6 +529,147 @@ static void uart_rx_dma_init(void)
 DECLARE_HOOK(HOOK_INIT, uart_rx_dma_init, HOOK_PRIO_DEFAULT);
 #endif
 
+#ifdef CONFIG_CONSOLE_READ_CURSORS
+/* Find the cursor of a reader, or reuse the least recently used one. */
+static struct console_reader *find_reader(const char *name)
+{
+	struct console_reader *r, *oldest = readers;
+
+	for (r = readers; r < readers + ARRAY_SIZE(readers); r++) {
+		if (!strncmp(r->name, name, sizeof(r->name)))
+			return r;
+		if (!r->name[0] ||
+		    (oldest->name[0] &&
+		     (int32_t)(r->last_used - oldest->last_used) < 0))
+			oldest = r;
+	}
+
+	/* A new cursor starts at the oldest output */
+	memcpy(oldest->name, name, sizeof(oldest->name));
+	oldest->pos = tx_buf_written - MIN(tx_buf_written,
+					   CONFIG_UART_TX_BUF_SIZE - 1);
+	oldest->lost = 0;
+	return oldest;
+}
+
+/*
+ * Bytes put in the transmit buffer since init, plus the space writers have
+ * reserved and may be copying into. Call with interrupts disabled.
+ */
+static uint32_t tx_buf_reach(void)
+{
+#ifndef CONFIG_POLLING_UART
+	return tx_buf_written + TX_BUF_DIFF(tx_buf_reserved, tx_buf_head);
+#else
+	return tx_buf_written;
+#endif
+}
+
+/**
+ * Copy the output since the reader's last read, up to size bytes.
+ *
+ * @param r		Reader cursor
+ * @param dest		Destination
+ * @param size		Size of destination
+ * @param pending	Set to the number of bytes left to read
+ * @return Number of bytes copied.
+ */
+static int read_cursor(struct console_reader *r, char *dest, int size,
+		       uint32_t *pending)
+{
+	uint32_t written, avail, clobbered;
+	int head, start, first, n;
+	char *zero;
+
+	interrupt_disable();
+	written = tx_buf_written;
+	head = tx_buf_head;
+	interrupt_enable();
+
+	/* Output older than the buffer holds is gone */
+	avail = written - r->pos;
+	if (avail > CONFIG_UART_TX_BUF_SIZE - 1) {
+		r->lost += avail - (CONFIG_UART_TX_BUF_SIZE - 1);
+		avail = CONFIG_UART_TX_BUF_SIZE - 1;
+	}
+
+	n = MIN(avail, size);
+	start = TX_BUF_DIFF(head, avail);
+	first = MIN(n, CONFIG_UART_TX_BUF_SIZE - start);
+	memcpy(dest, (char *)tx_buf + start, first);
+	memcpy(dest + first, (char *)tx_buf, n - first);
+
+	/*
+	 * Output put in the buffer while we copied, or still being copied in,
+	 * may have run over the start of the copy; drop that part.
+	 */
+	interrupt_disable();
+	clobbered = tx_buf_reach() - written;
+	interrupt_enable();
+	if (clobbered > CONFIG_UART_TX_BUF_SIZE - 1 - avail) {
+		clobbered = MIN(clobbered - (CONFIG_UART_TX_BUF_SIZE - 1 - avail),
+				avail);
+		r->lost += clobbered;
+		avail -= clobbered;
+		if (clobbered < n) {
+			memmove(dest, dest + clobbered, n - clobbered);
+			n -= clobbered;
+		} else {
+			n = 0;
+		}
+	}
+	r->pos = written - avail + n;
+	*pending = avail - n;
+
+	/* Skip unused bytes of preserved logs, as the snapshot reads do */
+	zero = memchr(dest, '\0', n);
+	if (zero) {
+		char *p;
+
+		for (p = zero; p < dest + n; p++)
+			if (*p)
+				*zero++ = *p;
+		n = zero - dest;
+	}
+
+	return n;
+}
+
+static enum ec_status console_read_v2(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_console_read_v2 *p = args->params;
+	struct ec_response_console_read_v2 *r = args->response;
+	struct console_reader *reader;
+	char name[EC_CONSOLE_READER_NAME_LEN];
+
+	if (args->response_max < sizeof(*r))
+		return EC_RES_RESPONSE_TOO_BIG;
+
+	/* Names shorter than the field are null-padded */
+	memset(name, 0, sizeof(name));
+	memcpy(name, p->reader, strnlen(p->reader, sizeof(name)));
+	if (!name[0])
+		return EC_RES_INVALID_PARAM;
+
+	reader = find_reader(name);
+	reader->last_used = ++reader_seq;
+	if (p->flags & EC_CONSOLE_READ_FROM_OLDEST)
+		reader->pos = tx_buf_written - MIN(tx_buf_written,
+						   CONFIG_UART_TX_BUF_SIZE - 1);
+
+	args->response_size = sizeof(*r) +
+		read_cursor(reader, r->data, args->response_max - sizeof(*r),
+			    &r->pending);
+	r->lost = reader->lost;
+	reader->lost = 0;
+
+	if (p->flags & EC_CONSOLE_READ_RELEASE)
+		reader->name[0] = '\0';
+
+	return EC_RES_SUCCESS;
+}
+#endif /* CONFIG_CONSOLE_READ_CURSORS */
+
 /*****************************************************************************/
 /* Host commands */
 
@@ -439,6 +707,10 @@ host_command_console_read(struct host_cmd_handler_args *args)
 				(char *)args->response,
 				args->response_max,
 				&args->response_size);
+#endif
+#ifdef CONFIG_CONSOLE_READ_CURSORS
+	} else if (args->version == 2) {
+		return console_read_v2(args);
 #endif
 	}
 	return EC_RES_INVALID_PARAM;
@@ -448,6 +720,9 @@ DECLARE_HOST_COMMAND(EC_CMD_CONSOLE_READ,
 		     EC_VER_MASK(0)
 #ifdef CONFIG_CONSOLE_ENABLE_READ_V1
 		     | EC_VER_MASK(1)
+#endif
+#ifdef CONFIG_CONSOLE_READ_CURSORS
+		     | EC_VER_MASK(2)
 #endif
 		     );
 
@@ -7,12 +7,14 @@
 #include "config.h"
 #include "console.h"
 #include "crc.h"
+#include "hooks.h"
 #include "link_defs.h"
 #include "printf.h"
 #include "queue.h"
 #include "task.h"
 #include "timer.h"
 #include "usb-stream.h"
+#include "util.h"
 
 #ifdef CONFIG_USB_CONSOLE
 /*
@@ -25,12 +27,18 @@
 /* Console output macro */
 #define USB_CONSOLE_TIMEOUT_US (30 * MSEC)
 
+/* How long output smaller than a packet waits for more to fill the packet */
+#define USB_CONSOLE_FLUSH_US 500
+
 #define QUEUE_SIZE_USB_TX     CONFIG_USB_CONSOLE_TX_BUF_SIZE
 #define QUEUE_SIZE_USB_RX     USB_MAX_PACKET_SIZE
 
 static void usb_console_wr(struct queue_policy const *policy, size_t count);
 static void uart_console_rd(struct queue_policy const *policy, size_t count);
-
+static void usb_console_tx_added(struct queue_policy const *policy,
+				 size_t count);
+static void usb_console_tx_removed(struct queue_policy const *policy,
+				   size_t count);
 
 static int last_tx_ok = 1;
 
@@ -46,6 +54,9 @@ static int is_enabled = 1;
  */
 static int is_readonly = 1;
 
+/* Task waiting for space in the Tx queue */
+static task_id_t tx_waiter = TASK_ID_INVALID;
+
 /*
  * This is a usb_console producer policy, which wakes up CONSOLE task whenever
  * rx_q gets new data added. This shall be called by rx_stream_handler() in
@@ -56,7 +67,17 @@ static struct queue_policy const usb_console_policy = {
 	.remove = uart_console_rd,
 };
 
-static struct queue const tx_q = QUEUE_NULL(QUEUE_SIZE_USB_TX, uint8_t);
+/*
+ * The Tx queue policy wakes up a task waiting for space whenever the USB
+ * stream takes a packet out of tx_q.
+ */
+static struct queue_policy const usb_console_tx_policy = {
+	.add    = usb_console_tx_added,
+	.remove = usb_console_tx_removed,
+};
+
+static struct queue const tx_q = QUEUE(QUEUE_SIZE_USB_TX, uint8_t,
+				       usb_console_tx_policy);
 static struct queue const rx_q = QUEUE(QUEUE_SIZE_USB_RX, uint8_t,
 				       usb_console_policy);
 
@@ -81,16 +102,54 @@ static void uart_console_rd(struct queue_policy const *policy, size_t count)
 	/* do nothing */
 }
 
-static void handle_output(void)
+static void usb_console_tx_added(struct queue_policy const *policy,
+				 size_t count)
+{
+	/* do nothing; see handle_output() */
+}
+
+static void usb_console_tx_removed(struct queue_policy const *policy,
+				   size_t count)
 {
-	/* Wake up the Tx FIFO handler */
+	task_id_t waiter = tx_waiter;
+
+	if (waiter != TASK_ID_INVALID)
+		task_set_event(waiter, TASK_EVENT_USB_CONSOLE_TX, 0);
+}
+
+/* Set while a flush of less than a packet is scheduled */
+static int flush_pending;
+
+static void usb_console_flush(void)
+{
+	flush_pending = 0;
 	usb_console.consumer.ops->written(&usb_console.consumer, 1);
 }
+DECLARE_DEFERRED(usb_console_flush);
+
+static void handle_output(void)
+{
+	/*
+	 * Wake up the Tx FIFO handler once there is a full packet; give less
+	 * than that a moment to fill up. While the endpoint is busy, the Tx
+	 * handler sends full packets from the queue as each one completes.
+	 *
+	 * The flush has its own deferred call, as rescheduling the stream's
+	 * would hold up its Rx handling, and it isn't pushed back by later
+	 * output, so the wait stays bounded.
+	 */
+	if (queue_count(&tx_q) >= USB_MAX_PACKET_SIZE) {
+		usb_console.consumer.ops->written(&usb_console.consumer, 1);
+	} else if (!flush_pending) {
+		flush_pending = 1;
+		hook_call_deferred(&usb_console_flush_data,
+				   USB_CONSOLE_FLUSH_US);
+	}
+}
 
 static int usb_wait_console(void)
 {
 	timestamp_t deadline = get_time();
-	int wait_time_us = 1;
 
 	if (!is_enabled || !tx_fifo_is_ready(&usb_console))
 		return EC_SUCCESS;
@@ -110,14 +169,21 @@ static int usb_wait_console(void)
 			if (timestamp_expired(deadline, NULL) ||
 			    in_interrupt_context()) {
 				last_tx_ok = 0;
-				return EC_ERROR_TIMEOUT;
+				break;
 			}
-			if (wait_time_us < MSEC)
-				udelay(wait_time_us);
-			else
-				usleep(wait_time_us);
-			wait_time_us *= 2;
+			/*
+			 * Wait for the endpoint to take a packet. Check again
+			 * every millisecond, as nothing wakes us on USB reset.
+			 * Other events stay pending for the task.
+			 */
+			tx_waiter = task_get_current();
+			task_wait_event_mask(TASK_EVENT_USB_CONSOLE_TX,
+					     MIN(deadline.val - get_time().val,
+						 MSEC));
+			tx_waiter = TASK_ID_INVALID;
 		}
+		if (!last_tx_ok)
+			return EC_ERROR_TIMEOUT;
 	} else {
 		last_tx_ok = queue_space(&tx_q);
 	}
@@ -139,29 +205,53 @@ uint32_t usb_console_crc(void)
 }
 #endif
 
-static int __tx_char(void *context, int c)
+static int tx_add(const char *s, size_t len)
 {
-	int ret;
-
-	if (c == '\n') {
-		ret = __tx_char(NULL, '\r');
-		if (ret)
-			return ret;
-	}
-
 #ifdef CONFIG_USB_CONSOLE_CRC
-	crc32_ctx_hash8(&usb_tx_crc_ctx, c);
+	size_t n;
 
-	while (queue_add_unit(&tx_q, &c) != 1)
+	crc32_ctx_hash(&usb_tx_crc_ctx, s, len);
+
+	/* Everything hashed must be sent, for the CRC to match */
+	while ((n = queue_add_units(&tx_q, s, len)) < len) {
+		s += n;
+		len -= n;
+		usb_console.consumer.ops->written(&usb_console.consumer, 1);
 		usleep(500);
+	}
 
 	return EC_SUCCESS;
 #else
-	/* Return 0 on success */
-	return queue_add_unit(&tx_q, &c) ? EC_SUCCESS : EC_ERROR_OVERFLOW;
+	return queue_add_units(&tx_q, s, len) == len ?
+		EC_SUCCESS : EC_ERROR_OVERFLOW;
 #endif
 }
 
+/* Add a run of output to the Tx queue, turning newlines into CRLF. */
+static int __tx_buf(void *context, const char *s, int len)
+{
+	const char *nl;
+	int n, ret;
+
+	while (len) {
+		nl = memchr(s, '\n', len);
+		n = nl ? nl - s : len;
+
+		ret = tx_add(s, n);
+		if (!ret && nl) {
+			ret = tx_add("\r\n", 2);
+			n++;
+		}
+		if (ret)
+			return ret;
+
+		s += n;
+		len -= n;
+	}
+
+	return EC_SUCCESS;
+}
+
 /*
  * Public USB console implementation below.
  */
@@ -189,11 +279,7 @@ int usb_puts(const char *outstr)
 	if (ret)
 		return ret;
 
-	while (*outstr) {
-		ret = __tx_char(NULL, *outstr++);
-		if (ret)
-			break;
-	}
+	ret = __tx_buf(NULL, outstr, strlen(outstr));
 	handle_output();
 
 	return ret;
@@ -219,7 +305,7 @@ int usb_vprintf(const char *format, va_list args)
 	if (ret)
 		return ret;
 
-	ret = vfnprintf(__tx_char, NULL, format, args);
+	ret = vfnprintf_bulk(__tx_buf, NULL, format, args);
 
 	handle_output();
 
@@ -46,6 +46,116 @@ int dp_flags[CONFIG_USB_PD_PORT_MAX_COUNT];
 
 uint32_t dp_status[CONFIG_USB_PD_PORT_MAX_COUNT];
 
+#ifdef CONFIG_USB_PD_DISCOVERY_CACHE
+/*
+ * Discovery results of recently seen partners and cables, keyed by their
+ * full Discover Identity response (VID, XID, PID, product VDOs).
+ */
+struct discovery_cache_entry {
+	enum tcpm_transmit_type type;
+	int identity_cnt;
+	union disc_ident_ack identity;
+	struct svid_mode_data svids[SVID_DISCOVERY_MAX];
+	int svid_idx;
+	int svid_cnt;
+};
+
+static struct discovery_cache_entry
+	discovery_cache[CONFIG_USB_PD_DISCOVERY_CACHE];
+static int discovery_cache_count;
+/* Next entry to replace once the cache is full */
+static int discovery_cache_next;
+
+static struct discovery_cache_entry *discovery_cache_find(
+		enum tcpm_transmit_type type, const struct pd_discovery *disc)
+{
+	int i;
+
+	for (i = 0; i < discovery_cache_count; i++) {
+		struct discovery_cache_entry *entry = &discovery_cache[i];
+
+		if (entry->type == type &&
+		    entry->identity_cnt == disc->identity_cnt &&
+		    !memcmp(entry->identity.raw_value,
+			    disc->identity.raw_value,
+			    disc->identity_cnt * sizeof(uint32_t)))
+			return entry;
+	}
+
+	return NULL;
+}
+
+/*
+ * Save the results once discovery completed successfully for this SOP*:
+ * identity and SVIDs ACKed, and modes discovered for every SVID.
+ */
+static void discovery_cache_update(int port, enum tcpm_transmit_type type)
+{
+	struct pd_discovery *disc = pd_get_am_discovery(port, type);
+	struct discovery_cache_entry *entry;
+
+	if (disc->identity_discovery != PD_DISC_COMPLETE ||
+	    disc->svids_discovery != PD_DISC_COMPLETE ||
+	    pd_get_modes_discovery(port, type) != PD_DISC_COMPLETE)
+		return;
+
+	entry = discovery_cache_find(type, disc);
+	if (!entry) {
+		if (discovery_cache_count < ARRAY_SIZE(discovery_cache)) {
+			entry = &discovery_cache[discovery_cache_count++];
+		} else {
+			entry = &discovery_cache[discovery_cache_next];
+			discovery_cache_next = (discovery_cache_next + 1) %
+					       ARRAY_SIZE(discovery_cache);
+		}
+	}
+
+	entry->type = type;
+	entry->identity_cnt = disc->identity_cnt;
+	entry->identity = disc->identity;
+	memcpy(entry->svids, disc->svids, sizeof(entry->svids));
+	entry->svid_idx = disc->svid_idx;
+	entry->svid_cnt = disc->svid_cnt;
+}
+
+/*
+ * Called with a freshly ACKed identity: if this partner or cable was seen
+ * before, skip SVIDs and modes discovery.
+ */
+static void discovery_cache_restore(int port, enum tcpm_transmit_type type)
+{
+	struct pd_discovery *disc = pd_get_am_discovery(port, type);
+	const struct discovery_cache_entry *entry;
+
+	entry = discovery_cache_find(type, disc);
+	if (!entry)
+		return;
+
+	memcpy(disc->svids, entry->svids, sizeof(disc->svids));
+	disc->svid_idx = entry->svid_idx;
+	disc->svid_cnt = entry->svid_cnt;
+	disc->svids_discovery = PD_DISC_COMPLETE;
+	CPRINTS("C%d: SOP%s discovery restored from cache (%d SVIDs)", port,
+		type == TCPC_TX_SOP ? "" : "'", disc->svid_cnt);
+}
+
+void pd_discovery_cache_clear(void)
+{
+	discovery_cache_count = 0;
+	discovery_cache_next = 0;
+}
+#else
+static inline void discovery_cache_update(int port,
+					  enum tcpm_transmit_type type)
+{
+}
+
+static inline void discovery_cache_restore(int port,
+					   enum tcpm_transmit_type type)
+{
+}
+#endif /* CONFIG_USB_PD_DISCOVERY_CACHE */
+
 __overridable const struct svdm_response svdm_rsp = {
 	.identity = NULL,
 	.svids = NULL,
@@ -356,6 +466,7 @@ void dfp_consume_identity(int port, enum tcpm_transmit_type type, int cnt,
 		break;
 	}
 	pd_set_identity_discovery(port, type, PD_DISC_COMPLETE);
+	discovery_cache_restore(port, type);
 }
 
 void dfp_consume_svids(int port, enum tcpm_transmit_type type, int cnt,
@@ -509,6 +620,9 @@ void pd_set_svids_discovery(int port, enum tcpm_transmit_type type,
 	struct pd_discovery *pd = pd_get_am_discovery(port, type);
 
 	pd->svids_discovery = disc;
+	/* No SVIDs means there are no modes to discover either */
+	if (disc == PD_DISC_COMPLETE && !pd->svid_cnt)
+		discovery_cache_update(port, type);
 }
 
 enum pd_discovery_state pd_get_svids_discovery(int port,
@@ -546,6 +660,7 @@ void pd_set_modes_discovery(int port, enum tcpm_transmit_type type,
 			continue;
 
 		mode_data->discovery = disc;
+		discovery_cache_update(port, type);
 		return;
 	}
 }
@@ -87,6 +87,142 @@ static const uint16_t bmc4b5b[] = {
 /* Reserved    Error        11111 */
 };
 
+#ifdef CONFIG_USB_PD_TCPC_FAST_PATH
+/*
+ * Two 4b5b symbols (10 bits, first symbol in the low bits) to one byte.
+ * Invalid symbols and K-codes decode to garbage which fails the CRC check.
+ */
+static const uint8_t dec4b5b_pair[1024] = {
+/* 000 */ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x13,
+/* 008 */ 0x10, 0x01, 0x04, 0x05, 0x10, 0x15, 0x06, 0x07,
+/* 010 */ 0x10, 0x12, 0x08, 0x09, 0x02, 0x03, 0x0a, 0x0b,
+/* 018 */ 0x11, 0x14, 0x0c, 0x0d, 0x0e, 0x0f, 0x00, 0x10,
+/* 020 */ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x13,
+/* 028 */ 0x10, 0x01, 0x04, 0x05, 0x10, 0x15, 0x06, 0x07,
+/* 030 */ 0x10, 0x12, 0x08, 0x09, 0x02, 0x03, 0x0a, 0x0b,
+/* 038 */ 0x11, 0x14, 0x0c, 0x0d, 0x0e, 0x0f, 0x00, 0x10,
+/* 040 */ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x13,
+/* 048 */ 0x10, 0x01, 0x04, 0x05, 0x10, 0x15, 0x06, 0x07,
+/* 050 */ 0x10, 0x12, 0x08, 0x09, 0x02, 0x03, 0x0a, 0x0b,
+/* 058 */ 0x11, 0x14, 0x0c, 0x0d, 0x0e, 0x0f, 0x00, 0x10,
+/* 060 */ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x13,
+/* 068 */ 0x10, 0x01, 0x04, 0x05, 0x10, 0x15, 0x06, 0x07,
+/* 070 */ 0x10, 0x12, 0x08, 0x09, 0x02, 0x03, 0x0a, 0x0b,
+/* 078 */ 0x11, 0x14, 0x0c, 0x0d, 0x0e, 0x0f, 0x00, 0x10,
+/* 080 */ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x13,
+/* 088 */ 0x10, 0x01, 0x04, 0x05, 0x10, 0x15, 0x06, 0x07,
+/* 090 */ 0x10, 0x12, 0x08, 0x09, 0x02, 0x03, 0x0a, 0x0b,
+/* 098 */ 0x11, 0x14, 0x0c, 0x0d, 0x0e, 0x0f, 0x00, 0x10,
+/* 0a0 */ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x13,
+/* 0a8 */ 0x10, 0x01, 0x04, 0x05, 0x10, 0x15, 0x06, 0x07,
+/* 0b0 */ 0x10, 0x12, 0x08, 0x09, 0x02, 0x03, 0x0a, 0x0b,
+/* 0b8 */ 0x11, 0x14, 0x0c, 0x0d, 0x0e, 0x0f, 0x00, 0x10,
+/* 0c0 */ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x13,
+/* 0c8 */ 0x10, 0x01, 0x04, 0x05, 0x10, 0x15, 0x06, 0x07,
+/* 0d0 */ 0x10, 0x12, 0x08, 0x09, 0x02, 0x03, 0x0a, 0x0b,
+/* 0d8 */ 0x11, 0x14, 0x0c, 0x0d, 0x0e, 0x0f, 0x00, 0x10,
+/* 0e0 */ 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x33,
+/* 0e8 */ 0x30, 0x31, 0x34, 0x35, 0x30, 0x35, 0x36, 0x37,
+/* 0f0 */ 0x30, 0x32, 0x38, 0x39, 0x32, 0x33, 0x3a, 0x3b,
+/* 0f8 */ 0x31, 0x34, 0x3c, 0x3d, 0x3e, 0x3f, 0x30, 0x30,
+/* 100 */ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x13,
+/* 108 */ 0x10, 0x01, 0x04, 0x05, 0x10, 0x15, 0x06, 0x07,
+/* 110 */ 0x10, 0x12, 0x08, 0x09, 0x02, 0x03, 0x0a, 0x0b,
+/* 118 */ 0x11, 0x14, 0x0c, 0x0d, 0x0e, 0x0f, 0x00, 0x10,
+/* 120 */ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x13,
+/* 128 */ 0x10, 0x11, 0x14, 0x15, 0x10, 0x15, 0x16, 0x17,
+/* 130 */ 0x10, 0x12, 0x18, 0x19, 0x12, 0x13, 0x1a, 0x1b,
+/* 138 */ 0x11, 0x14, 0x1c, 0x1d, 0x1e, 0x1f, 0x10, 0x10,
+/* 140 */ 0x50, 0x50, 0x50, 0x50, 0x50, 0x50, 0x50, 0x53,
+/* 148 */ 0x50, 0x41, 0x44, 0x45, 0x50, 0x55, 0x46, 0x47,
+/* 150 */ 0x50, 0x52, 0x48, 0x49, 0x42, 0x43, 0x4a, 0x4b,
+/* 158 */ 0x51, 0x54, 0x4c, 0x4d, 0x4e, 0x4f, 0x40, 0x50,
+/* 160 */ 0x50, 0x50, 0x50, 0x50, 0x50, 0x50, 0x50, 0x53,
+/* 168 */ 0x50, 0x51, 0x54, 0x55, 0x50, 0x55, 0x56, 0x57,
+/* 170 */ 0x50, 0x52, 0x58, 0x59, 0x52, 0x53, 0x5a, 0x5b,
+/* 178 */ 0x51, 0x54, 0x5c, 0x5d, 0x5e, 0x5f, 0x50, 0x50,
+/* 180 */ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x13,
+/* 188 */ 0x10, 0x01, 0x04, 0x05, 0x10, 0x15, 0x06, 0x07,
+/* 190 */ 0x10, 0x12, 0x08, 0x09, 0x02, 0x03, 0x0a, 0x0b,
+/* 198 */ 0x11, 0x14, 0x0c, 0x0d, 0x0e, 0x0f, 0x00, 0x10,
+/* 1a0 */ 0x50, 0x50, 0x50, 0x50, 0x50, 0x50, 0x50, 0x53,
+/* 1a8 */ 0x50, 0x51, 0x54, 0x55, 0x50, 0x55, 0x56, 0x57,
+/* 1b0 */ 0x50, 0x52, 0x58, 0x59, 0x52, 0x53, 0x5a, 0x5b,
+/* 1b8 */ 0x51, 0x54, 0x5c, 0x5d, 0x5e, 0x5f, 0x50, 0x50,
+/* 1c0 */ 0x70, 0x70, 0x70, 0x70, 0x70, 0x70, 0x70, 0x73,
+/* 1c8 */ 0x70, 0x61, 0x64, 0x65, 0x70, 0x75, 0x66, 0x67,
+/* 1d0 */ 0x70, 0x72, 0x68, 0x69, 0x62, 0x63, 0x6a, 0x6b,
+/* 1d8 */ 0x71, 0x74, 0x6c, 0x6d, 0x6e, 0x6f, 0x60, 0x70,
+/* 1e0 */ 0x70, 0x70, 0x70, 0x70, 0x70, 0x70, 0x70, 0x73,
+/* 1e8 */ 0x70, 0x71, 0x74, 0x75, 0x70, 0x75, 0x76, 0x77,
+/* 1f0 */ 0x70, 0x72, 0x78, 0x79, 0x72, 0x73, 0x7a, 0x7b,
+/* 1f8 */ 0x71, 0x74, 0x7c, 0x7d, 0x7e, 0x7f, 0x70, 0x70,
+/* 200 */ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x13,
+/* 208 */ 0x10, 0x01, 0x04, 0x05, 0x10, 0x15, 0x06, 0x07,
+/* 210 */ 0x10, 0x12, 0x08, 0x09, 0x02, 0x03, 0x0a, 0x0b,
+/* 218 */ 0x11, 0x14, 0x0c, 0x0d, 0x0e, 0x0f, 0x00, 0x10,
+/* 220 */ 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x33,
+/* 228 */ 0x30, 0x21, 0x24, 0x25, 0x30, 0x35, 0x26, 0x27,
+/* 230 */ 0x30, 0x32, 0x28, 0x29, 0x22, 0x23, 0x2a, 0x2b,
+/* 238 */ 0x31, 0x34, 0x2c, 0x2d, 0x2e, 0x2f, 0x20, 0x30,
+/* 240 */ 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x93,
+/* 248 */ 0x90, 0x81, 0x84, 0x85, 0x90, 0x95, 0x86, 0x87,
+/* 250 */ 0x90, 0x92, 0x88, 0x89, 0x82, 0x83, 0x8a, 0x8b,
+/* 258 */ 0x91, 0x94, 0x8c, 0x8d, 0x8e, 0x8f, 0x80, 0x90,
+/* 260 */ 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x93,
+/* 268 */ 0x90, 0x91, 0x94, 0x95, 0x90, 0x95, 0x96, 0x97,
+/* 270 */ 0x90, 0x92, 0x98, 0x99, 0x92, 0x93, 0x9a, 0x9b,
+/* 278 */ 0x91, 0x94, 0x9c, 0x9d, 0x9e, 0x9f, 0x90, 0x90,
+/* 280 */ 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x33,
+/* 288 */ 0x30, 0x21, 0x24, 0x25, 0x30, 0x35, 0x26, 0x27,
+/* 290 */ 0x30, 0x32, 0x28, 0x29, 0x22, 0x23, 0x2a, 0x2b,
+/* 298 */ 0x31, 0x34, 0x2c, 0x2d, 0x2e, 0x2f, 0x20, 0x30,
+/* 2a0 */ 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x33,
+/* 2a8 */ 0x30, 0x31, 0x34, 0x35, 0x30, 0x35, 0x36, 0x37,
+/* 2b0 */ 0x30, 0x32, 0x38, 0x39, 0x32, 0x33, 0x3a, 0x3b,
+/* 2b8 */ 0x31, 0x34, 0x3c, 0x3d, 0x3e, 0x3f, 0x30, 0x30,
+/* 2c0 */ 0xb0, 0xb0, 0xb0, 0xb0, 0xb0, 0xb0, 0xb0, 0xb3,
+/* 2c8 */ 0xb0, 0xa1, 0xa4, 0xa5, 0xb0, 0xb5, 0xa6, 0xa7,
+/* 2d0 */ 0xb0, 0xb2, 0xa8, 0xa9, 0xa2, 0xa3, 0xaa, 0xab,
+/* 2d8 */ 0xb1, 0xb4, 0xac, 0xad, 0xae, 0xaf, 0xa0, 0xb0,
+/* 2e0 */ 0xb0, 0xb0, 0xb0, 0xb0, 0xb0, 0xb0, 0xb0, 0xb3,
+/* 2e8 */ 0xb0, 0xb1, 0xb4, 0xb5, 0xb0, 0xb5, 0xb6, 0xb7,
+/* 2f0 */ 0xb0, 0xb2, 0xb8, 0xb9, 0xb2, 0xb3, 0xba, 0xbb,
+/* 2f8 */ 0xb1, 0xb4, 0xbc, 0xbd, 0xbe, 0xbf, 0xb0, 0xb0,
+/* 300 */ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x13,
+/* 308 */ 0x10, 0x11, 0x14, 0x15, 0x10, 0x15, 0x16, 0x17,
+/* 310 */ 0x10, 0x12, 0x18, 0x19, 0x12, 0x13, 0x1a, 0x1b,
+/* 318 */ 0x11, 0x14, 0x1c, 0x1d, 0x1e, 0x1f, 0x10, 0x10,
+/* 320 */ 0x50, 0x50, 0x50, 0x50, 0x50, 0x50, 0x50, 0x53,
+/* 328 */ 0x50, 0x41, 0x44, 0x45, 0x50, 0x55, 0x46, 0x47,
+/* 330 */ 0x50, 0x52, 0x48, 0x49, 0x42, 0x43, 0x4a, 0x4b,
+/* 338 */ 0x51, 0x54, 0x4c, 0x4d, 0x4e, 0x4f, 0x40, 0x50,
+/* 340 */ 0xd0, 0xd0, 0xd0, 0xd0, 0xd0, 0xd0, 0xd0, 0xd3,
+/* 348 */ 0xd0, 0xc1, 0xc4, 0xc5, 0xd0, 0xd5, 0xc6, 0xc7,
+/* 350 */ 0xd0, 0xd2, 0xc8, 0xc9, 0xc2, 0xc3, 0xca, 0xcb,
+/* 358 */ 0xd1, 0xd4, 0xcc, 0xcd, 0xce, 0xcf, 0xc0, 0xd0,
+/* 360 */ 0xd0, 0xd0, 0xd0, 0xd0, 0xd0, 0xd0, 0xd0, 0xd3,
+/* 368 */ 0xd0, 0xd1, 0xd4, 0xd5, 0xd0, 0xd5, 0xd6, 0xd7,
+/* 370 */ 0xd0, 0xd2, 0xd8, 0xd9, 0xd2, 0xd3, 0xda, 0xdb,
+/* 378 */ 0xd1, 0xd4, 0xdc, 0xdd, 0xde, 0xdf, 0xd0, 0xd0,
+/* 380 */ 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf3,
+/* 388 */ 0xf0, 0xe1, 0xe4, 0xe5, 0xf0, 0xf5, 0xe6, 0xe7,
+/* 390 */ 0xf0, 0xf2, 0xe8, 0xe9, 0xe2, 0xe3, 0xea, 0xeb,
+/* 398 */ 0xf1, 0xf4, 0xec, 0xed, 0xee, 0xef, 0xe0, 0xf0,
+/* 3a0 */ 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf3,
+/* 3a8 */ 0xf0, 0xf1, 0xf4, 0xf5, 0xf0, 0xf5, 0xf6, 0xf7,
+/* 3b0 */ 0xf0, 0xf2, 0xf8, 0xf9, 0xf2, 0xf3, 0xfa, 0xfb,
+/* 3b8 */ 0xf1, 0xf4, 0xfc, 0xfd, 0xfe, 0xff, 0xf0, 0xf0,
+/* 3c0 */ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x13,
+/* 3c8 */ 0x10, 0x01, 0x04, 0x05, 0x10, 0x15, 0x06, 0x07,
+/* 3d0 */ 0x10, 0x12, 0x08, 0x09, 0x02, 0x03, 0x0a, 0x0b,
+/* 3d8 */ 0x11, 0x14, 0x0c, 0x0d, 0x0e, 0x0f, 0x00, 0x10,
+/* 3e0 */ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x13,
+/* 3e8 */ 0x10, 0x01, 0x04, 0x05, 0x10, 0x15, 0x06, 0x07,
+/* 3f0 */ 0x10, 0x12, 0x08, 0x09, 0x02, 0x03, 0x0a, 0x0b,
+/* 3f8 */ 0x11, 0x14, 0x0c, 0x0d, 0x0e, 0x0f, 0x00, 0x10,
+};
+#else
 static const uint8_t dec4b5b[] = {
 /* Error    */ 0x10 /* 00000 */,
 /* Error    */ 0x10 /* 00001 */,
@@ -121,6 +257,7 @@ static const uint8_t dec4b5b[] = {
 /* 0 = 0000 */ 0x00 /* 11110 */,
 /* Error    */ 0x10 /* 11111 */,
 };
+#endif /* CONFIG_USB_PD_TCPC_FAST_PATH */
 
 /* Start of Packet sequence : three Sync-1 K-codes, then one Sync-2 K-code */
 #define PD_SOP (PD_SYNC1 | (PD_SYNC1<<5) | (PD_SYNC1<<10) | (PD_SYNC2<<15))
@@ -228,6 +365,17 @@ union pd_header_sop {
 #define RX_BUFFER_SIZE 2
 #endif
 
+#ifdef CONFIG_USB_PD_TCPC_FAST_PATH
+/* BMC symbols of a GoodCRC message after SOP: 16-bit header + 32-bit CRC */
+#define GOODCRC_SYMS ((16 + 32) / 4)
+
+struct goodcrc_template {
+	/* Header the symbols were computed for, 0 if none yet */
+	uint16_t header;
+	uint16_t sym[GOODCRC_SYMS];
+};
+#endif
+
 static struct pd_port_controller {
 	/* current port power role (SOURCE or SINK) */
 	uint8_t power_role;
@@ -263,6 +411,11 @@ static struct pd_port_controller {
 	uint16_t tx_head;
 	uint32_t tx_payload[7];
 	const uint32_t *tx_data;
+
+#ifdef CONFIG_USB_PD_TCPC_FAST_PATH
+	/* Precomputed GoodCRC for each MessageID */
+	struct goodcrc_template goodcrc[8];
+#endif
 } pd[CONFIG_USB_PD_PORT_MAX_COUNT];
 
 static int rx_buf_is_full(int port)
@@ -307,11 +460,11 @@ int encode_word(int port, int off, uint32_t val32)
 	return encode_short(port, off, (val32 >> 16) & 0xFFFF);
 }
 
-/* prepare a 4b/5b-encoded PD message to send */
-int prepare_message(int port, uint16_t header, uint8_t cnt,
-		   const uint32_t *data)
+/* write the 64-bit preamble and the Start Of Packet sequence */
+static int write_preamble_sop(int port)
 {
-	int off, i;
+	int off;
+
 	/* 64-bit preamble */
 	off = pd_write_preamble(port);
 #if defined(CONFIG_USB_VPD) || defined(CONFIG_USB_CTVPD)
@@ -327,6 +480,16 @@ int prepare_message(int port, uint16_t header, uint8_t cnt,
 	off = pd_write_sym(port, off, BMC(PD_SYNC1));
 	off = pd_write_sym(port, off, BMC(PD_SYNC2));
 #endif
+	return off;
+}
+
+/* prepare a 4b/5b-encoded PD message to send */
+int prepare_message(int port, uint16_t header, uint8_t cnt,
+		   const uint32_t *data)
+{
+	int off, i;
+
+	off = write_preamble_sop(port);
 	/* header */
 	off = encode_short(port, off, header);
 
@@ -461,11 +624,61 @@ static int send_validate_message(int port, uint16_t header,
 	return PD_TX_ERR_GOODCRC;
 }
 
+#ifdef CONFIG_USB_PD_TCPC_FAST_PATH
+static void goodcrc_sym_short(uint16_t *sym, uint16_t val16)
+{
+	int i;
+
+	for (i = 0; i < 4; i++, val16 >>= 4)
+		sym[i] = bmc4b5b[val16 & 0xF];
+}
+
+/*
+ * Prepare a GoodCRC message from the template for its MessageID, only
+ * computing the template again when the header (i.e. our roles) changed.
+ */
+static int prepare_goodcrc(int port, uint16_t header)
+{
+	struct goodcrc_template *t = &pd[port].goodcrc[PD_HEADER_ID(header)];
+	int off, i;
+
+	if (t->header != header) {
+		uint32_t crc;
+
+#ifdef CONFIG_COMMON_RUNTIME
+		mutex_lock(&pd_crc_lock);
+#endif
+		crc32_init();
+		crc32_hash16(header);
+		crc = crc32_result();
+#ifdef CONFIG_COMMON_RUNTIME
+		mutex_unlock(&pd_crc_lock);
+#endif
+		goodcrc_sym_short(t->sym, header);
+		goodcrc_sym_short(t->sym + 4, crc & 0xFFFF);
+		goodcrc_sym_short(t->sym + 8, crc >> 16);
+		t->header = header;
+	}
+
+	off = write_preamble_sop(port);
+	for (i = 0; i < GOODCRC_SYMS; i++)
+		off = pd_write_sym(port, off, t->sym[i]);
+	/* End Of Packet */
+	off = pd_write_sym(port, off, BMC(PD_EOP));
+	/* Ensure that we have a final edge */
+	return pd_write_last_edge(port, off);
+}
+#endif
+
 static void send_goodcrc(int port, int id)
 {
 	uint16_t header = PD_HEADER(PD_CTRL_GOOD_CRC, pd[port].power_role,
 			pd[port].data_role, id, 0, 0, 0);
+#ifdef CONFIG_USB_PD_TCPC_FAST_PATH
+	int bit_len = prepare_goodcrc(port, header);
+#else
 	int bit_len = prepare_message(port, header, 0, NULL);
+#endif
 
 	if (pd_start_tx(port, pd[port].polarity, bit_len) < 0)
 		/* another packet recvd before we could send goodCRC */
@@ -560,6 +773,10 @@ static inline int decode_short(int port, int off, uint16_t *val16)
 
 	end = pd_dequeue_bits(port, off, 20, &w);
 
+#ifdef CONFIG_USB_PD_TCPC_FAST_PATH
+	*val16 = dec4b5b_pair[w & 0x3ff] |
+		(dec4b5b_pair[(w >> 10) & 0x3ff] << 8);
+#else
 #if 0 /* DEBUG */
 	CPRINTS("%d-%d: %05x %x:%x:%x:%x",
 		off, end, w,
@@ -570,6 +787,7 @@ static inline int decode_short(int port, int off, uint16_t *val16)
 		(dec4b5b[(w >>  5) & 0x1f] << 4) |
 		(dec4b5b[(w >> 10) & 0x1f] << 8) |
 		(dec4b5b[(w >> 15) & 0x1f] << 12);
+#endif
 	return end;
 }
 
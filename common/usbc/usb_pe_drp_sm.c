@@ -4727,6 +4727,24 @@ static void pe_vdm_send_request_exit(int port)
 	pe[port].tx_type = TCPC_TX_INVALID;
 }
 
+/*
+ * If the identity matched an entry of the discovery cache, SVIDs and modes
+ * were restored along with it and discovery is done.
+ */
+static void pe_notify_cached_discovery(int port)
+{
+#ifdef CONFIG_USB_PD_DISCOVERY_CACHE
+	enum tcpm_transmit_type type = pe[port].tx_type;
+
+	if (pd_get_identity_discovery(port, type) == PD_DISC_COMPLETE &&
+	    pd_get_svids_discovery(port, type) == PD_DISC_COMPLETE &&
+	    pd_get_modes_discovery(port, type) != PD_DISC_NEEDED)
+		pe_notify_event(port, type == TCPC_TX_SOP ?
+				PD_STATUS_EVENT_SOP_DISC_DONE :
+				PD_STATUS_EVENT_SOP_PRIME_DISC_DONE);
+#endif
+}
+
 /**
  * PE_VDM_IDENTITY_REQUEST_CBL
  * Combination of PE_INIT_PORT_VDM_Identity_Request State specific to the
@@ -4900,6 +4918,8 @@ static void pe_vdm_identity_request_cbl_exit(int port)
 	/* Do not attempt further discovery if identity discovery failed. */
 	if (pd_get_identity_discovery(port, pe[port].tx_type) == PD_DISC_FAIL)
 		pd_set_svids_discovery(port, pe[port].tx_type, PD_DISC_FAIL);
+
+	pe_notify_cached_discovery(port);
 }
 
 /**
@@ -4986,6 +5006,8 @@ static void pe_init_port_vdm_identity_request_exit(int port)
 	/* Do not attempt further discovery if identity discovery failed. */
 	if (pd_get_identity_discovery(port, pe[port].tx_type) == PD_DISC_FAIL)
 		pd_set_svids_discovery(port, pe[port].tx_type, PD_DISC_FAIL);
+
+	pe_notify_cached_discovery(port);
 }
 
 /**
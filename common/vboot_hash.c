@@ -33,23 +33,128 @@ struct vboot_hash_tag {
 #define VBOOT_HASH_SYSJUMP_TAG 0x5648 /* "VH" */
 #define VBOOT_HASH_SYSJUMP_VERSION 1
 
-#define CHUNK_SIZE 1024       /* Bytes to hash per deferred call */
+#define CHUNK_SIZE 1024       /* Smallest piece hashed at a time */
 #define WORK_INTERVAL_US 100  /* Delay between deferred calls */
 
 /* Check that CHUNK_SIZE fits in shared memory. */
 SHARED_MEM_CHECK_SIZE(CHUNK_SIZE);
 
+#ifndef CONFIG_MAPPED_STORAGE
+/*
+ * Largest buffer to read flash into; more is not much faster. The buffer
+ * takes at most half of shared memory, to leave some for others.
+ */
+#define BUF_SIZE_MAX (8 * 1024)
+#endif
+
 static uint32_t data_offset;
 static uint32_t data_size;
 static uint32_t curr_pos;
+static uint8_t hash_type;     /* enum ec_vboot_hash_type */
 static const uint8_t *hash;   /* Hash, or NULL if not valid */
 static int want_abort;
 static int in_progress;
 #define VBOOT_HASH_DEFERRED	true
 #define VBOOT_HASH_BLOCKING	false
 
+/* Time the hash started, and CPU time and wall time it took, in us */
+static timestamp_t hash_start_time;
+static uint32_t hash_cpu_us;
+static uint32_t hash_us;
+
+#ifndef CONFIG_MAPPED_STORAGE
+/* Buffer to read flash into, held for one deferred call at most */
+static char *buf;
+static int buf_size;
+#endif
+
 static struct sha256_ctx ctx;
 
+#ifdef CONFIG_VBOOT_HASH_TREE
+#define TREE_BLOCK_SIZE EC_VBOOT_HASH_TREE_BLOCK_SIZE
+#define TREE_BLOCKS DIV_ROUND_UP(CONFIG_RW_SIZE, TREE_BLOCK_SIZE)
+
+/*
+ * Digests of the blocks of the region last tree hashed, kept across hashes
+ * and cleared block by block as flash is written.
+ */
+static uint32_t tree_offset;
+static uint32_t tree_size;
+static uint8_t tree_hash[TREE_BLOCKS][SHA256_DIGEST_SIZE];
+static uint8_t tree_valid[TREE_BLOCKS];
+
+/* Block being hashed */
+static struct sha256_ctx block_ctx;
+
+/*
+ * Bumped by each invalidation, which may come from another task while a
+ * block is being hashed. The digest of a block is only kept if no
+ * invalidation happened since the block was started.
+ */
+static volatile uint32_t tree_gen;
+static uint32_t block_gen;
+
+static int tree_blocks(void)
+{
+	return DIV_ROUND_UP(tree_size, TREE_BLOCK_SIZE);
+}
+
+/* Mark the digests of the blocks a region overlaps as stale. */
+static void tree_invalidate(int offset, int size)
+{
+	int start = tree_offset;
+	int end = tree_offset + tree_size;
+	int first, last;
+
+	if (offset + size <= start || offset >= end)
+		return;
+
+	first = (MAX(offset, start) - start) / TREE_BLOCK_SIZE;
+	last = (MIN(offset + size, end) - 1 - start) / TREE_BLOCK_SIZE;
+	tree_gen++;
+	memset(tree_valid + first, 0, last - first + 1);
+}
+
+/*
+ * Skip the blocks whose digests are still valid, and size the next piece to
+ * end at most at the end of the block.
+ */
+static int tree_next_piece(int size)
+{
+	while (curr_pos < data_size && tree_valid[curr_pos / TREE_BLOCK_SIZE] &&
+	       !(curr_pos % TREE_BLOCK_SIZE))
+		curr_pos = MIN(curr_pos + TREE_BLOCK_SIZE, data_size);
+
+	if (!(curr_pos % TREE_BLOCK_SIZE)) {
+		SHA256_init(&block_ctx);
+		block_gen = tree_gen;
+	}
+
+	return MIN(MIN(size, data_size - curr_pos),
+		   TREE_BLOCK_SIZE - curr_pos % TREE_BLOCK_SIZE);
+}
+
+/* Save the digest of the block just hashed, if it is complete. */
+static void tree_end_piece(void)
+{
+	int block = (curr_pos - 1) / TREE_BLOCK_SIZE;
+
+	if (curr_pos % TREE_BLOCK_SIZE && curr_pos < data_size)
+		return;
+
+	memcpy(tree_hash[block], SHA256_final(&block_ctx),
+	       SHA256_DIGEST_SIZE);
+
+	/*
+	 * Set, then check, in the opposite order to tree_invalidate(), so a
+	 * block written while it was hashed is never left valid.
+	 */
+	tree_valid[block] = 1;
+	if (block_gen != tree_gen)
+		tree_valid[block] = 0;
+}
+#endif /* CONFIG_VBOOT_HASH_TREE */
+
 int vboot_hash_in_progress(void)
 {
 	return in_progress;
@@ -73,102 +178,200 @@ void vboot_hash_abort(void)
 static void vboot_hash_next_chunk(void);
 DECLARE_DEFERRED(vboot_hash_next_chunk);
 
-#ifndef CONFIG_MAPPED_STORAGE
+#ifdef CONFIG_CONSOLE_VERBOSE
+#define SHA256_PRINT_SIZE SHA256_DIGEST_SIZE
+#else
+#define SHA256_PRINT_SIZE 4
+#endif
 
-static int read_and_hash_chunk(int offset, int size)
+/**
+ * Hash the next size bytes of data, or less if they don't fit in the buffer.
+ *
+ * @return Number of bytes hashed, or -1 on error.
+ */
+static int hash_next_chunk(int size)
 {
-	char *buf;
-	int rv;
-
-	if (size == 0)
-		return EC_SUCCESS;
+	struct sha256_ctx *c = &ctx;
+#ifdef CONFIG_MAPPED_STORAGE
+	const char *p;
+#endif
 
-	rv = shared_mem_acquire(size, &buf);
-	if (rv == EC_ERROR_BUSY) {
-		/* Couldn't update hash right now; try again later */
-		hook_call_deferred(&vboot_hash_next_chunk_data,
-				   WORK_INTERVAL_US);
-		return rv;
-	} else if (rv != EC_SUCCESS) {
-		vboot_hash_abort();
-		return rv;
+#ifdef CONFIG_VBOOT_HASH_TREE
+	if (hash_type == EC_VBOOT_HASH_TYPE_SHA256_TREE) {
+		size = tree_next_piece(size);
+		if (!size)
+			return 0;
+		c = &block_ctx;
 	}
+#endif
 
-	rv = flash_read(offset, size, buf);
-	if (rv == EC_SUCCESS)
-		SHA256_update(&ctx, (const uint8_t *)buf, size);
-	else
-		vboot_hash_abort();
+#ifdef CONFIG_MAPPED_STORAGE
 
-	shared_mem_release(buf);
-	return rv;
-}
+	/* Hash the flash in place */
+	if (flash_dataptr(data_offset + curr_pos, size, 1, &p) < 0)
+		return -1;
+
+	flash_lock_mapped_storage(1);
+	SHA256_update(c, (const uint8_t *)p, size);
+	flash_lock_mapped_storage(0);
+#else
+	size = MIN(size, buf_size);
+	if (flash_read(data_offset + curr_pos, size, buf) != EC_SUCCESS)
+		return -1;
 
+	SHA256_update(c, (const uint8_t *)buf, size);
 #endif
+	curr_pos += size;
 
-#ifdef CONFIG_CONSOLE_VERBOSE
-#define SHA256_PRINT_SIZE SHA256_DIGEST_SIZE
-#else
-#define SHA256_PRINT_SIZE 4
+#ifdef CONFIG_VBOOT_HASH_TREE
+	if (hash_type == EC_VBOOT_HASH_TYPE_SHA256_TREE)
+		tree_end_piece();
 #endif
+	return size;
+}
 
-static void hash_next_chunk(size_t size)
+/**
+ * Get the buffer to read flash into, if there isn't one already.
+ *
+ * @return EC_SUCCESS, or EC_ERROR_BUSY if there is no memory right now.
+ */
+static int get_buffer(void)
 {
-#ifdef CONFIG_MAPPED_STORAGE
-	flash_lock_mapped_storage(1);
-	SHA256_update(&ctx, (const uint8_t *)(CONFIG_MAPPED_STORAGE_BASE +
-					      data_offset + curr_pos), size);
-	flash_lock_mapped_storage(0);
-#else
-	if (read_and_hash_chunk(data_offset + curr_pos, size) != EC_SUCCESS)
-		return;
+#ifndef CONFIG_MAPPED_STORAGE
+	if (buf)
+		return EC_SUCCESS;
+
+	buf_size = MAX(MIN(shared_mem_size() / 2, BUF_SIZE_MAX) & ~3,
+		       CHUNK_SIZE);
+	if (shared_mem_acquire(buf_size, &buf) != EC_SUCCESS) {
+		buf = NULL;
+		return EC_ERROR_BUSY;
+	}
 #endif
+	return EC_SUCCESS;
 }
 
-static void vboot_hash_all_chunks(void)
+/* Give the buffer back, so others can use shared memory between calls. */
+static void put_buffer(void)
 {
-	do {
-		size_t size = MIN(CHUNK_SIZE, data_size - curr_pos);
-		hash_next_chunk(size);
-		curr_pos += size;
-	} while (curr_pos < data_size);
+#ifndef CONFIG_MAPPED_STORAGE
+	if (buf) {
+		shared_mem_release(buf);
+		buf = NULL;
+	}
+#endif
+}
 
-	hash = SHA256_final(&ctx);
-	CPRINTS("hash done %ph", HEX_BUF(hash, SHA256_PRINT_SIZE));
+/* Wrap up the hash, whether done or aborted. */
+static void hash_finish(void)
+{
+	put_buffer();
 	in_progress = 0;
 	clock_enable_module(MODULE_FAST_CPU, 0);
+}
+
+static void hash_done(void)
+{
+	uint32_t rate;
+
+#ifdef CONFIG_VBOOT_HASH_TREE
+	if (hash_type == EC_VBOOT_HASH_TYPE_SHA256_TREE)
+		SHA256_update(&ctx, tree_hash[0],
+			      tree_blocks() * SHA256_DIGEST_SIZE);
+#endif
+
+	/* Store the final hash */
+	hash = SHA256_final(&ctx);
+	hash_us = time_since32(hash_start_time);
 
-	return;
+	/* Bytes per us is MB/s */
+	rate = (uint64_t)data_size * 1000 / MAX(hash_us, 1);
+	CPRINTS("hash done %ph, %d.%03d MB/s",
+		HEX_BUF(hash, SHA256_PRINT_SIZE), rate / 1000, rate % 1000);
+
+	hash_finish();
+}
+
+/**
+ * Size the next piece to hash so that it ends the time budget left, at the
+ * rate reached so far.
+ */
+static int chunk_size(uint32_t budget_us)
+{
+	uint64_t size;
+
+	if (!curr_pos)
+		size = CHUNK_SIZE;
+	else if (!hash_cpu_us)
+		size = curr_pos * 2;	/* Too fast to time yet */
+	else
+		size = (uint64_t)curr_pos * budget_us / hash_cpu_us;
+
+	return MIN(MAX(size, CHUNK_SIZE), data_size - curr_pos);
+}
+
+static int vboot_hash_all_chunks(void)
+{
+	if (get_buffer() != EC_SUCCESS) {
+		hash_finish();
+		return EC_ERROR_BUSY;
+	}
+
+	while (curr_pos < data_size) {
+		if (hash_next_chunk(data_size - curr_pos) < 0) {
+			hash_finish();
+			return EC_ERROR_UNKNOWN;
+		}
+	}
+
+	hash_cpu_us = time_since32(hash_start_time);
+	hash_done();
+	return EC_SUCCESS;
 }
 
 /**
  * Do next chunk of hashing work, if any.
+ *
+ * Hashes for up to CONFIG_VBOOT_HASH_BUDGET_US, in pieces as large as fit in
+ * the time left, then lets other work run for WORK_INTERVAL_US.
  */
 static void vboot_hash_next_chunk(void)
 {
-	int size;
+	uint32_t elapsed = 0;
+	timestamp_t start;
+	uint32_t t;
 
 	/* Handle abort */
 	if (want_abort) {
-		in_progress = 0;
-		clock_enable_module(MODULE_FAST_CPU, 0);
+		hash_finish();
 		vboot_hash_abort();
 		return;
 	}
 
-	/* Compute the next chunk of hash */
-	size = MIN(CHUNK_SIZE, data_size - curr_pos);
-	hash_next_chunk(size);
-
-	curr_pos += size;
-	if (curr_pos >= data_size) {
-		/* Store the final hash */
-		hash = SHA256_final(&ctx);
-		CPRINTS("hash done %ph", HEX_BUF(hash, SHA256_PRINT_SIZE));
+	/* No memory to read flash into right now; try again later */
+	if (get_buffer() != EC_SUCCESS) {
+		hook_call_deferred(&vboot_hash_next_chunk_data,
+				   WORK_INTERVAL_US);
+		return;
+	}
 
-		in_progress = 0;
+	/* Compute the next chunks of hash */
+	while (curr_pos < data_size &&
+	       elapsed < CONFIG_VBOOT_HASH_BUDGET_US) {
+		start = get_time();
+		if (hash_next_chunk(chunk_size(
+			    CONFIG_VBOOT_HASH_BUDGET_US - elapsed)) < 0) {
+			hash_finish();
+			vboot_hash_abort();
+			return;
+		}
+		t = time_since32(start);
+		hash_cpu_us += t;
+		elapsed += t;
+	}
 
-		clock_enable_module(MODULE_FAST_CPU, 0);
+	if (curr_pos >= data_size) {
+		hash_done();
 
 		/* Handle receiving abort during finalize */
 		if (want_abort)
@@ -178,27 +381,27 @@ static void vboot_hash_next_chunk(void)
 	}
 
 	/* If we're still here, more work to do; come back later */
+	put_buffer();
 	hook_call_deferred(&vboot_hash_next_chunk_data, WORK_INTERVAL_US);
 }
 
 /**
+ * Start computing a hash of <size> bytes of data at flash offset <offset>.
  *
  * If nonce_size is non-zero, prefixes the <nonce> onto the data to be hashed.
- * Returns non-zero if error.
- */
-/**
- * Start computing a hash of <size> bytes of data at flash offset <offset>.
  *
  * @param offset	start address of data on flash to compute hash for.
  * @param size		size of data to compute hash for.
  * @param nonce		nonce to differentiate hash.
  * @param nonce_size	size of nonce.
+ * @param type		enum ec_vboot_hash_type.
  * @param deferred	True to hash progressively through deferred calls.
  * 			False to hash with a blocking single call.
  * @return		ec_error_list.
  */
 static int vboot_hash_start(uint32_t offset, uint32_t size,
-			    const uint8_t *nonce, int nonce_size, bool deferred)
+			    const uint8_t *nonce, int nonce_size, int type,
+			    bool deferred)
 {
 	/* Fail if hash computation is already in progress */
 	if (in_progress)
@@ -213,17 +416,39 @@ static int vboot_hash_start(uint32_t offset, uint32_t size,
 		return EC_ERROR_INVAL;
 	}
 
+	if (type == EC_VBOOT_HASH_TYPE_SHA256_TREE) {
+#ifdef CONFIG_VBOOT_HASH_TREE
+		if (size > TREE_BLOCKS * TREE_BLOCK_SIZE)
+			return EC_ERROR_INVAL;
+
+		/* Start over if the region changed */
+		if (offset != tree_offset || size != tree_size) {
+			tree_offset = offset;
+			tree_size = size;
+			memset(tree_valid, 0, sizeof(tree_valid));
+		}
+#else
+		return EC_ERROR_INVAL;
+#endif
+	} else if (type != EC_VBOOT_HASH_TYPE_SHA256) {
+		return EC_ERROR_INVAL;
+	}
+
 	clock_enable_module(MODULE_FAST_CPU, 1);
 	/* Save new hash request */
 	data_offset = offset;
 	data_size = size;
 	curr_pos = 0;
+	hash_type = type;
 	hash = NULL;
 	want_abort = 0;
 	in_progress = 1;
+	hash_start_time = get_time();
+	hash_cpu_us = 0;
 
 	/* Restart the hash computation */
-	CPRINTS("hash start 0x%08x 0x%08x", offset, size);
+	CPRINTS("hash start 0x%08x 0x%08x%s", offset, size,
+		type == EC_VBOOT_HASH_TYPE_SHA256_TREE ? " tree" : "");
 	SHA256_init(&ctx);
 	if (nonce_size)
 		SHA256_update(&ctx, nonce, nonce_size);
@@ -231,17 +456,29 @@ static int vboot_hash_start(uint32_t offset, uint32_t size,
 	if (deferred)
 		hook_call_deferred(&vboot_hash_next_chunk_data, 0);
 	else
-		vboot_hash_all_chunks();
+		return vboot_hash_all_chunks();
 
 	return EC_SUCCESS;
 }
 
+void vboot_hash_invalidate_blocks(int offset, int size)
+{
+#ifdef CONFIG_VBOOT_HASH_TREE
+	if (offset < 0 || size <= 0 || offset + size < 0)
+		return;
+
+	tree_invalidate(offset, size);
+#endif
+}
+
 int vboot_hash_invalidate(int offset, int size)
 {
 	/* Don't invalidate if passed an invalid region */
 	if (offset < 0 || size <= 0 || offset + size < 0)
 		return 0;
 
+	vboot_hash_invalidate_blocks(offset, size);
+
 	/* Don't invalidate if hash is already invalid */
 	if (!hash)
 		return 0;
@@ -308,7 +545,8 @@ static void vboot_hash_init(void)
 	{
 		/* Start computing the hash of RW firmware */
 		vboot_hash_start(flash_get_rw_offset(system_get_active_copy()),
-				 get_rw_size(), NULL, 0, VBOOT_HASH_DEFERRED);
+				 get_rw_size(), NULL, 0, EC_VBOOT_HASH_TYPE_SHA256,
+				 VBOOT_HASH_DEFERRED);
 	}
 }
 DECLARE_HOOK(HOOK_INIT, vboot_hash_init, HOOK_PRIO_INIT_VBOOT_HASH);
@@ -316,7 +554,9 @@ DECLARE_HOOK(HOOK_INIT, vboot_hash_init, HOOK_PRIO_INIT_VBOOT_HASH);
 int vboot_get_rw_hash(const uint8_t **dst)
 {
 	int rv = vboot_hash_start(flash_get_rw_offset(system_get_active_copy()),
-				  get_rw_size(), NULL, 0, VBOOT_HASH_BLOCKING);
+				  get_rw_size(), NULL, 0,
+				  EC_VBOOT_HASH_TYPE_SHA256,
+				  VBOOT_HASH_BLOCKING);
 	*dst = hash;
 	return rv;
 }
@@ -327,8 +567,8 @@ static int vboot_hash_preserve_state(void)
 {
 	struct vboot_hash_tag tag;
 
-	/* If we haven't finished our hash, nothing to save */
-	if (!hash)
+	/* If we haven't finished a plain SHA-256 hash, nothing to save */
+	if (!hash || hash_type != EC_VBOOT_HASH_TYPE_SHA256)
 		return EC_SUCCESS;
 
 	memcpy(tag.hash, hash, sizeof(tag.hash));
@@ -380,6 +620,9 @@ static int command_hash(int argc, char **argv)
 			ccprintf("%ph\n", HEX_BUF(hash, SHA256_DIGEST_SIZE));
 		else
 			ccprintf("(invalid)\n");
+		if (hash && hash_us)
+			ccprintf("Time:   %d us, %d us hashing\n", hash_us,
+				 hash_cpu_us);
 
 		return EC_SUCCESS;
 	}
@@ -392,13 +635,15 @@ static int command_hash(int argc, char **argv)
 			return vboot_hash_start(
 					get_offset(EC_VBOOT_HASH_OFFSET_ACTIVE),
 					get_rw_size(),
-					NULL, 0, VBOOT_HASH_DEFERRED);
+					NULL, 0, EC_VBOOT_HASH_TYPE_SHA256,
+					VBOOT_HASH_DEFERRED);
 		} else if (!strcasecmp(argv[1], "ro")) {
 			return vboot_hash_start(
 				CONFIG_EC_PROTECTED_STORAGE_OFF +
 				CONFIG_RO_STORAGE_OFF,
 				system_get_image_used(EC_IMAGE_RO),
-				NULL, 0, VBOOT_HASH_DEFERRED);
+				NULL, 0, EC_VBOOT_HASH_TYPE_SHA256,
+				VBOOT_HASH_DEFERRED);
 		}
 		return EC_ERROR_PARAM2;
 	}
@@ -420,10 +665,13 @@ static int command_hash(int argc, char **argv)
 
 		return vboot_hash_start(offset, size,
 					(const uint8_t *)&nonce,
-					sizeof(nonce), VBOOT_HASH_DEFERRED);
+					sizeof(nonce),
+					EC_VBOOT_HASH_TYPE_SHA256,
+					VBOOT_HASH_DEFERRED);
 	} else
 		return vboot_hash_start(offset, size,
-					NULL, 0, VBOOT_HASH_DEFERRED);
+					NULL, 0, EC_VBOOT_HASH_TYPE_SHA256,
+					VBOOT_HASH_DEFERRED);
 }
 DECLARE_CONSOLE_COMMAND(hash, command_hash,
 			"[abort | ro | rw] | [<offset> <size> [<nonce>]]",
@@ -441,7 +689,7 @@ static void fill_response(struct ec_response_vboot_hash *r,
 	else if (get_offset(request_offset) == data_offset && hash &&
 		 !want_abort) {
 		r->status = EC_VBOOT_HASH_STATUS_DONE;
-		r->hash_type = EC_VBOOT_HASH_TYPE_SHA256;
+		r->hash_type = hash_type;
 		r->digest_size = SHA256_DIGEST_SIZE;
 		r->reserved0 = 0;
 		r->offset = data_offset;
@@ -464,8 +712,6 @@ static int host_start_hash(const struct ec_params_vboot_hash *p)
 	int rv;
 
 	/* Validity-check input params */
-	if (p->hash_type != EC_VBOOT_HASH_TYPE_SHA256)
-		return EC_RES_INVALID_PARAM;
 	if (p->nonce_size > sizeof(p->nonce_data))
 		return EC_RES_INVALID_PARAM;
 
@@ -477,7 +723,7 @@ static int host_start_hash(const struct ec_params_vboot_hash *p)
 		size = get_rw_size();
 	offset = get_offset(offset);
 	rv = vboot_hash_start(offset, size, p->nonce_data, p->nonce_size,
-			      VBOOT_HASH_DEFERRED);
+			      p->hash_type, VBOOT_HASH_DEFERRED);
 
 	if (rv == EC_SUCCESS)
 		return EC_RES_SUCCESS;
@@ -950,6 +950,28 @@ void task_print_list(void)
 	}
 }
 
+int task_get_stack(task_id_t tskid, const uint32_t **sp,
+		   const uint32_t **end)
+{
+	const struct panic_data *pdata = panic_get_data();
+	uint32_t s = tasks[tskid].sp;
+
+	/*
+	 * The task that was running at the panic didn't switch out; its stack
+	 * pointer is the process stack pointer saved with the panic data.
+	 */
+	if (tskid == task_get_current() && pdata && pdata->cm.regs[0])
+		s = pdata->cm.regs[0];
+
+	*sp = (const uint32_t *)s;
+	*end = tasks[tskid].stack + tasks_init[tskid].stack_size / 4;
+
+	/* Don't trust a stack pointer outside the stack */
+	if (*sp < tasks[tskid].stack || *sp > *end)
+		return EC_ERROR_INVAL;
+	return EC_SUCCESS;
+}
+
 int command_task_info(int argc, char **argv)
 {
 #ifdef CONFIG_TASK_PROFILING
@@ -39,4 +39,10 @@ void __keep watchdog_trace(uint32_t excep_lr, uint32_t excep_sp)
 	 * messages might not appear but they are useless in that situation. */
 	timer_print_info();
 	task_print_list();
+
+#ifdef CONFIG_PANIC_LOG
+	/* Save psp where exception_panic() does, for the current task's log */
+	get_panic_data_write()->cm.regs[0] = psp;
+	panic_log_save();
+#endif
 }
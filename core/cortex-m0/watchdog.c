@@ -42,4 +42,8 @@ void watchdog_trace(uint32_t excep_lr, uint32_t excep_sp)
 	 * messages might not appear but they are useless in that situation. */
 	timer_print_info();
 	task_print_list();
+
+#ifdef CONFIG_PANIC_LOG
+	panic_log_save();
+#endif
 }
@@ -9,3 +9,4 @@
 CFLAGS_CPU=-fno-builtin
 
 core-y=main.o task.o timer.o panic.o disabled.o stack_trace.o
+core-$(TEST_FUZZ)+=fuzz_snapshot.o
@@ -0,0 +1,102 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Persistent fuzzing support: instead of re-initializing the emulated EC for
+ * every input, copy the .data/.bss of the EC objects once the tasks have
+ * settled, and copy it back before each input.
+ *
+ * Only the EC objects (libec.a) are covered, so the fuzzer runtime is left
+ * untouched. Emulator state (scheduler, threads, emulated clock) is marked
+ * __fuzz_persistent and lives outside of the snapshot range. Pending task
+ * events and timers are not rolled back.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "common.h"
+#include "link_defs.h"
+#include "test_util.h"
+#include "util.h"
+
+struct snapshot_region {
+	uint8_t *start;
+	uint8_t *end;
+	uint8_t *copy;
+};
+
+static struct snapshot_region regions[] __fuzz_persistent = {
+	{ __ec_snapshot_data, __ec_snapshot_data_end, NULL },
+	{ __ec_snapshot_bss, __ec_snapshot_bss_end, NULL },
+};
+
+static int snapshot_taken __fuzz_persistent;
+static uint64_t restore_count __fuzz_persistent;
+static struct timespec first_restore __fuzz_persistent;
+
+static uint64_t elapsed_us(const struct timespec *from)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - from->tv_sec) * 1000000ULL +
+	       (now.tv_nsec - from->tv_nsec) / 1000;
+}
+
+static void fuzz_snapshot_report(void)
+{
+	uint64_t us;
+	size_t size = 0;
+	int i;
+
+	if (restore_count < 2)
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(regions); i++)
+		size += regions[i].end - regions[i].start;
+
+	us = elapsed_us(&first_restore);
+	fprintf(stderr,
+		"fuzz snapshot: %zu bytes, %llu restores, %llu execs/s "
+		"(target %d execs/s)\n",
+		size, (unsigned long long)restore_count,
+		(unsigned long long)(us ? restore_count * 1000000ULL / us : 0),
+		FUZZ_SNAPSHOT_TARGET_EXECS);
+}
+
+void fuzz_snapshot_take(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(regions); i++) {
+		size_t size = regions[i].end - regions[i].start;
+
+		if (!regions[i].copy)
+			regions[i].copy = malloc(size ? size : 1);
+		ASSERT(regions[i].copy);
+		memcpy(regions[i].copy, regions[i].start, size);
+	}
+
+	if (!snapshot_taken)
+		atexit(fuzz_snapshot_report);
+	snapshot_taken = 1;
+}
+
+void fuzz_snapshot_restore(void)
+{
+	int i;
+
+	ASSERT(snapshot_taken);
+
+	for (i = 0; i < ARRAY_SIZE(regions); i++)
+		memcpy(regions[i].start, regions[i].copy,
+		       regions[i].end - regions[i].start);
+
+	if (!restore_count++)
+		clock_gettime(CLOCK_MONOTONIC, &first_restore);
+}
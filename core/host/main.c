@@ -10,6 +10,7 @@
 #include "hooks.h"
 #include "host_task.h"
 #include "keyboard_scan.h"
+#include "link_defs.h"
 #include "stack_trace.h"
 #include "system.h"
 #include "task.h"
@@ -21,7 +22,7 @@
 #define CPUTS(outstr) cputs(CC_SYSTEM, outstr)
 #define CPRINTS(format, args...) cprints(CC_SYSTEM, format, ## args)
 
-const char *__prog_name;
+const char *__prog_name __fuzz_persistent;
 
 const char *__get_prog_name(void)
 {
@@ -79,13 +80,13 @@ void *_main_thread(void *a)
 
 int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
 {
-	static int initialized;
-	static pthread_t main_t;
+	static int initialized __fuzz_persistent;
+	static pthread_t main_t __fuzz_persistent;
 	/*
 	 * We lose the program name as LLVM fuzzer takes over main function:
 	 * make up one.
 	 */
-	static const char *name = STRINGIFY(PROJECT)".exe";
+	static const char *name __fuzz_persistent = STRINGIFY(PROJECT)".exe";
 
 	if (!initialized) {
 		__prog_name = name;
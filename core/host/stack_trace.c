@@ -10,6 +10,7 @@
 
 #include "host_task.h"
 #include "host_test.h"
+#include "link_defs.h"
 #include "timer.h"
 
 #define SIGNAL_TRACE_DUMP SIGTERM
@@ -28,7 +29,7 @@
  */
 #define DIRECT_TRACE_OFFSET 2
 
-static pthread_t main_thread;
+static pthread_t main_thread __fuzz_persistent;
 
 static void __attribute__((noinline)) _task_dump_trace_impl(int offset)
 {
@@ -18,6 +18,7 @@
 #include "common.h"
 #include "console.h"
 #include "host_task.h"
+#include "link_defs.h"
 #include "task.h"
 #include "task_id.h"
 #include "test_util.h"
@@ -38,21 +39,21 @@ struct task_args {
 	void *d;
 };
 
-static struct emu_task_t tasks[TASK_ID_COUNT];
-static pthread_cond_t scheduler_cond;
-static pthread_mutex_t run_lock;
-static task_id_t running_task_id;
-static int task_started;
-
-static sem_t interrupt_sem;
-static pthread_mutex_t interrupt_lock;
-static pthread_t interrupt_thread;
-static int in_interrupt;
-static int interrupt_disabled;
-static void (*pending_isr)(void);
-static int generator_sleeping;
-static timestamp_t generator_sleep_deadline;
-static int has_interrupt_generator = 1;
+static struct emu_task_t tasks[TASK_ID_COUNT] __fuzz_persistent;
+static pthread_cond_t scheduler_cond __fuzz_persistent;
+static pthread_mutex_t run_lock __fuzz_persistent;
+static task_id_t running_task_id __fuzz_persistent;
+static int task_started __fuzz_persistent;
+
+static sem_t interrupt_sem __fuzz_persistent;
+static pthread_mutex_t interrupt_lock __fuzz_persistent;
+static pthread_t interrupt_thread __fuzz_persistent;
+static int in_interrupt __fuzz_persistent;
+static int interrupt_disabled __fuzz_persistent;
+static void (*pending_isr)(void) __fuzz_persistent;
+static int generator_sleeping __fuzz_persistent;
+static timestamp_t generator_sleep_deadline __fuzz_persistent;
+static int has_interrupt_generator __fuzz_persistent = 1;
 
 /* thread local task id */
 static __thread task_id_t my_task_id = TASK_ID_INVALID;
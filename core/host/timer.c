@@ -7,14 +7,16 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <time.h>
 
+#include "link_defs.h"
 #include "task.h"
 #include "test_util.h"
 #include "timer.h"
 #include "util.h"
 
-static timestamp_t boot_time;
-static int time_set;
+static timestamp_t boot_time __fuzz_persistent;
+static int time_set __fuzz_persistent;
 
 void usleep(unsigned us)
 {
@@ -31,7 +33,7 @@ void usleep(unsigned us)
 
 timestamp_t _get_time(void)
 {
-	static timestamp_t time;
+	static timestamp_t time __fuzz_persistent;
 
 	/*
 	 * We just monotonically increase the microsecond every time we check
@@ -55,6 +57,14 @@ uint32_t __hw_clock_source_read(void)
 	return get_time().le.lo;
 }
 
+uint64_t test_bench_time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
 void force_time(timestamp_t ts)
 {
 	timestamp_t now = _get_time();
@@ -1569,7 +1569,7 @@ static void print_frame(void)
 			}
 			debug_line[j++] = '\n';
 			debug_line[j++] = '\0';
-			CPRINTF(debug_line);
+			CPUTS(debug_line);
 		}
 		CPUTS("==============\n");
 	}
@@ -12,6 +12,15 @@
 /* Disable hibernate: We never want to exit while fuzzing. */
 #undef CONFIG_HIBERNATE
 
+/*
+ * Roll back a snapshot of the EC global state between inputs, instead of
+ * resetting the emulated devices and waiting for the tasks to settle.
+ */
+#define FUZZ_PERSISTENT_SNAPSHOT
+
+/* Expected throughput in persistent mode, reported when the fuzzer exits. */
+#define FUZZ_SNAPSHOT_TARGET_EXECS 1000
+
 #ifdef TEST_HOST_COMMAND_FUZZ
 #undef CONFIG_HOSTCMD_DEBUG_MODE
 
@@ -12,6 +12,7 @@
 #include "console.h"
 #include "host_command.h"
 #include "host_test.h"
+#include "link_defs.h"
 #include "task.h"
 #include "test_util.h"
 #include "timer.h"
@@ -26,11 +27,14 @@
 /* Request/response buffer size (and maximum command length) */
 #define BUFFER_SIZE 128
 
-struct host_packet pkt;
-static uint8_t resp_buf[BUFFER_SIZE];
-struct ec_host_response *resp = (struct ec_host_response *)resp_buf;
-static uint8_t req_buf[BUFFER_SIZE];
-static struct ec_host_request *req = (struct ec_host_request *)req_buf;
+/* Filled in by the fuzzer thread, must survive snapshot restores. */
+struct host_packet pkt __fuzz_persistent;
+static uint8_t resp_buf[BUFFER_SIZE] __fuzz_persistent;
+struct ec_host_response *resp __fuzz_persistent =
+	(struct ec_host_response *)resp_buf;
+static uint8_t req_buf[BUFFER_SIZE] __fuzz_persistent;
+static struct ec_host_request *req __fuzz_persistent =
+	(struct ec_host_request *)req_buf;
 
 static void hostcmd_respond(struct host_packet *pkt)
 {
@@ -55,7 +59,7 @@ struct chunk {
 
 static int hostcmd_fill(const uint8_t *data, size_t size)
 {
-	static int first = 1;
+	static int first __fuzz_persistent = 1;
 
 #ifdef VALID_REQUEST_ONLY
 	const int checksum_offset = offsetof(struct ec_host_request, checksum);
@@ -128,16 +132,22 @@ static int hostcmd_fill(const uint8_t *data, size_t size)
 	return 0;
 }
 
-static pthread_cond_t done_cond;
-static pthread_mutex_t lock;
+static pthread_cond_t done_cond __fuzz_persistent;
+static pthread_mutex_t lock __fuzz_persistent;
 
 void run_test(int argc, char **argv)
 {
 	ccprints("Fuzzing task started");
 	wait_for_task_started();
+#ifdef FUZZ_PERSISTENT_SNAPSHOT
+	fuzz_snapshot_take();
+#endif
 
 	while (1) {
 		task_wait_event_mask(TASK_EVENT_FUZZ, -1);
+#ifdef FUZZ_PERSISTENT_SNAPSHOT
+		fuzz_snapshot_restore();
+#endif
 		/* Send the host command (pkt prepared by main thread). */
 		host_packet_receive(&pkt);
 		task_wait_event_mask(TASK_EVENT_HOSTCMD_DONE, -1);
@@ -6,6 +6,7 @@
  */
 #define HIDE_EC_STDLIB
 #include "common.h"
+#include "link_defs.h"
 #include "task.h"
 #include "tcpm.h"
 #include "test_util.h"
@@ -154,12 +155,14 @@ const struct tcpc_config_t tcpc_config[CONFIG_USB_PD_PORT_MAX_COUNT] = {
 	}
 };
 
-static pthread_cond_t done_cond;
-static pthread_mutex_t lock;
+static pthread_cond_t done_cond __fuzz_persistent;
+static pthread_mutex_t lock __fuzz_persistent;
 
-enum tcpc_cc_voltage_status next_cc1, next_cc2;
+/* Filled in by the fuzzer thread, must survive snapshot restores. */
+enum tcpc_cc_voltage_status next_cc1 __fuzz_persistent;
+enum tcpc_cc_voltage_status next_cc2 __fuzz_persistent;
 const int MAX_MESSAGES = 8;
-static struct message messages[MAX_MESSAGES];
+static struct message messages[MAX_MESSAGES] __fuzz_persistent;
 
 void run_test(int argc, char **argv)
 {
@@ -168,16 +171,26 @@ void run_test(int argc, char **argv)
 
 	ccprints("Fuzzing task started");
 	wait_for_task_started();
+#ifdef FUZZ_PERSISTENT_SNAPSHOT
+	/* Let the PD task settle with the TCPC in its reset state. */
+	task_wait_event(250 * MSEC);
+	fuzz_snapshot_take();
+#endif
 
 	while (1) {
 		task_wait_event_mask(TASK_EVENT_FUZZ, -1);
 
+#ifdef FUZZ_PERSISTENT_SNAPSHOT
+		/* Roll back to the settled state instead of a TCPC reset. */
+		fuzz_snapshot_restore();
+#else
 		memset(&mock_tcpc_state[port],
 			0, sizeof(mock_tcpc_state[port]));
 
 		task_set_event(PD_PORT_TO_TASK_ID(port),
 			PD_EVENT_TCPC_RESET, 0);
 		task_wait_event(250 * MSEC);
+#endif
 
 		mock_tcpc_state[port].cc1 = next_cc1;
 		mock_tcpc_state[port].cc2 = next_cc2;
@@ -223,6 +223,11 @@ int charge_manager_get_charger_voltage(void);
  */
 enum charge_supplier charge_manager_get_supplier(void);
 
+#ifdef TEST_BUILD
+/* Number of port supplier entries looked at to select the charge port */
+extern int charge_manager_supplier_scans;
+#endif
+
 #ifdef CONFIG_USB_PD_LOGGING
 /* Save power state log entry for the given port */
 void charge_manager_save_log(int port);
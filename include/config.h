@@ -1256,6 +1256,16 @@
 /* Support curve25519 public key cryptography */
 #undef CONFIG_CURVE25519
 
+/*
+ * Compute curve25519 public keys (multiples of the base point) in constant
+ * time from a table of precomputed multiples, kept in flash, instead of with
+ * the generic ladder. The value is the number of passes over the scalar, and
+ * sets the size of the table: 2 (30 KB), 4 (15 KB), 8 (7.5 KB) or 16
+ * (3.75 KB). Each halving of the table adds 4 doublings per pass. Needs the
+ * generic (not Cortex-M0) curve25519 code.
+ */
+#undef CONFIG_CURVE25519_BASE_TABLE
+
 /*****************************************************************************/
 /* PMIC config */
 
@@ -1460,6 +1470,30 @@
 
 /*****************************************************************************/
 
+/*
+ * Console batch mode: run a block of command lines back to back in the
+ * console task, and return the output of each line in a length-prefixed
+ * frame. Batches are collected with the 'batch' console command, or sent and
+ * read with EC_CMD_CONSOLE_BATCH.
+ */
+#undef CONFIG_CONSOLE_BATCH
+
+/* Size of the batch input and output buffers, each */
+#define CONFIG_CONSOLE_BATCH_BUF_SIZE 1024
+
+/*
+ * Defer console formatting. cprintf()/cprints()/cputs() store a reference to
+ * the format string and the raw arguments in a binary ring, and the console
+ * task formats them later. Callers outside the console task no longer pay for
+ * vfnprintf(). The ring also keeps formatted records as history, which can be
+ * dumped with the 'binlog' console command and decoded on the host with
+ * util/ec_binlog_decode.
+ */
+#undef CONFIG_CONSOLE_BINLOG
+
+/* Size of the binary console log ring, in bytes. Must be a power of 2. */
+#define CONFIG_CONSOLE_BINLOG_BUF_SIZE 2048
+
 /*
  * Make it possible for console to be output to different channels that can be
  * turned on and off.
@@ -1472,6 +1506,23 @@
  */
 #define CONFIG_CONSOLE_CHANNEL
 
+/*
+ * Rate limit console channels, and count the lines each channel loses.
+ *
+ * Each channel gets a token bucket allowing this many lines per second, with
+ * bursts of up to CONFIG_CONSOLE_CHANNEL_RATE_BURST lines; lines over the
+ * limit are suppressed. The limits can be changed (or lifted) per channel
+ * with the 'chan rate' console command. The command channel is never limited.
+ *
+ * Suppressed lines, and lines lost because the output buffer was full, are
+ * counted per channel, and reported by 'chan' and
+ * EC_CMD_CONSOLE_CHANNEL_STATS.
+ *
+ * Requires CONFIG_CONSOLE_CHANNEL.
+ */
+#undef CONFIG_CONSOLE_CHANNEL_RATE_LIMIT
+#define CONFIG_CONSOLE_CHANNEL_RATE_BURST 20
+
 /*
  * Provide additional help on console commands, such as the supported
  * options/usage.
@@ -1502,6 +1553,14 @@
  */
 #define CONFIG_CONSOLE_ENABLE_READ_V1
 
+/*
+ * Enable EC_CMD_CONSOLE_READ V2, which reads through named reader cursors
+ * rather than the single snapshot, so that several readers don't disturb each
+ * other. Define to the number of cursors; the least recently used one is
+ * reused for a new reader.
+ */
+#undef CONFIG_CONSOLE_READ_CURSORS
+
 /*
  * Number of entries in console history buffer.
  *
@@ -1719,6 +1778,8 @@
 /* This enables chip-specific access functions */
 #define CONFIG_FLASH_PHYSICAL
 #undef CONFIG_FLASH_BANK_SIZE
+/* Support EC_CMD_FLASH_BLOCK_HASH, to update only the blocks that changed */
+#undef CONFIG_FLASH_BLOCK_HASH
 /* Provide event log stored in flash memory. */
 #undef CONFIG_FLASH_LOG
 #undef CONFIG_FLASH_LOG_BASE
@@ -1824,6 +1885,13 @@
 /* Most efficient flash write size (in bytes) */
 #undef CONFIG_FLASH_WRITE_IDEAL_SIZE
 
+/*
+ * Support write sessions (flash_write_begin() and version 2 of
+ * EC_CMD_FLASH_WRITE). Define to the size of the buffer in bytes, such as a
+ * bank; it must be a multiple of CONFIG_FLASH_WRITE_SIZE.
+ */
+#undef CONFIG_FLASH_WRITE_SESSION
+
 /* Protected region of storage belonging to EC */
 #undef CONFIG_EC_PROTECTED_STORAGE_OFF
 #undef CONFIG_EC_PROTECTED_STORAGE_SIZE
@@ -3029,6 +3097,18 @@
 #undef CONFIG_PANIC_DATA_BASE
 #undef CONFIG_PANIC_DATA_SIZE
 
+/*
+ * Size of the crash log, in bytes. On panic, the time, the state and the top
+ * of the stack of each task, and as much of the newest console output as
+ * fits, compressed, are saved there. The log is kept across the reset with
+ * CONFIG_PRESERVE_LOGS, and read with the 'paniclog' console command or
+ * EC_CMD_GET_PANIC_LOG.
+ */
+#undef CONFIG_PANIC_LOG
+
+/* Words of the stack of each task kept in the crash log */
+#define CONFIG_PANIC_LOG_STACK_WORDS 8
+
 /* Support PECI interface to x86 processor */
 #undef CONFIG_PECI
 
@@ -3363,6 +3443,12 @@
 /* Support computing of other hash sizes (without the VBOOT code) */
 #undef CONFIG_SHA256
 
+/*
+ * The chip has a SHA-256 engine: it provides SHA256_hw_transform(), which
+ * replaces the software transform.
+ */
+#undef CONFIG_SHA256_HW_ACCELERATE
+
 /* Unroll some loops in SHA256_transform for better performance. */
 #undef CONFIG_SHA256_UNROLLED
 
@@ -3933,6 +4019,15 @@
 /* Support for USB PD alternate mode of Downward Facing Port */
 #undef CONFIG_USB_PD_ALT_MODE_DFP
 
+/*
+ * Number of partners/cables for which alternate mode discovery results are
+ * kept across detach. On attach, a Discover Identity matching a cached entry
+ * restores its SVIDs and modes instead of running the full discovery
+ * sequence. Requires CONFIG_USB_PD_ALT_MODE_DFP and CONFIG_USB_PD_TCPMV2:
+ * the TCPMv1 policy asks for SVIDs after every Discover Identity.
+ */
+#undef CONFIG_USB_PD_DISCOVERY_CACHE
+
 /* HPD is sent to the GPU from the EC via a GPIO */
 #undef CONFIG_USB_PD_DP_HPD_GPIO
 
@@ -4105,6 +4200,14 @@
 /* Enable TCPC to enter low power mode */
 #undef CONFIG_USB_PD_TCPC_LOW_POWER
 
+/*
+ * Speed up the bit-banged TCPC (common/usb_pd_tcpc.c) by decoding two 4b5b
+ * symbols per table lookup and by keeping a precomputed GoodCRC message for
+ * each MessageID, so no CRC has to be computed before acknowledging a packet.
+ * Costs 1kB of flash and 208 bytes of RAM per port.
+ */
+#undef CONFIG_USB_PD_TCPC_FAST_PATH
+
 /*
  * Default debounce when exiting low-power mode before checking CC status.
  * Some TCPCs need additional time following a VBUS change to internally
@@ -4691,6 +4794,19 @@
 /* Support computing hash of code for verified boot */
 #undef CONFIG_VBOOT_HASH
 
+/*
+ * CPU time, in us, the vboot hash takes at a time before letting other work
+ * run. Larger hashes faster, but delays other deferred work more.
+ */
+#define CONFIG_VBOOT_HASH_BUDGET_US 1000
+
+/*
+ * Keep the digest of each block of the last SHA-256 tree hash (see
+ * EC_VBOOT_HASH_TYPE_SHA256_TREE), so a flash write only invalidates the
+ * blocks it touches. Costs 33 bytes of RAM per 4 KB of CONFIG_RW_SIZE.
+ */
+#undef CONFIG_VBOOT_HASH_TREE
+
 /* Support for secure temporary storage for verified boot */
 #undef CONFIG_VSTORE
 
@@ -4966,6 +5082,15 @@
 #endif
 #endif
 
+/******************************************************************************/
+/*
+ * The discovery cache skips SVIDs and modes discovery, which only the TCPMv2
+ * policy engine knows to do.
+ */
+#if defined(CONFIG_USB_PD_DISCOVERY_CACHE) && !defined(CONFIG_USB_PD_TCPMV2)
+#error CONFIG_USB_PD_DISCOVERY_CACHE requires CONFIG_USB_PD_TCPMV2
+#endif
+
 /******************************************************************************/
 /*
  * Automatically define CONFIG_USB_PD_FRS if FRS is enabled in the TCPC or PPC
@@ -5544,6 +5669,11 @@
 #define CONFIG_USB_PD_TBT_GEN3_CAPABLE
 #endif /* CONFIG_USB_PD_TBT_COMPAT_MODE */
 
+#if defined(CONFIG_CONSOLE_CHANNEL_RATE_LIMIT) && \
+	!defined(CONFIG_CONSOLE_CHANNEL)
+#error CONFIG_CONSOLE_CHANNEL_RATE_LIMIT requires CONFIG_CONSOLE_CHANNEL
+#endif
+
 /*
  * CONFIG_CHIP_INIT_ROM_REGION requires that the chip has defined a
  * ROM resident region to store the .init_rom section.
@@ -5756,6 +5886,10 @@
 #define CONFIG_SHA256
 #endif
 
+#ifdef CONFIG_FLASH_BLOCK_HASH
+#define CONFIG_SHA256
+#endif
+
 #ifdef CONFIG_SMBUS_PEC
 #define CONFIG_CRC8
 #endif
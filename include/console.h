@@ -48,6 +48,9 @@ struct binary_print_params {
 
 #define PRINTF_TIMESTAMP_NOW NULL
 
+/* Longest console command name, not counting the terminating null */
+#define CONSOLE_COMMAND_NAME_MAX_LEN 15
+
 /* Console command; used by DECLARE_CONSOLE_COMMAND macro. */
 struct console_command {
 	/* Command name.  Case-insensitive. */
@@ -86,6 +89,17 @@ static inline int console_is_restricted(void)
 }
 #endif
 
+#ifdef TEST_BUILD
+/**
+ * Find a command by name, or by a prefix unique to one command.
+ *
+ * @param name		Command name to find.
+ *
+ * @return A pointer to the command structure, or NULL if no match found.
+ */
+const struct console_command *find_command(char *name);
+#endif
+
 /* Console channels */
 enum console_channel {
 	#define CONSOLE_CHANNEL(enumeration, string) enumeration,
@@ -140,6 +154,17 @@ int cprints(enum console_channel channel, const char *format, ...);
  */
 void cflush(void);
 
+/**
+ * Count a line of the channel lost because the output buffer was full.
+ *
+ * Only needed by code that outputs lines on behalf of a channel other than
+ * through cputs(), cprintf() and cprints(); see
+ * CONFIG_CONSOLE_CHANNEL_RATE_LIMIT.
+ *
+ * @param channel	Output channel
+ */
+void console_channel_dropped(enum console_channel channel);
+
 /* Convenience macros for printing to the command channel.
  *
  * Modules may define similar macros in their .c files for their own use; it is
@@ -155,6 +180,15 @@ void cflush(void);
  */
 void console_has_input(void);
 
+/**
+ * Run a console command line, as if it had been typed.
+ *
+ * @param input		Command line; modified during parsing.
+ *
+ * @return EC_SUCCESS, or non-zero if error.
+ */
+int console_run_command(char *input);
+
 /**
  * Register a console command handler.
  *
@@ -194,10 +228,17 @@ void console_has_input(void);
 #define _FLAG_ARGS(F)
 #endif
 
+/*
+ * Commands are sorted by name at link time, from the name of their section,
+ * and looked up by binary search. Command names must therefore be lowercase,
+ * so that the link order matches the case-insensitive lookup.
+ */
+
 /* This macro takes all possible args and discards the ones we don't use */
 #define _DCL_CON_CMD_ALL(NAME, ROUTINE, ARGDESC, HELP, FLAGS)		\
 	static const char __con_cmd_label_##NAME[] = #NAME;		\
-	_Static_assert(sizeof(__con_cmd_label_##NAME) < 16,		\
+	_Static_assert(sizeof(__con_cmd_label_##NAME) <=		\
+		       CONSOLE_COMMAND_NAME_MAX_LEN + 1,		\
 		       "command name '" #NAME "' is too long");		\
 	const struct console_command __keep __no_sanitize_address	\
 	__con_cmd_##NAME						\
@@ -0,0 +1,46 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Console batch mode; see CONFIG_CONSOLE_BATCH */
+
+#ifndef __CROS_EC_CONSOLE_BATCH_H
+#define __CROS_EC_CONSOLE_BATCH_H
+
+#include <stdarg.h>
+
+#include "common.h"
+
+/**
+ * Queue a console input line if a batch is being collected on the console.
+ *
+ * Lines starting with "batch" are not queued, so that the batch can be run.
+ *
+ * @param line		Input line
+ * @return EC_SUCCESS if the line was queued, else the caller runs it.
+ */
+int console_batch_queue_line(const char *line);
+
+/**
+ * Run the pending batch, if any, or carry on with the running one. Returns
+ * early while the output waits for the host. Called by the console task.
+ */
+void console_batch_run(void);
+
+/**
+ * Return non-zero if console command output is captured for a batch, in
+ * which case it is passed to console_batch_vprintf() instead of being output.
+ */
+int console_batch_capturing(void);
+
+/**
+ * Add output of the command being run to its batch output frame.
+ *
+ * @param format	Format string
+ * @param args		Parameters
+ * @return EC_SUCCESS, or EC_ERROR_OVERFLOW if the output was truncated.
+ */
+int console_batch_vprintf(const char *format, va_list args);
+
+#endif  /* __CROS_EC_CONSOLE_BATCH_H */
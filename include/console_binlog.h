@@ -0,0 +1,49 @@
+/* Copyright 2020 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Deferred (binary) console logging; see CONFIG_CONSOLE_BINLOG */
+
+#ifndef __CROS_EC_CONSOLE_BINLOG_H
+#define __CROS_EC_CONSOLE_BINLOG_H
+
+#include <stdarg.h>
+
+#include "common.h"
+#include "console.h"
+
+/* Record flags for console_binlog_vprintf() */
+#define CONSOLE_BINLOG_TIMESTAMP BIT(0)	/* Wrap as cprints() does */
+
+/**
+ * Store a console line in the binary log, to be formatted later by the
+ * console task.
+ *
+ * The format must be a string literal (or otherwise live as long as the
+ * image), since only a reference to it is stored.
+ *
+ * @param channel	Output channel
+ * @param flags		CONSOLE_BINLOG_* flags
+ * @param format	Format string
+ * @param args		Parameters
+ * @return EC_SUCCESS if the line was stored. Otherwise the pending lines have
+ *	   been output and the caller must format this one itself, as it would
+ *	   without the binary log. This is always the case in the console task.
+ */
+int console_binlog_vprintf(enum console_channel channel, int flags,
+			   const char *format, va_list args);
+
+/**
+ * Like console_binlog_vprintf(), with a variable argument list.
+ */
+__attribute__((__format__(__printf__, 3, 4)))
+int console_binlog_printf(enum console_channel channel, int flags,
+			  const char *format, ...);
+
+/**
+ * Format and output all pending lines.
+ */
+void console_binlog_flush(void);
+
+#endif  /* __CROS_EC_CONSOLE_BINLOG_H */
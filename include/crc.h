@@ -24,7 +24,12 @@ void crc32_hash16(uint16_t val);
 
 uint32_t crc32_result(void);
 
-/* Provided context variant */
+#endif /* CONFIG_HW_CRC */
+
+/*
+ * Provided context variant; always software, as the hardware block only has
+ * the one context
+ */
 
 void crc32_ctx_init(uint32_t *ctx);
 
@@ -34,8 +39,8 @@ void crc32_ctx_hash16(uint32_t *ctx, uint16_t val);
 
 void crc32_ctx_hash8(uint32_t *ctx, uint8_t val);
 
-uint32_t crc32_ctx_result(uint32_t *ctx);
+void crc32_ctx_hash(uint32_t *ctx, const void *buf, int size);
 
-#endif /* CONFIG_HW_CRC */
+uint32_t crc32_ctx_result(uint32_t *ctx);
 
 #endif /* __CROS_EC_CRC_H */
@@ -1594,6 +1594,32 @@ struct ec_params_flash_write {
 	/* Followed by data to write */
 } __ec_align4;
 
+/*
+ * Version 2 writes in a session. The first command has EC_FLASH_WRITE_BEGIN
+ * set and no data, with the offset and size of the whole update; the
+ * following ones carry the data in order, and the last one has
+ * EC_FLASH_WRITE_COMMIT set. The data is programmed a buffer at a time, so
+ * errors may be reported for data sent in an earlier command.
+ */
+#define EC_VER_FLASH_WRITE_SESSION 2
+
+#define EC_FLASH_WRITE_BEGIN BIT(0)
+#define EC_FLASH_WRITE_COMMIT BIT(1)
+
+/**
+ * struct ec_params_flash_write_v2 - Parameters for the flash write command,
+ * version 2.
+ * @offset: Byte offset to write.
+ * @size: Size to write in bytes.
+ * @flags: EC_FLASH_WRITE_* flags.
+ */
+struct ec_params_flash_write_v2 {
+	uint32_t offset;
+	uint32_t size;
+	uint32_t flags;
+	/* Followed by data to write */
+} __ec_align4;
+
 /* Erase flash */
 #define EC_CMD_FLASH_ERASE 0x0013
 
@@ -2394,8 +2420,18 @@ enum ec_vboot_hash_cmd {
 
 enum ec_vboot_hash_type {
 	EC_VBOOT_HASH_TYPE_SHA256 = 0, /* SHA-256 */
+	EC_VBOOT_HASH_TYPE_SHA256_TREE = 1, /* SHA-256 of block digests */
 };
 
+/*
+ * For EC_VBOOT_HASH_TYPE_SHA256_TREE, the data is cut into blocks of
+ * EC_VBOOT_HASH_TREE_BLOCK_SIZE bytes (the last may be shorter), and the
+ * digest is SHA-256(nonce || SHA-256(block 0) || SHA-256(block 1) || ...).
+ * The EC keeps the block digests, so after a flash write it only rehashes
+ * the blocks written.
+ */
+#define EC_VBOOT_HASH_TREE_BLOCK_SIZE 4096
+
 enum ec_vboot_hash_status {
 	EC_VBOOT_HASH_STATUS_NONE = 0, /* No hash (not started, or aborted) */
 	EC_VBOOT_HASH_STATUS_DONE = 1, /* Finished computing a hash */
@@ -4207,6 +4243,31 @@ struct ec_params_console_read_v1 {
 	uint8_t subcmd; /* enum ec_console_read_subcmd */
 } __ec_align1;
 
+/*
+ * Version 2 reads through a named reader cursor instead of the snapshot, and
+ * doesn't need EC_CMD_CONSOLE_SNAPSHOT. A reader's cursor is created on first
+ * use, at the oldest output in the buffer; each read returns the output since
+ * the reader's previous read, as much as fits in the response. Output that was
+ * overwritten before the reader got to it is counted in 'lost'.
+ */
+#define EC_CONSOLE_READER_NAME_LEN 8
+
+/* Start again from the oldest output in the buffer */
+#define EC_CONSOLE_READ_FROM_OLDEST	BIT(0)
+/* Release the cursor after this read */
+#define EC_CONSOLE_READ_RELEASE		BIT(1)
+
+struct ec_params_console_read_v2 {
+	uint8_t flags;		/* EC_CONSOLE_READ_* */
+	char reader[EC_CONSOLE_READER_NAME_LEN]; /* Name, null-padded */
+} __ec_align1;
+
+struct ec_response_console_read_v2 {
+	uint32_t lost;		/* Bytes lost since the previous read */
+	uint32_t pending;	/* Bytes left to read after this response */
+	char data[];		/* Output; not null-terminated */
+} __ec_align4;
+
 /*****************************************************************************/
 
 /*
@@ -6523,6 +6584,123 @@ struct ec_response_typec_status {
 	/* TODO(b/167700356): Add revisions and source cap PDOs */
 } __ec_align1;
 
+/*****************************************************************************/
+/*
+ * Get the rate limit and line counters of a console channel.
+ *
+ * Channels are numbered from 0 to channel_count - 1; the numbering depends on
+ * the image, so the name is returned too. Returns EC_RES_INVALID_PARAM for a
+ * channel past the last one.
+ */
+#define EC_CMD_CONSOLE_CHANNEL_STATS 0x0134
+
+struct ec_params_console_channel_stats {
+	uint8_t channel;
+} __ec_align1;
+
+/* Channel is enabled in the console channel mask */
+#define EC_CONSOLE_CHANNEL_ENABLED BIT(0)
+
+struct ec_response_console_channel_stats {
+	char name[16];		/* Channel name, null-terminated */
+	uint8_t channel_count;	/* Number of channels */
+	uint8_t flags;		/* EC_CONSOLE_CHANNEL_* */
+	uint16_t burst;		/* Lines allowed in a burst */
+	uint32_t rate;		/* Lines per second, 0 if not limited */
+	uint32_t suppressed;	/* Lines over the rate limit */
+	uint32_t dropped;	/* Lines lost to a full output buffer */
+} __ec_align4;
+
+/*****************************************************************************/
+/*
+ * Run a batch of console commands back to back in the console task, and read
+ * their output.
+ *
+ * CONSOLE_BATCH_ADD appends newline-separated command lines to the batch;
+ * CONSOLE_BATCH_RUN appends lines too, then starts the batch. Both return
+ * EC_RES_BUSY while a batch is collected on the console, or is running.
+ * Adding to a batch which has run discards what is left of its output.
+ *
+ * CONSOLE_BATCH_READ returns the output not read yet of the command lines
+ * which have completed, in order: a struct ec_console_batch_frame per line,
+ * followed by its output. This is a byte stream, so frames may be split
+ * across reads. Keep reading until EC_CONSOLE_BATCH_DONE is set.
+ */
+#define EC_CMD_CONSOLE_BATCH 0x0135
+
+enum ec_console_batch_subcmd {
+	CONSOLE_BATCH_ADD = 0,
+	CONSOLE_BATCH_RUN = 1,
+	CONSOLE_BATCH_READ = 2,
+};
+
+struct ec_params_console_batch {
+	uint8_t subcmd;		/* enum ec_console_batch_subcmd */
+	char commands[];	/* For ADD and RUN; not null-terminated */
+} __ec_align1;
+
+/* The batch has run and all of its output has been read */
+#define EC_CONSOLE_BATCH_DONE		BIT(0)
+/*
+ * Out of space; the lines after the last frame were not run, or lines were
+ * dropped while the batch was collected
+ */
+#define EC_CONSOLE_BATCH_OVERFLOW	BIT(1)
+
+struct ec_response_console_batch {
+	uint8_t flags;		/* EC_CONSOLE_BATCH_* */
+	uint8_t data[];		/* Frames, each followed by its output */
+} __ec_align1;
+
+/* The output of the command was truncated */
+#define EC_CONSOLE_BATCH_FRAME_TRUNCATED BIT(0)
+
+struct ec_console_batch_frame {
+	uint16_t size;		/* Bytes of output following the frame */
+	uint8_t flags;		/* EC_CONSOLE_BATCH_FRAME_* */
+	uint8_t result;		/* enum ec_error_list, at most 255 */
+} __ec_align1;
+
+/*
+ * Read the crash log saved on the last panic. The log is a struct
+ * panic_log_header and records; see panic.h for details. Returns the log from
+ * the given offset on, as much as fits; nothing past the end, or if there is
+ * no log.
+ */
+#define EC_CMD_GET_PANIC_LOG 0x0136
+
+struct ec_params_get_panic_log {
+	uint16_t offset;
+} __ec_align2;
+
+/*
+ * Hash flash block by block, for updates that only erase and write the blocks
+ * that changed. The response is the SHA-256 digest of each block, for as
+ * many blocks as fit, and as are hashed in EC_FLASH_BLOCK_HASH_MAX_SIZE bytes
+ * (always at least one).
+ */
+#define EC_CMD_FLASH_BLOCK_HASH 0x0137
+
+#define EC_FLASH_BLOCK_HASH_SIZE 32
+/* Largest block size */
+#define EC_FLASH_BLOCK_HASH_MAX_BLOCK_SIZE 0x20000
+/* Bytes hashed by one command, unless a single block is bigger */
+#define EC_FLASH_BLOCK_HASH_MAX_SIZE 0x10000
+
+/**
+ * struct ec_params_flash_block_hash - Parameters for the flash block hash
+ * command.
+ * @offset: Byte offset of the first block.
+ * @size: Size to hash in bytes; the last block may be shorter.
+ * @block_size: Size of each block in bytes, at most
+ *              EC_FLASH_BLOCK_HASH_MAX_BLOCK_SIZE.
+ */
+struct ec_params_flash_block_hash {
+	uint32_t offset;
+	uint32_t size;
+	uint32_t block_size;
+} __ec_align4;
+
 /*****************************************************************************/
 /* The command range 0x200-0x2FF is reserved for Rotor. */
 
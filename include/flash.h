@@ -309,6 +309,48 @@ int flash_read(int offset, int size, char *data);
  */
 int flash_write(int offset, int size, const char *data);
 
+/**
+ * Begin a write session (CONFIG_FLASH_WRITE_SESSION).
+ *
+ * Data appended to the session is programmed a buffer at a time, and read
+ * back to verify it. Any session already in progress is aborted, and so is
+ * this one if no data is appended to it for a few seconds.
+ *
+ * Offset and size must be a multiple of CONFIG_FLASH_WRITE_SIZE.
+ *
+ * @param offset	Flash offset to write.
+ * @param size		Number of bytes in the whole session.
+ */
+int flash_write_begin(int offset, int size);
+
+/**
+ * Append data to the write session. On error, the session is aborted.
+ *
+ * Protection is checked again before each buffer is programmed.
+ *
+ * @param offset	Flash offset of the data, right after the data
+ *			appended so far.
+ * @param data		Data to write to flash.
+ * @param size		Number of bytes to write.
+ * @return EC_ERROR_INVAL if the data is out of order or past the end of the
+ * session, EC_ERROR_ACCESS_DENIED if the flash is now protected,
+ * EC_ERROR_HW_INTERNAL if data read back didn't match.
+ */
+int flash_write_append(int offset, const char *data, int size);
+
+/**
+ * Program the rest of the data and end the write session.
+ *
+ * @return EC_ERROR_INVAL if less data than the session size was appended, in
+ * which case the buffered data is not programmed.
+ */
+int flash_write_commit(void);
+
+/**
+ * End the write session, if any, without programming buffered data.
+ */
+void flash_write_abort(void);
+
 /**
  * Erase flash.
  *
@@ -101,6 +101,10 @@ extern const struct irq_priority __irqprio_end[];
 extern const void *__irqhandler[];
 extern const struct irq_def __irq_data[], __irq_data_end[];
 
+/* General read-only data, including string literals */
+extern const char __rodata_start[];
+extern const char __rodata_end[];
+
 /* Shared memory buffer.  Use via shared_mem.h interface. */
 extern uint8_t __shared_mem_buf[];
 
@@ -122,6 +126,19 @@ extern void *__dram_data_end;
 extern void *__dram_bss_start;
 extern void *__dram_bss_end;
 
+/*
+ * Emulator fuzzing snapshot: .data/.bss of the EC objects (libec.a), see
+ * core/host/host_exe.lds. Variables marked __fuzz_persistent are kept out of
+ * that range and survive a snapshot restore.
+ */
+extern uint8_t __ec_snapshot_data[], __ec_snapshot_data_end[];
+extern uint8_t __ec_snapshot_bss[], __ec_snapshot_bss_end[];
+#ifdef TEST_FUZZ
+#define __fuzz_persistent __attribute__((section(".data.fuzz_persistent")))
+#else
+#define __fuzz_persistent
+#endif
+
 /* Helper for special chip-specific memory sections */
 #if defined(CONFIG_CHIP_MEMORY_REGIONS) || defined(CONFIG_DRAM_BASE)
 #define __SECTION(name) __attribute__((section("." STRINGIFY(name) ".50_auto")))
@@ -142,6 +159,13 @@ extern void *__dram_bss_end;
 #ifdef CONFIG_PRESERVE_LOGS
 #define __preserved_logs(name)                                                 \
 	__attribute__((section(".preserved_logs." STRINGIFY(name))))
+/*
+ * Preserved logs placed after all of the above, so that adding one keeps the
+ * others where images built without it expect them.
+ */
+#define __preserved_logs_tail(name)                                            \
+	__attribute__((section(".preserved_logs_tail." STRINGIFY(name))))
 #else
 #define __preserved_logs(name)
+#define __preserved_logs_tail(name)
 #endif
@@ -116,6 +116,65 @@ enum panic_arch {
 /* Already reported via host event */
 #define PANIC_DATA_FLAG_OLD_HOSTEVENT  BIT(3)
 
+/*
+ * Crash log saved on panic (CONFIG_PANIC_LOG): a header, then records, each
+ * a struct panic_log_record followed by its data and padded to 4 bytes.
+ */
+struct panic_log_header {
+	uint32_t magic;           /* PANIC_LOG_MAGIC if valid */
+	uint16_t size;            /* Bytes of records following the header */
+	uint8_t version;          /* PANIC_LOG_VERSION */
+	uint8_t reserved;         /* Reserved; set 0 */
+};
+
+#define PANIC_LOG_MAGIC 0x4c636e50  /* "PncL" */
+#define PANIC_LOG_VERSION 1
+
+enum panic_log_type {
+	PANIC_LOG_TIME = 1,          /* struct panic_log_time */
+	PANIC_LOG_TASK = 2,          /* struct panic_log_task */
+	PANIC_LOG_CONSOLE = 3,       /* struct panic_log_console */
+};
+
+struct panic_log_record {
+	uint8_t type;             /* enum panic_log_type */
+	uint8_t reserved;         /* Reserved; set 0 */
+	uint16_t size;            /* Bytes of data following, before padding */
+};
+
+/* Size of the data of a record, with padding */
+#define PANIC_LOG_PADDED(size) (((size) + 3) & ~3)
+
+struct panic_log_time {
+	uint64_t now;             /* get_time() at the panic, in us */
+	uint32_t hw_clock;        /* Hardware clock source counter */
+};
+
+struct panic_log_task {
+	uint8_t id;               /* Task ID */
+	uint8_t reserved[3];      /* Reserved; set 0 */
+	char name[8];             /* Task name, null-padded */
+	uint32_t events;          /* Pending events */
+	uint32_t sp;              /* Stack pointer saved at the last switch */
+	uint32_t stack[];         /* Stack from sp on; may be empty */
+};
+
+/*
+ * The newest console output, compressed: a control byte c below 0x80 is
+ * followed by c + 1 literal bytes; from 0x80 on, it is followed by a byte d,
+ * and (c & 0x7f) + 3 bytes are copied from d + 1 bytes back in the output.
+ */
+struct panic_log_console {
+	uint16_t raw_size;        /* Bytes of output, once decompressed */
+	uint16_t reserved;        /* Reserved; set 0 */
+	uint8_t data[];           /* Compressed output */
+};
+
+#define PANIC_LOG_LZ_MIN_MATCH 3
+#define PANIC_LOG_LZ_MAX_MATCH (0x7f + PANIC_LOG_LZ_MIN_MATCH)
+#define PANIC_LOG_LZ_MAX_LITERAL 0x80
+#define PANIC_LOG_LZ_WINDOW 256
+
 /**
  * Write a string to the panic reporting device
  *
@@ -237,6 +296,13 @@ struct panic_data *get_panic_data_write(void);
  */
 void chip_panic_data_backup(void);
 
+/**
+ * Save the crash log (CONFIG_PANIC_LOG): the time, the state of each task,
+ * and as much of the newest console output as fits, compressed. Called on
+ * panic or watchdog, before the reset.
+ */
+void panic_log_save(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -76,6 +76,27 @@
 __stdlib_compat int vfnprintf(int (*addchar)(void *context, int c),
 			      void *context, const char *format, va_list args);
 
+/**
+ * Print formatted output to a function, a run of characters at a time.
+ *
+ * Same as vfnprintf(), but cheaper for outputs that can take several
+ * characters at once.
+ *
+ * @param addstr	Function to be called with each run of characters.
+ *			Will be passed the same context passed to
+ *			vfnprintf_bulk(), the characters and their number.
+ *			Should return 0 if all characters were accepted or
+ *			non-zero if any were dropped due to overflow.
+ * @param context	Context pointer to pass to addstr()
+ * @param format	Format string (see above for acceptable formats)
+ * @param args		Parameters
+ * @return EC_SUCCESS, or EC_ERROR_OVERFLOW if the output was truncated.
+ */
+__stdlib_compat int vfnprintf_bulk(int (*addstr)(void *context, const char *s,
+						 int len),
+				   void *context, const char *format,
+				   va_list args);
+
 /**
  * Print formatted outut to a string.
  *
@@ -58,6 +58,16 @@ struct rsa_public_key {
 };
 #endif
 
+/*
+ * Recover the digest from a signature, without checking it against the
+ * data: the signature can be checked while, or before, the data is hashed.
+ * Returns 1 if the signature is well-formed, and the digest in sha.
+ */
+int rsa_recover_digest(const struct rsa_public_key *key,
+		       const uint8_t *signature,
+		       uint8_t *sha,
+		       uint32_t *workbuf32);
+
 int rsa_verify(const struct rsa_public_key *key,
 	       const uint8_t *signature,
 	       const uint8_t *sha,
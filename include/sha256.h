@@ -23,9 +23,25 @@ struct sha256_ctx {
 };
 
 void SHA256_init(struct sha256_ctx *ctx);
+/*
+ * Whole blocks of data are hashed where they are, so data may point straight
+ * into memory-mapped flash; only a partial block at either end is copied.
+ */
 void SHA256_update(struct sha256_ctx *ctx, const uint8_t *data, uint32_t len);
 uint8_t *SHA256_final(struct sha256_ctx *ctx);
 
+/**
+ * Hash whole blocks with the chip's SHA engine (CONFIG_SHA256_HW_ACCELERATE).
+ * The blocks may be anywhere, including memory-mapped flash, and need not be
+ * aligned. Returns when the state is updated.
+ *
+ * @param h		Hash state, updated in place
+ * @param data		Blocks to hash
+ * @param block_nb	Number of blocks of SHA256_BLOCK_SIZE bytes; not 0
+ */
+void SHA256_hw_transform(uint32_t h[8], const uint8_t *data,
+			 unsigned int block_nb);
+
 void hmac_SHA256(uint8_t *output, const uint8_t *key, const int key_len,
 		 const uint8_t *message, const int message_len);
 
@@ -58,15 +58,27 @@ int shared_mem_acquire(int size, char **dest_ptr);
 void shared_mem_release(void *ptr);
 
 /*
- * This structure is allocated at the base of the free memory chunk and every
- * allocated buffer.
+ * This structure is allocated at the base of every buffer, free or allocated.
+ * A free buffer also ends with a copy of its size (a boundary tag), so that
+ * the buffer after it can find it. next_buffer and prev_buffer link free
+ * buffers in the free list of their size class; they are unused in allocated
+ * buffers.
  */
 struct shm_buffer {
 	struct shm_buffer *next_buffer;
 	struct shm_buffer *prev_buffer;
-	size_t buffer_size;
+	size_t buffer_size;	/* Including this header, and SHM_BUF_* flags */
 };
 
+/* Flags in the low bits of buffer_size, which is a multiple of 4 */
+#define SHM_BUF_ALLOCATED	BIT(0)
+/* The buffer right below this one is free */
+#define SHM_BUF_PREV_FREE	BIT(1)
+#define SHM_BUF_FLAGS		(SHM_BUF_ALLOCATED | SHM_BUF_PREV_FREE)
+
+/* Number of free lists; buffers of 2^(n + 4) bytes and up go in list n */
+#define SHM_SIZE_CLASSES	20
+
 #ifdef TEST_SHMALLOC
 
 /*
@@ -78,11 +90,13 @@ struct shm_buffer {
  * possible paths have been executed.
  */
 
-#define MAX_MASK_BIT 24
+#define MAX_MASK_BIT 13
 #define ALL_PATHS_MASK ((1 << (MAX_MASK_BIT + 1)) - 1)
 void set_map_bit(uint32_t mask);
-extern struct shm_buffer *free_buf_chain;
-extern struct shm_buffer *allocced_buf_chain;
+extern struct shm_buffer *free_lists[SHM_SIZE_CLASSES];
+extern uint32_t free_lists_map;
+extern struct shm_buffer *shm_start;
+extern struct shm_buffer *shm_end;
 #endif
 
 #endif  /* __CROS_EC_SHARED_MEM_H */
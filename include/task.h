@@ -27,6 +27,15 @@
 /* npcx peci event */
 #define TASK_EVENT_PECI_DONE	BIT(19)
 
+/*
+ * USB console stream Tx queue has room. USB streams are only on chips
+ * without PECI, so the two share a bit.
+ */
+#define TASK_EVENT_USB_CONSOLE_TX	TASK_EVENT_PECI_DONE
+#if defined(CONFIG_PECI) && defined(CONFIG_USB_CONSOLE_STREAM)
+#error "PECI and the USB console stream share a task event"
+#endif
+
 /* I2C tx/rx interrupt handler completion event. */
 #ifdef CHIP_STM32
 #define TASK_EVENT_I2C_COMPLETION(port) \
@@ -183,6 +192,18 @@ void task_print_list(void);
  */
 const char *task_get_name(task_id_t tskid);
 
+/**
+ * Get the stack of a task, as saved at its last context switch. For the task
+ * that was running at a panic, get its stack at the panic instead.
+ *
+ * @param tskid		Task ID
+ * @param sp		Set to the saved stack pointer
+ * @param end		Set to the end (top) of the stack
+ * @return EC_SUCCESS, or EC_ERROR_UNIMPLEMENTED if the core can't tell.
+ */
+int task_get_stack(task_id_t tskid, const uint32_t **sp,
+		   const uint32_t **end);
+
 #ifdef CONFIG_TASK_PROFILING
 /**
  * Start tracking an interrupt.
@@ -144,6 +144,14 @@ void run_test(int argc, char **argv);
 /* Test entry point for fuzzing tests. */
 int test_fuzz_one_input(const uint8_t *data, unsigned int size);
 
+/*
+ * Persistent fuzzing: save the EC global state once tasks have settled, and
+ * roll it back before each input (see core/host/fuzz_snapshot.c). Both must
+ * be called from a task context, so that no other task is running.
+ */
+void fuzz_snapshot_take(void);
+void fuzz_snapshot_restore(void);
+
 /* Resets test error count */
 void test_reset(void);
 
@@ -191,6 +199,12 @@ uint32_t prng(uint32_t seed);
 
 uint32_t prng_no_seed(void);
 
+/*
+ * Host clock in nanoseconds, for benchmarks. Unlike get_time(), which is
+ * emulated and only advances by 1 us per call, this measures real time.
+ */
+uint64_t test_bench_time_ns(void);
+
 /* Number of failed tests */
 extern int __test_error_count;
 
@@ -211,6 +225,12 @@ void test_capture_console(int enabled);
 /* Get captured console output */
 const char *test_get_captured_console(void);
 
+/*
+ * Keep UART output in the transmit buffer instead of sending it, e.g. to time
+ * the buffering alone. Output resumes on the next flush after releasing.
+ */
+void test_hold_uart_output(int hold);
+
 /*
  * Flush emulator status. Must be called before emulator reboots or
  * exits.
@@ -366,4 +366,16 @@ int uart_console_read_buffer(uint8_t type,
  */
 void uart_init_buffer(void);
 
+/**
+ * Get the transmit buffer, oldest output first, as two spans. Output not
+ * sent yet is included. Bytes never written are zero.
+ *
+ * @param first		Set to the older span
+ * @param first_len	Set to the length of the older span
+ * @param second	Set to the newer span
+ * @param second_len	Set to the length of the newer span
+ */
+void uart_get_buffer(const char **first, int *first_len,
+		     const char **second, int *second_len);
+
 #endif  /* __CROS_EC_UART_H */
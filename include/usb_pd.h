@@ -1727,6 +1727,12 @@ void dfp_consume_modes(int port, enum tcpm_transmit_type type, int cnt,
  */
 void pd_dfp_discovery_init(int port);
 
+/**
+ * Forget all alternate mode discovery results saved across detach
+ * (CONFIG_USB_PD_DISCOVERY_CACHE).
+ */
+void pd_discovery_cache_clear(void);
+
 /**
  * Set identity discovery state for this type and port
  *
@@ -276,6 +276,20 @@ void hexdump(const uint8_t *data, int len);
  */
 uint64_t mula32(uint32_t a, uint32_t b, uint32_t c);
 uint64_t mulaa32(uint32_t a, uint32_t b, uint32_t c, uint32_t d);
+#elif defined(__ARM_FEATURE_DSP)
+/* UMAAL computes (a*b)+c+d in one instruction; the result can't overflow. */
+static inline uint64_t mulaa32(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+	uint32_t lo = c, hi = d;
+
+	asm("umaal %0, %1, %2, %3" : "+r"(lo), "+r"(hi) : "r"(a), "r"(b));
+	return ((uint64_t)hi << 32) | lo;
+}
+
+static inline uint64_t mula32(uint32_t a, uint32_t b, uint32_t c)
+{
+	return mulaa32(a, b, c, 0);
+}
 #else
 static inline uint64_t mula32(uint32_t a, uint32_t b, uint32_t c)
 {
@@ -37,6 +37,15 @@ int vboot_get_rw_hash(const uint8_t **dst);
  */
 int vboot_hash_invalidate(int offset, int size);
 
+/**
+ * Mark the block digests kept for tree hashes (CONFIG_VBOOT_HASH_TREE) stale
+ * where they overlap the specified region. Leaves the hash itself alone.
+ *
+ * @param offset	Region start offset in flash
+ * @param size		Size of region in bytes
+ */
+void vboot_hash_invalidate_blocks(int offset, int size);
+
 /**
  * Get vboot progress status.
  *
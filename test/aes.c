@@ -644,6 +644,206 @@ static void test_aes_speed(void)
 	ccprintf("AES duration %lld us\n", (long long)(t1.val - t0.val));
 }
 
+/* Template-sized buffers, as encrypted by the fingerprint sensor code. */
+static const int template_sizes[] = {
+	5092 + 32,	/* FPC1025 */
+	14380 + 32,	/* FPC1035 */
+	47552 + 32,	/* FPC1145 */
+};
+static uint8_t template_buf[47552 + 32];
+static uint8_t template_out[47552 + 32];
+
+static void fill_random(uint8_t *buf, int size)
+{
+	int i;
+
+	for (i = 0; i < size; i++)
+		buf[i] = prng_no_seed();
+}
+
+/* The CTR path gives the same blocks as AES_encrypt on each counter. */
+static int test_aes_ctr32(void)
+{
+	static const uint8_t key[16] = {
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+		0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+	};
+	/* The 32-bit counter wraps in the middle of the blocks */
+	static const uint8_t ivec[16] = {
+		0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+		0xf8, 0xf9, 0xfa, 0xfb, 0xff, 0xff, 0xff, 0xfd,
+	};
+	uint8_t counter[16], block[16];
+	uint8_t *in = template_buf, *out = template_out;
+	AES_KEY aes_key;
+	int blocks, i, j;
+
+	TEST_ASSERT(AES_set_encrypt_key(key, 8 * sizeof(key), &aes_key) == 0);
+	fill_random(in, 16 * 9 + 1);
+
+	for (blocks = 0; blocks <= 9; blocks++) {
+		/* Unaligned, and one byte past the blocks left untouched */
+		memset(out, 0xa5, 16 * blocks + 2);
+		AES_ctr32_encrypt_blocks(in + 1, out + 1, blocks, &aes_key,
+					 ivec);
+		TEST_EQ(out[0], 0xa5, "%02x");
+		TEST_EQ(out[16 * blocks + 1], 0xa5, "%02x");
+
+		memcpy(counter, ivec, sizeof(counter));
+		for (i = 0; i < blocks; i++) {
+			AES_encrypt(counter, block, &aes_key);
+			for (j = 0; j < 16; j++)
+				block[j] ^= in[1 + 16 * i + j];
+			TEST_ASSERT_ARRAY_EQ(block, out + 1 + 16 * i, 16);
+			for (j = 15; j >= 12 && !++counter[j]; j--)
+				;
+		}
+	}
+
+	/* In place */
+	memcpy(out, in, 16 * 9);
+	AES_ctr32_encrypt_blocks(out, out, 9, &aes_key, ivec);
+	AES_ctr32_encrypt_blocks(out, out, 9, &aes_key, ivec);
+	TEST_ASSERT_ARRAY_EQ(in, out, 16 * 9);
+
+	return EC_SUCCESS;
+}
+
+/*
+ * GCM with the CTR path matches GCM block by block, whether the text comes
+ * at once or in pieces that split blocks.
+ */
+static int test_aes_gcm_ctr32(void)
+{
+	static const uint8_t key[16] = {
+		0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+		0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08,
+	};
+	static const uint8_t nonce[12] = {
+		0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad,
+		0xde, 0xca, 0xf8, 0x88,
+	};
+	static const int pieces[] = { 1, 15, 17, 64, 3, 100, 1000 };
+	const int size = 5092 + 32;
+	static AES_KEY aes_key;
+	static GCM128_CONTEXT ctx;
+	uint8_t tag[16], tag_ctr32[16];
+	int done, n, i;
+
+	TEST_ASSERT(AES_set_encrypt_key(key, 8 * sizeof(key), &aes_key) == 0);
+	fill_random(template_buf, size);
+
+	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, sizeof(nonce));
+	TEST_ASSERT(CRYPTO_gcm128_encrypt(&ctx, &aes_key, template_buf,
+					  template_out, size));
+	CRYPTO_gcm128_tag(&ctx, tag, sizeof(tag));
+
+	/* Encrypt in pieces, in place */
+	memcpy(tmp, template_out, sizeof(tmp));
+	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, sizeof(nonce));
+	for (done = 0, i = 0; done < size; done += n, i++) {
+		n = MIN(pieces[i % ARRAY_SIZE(pieces)], size - done);
+		TEST_ASSERT(CRYPTO_gcm128_encrypt_ctr32(
+			&ctx, &aes_key, template_buf + done,
+			template_buf + done, n,
+			(ctr128_f)AES_ctr32_encrypt_blocks));
+	}
+	CRYPTO_gcm128_tag(&ctx, tag_ctr32, sizeof(tag_ctr32));
+	TEST_ASSERT_ARRAY_EQ(template_out, template_buf, size);
+	TEST_ASSERT_ARRAY_EQ(tag, tag_ctr32, sizeof(tag));
+
+	/* Decrypt at once, in place, and check the tag */
+	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, sizeof(nonce));
+	TEST_ASSERT(CRYPTO_gcm128_decrypt_ctr32(
+		&ctx, &aes_key, template_buf, template_buf, size,
+		(ctr128_f)AES_ctr32_encrypt_blocks));
+	TEST_ASSERT(CRYPTO_gcm128_finish(&ctx, tag, sizeof(tag)));
+
+	/* Decrypt in pieces, out of place, and check against the block path */
+	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, sizeof(nonce));
+	TEST_ASSERT(CRYPTO_gcm128_decrypt(&ctx, &aes_key, template_out,
+					  template_out, size));
+	TEST_ASSERT_ARRAY_EQ(template_buf, template_out, size);
+	TEST_ASSERT(CRYPTO_gcm128_finish(&ctx, tag, sizeof(tag)));
+
+	/* A corrupted byte fails the tag */
+	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, sizeof(nonce));
+	TEST_ASSERT(CRYPTO_gcm128_encrypt_ctr32(
+		&ctx, &aes_key, template_buf, template_out, size,
+		(ctr128_f)AES_ctr32_encrypt_blocks));
+	template_out[size / 2] ^= 1;
+	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, sizeof(nonce));
+	for (done = 0, i = 0; done < size; done += n, i++) {
+		n = MIN(pieces[i % ARRAY_SIZE(pieces)], size - done);
+		TEST_ASSERT(CRYPTO_gcm128_decrypt_ctr32(
+			&ctx, &aes_key, template_out + done, tmp, n,
+			(ctr128_f)AES_ctr32_encrypt_blocks));
+	}
+	TEST_ASSERT(!CRYPTO_gcm128_finish(&ctx, tag, sizeof(tag)));
+
+	return EC_SUCCESS;
+}
+
+/*
+ * Time the AES-GCM encryption of a template, with its key setup, block by
+ * block or with the CTR path.
+ */
+static uint64_t time_gcm_template(int size, int ctr32, uint64_t *setup_ns)
+{
+	static const uint8_t key[16] = { 0 };
+	static const uint8_t nonce[12] = { 0 };
+	static AES_KEY aes_key;
+	static GCM128_CONTEXT ctx;
+	uint8_t tag[16];
+	uint64_t t0, t1;
+
+	t0 = test_bench_time_ns();
+	AES_set_encrypt_key(key, 8 * sizeof(key), &aes_key);
+	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, sizeof(nonce));
+	t1 = test_bench_time_ns();
+	if (ctr32)
+		CRYPTO_gcm128_encrypt_ctr32(&ctx, &aes_key, template_buf,
+					    template_out, size,
+					    (ctr128_f)AES_ctr32_encrypt_blocks);
+	else
+		CRYPTO_gcm128_encrypt(&ctx, &aes_key, template_buf,
+				      template_out, size);
+	CRYPTO_gcm128_tag(&ctx, tag, sizeof(tag));
+
+	*setup_ns = t1 - t0;
+	return test_bench_time_ns() - t0;
+}
+
+/* Throughput in MB/s */
+static int mb_per_s(int size, uint64_t ns)
+{
+	return (uint64_t)size * 1000 / MAX(ns, 1);
+}
+
+static void test_aes_gcm_template_speed(void)
+{
+	uint64_t t_block, t_ctr32, setup;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(template_sizes); i++) {
+		watchdog_reload();
+		t_block = time_gcm_template(template_sizes[i], 0, &setup);
+		t_ctr32 = time_gcm_template(template_sizes[i], 1, &setup);
+		ccprintf("AES-GCM %5d bytes: blocks %d MB/s, ctr32 %d MB/s, "
+			 "key setup %lld ns\n", template_sizes[i],
+			 mb_per_s(template_sizes[i], t_block),
+			 mb_per_s(template_sizes[i], t_ctr32),
+			 (long long)setup);
+	}
+}
+
 void run_test(int argc, char **argv)
 {
 	watchdog_reload();
@@ -659,6 +859,11 @@ void run_test(int argc, char **argv)
 
 	watchdog_reload();
 	RUN_TEST(test_aes_gcm);
+	RUN_TEST(test_aes_ctr32);
+	RUN_TEST(test_aes_gcm_ctr32);
+
+	/* do not check result, just as a benchmark */
+	test_aes_gcm_template_speed();
 
 	test_print_result();
 }
@@ -25,6 +25,10 @@ test-list-host += charge_manager
 test-list-host += charge_manager_drp_charging
 test-list-host += charge_ramp
 test-list-host += compile_time_macros
+test-list-host += console_batch
+test-list-host += console_binlog
+test-list-host += console_channel
+test-list-host += console_command
 test-list-host += console_edit
 test-list-host += crc32
 test-list-host += entropy
@@ -59,13 +63,17 @@ test-list-host += motion_sense_fifo
 test-list-host += mutex
 test-list-host += newton_fit
 test-list-host += online_calibration
+test-list-host += panic_log
 test-list-host += pingpong
 test-list-host += power_button
 test-list-host += printf
 test-list-host += queue
 test-list-host += rsa
 test-list-host += rsa3
+test-list-host += rsa3072
+test-list-host += rsa3072_3
 test-list-host += rtc
+test-list-host += rwsig
 test-list-host += sbs_charging_v2
 test-list-host += sha256
 test-list-host += sha256_unrolled
@@ -75,6 +83,7 @@ test-list-host += static_if_error
 test-list-host += system
 test-list-host += thermal
 test-list-host += timer_dos
+test-list-host += uart
 test-list-host += uptime
 test-list-host += usb_common
 test-list-host += usb_pd_int
@@ -100,6 +109,7 @@ test-list-host += usb_pe_drp_noextended
 test-list-host += utils
 test-list-host += utils_str
 test-list-host += vboot
+test-list-host += vboot_hash
 test-list-host += x25519
 test-list-host += stillness_detector
 endif
@@ -133,6 +143,10 @@ charge_manager-y=charge_manager.o
 charge_manager_drp_charging-y=charge_manager.o
 charge_ramp-y+=charge_ramp.o
 compile_time_macros-y=compile_time_macros.o
+console_batch-y=console_batch.o
+console_binlog-y=console_binlog.o
+console_channel-y=console_channel.o
+console_command-y=console_command.o
 console_edit-y=console_edit.o
 crc32-y=crc32.o
 entropy-y=entropy.o
@@ -167,6 +181,7 @@ kasa-y=kasa.o
 mpu-y=mpu.o
 mutex-y=mutex.o
 newton_fit-y=newton_fit.o
+panic_log-y=panic_log.o
 pingpong-y=pingpong.o
 power_button-y=power_button.o
 powerdemo-y=powerdemo.o
@@ -176,7 +191,10 @@ rollback-y=rollback.o
 rollback_entropy-y=rollback_entropy.o
 rsa-y=rsa.o
 rsa3-y=rsa.o
+rsa3072-y=rsa.o
+rsa3072_3-y=rsa.o
 rtc-y=rtc.o
+rwsig-y=rwsig.o
 scratchpad-y=scratchpad.o
 sbs_charging-y=sbs_charging.o
 sbs_charging_v2-y=sbs_charging_v2.o
@@ -190,6 +208,7 @@ system-y=system.o
 thermal-y=thermal.o
 timer_calib-y=timer_calib.o
 timer_dos-y=timer_dos.o
+uart-y=uart.o
 uptime-y=uptime.o
 usb_common-y=usb_common_test.o fake_battery.o
 usb_pd_int-y=usb_pd_int.o
@@ -216,6 +235,7 @@ usb_tcpmv2_tcpci-y=usb_tcpmv2_tcpci.o vpd_api.o usb_sm_checks.o
 utils-y=utils.o
 utils_str-y=utils_str.o
 vboot-y=vboot.o
+vboot_hash-y=vboot_hash.o
 float-y=fp.o
 fp-y=fp.o
 x25519-y=x25519.o
@@ -787,6 +787,103 @@ static int test_unknown_dualrole_capability(void)
 	return EC_SUCCESS;
 }
 
+/*
+ * Port the charge manager is expected to pick from a charge table, scanning
+ * every supplier of every port in the same way as the original selection.
+ * All ports are dedicated and there is no override.
+ */
+static int expected_charge_port(struct charge_port_info
+				charge[CHARGE_SUPPLIER_COUNT][CHARGE_PORT_COUNT],
+				int prev_port)
+{
+	int supplier = CHARGE_SUPPLIER_NONE;
+	int port = CHARGE_PORT_NONE;
+	int best_power = -1, power;
+	int i, j;
+
+	for (i = 0; i < CHARGE_SUPPLIER_COUNT; ++i)
+		for (j = 0; j < CHARGE_PORT_COUNT; ++j) {
+			if (charge[i][j].current == 0)
+				continue;
+			power = charge[i][j].current * charge[i][j].voltage;
+			if (supplier == CHARGE_SUPPLIER_NONE ||
+			    supplier_priority[i] < supplier_priority[supplier] ||
+			    (supplier_priority[i] ==
+			     supplier_priority[supplier] &&
+			     (power > best_power ||
+			      (power == best_power && j == prev_port)))) {
+				supplier = i;
+				port = j;
+				best_power = power;
+			}
+		}
+	return port;
+}
+
+/* The low bits of prng_no_seed() have short periods */
+static int churn_rand(int n)
+{
+	return (prng_no_seed() >> 16) % n;
+}
+
+static int test_selection_churn(void)
+{
+	static const int currents[] = { 0, 500, 1500, 3000 };
+	static const int voltages[] = { 5000, 9000 };
+	static struct charge_port_info
+		table[CHARGE_SUPPLIER_COUNT][CHARGE_PORT_COUNT];
+	struct charge_port_info charge;
+	int changes = 1000, full_scans;
+	int i, port, supplier, prev_port;
+
+	/* Initialize table to no charge. */
+	initialize_charge_table(0, 5000, 5000);
+	TEST_ASSERT(active_charge_port == CHARGE_PORT_NONE);
+	memset(table, 0, sizeof(table));
+
+	/* Equal offers on inactive ports: the lower supplier index wins. */
+	charge.current = 1500;
+	charge.voltage = 5000;
+	charge_manager_update_charge(CHARGE_SUPPLIER_TEST3, 0, &charge);
+	charge_manager_update_charge(CHARGE_SUPPLIER_TEST2, 1, &charge);
+	wait_for_charge_manager_refresh();
+	TEST_ASSERT(active_charge_port == 1);
+	charge.current = 0;
+	charge_manager_update_charge(CHARGE_SUPPLIER_TEST3, 0, &charge);
+	charge_manager_update_charge(CHARGE_SUPPLIER_TEST2, 1, &charge);
+	wait_for_charge_manager_refresh();
+	TEST_ASSERT(active_charge_port == CHARGE_PORT_NONE);
+
+	/*
+	 * Plug, unplug and renegotiate random suppliers on random ports. The
+	 * same power on equal priority suppliers exercises the tie breaks.
+	 */
+	charge_manager_supplier_scans = 0;
+	for (i = 0; i < changes; i++) {
+		port = churn_rand(CHARGE_PORT_COUNT);
+		supplier = churn_rand(CHARGE_SUPPLIER_COUNT);
+		charge.current = currents[churn_rand(ARRAY_SIZE(currents))];
+		charge.voltage = voltages[churn_rand(ARRAY_SIZE(voltages))];
+		table[supplier][port] = charge;
+
+		prev_port = active_charge_port;
+		charge_manager_update_charge(supplier, port, &charge);
+		wait_for_charge_manager_refresh();
+		TEST_ASSERT(active_charge_port ==
+			    expected_charge_port(table, prev_port));
+	}
+
+	/* Only the changed port needs to be looked at again on each change */
+	full_scans = changes * CHARGE_SUPPLIER_COUNT * CHARGE_PORT_COUNT;
+	ccprintf("%d changes on %d ports: %d supplier scans (full: %d)\n",
+		 changes, CHARGE_PORT_COUNT, charge_manager_supplier_scans,
+		 full_scans);
+	TEST_ASSERT(charge_manager_supplier_scans <=
+		    changes * CHARGE_SUPPLIER_COUNT);
+
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, char **argv)
 {
 	test_reset();
@@ -800,6 +897,7 @@ void run_test(int argc, char **argv)
 	RUN_TEST(test_dual_role);
 	RUN_TEST(test_rejected_port);
 	RUN_TEST(test_unknown_dualrole_capability);
+	RUN_TEST(test_selection_churn);
 
 	test_print_result();
 }
@@ -0,0 +1,330 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test console batch mode.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "system.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+/* Print the arguments after the first, and return the first as result. */
+static int command_btest(int argc, char **argv)
+{
+	int i;
+
+	if (argc < 2)
+		return EC_ERROR_PARAM_COUNT;
+
+	for (i = 2; i < argc; i++)
+		ccprintf("%s\n", argv[i]);
+	return strtoi(argv[1], NULL, 0);
+}
+DECLARE_CONSOLE_COMMAND(btest, command_btest, "result [words...]", NULL);
+
+/* Print more than fits in the batch output buffer */
+static int command_bflood(int argc, char **argv)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_CONSOLE_BATCH_BUF_SIZE / 8; i++)
+		ccprintf("flood%02d\n", i);
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(bflood, command_bflood, NULL, NULL);
+
+static int batch_command(int subcmd, const char *lines, void *resp,
+			 int resp_size)
+{
+	uint8_t buf[sizeof(struct ec_params_console_batch) + 128];
+	struct ec_params_console_batch *p = (void *)buf;
+	int len = lines ? strlen(lines) : 0;
+
+	p->subcmd = subcmd;
+	memcpy(p->commands, lines, len);
+	return test_send_host_command(EC_CMD_CONSOLE_BATCH, 0, p,
+				      sizeof(*p) + len, resp, resp_size);
+}
+
+static int batch_read(struct ec_response_console_batch *r, int size,
+		      int *len)
+{
+	struct ec_params_console_batch p = {
+		.subcmd = CONSOLE_BATCH_READ,
+	};
+	struct host_cmd_handler_args args = {
+		.command = EC_CMD_CONSOLE_BATCH,
+		.params = &p,
+		.params_size = sizeof(p),
+		.response = r,
+		.response_max = size,
+	};
+	int rv;
+
+	rv = host_command_process(&args);
+	*len = args.response_size - sizeof(*r);
+	return rv;
+}
+
+/*
+ * Read all the output of a host batch, "chunk" bytes at a time, into out.
+ * Return the flags of the last read.
+ */
+static int read_all(uint8_t *out, int *len, int chunk)
+{
+	uint8_t buf[sizeof(struct ec_response_console_batch) + 64];
+	struct ec_response_console_batch *r = (void *)buf;
+	int tries, n;
+
+	*len = 0;
+	for (tries = 0; tries < 1000; tries++) {
+		/* Let the console task run the batch */
+		msleep(1);
+		TEST_ASSERT(batch_read(r, sizeof(*r) + chunk, &n) ==
+			    EC_RES_SUCCESS);
+		memcpy(out + *len, r->data, n);
+		*len += n;
+		if (r->flags & EC_CONSOLE_BATCH_DONE)
+			return r->flags;
+	}
+	return -1;
+}
+
+/* Check the next frame of the output, and move past it. */
+static int check_frame(const uint8_t **pos, int result, int flags,
+		       const char *output)
+{
+	struct ec_console_batch_frame f;
+
+	memcpy(&f, *pos, sizeof(f));
+	*pos += sizeof(f);
+	TEST_EQ(f.result, result, "%d");
+	TEST_EQ(f.flags, flags, "%d");
+	if (output) {
+		TEST_EQ(f.size, (int)strlen(output), "%d");
+		TEST_ASSERT(memcmp(*pos, output, f.size) == 0);
+	}
+	*pos += f.size;
+
+	return EC_SUCCESS;
+}
+
+static int test_host_batch(void)
+{
+	uint8_t out[CONFIG_CONSOLE_BATCH_BUF_SIZE];
+	const uint8_t *pos = out;
+	int len;
+
+	TEST_ASSERT(batch_command(CONSOLE_BATCH_ADD, "btest 0 a b\nbtest 1\n",
+				  NULL, 0) == EC_RES_SUCCESS);
+	TEST_ASSERT(batch_command(CONSOLE_BATCH_RUN,
+				  "nosuchcommand\n\nbtest 0 last", NULL, 0) ==
+		    EC_RES_SUCCESS);
+
+	/* Only one batch at a time */
+	TEST_ASSERT(batch_command(CONSOLE_BATCH_ADD, "btest 0\n", NULL, 0) ==
+		    EC_RES_BUSY);
+
+	TEST_EQ(read_all(out, &len, 64), EC_CONSOLE_BATCH_DONE, "%d");
+
+	TEST_ASSERT(check_frame(&pos, EC_SUCCESS, 0, "a\nb\n") == EC_SUCCESS);
+	TEST_ASSERT(check_frame(&pos, EC_ERROR_UNKNOWN, 0,
+				"Unknown error\nUsage: btest result "
+				"[words...]\n") == EC_SUCCESS);
+	TEST_ASSERT(check_frame(&pos, EC_ERROR_UNKNOWN, 0,
+				"Command 'nosuchcommand' not found or "
+				"ambiguous.\n") == EC_SUCCESS);
+	TEST_ASSERT(check_frame(&pos, EC_SUCCESS, 0, "") == EC_SUCCESS);
+	TEST_ASSERT(check_frame(&pos, EC_SUCCESS, 0, "last\n") == EC_SUCCESS);
+	TEST_EQ((int)(pos - out), len, "%d");
+
+	return EC_SUCCESS;
+}
+
+/* Frames are read while the batch runs, so the output can be larger. */
+static int test_host_streaming(void)
+{
+	uint8_t out[CONFIG_CONSOLE_BATCH_BUF_SIZE * 4];
+	const uint8_t *pos = out;
+	int len, i;
+
+	for (i = 0; i < 4; i++)
+		TEST_ASSERT(batch_command(CONSOLE_BATCH_ADD,
+					  "btest 0 0123456789abcdef "
+					  "0123456789abcdef 0123456789abcdef\n",
+					  NULL, 0) == EC_RES_SUCCESS);
+	TEST_ASSERT(batch_command(CONSOLE_BATCH_RUN, "bflood", NULL, 0) ==
+		    EC_RES_SUCCESS);
+
+	TEST_EQ(read_all(out, &len, 16), EC_CONSOLE_BATCH_DONE, "%d");
+
+	for (i = 0; i < 4; i++)
+		TEST_ASSERT(check_frame(&pos, EC_SUCCESS, 0,
+					"0123456789abcdef\n0123456789abcdef\n"
+					"0123456789abcdef\n") == EC_SUCCESS);
+	/* Too much output for the buffer, even when read as it comes */
+	TEST_ASSERT(check_frame(&pos, EC_SUCCESS,
+				EC_CONSOLE_BATCH_FRAME_TRUNCATED, NULL) ==
+		    EC_SUCCESS);
+	TEST_EQ((int)(pos - out), len, "%d");
+
+	return EC_SUCCESS;
+}
+
+/* The console keeps running commands while a batch waits for the host. */
+static int test_host_wait(void)
+{
+	uint8_t out[CONFIG_CONSOLE_BATCH_BUF_SIZE];
+	const uint8_t *pos = out;
+	int len;
+
+	TEST_ASSERT(batch_command(CONSOLE_BATCH_RUN, "bflood\nbtest 0 next",
+				  NULL, 0) == EC_RES_SUCCESS);
+	msleep(10);
+
+	test_capture_console(1);
+	UART_INJECT("btest 0 responsive\n");
+	msleep(10);
+	cflush();
+	test_capture_console(0);
+	TEST_ASSERT(strstr(test_get_captured_console(), "responsive\r\n") !=
+		    NULL);
+
+	TEST_EQ(read_all(out, &len, 64), EC_CONSOLE_BATCH_DONE, "%d");
+	TEST_ASSERT(check_frame(&pos, EC_SUCCESS,
+				EC_CONSOLE_BATCH_FRAME_TRUNCATED, NULL) ==
+		    EC_SUCCESS);
+	TEST_ASSERT(check_frame(&pos, EC_SUCCESS, 0, "next\n") == EC_SUCCESS);
+	TEST_EQ((int)(pos - out), len, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_console_batch(void)
+{
+	struct ec_response_console_batch r;
+	const char *captured;
+
+	/* Lines are queued, not run */
+	test_capture_console(1);
+	UART_INJECT("batch start\n");
+	UART_INJECT("btest 0 one\n");
+	UART_INJECT("btest 4\n");
+	msleep(10);
+	cflush();
+	test_capture_console(0);
+	TEST_ASSERT(strstr(test_get_captured_console(), "\none\r\n") == NULL);
+
+	test_capture_console(1);
+	UART_INJECT("batch run\n");
+	msleep(10);
+	cflush();
+	test_capture_console(0);
+
+	captured = test_get_captured_console();
+	TEST_ASSERT(strstr(captured, "@@ 0 0 4\r\none\r\n") != NULL);
+	TEST_ASSERT(strstr(captured, "@@ 1 4 39\r\nTimeout\r\n"
+			   "Usage: btest result [words...]\r\n") != NULL);
+
+	/* The host can't read or add to the console's batch */
+	TEST_ASSERT(batch_command(CONSOLE_BATCH_READ, NULL, &r, sizeof(r)) ==
+		    EC_RES_ACCESS_DENIED);
+
+	/* Lines run normally again */
+	test_capture_console(1);
+	UART_INJECT("btest 0 after\n");
+	msleep(10);
+	cflush();
+	test_capture_console(0);
+	TEST_ASSERT(strstr(test_get_captured_console(), "after\r\n") != NULL);
+	TEST_ASSERT(strstr(test_get_captured_console(), "@@") == NULL);
+
+	return EC_SUCCESS;
+}
+
+/* Lines dropped from a full console batch are reported when it runs. */
+static int test_console_overflow(void)
+{
+	int i;
+
+	UART_INJECT("batch start\n");
+	msleep(10);
+	for (i = 0; i < CONFIG_CONSOLE_BATCH_BUF_SIZE / 32; i++) {
+		UART_INJECT("btest 0 0123456789abcdef0123456789\n");
+		msleep(10);
+	}
+
+	test_capture_console(1);
+	UART_INJECT("batch run\n");
+	msleep(10);
+	cflush();
+	test_capture_console(0);
+	TEST_ASSERT(strstr(test_get_captured_console(), "@@ overflow") !=
+		    NULL);
+
+	return EC_SUCCESS;
+}
+
+/* A batch the host adds lines to but never runs is released. */
+static int test_host_idle(void)
+{
+	TEST_ASSERT(batch_command(CONSOLE_BATCH_ADD, "btest 0\n", NULL, 0) ==
+		    EC_RES_SUCCESS);
+
+	test_capture_console(1);
+	UART_INJECT("batch start\n");
+	msleep(10);
+	cflush();
+	test_capture_console(0);
+	TEST_ASSERT(strstr(test_get_captured_console(), "Collecting") == NULL);
+
+	sleep(6);
+	test_capture_console(1);
+	UART_INJECT("batch start\n");
+	msleep(10);
+	cflush();
+	test_capture_console(0);
+	TEST_ASSERT(strstr(test_get_captured_console(), "Collecting") != NULL);
+
+	UART_INJECT("batch abort\n");
+	msleep(10);
+
+	return EC_SUCCESS;
+}
+
+/* The host can't run console commands on a locked system. */
+static int test_host_locked(void)
+{
+	UART_INJECT("syslock\n");
+	msleep(10);
+	TEST_ASSERT(system_is_locked());
+
+	TEST_ASSERT(batch_command(CONSOLE_BATCH_ADD, "btest 0\n", NULL, 0) ==
+		    EC_RES_ACCESS_DENIED);
+	TEST_ASSERT(batch_command(CONSOLE_BATCH_RUN, "btest 0", NULL, 0) ==
+		    EC_RES_ACCESS_DENIED);
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_host_batch);
+	RUN_TEST(test_host_streaming);
+	RUN_TEST(test_host_wait);
+	RUN_TEST(test_console_batch);
+	RUN_TEST(test_console_overflow);
+	RUN_TEST(test_host_idle);
+	/* Last, as the system can't be unlocked again */
+	RUN_TEST(test_host_locked);
+
+	test_print_result();
+}
@@ -0,0 +1,198 @@
+/* Copyright 2020 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test deferred (binary) console logging.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "printf.h"
+#include "test_util.h"
+#include "timer.h"
+#include "uart.h"
+#include "util.h"
+
+#define BENCH_LINES 64
+
+/* Output of a deferred cprintf() must match a direct snprintf(). */
+static int test_deferred_output(void)
+{
+	static const uint8_t bytes[] = { 0xde, 0xad, 0xbe, 0xef, 0x01 };
+	const char *captured;
+	char expected[256];
+
+	test_capture_console(1);
+	cprintf(CC_COMMAND,
+		"a %d %u %x %08X %-5s| %.*s %*d %c %lld %s %ph %pb %% end",
+		-12, 34u, 0xabc, 0x1f, "ab", 3, "truncated", 6, 42, 'z',
+		-1234567890123LL, "str", HEX_BUF(bytes, 5),
+		BINARY_VALUE(5, 8));
+	test_capture_console(0);
+
+	/* Nothing is formatted until the console task gets to it */
+	TEST_ASSERT(test_get_captured_console()[0] == '\0');
+
+	test_capture_console(1);
+	cflush();
+	test_capture_console(0);
+
+	snprintf(expected, sizeof(expected),
+		 "a %d %u %x %08X %-5s| %.*s %*d %c %lld %s %ph %pb %% end",
+		 -12, 34u, 0xabc, 0x1f, "ab", 3, "truncated", 6, 42, 'z',
+		 -1234567890123LL, "str", HEX_BUF(bytes, 5),
+		 BINARY_VALUE(5, 8));
+	captured = test_get_captured_console();
+	TEST_ASSERT(strncmp(captured, expected, sizeof(expected)) == 0);
+
+	return EC_SUCCESS;
+}
+
+/* cprints() lines keep the time they were logged at. */
+static int test_deferred_timestamp(void)
+{
+	static const char suffix[] = " hello world]\r\n";
+	const char *captured;
+	char *e;
+	uint64_t logged, printed;
+	int len;
+
+	logged = get_time().val;
+	cprints(CC_COMMAND, "hello %s", "world");
+
+	/* Let time pass before the line is formatted, without yielding */
+	udelay(10 * MSEC);
+
+	test_capture_console(1);
+	cflush();
+	test_capture_console(0);
+
+	captured = test_get_captured_console();
+	len = strlen(captured);
+	TEST_ASSERT(captured[0] == '[');
+	TEST_ASSERT(len > sizeof(suffix));
+	TEST_ASSERT(strncmp(captured + len - (sizeof(suffix) - 1), suffix,
+			    sizeof(suffix)) == 0);
+
+	/* The time printed is the time of the cprints() call, not later */
+	printed = strtoi(captured + 1, &e, 10) * SECOND;
+	TEST_ASSERT(*e == '.');
+	printed += strtoi(e + 1, NULL, 10);
+	TEST_ASSERT(printed >= logged && printed < logged + MSEC);
+
+	return EC_SUCCESS;
+}
+
+/* Lines that can't be stored are formatted directly, in order. */
+static int test_fallback_order(void)
+{
+	char long_str[201];
+	char expected[256];
+
+	memset(long_str, 'x', sizeof(long_str) - 1);
+	long_str[sizeof(long_str) - 1] = '\0';
+
+	test_capture_console(1);
+	cprintf(CC_COMMAND, "first ");
+	cputs(CC_COMMAND, "second ");
+	/* Too long for a record */
+	cprintf(CC_COMMAND, "%s", long_str);
+	cprintf(CC_COMMAND, " last");
+	cflush();
+	test_capture_console(0);
+
+	snprintf(expected, sizeof(expected), "first second %s last",
+		 long_str);
+	TEST_ASSERT(strncmp(test_get_captured_console(), expected,
+			    sizeof(expected)) == 0);
+
+	return EC_SUCCESS;
+}
+
+/* A format in writable memory is formatted before the buffer is reused. */
+static int test_buffer_format(void)
+{
+	static char line[32];
+
+	test_capture_console(1);
+	strzcpy(line, "first %d ", sizeof(line));
+	cprintf(CC_COMMAND, line, 1);
+	strzcpy(line, "second %d", sizeof(line));
+	cprintf(CC_COMMAND, line, 2);
+	cflush();
+	test_capture_console(0);
+
+	TEST_ASSERT(strncmp(test_get_captured_console(), "first 1 second 2",
+			    sizeof(line)) == 0);
+
+	return EC_SUCCESS;
+}
+
+/* Dumping the log ends on whole records once the ring has wrapped. */
+static int test_dump(void)
+{
+	static char cmd[] = "binlog";
+	static char arg[] = "dump";
+	char *argv[] = { cmd, arg };
+	const struct console_command *c = find_command(cmd);
+	const char *captured;
+	int i;
+
+	TEST_ASSERT(c);
+	for (i = 0; i < CONFIG_CONSOLE_BINLOG_BUF_SIZE / 4; i++) {
+		cprintf(CC_COMMAND, "wrap %d\n", i);
+		cflush();
+	}
+
+	test_capture_console(1);
+	TEST_ASSERT(c->handler(ARRAY_SIZE(argv), argv) == EC_SUCCESS);
+	test_capture_console(0);
+
+	captured = test_get_captured_console();
+	TEST_ASSERT(strncmp(captured, "binlog:", 7) == 0);
+	TEST_ASSERT(!strstr(captured, "overwritten"));
+
+	return EC_SUCCESS;
+}
+
+/* Cost of a console line for the caller, with and without binary log. */
+static int test_caller_cost(void)
+{
+	uint64_t deferred = 0, direct = 0;
+	uint64_t t;
+	int i;
+
+	for (i = 0; i < BENCH_LINES; i++) {
+		t = test_bench_time_ns();
+		cprintf(CC_COMMAND, "bench %d: %s 0x%08x\n", i, "deferred",
+			i * 0x1234567);
+		deferred += test_bench_time_ns() - t;
+		cflush();
+
+		t = test_bench_time_ns();
+		uart_printf("bench %d: %s 0x%08x\n", i, "direct",
+			    i * 0x1234567);
+		direct += test_bench_time_ns() - t;
+		cflush();
+	}
+
+	ccprintf("Per line: deferred %lld ns, direct %lld ns\n",
+		 (long long)(deferred / BENCH_LINES),
+		 (long long)(direct / BENCH_LINES));
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_deferred_output);
+	RUN_TEST(test_deferred_timestamp);
+	RUN_TEST(test_fallback_order);
+	RUN_TEST(test_buffer_format);
+	RUN_TEST(test_dump);
+	RUN_TEST(test_caller_cost);
+
+	test_print_result();
+}
@@ -0,0 +1,190 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test console channel rate limiting and line accounting.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "test_util.h"
+#include "timer.h"
+#include "uart.h"
+#include "util.h"
+
+static int get_stats(int channel, struct ec_response_console_channel_stats *r)
+{
+	struct ec_params_console_channel_stats p = {
+		.channel = channel,
+	};
+
+	return test_send_host_command(EC_CMD_CONSOLE_CHANNEL_STATS, 0, &p,
+				      sizeof(p), r, sizeof(*r));
+}
+
+/* Output "count" lines on the channel, and return how many made it out. */
+static int output_lines(enum console_channel channel, int count)
+{
+	const char *s;
+	int lines = 0;
+	int i;
+
+	cflush();
+	test_capture_console(1);
+	for (i = 0; i < count; i++)
+		cprintf(channel, "line %d\n", i);
+	cflush();
+	test_capture_console(0);
+
+	for (s = test_get_captured_console(); (s = strstr(s, "line ")); s++)
+		lines++;
+	return lines;
+}
+
+static int run_command(char *command)
+{
+	UART_INJECT(command);
+	/* Let the console task run it */
+	msleep(10);
+	return EC_SUCCESS;
+}
+
+static int test_stats_command(void)
+{
+	struct ec_response_console_channel_stats r;
+
+	TEST_ASSERT(get_stats(CC_CHARGER, &r) == EC_RES_SUCCESS);
+	TEST_ASSERT(strncmp(r.name, "charger", sizeof(r.name)) == 0);
+	TEST_EQ(r.channel_count, CC_CHANNEL_COUNT, "%d");
+	TEST_EQ(r.flags, EC_CONSOLE_CHANNEL_ENABLED, "%d");
+	TEST_EQ(r.rate, 10, "%d");
+	TEST_EQ(r.burst, 5, "%d");
+
+	/* Command output is never limited */
+	TEST_ASSERT(get_stats(CC_COMMAND, &r) == EC_RES_SUCCESS);
+	TEST_EQ(r.rate, 0, "%d");
+
+	TEST_ASSERT(get_stats(CC_CHANNEL_COUNT, &r) == EC_RES_INVALID_PARAM);
+
+	return EC_SUCCESS;
+}
+
+/* A burst goes through, then lines come at the channel rate. */
+static int test_rate_limit(void)
+{
+	struct ec_response_console_channel_stats r;
+	uint32_t suppressed;
+
+	TEST_ASSERT(get_stats(CC_CHARGER, &r) == EC_RES_SUCCESS);
+	suppressed = r.suppressed;
+
+	TEST_ASSERT(output_lines(CC_CHARGER, 20) == 5);
+	TEST_ASSERT(get_stats(CC_CHARGER, &r) == EC_RES_SUCCESS);
+	TEST_EQ(r.suppressed - suppressed, 15, "%d");
+
+	/* 10 lines per second, so 250 ms lets 2 more lines through */
+	msleep(250);
+	TEST_ASSERT(output_lines(CC_CHARGER, 20) == 2);
+
+	/* Other channels have their own bucket */
+	TEST_ASSERT(output_lines(CC_CLOCK, 20) == 5);
+
+	TEST_ASSERT(output_lines(CC_COMMAND, 20) == 20);
+
+	return EC_SUCCESS;
+}
+
+/* A line output in pieces takes one token, and is kept or cut whole. */
+static int test_rate_pieces(void)
+{
+	struct ec_response_console_channel_stats r;
+	uint32_t suppressed;
+	const char *s;
+	int lines = 0;
+	int i;
+
+	/* Let the bucket fill up again */
+	msleep(1000);
+	TEST_ASSERT(get_stats(CC_CLOCK, &r) == EC_RES_SUCCESS);
+	suppressed = r.suppressed;
+
+	cflush();
+	test_capture_console(1);
+	for (i = 0; i < 20; i++) {
+		cputs(CC_CLOCK, "piece ");
+		cprintf(CC_CLOCK, "%d ", i);
+		cputs(CC_CLOCK, "end\n");
+	}
+	cflush();
+	test_capture_console(0);
+
+	for (s = test_get_captured_console(); (s = strstr(s, "piece ")); s++)
+		lines++;
+	TEST_EQ(lines, 5, "%d");
+	TEST_ASSERT(!strstr(test_get_captured_console(), "end\nend"));
+	TEST_ASSERT(get_stats(CC_CLOCK, &r) == EC_RES_SUCCESS);
+	TEST_EQ(r.suppressed - suppressed, 15, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_rate_command(void)
+{
+	struct ec_response_console_channel_stats r;
+
+	TEST_ASSERT(run_command("chan rate charger 0\n") == EC_SUCCESS);
+	TEST_ASSERT(output_lines(CC_CHARGER, 20) == 20);
+
+	TEST_ASSERT(run_command("chan rate charger 1 3\n") == EC_SUCCESS);
+	TEST_ASSERT(get_stats(CC_CHARGER, &r) == EC_RES_SUCCESS);
+	TEST_EQ(r.rate, 1, "%d");
+	TEST_EQ(r.burst, 3, "%d");
+	TEST_ASSERT(output_lines(CC_CHARGER, 20) == 3);
+
+	/* The command channel can't be limited */
+	TEST_ASSERT(run_command("chan rate command 1\n") == EC_SUCCESS);
+	TEST_ASSERT(output_lines(CC_COMMAND, 20) == 20);
+
+	TEST_ASSERT(run_command("chan rate charger 0\n") == EC_SUCCESS);
+
+	return EC_SUCCESS;
+}
+
+/* Lines that don't fit in the output buffer are counted as dropped. */
+static int test_dropped(void)
+{
+	struct ec_response_console_channel_stats r;
+	char fill[CONFIG_UART_TX_BUF_SIZE];
+	uint32_t dropped;
+
+	TEST_ASSERT(get_stats(CC_CHARGER, &r) == EC_RES_SUCCESS);
+	dropped = r.dropped;
+
+	memset(fill, '.', sizeof(fill));
+	cflush();
+	test_hold_uart_output(1);
+	uart_put_raw(fill, sizeof(fill));
+	cprintf(CC_CHARGER, "dropped\n");
+	cprints(CC_CHARGER, "dropped");
+	test_hold_uart_output(0);
+	cflush();
+
+	TEST_ASSERT(get_stats(CC_CHARGER, &r) == EC_RES_SUCCESS);
+	TEST_EQ(r.dropped - dropped, 2, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_stats_command);
+	RUN_TEST(test_rate_limit);
+	RUN_TEST(test_rate_pieces);
+	RUN_TEST(test_rate_command);
+	RUN_TEST(test_dropped);
+
+	test_print_result();
+}
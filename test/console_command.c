@@ -0,0 +1,143 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test console command lookup.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "link_defs.h"
+#include "test_util.h"
+#include "util.h"
+
+#define BENCH_ROUNDS 100
+#define BENCH_RUNS 5
+
+/* Linear search, as find_command() used to do it */
+static const struct console_command *find_command_linear(char *name)
+{
+	const struct console_command *cmd, *match = NULL;
+	int match_length = strlen(name);
+
+	for (cmd = __cmds; cmd < __cmds_end; cmd++) {
+		if (!strncasecmp(name, cmd->name, match_length)) {
+			if (match)
+				return NULL;
+			if (cmd->name[match_length] == '\0')
+				return cmd;
+			match = cmd;
+		}
+	}
+
+	return match;
+}
+
+/* The binary search relies on the link order. */
+static int test_sorted(void)
+{
+	const struct console_command *cmd;
+	const char *c;
+
+	TEST_ASSERT(__cmds_end - __cmds > 1);
+
+	for (cmd = __cmds; cmd < __cmds_end; cmd++) {
+		for (c = cmd->name; *c; c++)
+			TEST_ASSERT(*c < 'A' || *c > 'Z');
+		if (cmd > __cmds)
+			TEST_ASSERT(strcasecmp(cmd[-1].name, cmd->name) < 0);
+	}
+
+	return EC_SUCCESS;
+}
+
+/* Every prefix of every command, in any case, finds what it used to. */
+static int test_same_as_linear(void)
+{
+	static char * const unknown[] = {
+		"zzzz", "0", "_", "helpx", "~",
+	};
+	const struct console_command *cmd;
+	char name[CONSOLE_COMMAND_NAME_MAX_LEN + 1];
+	int len, i;
+
+	for (cmd = __cmds; cmd < __cmds_end; cmd++) {
+		for (len = 1; len <= strlen(cmd->name); len++) {
+			strzcpy(name, cmd->name, len + 1);
+			TEST_ASSERT(find_command(name) ==
+				    find_command_linear(name));
+
+			for (i = 0; i < len; i++)
+				if (name[i] >= 'a' && name[i] <= 'z')
+					name[i] += 'A' - 'a';
+			TEST_ASSERT(find_command(name) ==
+				    find_command_linear(name));
+		}
+		TEST_ASSERT(find_command(name) == cmd);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(unknown); i++)
+		TEST_ASSERT(find_command(unknown[i]) == NULL);
+
+	/* "help" is a full match, even though "h" is ambiguous */
+	TEST_ASSERT(find_command("help") != NULL);
+	TEST_ASSERT(find_command("h") == find_command_linear("h"));
+
+	return EC_SUCCESS;
+}
+
+/* Time the lookup of each command, by full name and by shortest prefix. */
+static uint64_t bench(const struct console_command *(*find)(char *name))
+{
+	const struct console_command *cmd;
+	char name[CONSOLE_COMMAND_NAME_MAX_LEN + 1];
+	uint64_t t;
+	int round, len;
+
+	t = test_bench_time_ns();
+	for (round = 0; round < BENCH_ROUNDS; round++) {
+		for (cmd = __cmds; cmd < __cmds_end; cmd++) {
+			strzcpy(name, cmd->name, sizeof(name));
+			find(name);
+
+			for (len = 1; len < strlen(cmd->name); len++) {
+				name[len] = '\0';
+				if (find(name) == cmd)
+					break;
+				strzcpy(name, cmd->name, sizeof(name));
+			}
+		}
+	}
+	return test_bench_time_ns() - t;
+}
+
+static int test_dispatch_time(void)
+{
+	const int lookups = BENCH_ROUNDS * (__cmds_end - __cmds) * 2;
+	uint64_t t_linear = UINT64_MAX, t_search = UINT64_MAX;
+	int i;
+
+	/* Best of a few runs, as the host may be busy */
+	for (i = 0; i < BENCH_RUNS; i++) {
+		t_linear = MIN(t_linear, bench(find_command_linear));
+		t_search = MIN(t_search, bench(find_command));
+	}
+
+	ccprintf("%d commands, per lookup: linear %lld ns, binary search "
+		 "%lld ns\n", (int)(__cmds_end - __cmds),
+		 (long long)(t_linear / lookups),
+		 (long long)(t_search / lookups));
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_sorted);
+	RUN_TEST(test_same_as_linear);
+	RUN_TEST(test_dispatch_time);
+
+	test_print_result();
+}
@@ -63,6 +63,26 @@ static int test_kat0(void)
 	return EC_SUCCESS;
 }
 
+// test that hashing a buffer matches hashing it a byte at a time
+static int test_buf(void)
+{
+	uint32_t crc, crc_buf;
+	int i;
+	const char input[] = "The quick brown fox jumps over the lazy dog";
+
+	crc32_ctx_init(&crc);
+	for (i = 0; i < strlen(input); ++i)
+		crc32_ctx_hash8(&crc, input[i]);
+
+	crc32_ctx_init(&crc_buf);
+	crc32_ctx_hash(&crc_buf, input, 10);
+	crc32_ctx_hash(&crc_buf, input + 10, strlen(input) - 10);
+
+	TEST_ASSERT(crc32_ctx_result(&crc_buf) == crc32_ctx_result(&crc));
+
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, char **argv)
 {
 	test_reset();
@@ -70,6 +90,7 @@ void run_test(int argc, char **argv)
 	RUN_TEST(test_static_version);
 	RUN_TEST(test_8);
 	RUN_TEST(test_kat0);
+	RUN_TEST(test_buf);
 
 	test_print_result();
 }
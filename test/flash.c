@@ -11,6 +11,7 @@
 #include "gpio.h"
 #include "hooks.h"
 #include "host_command.h"
+#include "sha256.h"
 #include "system.h"
 #include "task.h"
 #include "test_util.h"
@@ -70,6 +71,9 @@ int gpio_get_level(enum gpio_signal signal)
 /*****************************************************************************/
 /* Test utilities */
 
+/* Exported by common/flash.c in test builds */
+int flash_is_erased_read(uint32_t offset, int size);
+
 static void record_flash(int offset, int size)
 {
 	memcpy(flash_recorded_data, __host_flash + offset, size);
@@ -184,6 +188,27 @@ int host_command_write(int offset, int size, const char *data)
 				      buf, size + sizeof(*params), NULL, 0);
 }
 
+#ifdef CONFIG_FLASH_WRITE_SESSION
+int host_command_write_session(int offset, int size, const char *data,
+			       uint32_t flags)
+{
+	uint8_t buf[256];
+	struct ec_params_flash_write_v2 *params =
+		(struct ec_params_flash_write_v2 *)buf;
+
+	params->offset = offset;
+	params->size = size;
+	params->flags = flags;
+	if (data)
+		memcpy(params + 1, data, size);
+
+	return test_send_host_command(EC_CMD_FLASH_WRITE,
+				      EC_VER_FLASH_WRITE_SESSION, buf,
+				      (data ? size : 0) + sizeof(*params),
+				      NULL, 0);
+}
+#endif
+
 int host_command_erase(int offset, int size)
 {
 	struct ec_params_flash_write params;
@@ -269,10 +294,17 @@ static int test_is_erased(void)
 #ifdef EMU_BUILD
 	memset(__host_flash, 0xff, 1024);
 	TEST_ASSERT(flash_is_erased(0, 1024));
+	TEST_ASSERT(flash_is_erased_read(0, 1024));
 
 	for (i = 0; i < 1024; ++i) {
 		__host_flash[i] = 0xec;
 		TEST_ASSERT(!flash_is_erased(0, 1024));
+		TEST_ASSERT(!flash_is_erased_read(0, 1024));
+		/* Regions not aligned to a native word */
+		TEST_ASSERT(flash_is_erased(4, 1020) == (i < 4));
+		TEST_ASSERT(flash_is_erased(0, 1020) == (i >= 1020));
+		TEST_ASSERT(flash_is_erased_read(4, 1020) == (i < 4));
+		TEST_ASSERT(flash_is_erased_read(0, 1020) == (i >= 1020));
 		__host_flash[i] = 0xff;
 	}
 #else
@@ -282,6 +314,36 @@ static int test_is_erased(void)
 	return EC_SUCCESS;
 }
 
+static int test_is_erased_speed(void)
+{
+#ifdef EMU_BUILD
+	const int size = 0x8000;
+	uint64_t t_mapped, t_read, t;
+	int i;
+
+	memset(__host_flash, 0xff, size);
+
+	t = test_bench_time_ns();
+	for (i = 0; i < 16; i++)
+		TEST_ASSERT(flash_is_erased(0, size));
+	t_mapped = MAX(test_bench_time_ns() - t, 1);
+
+	t = test_bench_time_ns();
+	for (i = 0; i < 16; i++)
+		TEST_ASSERT(flash_is_erased_read(0, size));
+	t_read = MAX(test_bench_time_ns() - t, 1);
+
+	ccprintf("flash_is_erased, %d bytes: mapped %lld bytes/us, "
+		 "read %lld bytes/us\n", size,
+		 (long long)(16ULL * size * 1000 / t_mapped),
+		 (long long)(16ULL * size * 1000 / t_read));
+#else
+	ccprintf("Skip. Emulator only test.\n");
+#endif
+
+	return EC_SUCCESS;
+}
+
 static int test_overwrite_current(void)
 {
 	uint32_t offset, size;
@@ -346,6 +408,207 @@ static int test_op_failure(void)
 	return EC_SUCCESS;
 }
 
+#ifdef CONFIG_FLASH_WRITE_SESSION
+/* Bytes of data per packet, as the host sends them */
+#define SESSION_PACKET 128
+
+static char session_data[2 * CONFIG_FLASH_BANK_SIZE];
+
+/* Send data in packets, in a session if asked, and return the time in ns. */
+static uint64_t send_update(int offset, int size, int session)
+{
+	uint64_t t = test_bench_time_ns();
+	int i, n;
+
+	if (session && host_command_write_session(offset, size, NULL,
+						  EC_FLASH_WRITE_BEGIN))
+		return 0;
+
+	for (i = 0; i < size; i += n) {
+		n = MIN(size - i, SESSION_PACKET);
+		if (!session) {
+			if (host_command_write(offset + i, n,
+					       session_data + i))
+				return 0;
+		} else if (host_command_write_session(
+				   offset + i, n, session_data + i,
+				   i + n == size ? EC_FLASH_WRITE_COMMIT : 0)) {
+			return 0;
+		}
+	}
+
+	return MAX(test_bench_time_ns() - t, 1);
+}
+
+static int test_write_session(void)
+{
+	uint32_t offset;
+	int i;
+
+	offset = system_is_in_rw() ? CONFIG_RO_STORAGE_OFF :
+		CONFIG_RW_STORAGE_OFF;
+
+#ifdef EMU_BUILD
+	mock_is_running_img = 0;
+#endif
+
+	for (i = 0; i < sizeof(session_data); i++)
+		session_data[i] = i * 7 + i / 251;
+
+	/* Sessions that don't start or end on a buffer boundary */
+	VERIFY_ERASE(offset, sizeof(session_data));
+	TEST_ASSERT(send_update(offset + 0x20, sizeof(session_data) - 0x40,
+				1));
+	TEST_ASSERT(verify_write(offset + 0x20, sizeof(session_data) - 0x40,
+				 session_data) == EC_SUCCESS);
+	TEST_ASSERT(verify_erase(offset, 0x20) == EC_SUCCESS);
+	TEST_ASSERT(verify_erase(offset + sizeof(session_data) - 0x20, 0x20) ==
+		    EC_SUCCESS);
+
+	/* Data out of order ends the session */
+	TEST_ASSERT(host_command_write_session(offset, 0x40, NULL,
+					       EC_FLASH_WRITE_BEGIN) ==
+		    EC_RES_SUCCESS);
+	TEST_ASSERT(host_command_write_session(offset + 0x20, 0x20,
+					       session_data, 0) ==
+		    EC_RES_INVALID_PARAM);
+	TEST_ASSERT(host_command_write_session(offset, 0x20, session_data,
+					       0) != EC_RES_SUCCESS);
+
+	/* So does committing before all the data is sent, writing nothing */
+	VERIFY_ERASE(offset, 0x40);
+	TEST_ASSERT(host_command_write_session(offset, 0x40, NULL,
+					       EC_FLASH_WRITE_BEGIN) ==
+		    EC_RES_SUCCESS);
+	TEST_ASSERT(host_command_write_session(offset, 0x20, session_data,
+					       EC_FLASH_WRITE_COMMIT) ==
+		    EC_RES_ERROR);
+	TEST_ASSERT(verify_erase(offset, 0x40) == EC_SUCCESS);
+	TEST_ASSERT(host_command_write_session(offset + 0x20, 0x20,
+					       session_data + 0x20, 0) !=
+		    EC_RES_SUCCESS);
+
+#ifdef EMU_BUILD
+	/* Protection is checked again before each buffer is programmed */
+	TEST_ASSERT(host_command_write_session(offset, 0x40, NULL,
+					       EC_FLASH_WRITE_BEGIN) ==
+		    EC_RES_SUCCESS);
+	TEST_ASSERT(host_command_write_session(offset, 0x20, session_data,
+					       0) == EC_RES_SUCCESS);
+	mock_is_running_img = 1;
+	TEST_ASSERT(host_command_write_session(offset + 0x20, 0x20,
+					       session_data + 0x20,
+					       EC_FLASH_WRITE_COMMIT) ==
+		    EC_RES_ERROR);
+	mock_is_running_img = 0;
+	TEST_ASSERT(verify_erase(offset, 0x40) == EC_SUCCESS);
+#endif
+
+	/* A session the host stops sending data to times out */
+	TEST_ASSERT(host_command_write_session(offset, 0x40, NULL,
+					       EC_FLASH_WRITE_BEGIN) ==
+		    EC_RES_SUCCESS);
+	TEST_ASSERT(host_command_write_session(offset, 0x20, session_data,
+					       0) == EC_RES_SUCCESS);
+	sleep(6);
+	TEST_ASSERT(host_command_write_session(offset + 0x20, 0x20,
+					       session_data + 0x20,
+					       EC_FLASH_WRITE_COMMIT) !=
+		    EC_RES_SUCCESS);
+	TEST_ASSERT(verify_erase(offset, 0x40) == EC_SUCCESS);
+
+	/* Failed programming is reported */
+	mock_flash_op_fail = EC_ERROR_UNKNOWN;
+	TEST_ASSERT(send_update(offset, sizeof(session_data), 1) == 0);
+	mock_flash_op_fail = EC_SUCCESS;
+
+	return EC_SUCCESS;
+}
+
+static int test_write_session_speed(void)
+{
+	uint32_t offset;
+	uint64_t t_packet, t_session;
+
+	offset = system_is_in_rw() ? CONFIG_RO_STORAGE_OFF :
+		CONFIG_RW_STORAGE_OFF;
+
+	VERIFY_ERASE(offset, sizeof(session_data));
+	t_packet = send_update(offset, sizeof(session_data), 0);
+	TEST_ASSERT(t_packet);
+
+	VERIFY_ERASE(offset, sizeof(session_data));
+	t_session = send_update(offset, sizeof(session_data), 1);
+	TEST_ASSERT(t_session);
+	TEST_ASSERT(verify_write(offset, sizeof(session_data),
+				 session_data) == EC_SUCCESS);
+
+	ccprintf("Flash update, %d bytes in %d byte packets: per packet %lld "
+		 "bytes/ms, session %lld bytes/ms\n",
+		 (int)sizeof(session_data), SESSION_PACKET,
+		 (long long)(sizeof(session_data) * 1000000ULL / t_packet),
+		 (long long)(sizeof(session_data) * 1000000ULL / t_session));
+	TEST_ASSERT(t_session < t_packet);
+
+	return EC_SUCCESS;
+}
+#endif
+
+#ifdef CONFIG_FLASH_BLOCK_HASH
+static int test_block_hash(void)
+{
+	uint8_t digest[4][EC_FLASH_BLOCK_HASH_SIZE];
+	struct ec_params_flash_block_hash p;
+	struct host_cmd_handler_args args = {
+		.command = EC_CMD_FLASH_BLOCK_HASH,
+		.params = &p,
+		.params_size = sizeof(p),
+		.response = digest,
+	};
+	struct sha256_ctx ctx;
+	const uint8_t *expected;
+	int i;
+
+	p.offset = CONFIG_RO_STORAGE_OFF;
+	p.block_size = 0x100;
+	/* The last block is shorter */
+	p.size = 3 * p.block_size + 0x10;
+	args.response_max = sizeof(digest);
+	TEST_ASSERT(host_command_process(&args) == EC_RES_SUCCESS);
+	TEST_EQ(args.response_size, (int)sizeof(digest), "%d");
+
+	for (i = 0; i < 4; i++) {
+		SHA256_init(&ctx);
+		SHA256_update(&ctx, (const uint8_t *)__host_flash +
+			      p.offset + i * p.block_size,
+			      MIN(p.block_size, p.size - i * p.block_size));
+		expected = SHA256_final(&ctx);
+		TEST_ASSERT_ARRAY_EQ(digest[i], expected,
+				     EC_FLASH_BLOCK_HASH_SIZE);
+	}
+
+	/* Only as many digests as fit are returned */
+	args.response_max = 2 * EC_FLASH_BLOCK_HASH_SIZE + 1;
+	TEST_ASSERT(host_command_process(&args) == EC_RES_SUCCESS);
+	TEST_EQ(args.response_size, 2 * EC_FLASH_BLOCK_HASH_SIZE, "%d");
+
+	p.block_size = 0;
+	TEST_ASSERT(host_command_process(&args) == EC_RES_INVALID_PARAM);
+	p.block_size = EC_FLASH_BLOCK_HASH_MAX_BLOCK_SIZE + 1;
+	TEST_ASSERT(host_command_process(&args) == EC_RES_INVALID_PARAM);
+	p.block_size = 0x100;
+	p.offset = CONFIG_FLASH_SIZE - 0x100;
+	TEST_ASSERT(host_command_process(&args) == EC_RES_INVALID_PARAM);
+	p.offset = 0xffffff00;
+	TEST_ASSERT(host_command_process(&args) == EC_RES_INVALID_PARAM);
+	p.offset = CONFIG_RO_STORAGE_OFF;
+	args.params_size = sizeof(p) - 1;
+	TEST_ASSERT(host_command_process(&args) == EC_RES_INVALID_PARAM);
+
+	return EC_SUCCESS;
+}
+#endif
+
 static int test_flash_info(void)
 {
 	struct ec_response_flash_info_1 resp;
@@ -451,9 +714,17 @@ static void run_test_step1(void)
 
 	RUN_TEST(test_read);
 	RUN_TEST(test_is_erased);
+	RUN_TEST(test_is_erased_speed);
 	RUN_TEST(test_overwrite_current);
 	RUN_TEST(test_overwrite_other);
 	RUN_TEST(test_op_failure);
+#ifdef CONFIG_FLASH_WRITE_SESSION
+	RUN_TEST(test_write_session);
+	RUN_TEST(test_write_session_speed);
+#endif
+#ifdef CONFIG_FLASH_BLOCK_HASH
+	RUN_TEST(test_block_hash);
+#endif
 	RUN_TEST(test_flash_info);
 	RUN_TEST(test_region_info);
 	RUN_TEST(test_write_protect);
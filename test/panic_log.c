@@ -0,0 +1,152 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test the crash log.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "panic.h"
+#include "test_util.h"
+#include "timer.h"
+#include "uart.h"
+#include "util.h"
+
+static uint8_t log_buf[CONFIG_PANIC_LOG];
+
+/* Read the whole log over the host interface, in small pieces. */
+static int read_log(void)
+{
+	struct ec_params_get_panic_log p = { 0 };
+	struct host_cmd_handler_args args = {
+		.command = EC_CMD_GET_PANIC_LOG,
+		.params = &p,
+		.params_size = sizeof(p),
+	};
+
+	do {
+		args.response = log_buf + p.offset;
+		args.response_max = MIN(32, sizeof(log_buf) - p.offset);
+		if (host_command_process(&args) != EC_RES_SUCCESS)
+			return -1;
+		p.offset += args.response_size;
+	} while (args.response_size && p.offset < sizeof(log_buf));
+
+	return p.offset;
+}
+
+static const struct panic_log_record *find_record(int type)
+{
+	const struct panic_log_header *h = (const void *)log_buf;
+	const uint8_t *p = (const uint8_t *)(h + 1);
+	const struct panic_log_record *r;
+
+	for (; p < (const uint8_t *)(h + 1) + h->size;
+	     p += sizeof(*r) + PANIC_LOG_PADDED(r->size)) {
+		r = (const void *)p;
+		if (r->type == type)
+			return r;
+	}
+	return NULL;
+}
+
+static int test_no_log(void)
+{
+	struct ec_params_get_panic_log p = { 0 };
+
+	TEST_EQ(read_log(), 0, "%d");
+
+	/* The offset is required */
+	TEST_EQ(test_send_host_command(EC_CMD_GET_PANIC_LOG, 0, &p,
+				       sizeof(p) - 1, log_buf,
+				       sizeof(log_buf)),
+		EC_RES_INVALID_PARAM, "%d");
+
+	test_capture_console(1);
+	UART_INJECT("paniclog\n");
+	msleep(10);
+	cflush();
+	test_capture_console(0);
+	TEST_ASSERT(strstr(test_get_captured_console(), "No crash log") !=
+		    NULL);
+
+	return EC_SUCCESS;
+}
+
+/* Console output is saved at a fraction of its size. */
+static int test_save(void)
+{
+	const struct panic_log_header *h = (const void *)log_buf;
+	const struct panic_log_record *r;
+	const struct panic_log_console *c;
+	const struct panic_log_time *t;
+	uint64_t before = get_time().val;
+	int i, size;
+
+	for (i = 0; i < 20; i++)
+		ccprintf("[%d.%06d PD C0 state SNK_READY, charge %d mA]\n",
+			 i / 4, i * 1234 % 1000000, 1000 + i % 3 * 500);
+	cflush();
+
+	panic_log_save();
+	size = read_log();
+
+	TEST_EQ((int)h->magic, PANIC_LOG_MAGIC, "%08x");
+	TEST_EQ(h->version, PANIC_LOG_VERSION, "%d");
+	TEST_EQ(size, (int)(sizeof(*h) + h->size), "%d");
+	TEST_ASSERT(size <= CONFIG_PANIC_LOG);
+
+	r = find_record(PANIC_LOG_TIME);
+	TEST_ASSERT(r);
+	t = (const void *)(r + 1);
+	TEST_ASSERT(t->now >= before && t->now <= get_time().val);
+
+	r = find_record(PANIC_LOG_TASK);
+	TEST_ASSERT(r);
+	TEST_ASSERT(r->size >= sizeof(struct panic_log_task));
+
+	r = find_record(PANIC_LOG_CONSOLE);
+	TEST_ASSERT(r);
+	c = (const void *)(r + 1);
+	ccprintf("Console output: %d bytes in %d\n", c->raw_size, r->size);
+	TEST_ASSERT(c->raw_size > 2 * r->size);
+
+	return EC_SUCCESS;
+}
+
+/* The newest output decompresses intact. */
+static int test_print(void)
+{
+	const char *captured;
+
+	test_capture_console(1);
+	UART_INJECT("paniclog\n");
+	msleep(10);
+	cflush();
+	test_capture_console(0);
+
+	captured = test_get_captured_console();
+	TEST_ASSERT(strstr(captured, "Task  0 ") != NULL);
+	TEST_ASSERT(strstr(captured,
+			   "[4.023446 PD C0 state SNK_READY, charge 1500 mA]")
+		    != NULL);
+	TEST_ASSERT(strstr(captured,
+			   "[4.022212 PD C0 state SNK_READY, charge 1000 mA]")
+		    != NULL);
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_no_log);
+	RUN_TEST(test_save);
+	RUN_TEST(test_print);
+
+	test_print_result();
+}
@@ -177,11 +177,27 @@ test_static int test_vsnprintf_int(void)
 	T(expect_success("123",        "%u",    123));
 	T(expect_success("4294967295", "%u",   -1));
 	T(expect_success("18446744073709551615", "%llu", (uint64_t)-1));
+	T(expect_success("4294967296", "%llu", 1ULL << 32));
+	T(expect_success("1000000000000000000", "%llu", 1000000000000000000ULL));
+	T(expect_success("999999999999999999", "%llu", 999999999999999999ULL));
+	T(expect_success("-9223372036854775808", "%lld", INT64_MIN));
+	T(expect_success("-2147483648", "%d", INT32_MIN));
+	T(expect_success("123456789.012", "%.3lld", 123456789012LL));
+	T(expect_success("0.000000000000000000001", "%.21llu", 1ULL));
+	T(expect_success("12.00", "%.2d", 1200));
+	T(expect_success("5.", "%.0d", 5));
+	T(expect_success("0.", "%.0d", 0));
 
 	T(expect_success("0",         "%x",     0));
 	T(expect_success("0",         "%X",     0));
 	T(expect_success("5e",        "%x",     0X5E));
 	T(expect_success("5E",        "%X",     0X5E));
+	T(expect_success("fedcba9876543210", "%llx", 0xfedcba9876543210ULL));
+	T(expect_success("100000000", "%llx",  1ULL << 32));
+	T(expect_success("DEADBEEF",  "%X",     0xdeadbeef));
+	T(expect_success("0000beef",  "%08x",   0xbeef));
+	/* Digits after the point are always decimal */
+	T(expect_success("2e.60",     "%.2x",   4660));
 
 	/*
 	 * %l is deprecated on 32-bit systems (see crbug.com/984041), but is
@@ -297,6 +313,85 @@ test_static int test_vsnprintf_combined(void)
 	return EC_SUCCESS;
 }
 
+/* Per-character output, to compare with the bulk path of vsnprintf() */
+struct char_output {
+	char *str;
+	int size;
+};
+
+static int add_char(void *context, int c)
+{
+	struct char_output *out = context;
+
+	if (!out->size)
+		return 1;
+	*(out->str++) = c;
+	out->size--;
+	return 0;
+}
+
+static int char_printf(char *str, int size, const char *format, ...)
+{
+	struct char_output out = { str, size - 1 };
+	va_list args;
+	int rv;
+
+	va_start(args, format);
+	rv = vfnprintf(add_char, &out, format, args);
+	va_end(args);
+	*out.str = '\0';
+	return rv;
+}
+
+#define BENCH_ROUNDS 2000
+
+/* Format a pattern BENCH_ROUNDS times and return the average time in ns. */
+#define BENCH(printf_fn, ...)						\
+	({								\
+		uint64_t _t = test_bench_time_ns();			\
+		int _i;							\
+									\
+		for (_i = 0; _i < BENCH_ROUNDS; _i++)			\
+			printf_fn(output, sizeof(output), __VA_ARGS__);	\
+		(test_bench_time_ns() - _t) / BENCH_ROUNDS;		\
+	})
+
+#define BENCH_PATTERN(name, ...)					\
+	do {								\
+		uint64_t _bulk = BENCH(snprintf, __VA_ARGS__);		\
+		uint64_t _chars = BENCH(char_printf, __VA_ARGS__);	\
+									\
+		ccprintf("%-10s bulk %4lld ns, per char %4lld ns\n",	\
+			 name, (long long)_bulk, (long long)_chars);	\
+		bulk += _bulk;						\
+		chars += _chars;					\
+	} while (0)
+
+test_static int test_vsnprintf_benchmark(void)
+{
+	static const uint8_t dump[32] = {
+		0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+		0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+	};
+	uint64_t ts = 123456789012ULL;
+	uint64_t bulk = 0, chars = 0;
+
+	BENCH_PATTERN("timestamp", "[%pT %s]\n", &ts,
+		      "C0: PE_SNK_Ready");
+	BENCH_PATTERN("decimal", "%d mV, %d mA, %d%%", 19832, -1520, 87);
+	BENCH_PATTERN("hex", "0x%08x 0x%04x %x", 0xdeadbeef, 0x1234, 0x5e);
+	BENCH_PATTERN("64-bit", "%lld %llx", 1234567890123456789LL,
+		      0xfedcba9876543210ULL);
+	BENCH_PATTERN("hexdump", "%ph", HEX_BUF(dump, sizeof(dump)));
+	BENCH_PATTERN("string", "%-16s|%8s|", "name", "value");
+
+	/* Timings vary between hosts, so they are reported, not checked */
+	ccprintf("%-10s bulk %4lld ns, per char %4lld ns\n", "total",
+		 (long long)bulk, (long long)chars);
+
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, char **argv)
 {
 	test_reset();
@@ -309,6 +404,7 @@ void run_test(int argc, char **argv)
 	RUN_TEST(test_vsnprintf_timestamps);
 	RUN_TEST(test_vsnprintf_hexdump);
 	RUN_TEST(test_vsnprintf_combined);
+	RUN_TEST(test_vsnprintf_benchmark);
 
 	test_print_result();
 }
@@ -9,19 +9,35 @@
 #include "common.h"
 #include "rsa.h"
 #include "test_util.h"
+#include "timer.h"
 #include "util.h"
 
-#ifdef TEST_RSA3
+#if defined(TEST_RSA3)
 #include "rsa2048-3.h"
+#elif defined(TEST_RSA3072)
+#include "rsa3072-F4.h"
+#elif defined(TEST_RSA3072_3)
+#include "rsa3072-3.h"
 #else
 #include "rsa2048-F4.h"
 #endif
 
+#ifdef CONFIG_RSA_EXPONENT_3
+#define RSA_EXPONENT "3"
+#else
+#define RSA_EXPONENT "F4"
+#endif
+
+/* Verifications to time */
+#define BENCH_RUNS 20
+
 static uint32_t rsa_workbuf[3 * RSANUMBYTES/4];
 
 void run_test(int argc, char **argv)
 {
+	uint64_t t;
 	int good;
+	int i;
 
 	good = rsa_verify(rsa_key, sig, hash, rsa_workbuf);
 	if (!good) {
@@ -49,6 +65,14 @@ void run_test(int argc, char **argv)
 	}
 	ccprintf("RSA verify FAILED (as expected)\n");
 
+	/* Time the verification, as rwsig does it at boot */
+	t = test_bench_time_ns();
+	for (i = 0; i < BENCH_RUNS; i++)
+		rsa_verify(rsa_key, sig, hash, rsa_workbuf);
+	t = test_bench_time_ns() - t;
+	ccprintf("RSA-%d exponent %s verify: %lld us\n", CONFIG_RSA_KEY_SIZE,
+		 RSA_EXPONENT, (long long)(t / BENCH_RUNS / 1000));
+
 	test_pass();
 }
 
@@ -0,0 +1,140 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * RSA 3072 with 3 exponent public key and verification.
+ * Private key in rsa3072-3.pem.
+ */
+
+/* First generate a key:
+ * # openssl genrsa -3 -out key.pem 3072
+ * # openssl rsa -in key.pem -pubout > key.pub
+ * Then dump the key:
+ * # dumpRSAPublicKey -pub key.pub | xxd -i
+ */
+const uint8_t rsa_data[] = {
+	0x60, 0x00, 0x00, 0x00, 0x57, 0xfc, 0x1f, 0x2e, 0x99, 0x50, 0xd1, 0xdb,
+	0x6d, 0x0d, 0x48, 0xf6, 0x5d, 0xb0, 0x2d, 0xa7, 0x01, 0x63, 0x09, 0xdb,
+	0xc0, 0xf4, 0xe0, 0x4a, 0x65, 0xf9, 0xb0, 0xdc, 0x3d, 0x89, 0x19, 0xcd,
+	0xa2, 0xc4, 0x2f, 0xfe, 0x66, 0xf3, 0xf1, 0x94, 0x14, 0x64, 0x98, 0x48,
+	0x73, 0x43, 0x83, 0x17, 0xa3, 0x56, 0xb7, 0xfd, 0x4c, 0x8a, 0xe4, 0x3f,
+	0x31, 0x10, 0xa1, 0xe3, 0x9c, 0xf6, 0x99, 0x76, 0x1f, 0xe2, 0x7c, 0x80,
+	0x3f, 0x98, 0x17, 0xbc, 0x20, 0xfe, 0x49, 0xc8, 0x38, 0xbc, 0xe3, 0xcf,
+	0xa3, 0xd5, 0xae, 0xa5, 0xc1, 0xa6, 0xd8, 0xa5, 0xc8, 0x8b, 0x63, 0xe9,
+	0xbb, 0x06, 0xb1, 0x5e, 0x7e, 0x1c, 0xee, 0x9b, 0x03, 0x10, 0x13, 0x40,
+	0x12, 0xbd, 0x29, 0xfa, 0x0f, 0xcd, 0xe5, 0x75, 0x1a, 0xee, 0x96, 0x47,
+	0xf4, 0x15, 0xd2, 0x79, 0x6a, 0x7c, 0xc3, 0x7b, 0xb5, 0x79, 0x05, 0x76,
+	0xf3, 0x26, 0x8f, 0x8e, 0xb3, 0x21, 0xc2, 0xe8, 0xb6, 0x7e, 0x29, 0x32,
+	0xeb, 0xe8, 0xb0, 0xb1, 0x97, 0x11, 0xc5, 0x57, 0xc5, 0x68, 0x9f, 0xa4,
+	0xde, 0x05, 0x26, 0xf8, 0xb2, 0xbe, 0xa9, 0xa3, 0xb1, 0xdb, 0x81, 0xd7,
+	0x20, 0xdb, 0x14, 0x70, 0xd6, 0x73, 0x38, 0xfa, 0x33, 0x60, 0x64, 0x7d,
+	0x7a, 0xad, 0x64, 0x1b, 0x03, 0xf2, 0x6b, 0x6d, 0x20, 0x9f, 0x4f, 0x53,
+	0x4f, 0x27, 0x58, 0x14, 0xaa, 0x63, 0x11, 0x38, 0x9b, 0x96, 0x7d, 0x58,
+	0xf0, 0x15, 0xfe, 0x25, 0x97, 0x0e, 0xa9, 0x8f, 0x5f, 0x0f, 0x3d, 0x4c,
+	0xec, 0x92, 0xf7, 0x34, 0xb4, 0x44, 0x20, 0xef, 0xf4, 0x84, 0xd4, 0x9a,
+	0x46, 0x9c, 0x4f, 0x0c, 0x10, 0xf2, 0xb1, 0x7f, 0x34, 0xfc, 0x29, 0x61,
+	0x06, 0x6e, 0xfb, 0xbb, 0x27, 0xbc, 0x55, 0x01, 0xc1, 0x1a, 0xe8, 0x2b,
+	0x8a, 0x3f, 0x0d, 0x1e, 0x28, 0xa5, 0xd4, 0x62, 0x20, 0xb8, 0xe0, 0x77,
+	0x11, 0x53, 0x8a, 0x8f, 0x01, 0x08, 0x7a, 0xf9, 0xf9, 0x82, 0x2b, 0x91,
+	0x6c, 0x7d, 0xcc, 0x01, 0x7a, 0x58, 0xed, 0x7e, 0xbe, 0x40, 0x88, 0x4e,
+	0x5f, 0x35, 0x7f, 0x8e, 0x2f, 0x84, 0x97, 0x10, 0x08, 0x71, 0x2c, 0x1b,
+	0xd1, 0x89, 0x94, 0x35, 0xaa, 0x0f, 0x09, 0x96, 0x86, 0xe8, 0xf5, 0x90,
+	0xed, 0xdd, 0xc6, 0x66, 0xf8, 0x89, 0x5c, 0x64, 0x98, 0xaa, 0x2c, 0x46,
+	0xe1, 0x23, 0x72, 0xc3, 0x23, 0xbf, 0x39, 0xee, 0x9b, 0xbd, 0x12, 0xfa,
+	0x96, 0xa6, 0x52, 0xc9, 0x40, 0xad, 0xc9, 0xa7, 0x27, 0x02, 0xbb, 0x22,
+	0x7d, 0xdb, 0x15, 0xf4, 0x71, 0x70, 0x3b, 0xba, 0xf4, 0xa4, 0xfe, 0xed,
+	0xa7, 0xf2, 0x52, 0x51, 0x6b, 0xf2, 0x5d, 0x0d, 0xb6, 0x30, 0x2e, 0x1d,
+	0xac, 0x28, 0xc7, 0x58, 0xa9, 0x98, 0x41, 0x5a, 0x73, 0x49, 0x9d, 0xb2,
+	0x51, 0x35, 0x47, 0x3d, 0x35, 0x01, 0x7c, 0xe8, 0x10, 0xef, 0x5a, 0xf8,
+	0x46, 0x9b, 0x9a, 0x4d, 0x28, 0x1c, 0x9d, 0x98, 0x6f, 0x2f, 0xff, 0x09,
+	0xf7, 0x26, 0xe3, 0x2e, 0x8f, 0xbf, 0xd5, 0x49, 0xb1, 0x20, 0x8f, 0xf8,
+	0x0b, 0xf0, 0xe9, 0xa6, 0x80, 0x06, 0xd1, 0xd2, 0x00, 0xc4, 0x62, 0x9d,
+	0xe5, 0xd1, 0x58, 0xca, 0x0a, 0x1e, 0x0a, 0x9f, 0xf7, 0xa7, 0x88, 0xfe,
+	0x07, 0x04, 0x56, 0x7d, 0x5e, 0xe6, 0x7c, 0xf8, 0x5d, 0x02, 0x17, 0xa6,
+	0x27, 0x3d, 0x79, 0x5a, 0x53, 0xba, 0x1a, 0x34, 0x8e, 0x00, 0xf4, 0xdd,
+	0x4f, 0x14, 0xe7, 0xd0, 0xa0, 0xe5, 0x53, 0x5f, 0xd7, 0x71, 0x59, 0x68,
+	0xf7, 0xea, 0x7d, 0xf9, 0x3d, 0x30, 0x85, 0x4a, 0xa2, 0x94, 0xb5, 0x26,
+	0x67, 0xae, 0x05, 0xbb, 0xd7, 0x38, 0x22, 0x5e, 0x04, 0x01, 0x0b, 0x68,
+	0x96, 0xd2, 0x39, 0x80, 0x99, 0x4b, 0xf0, 0xb1, 0x20, 0x69, 0x9d, 0x99,
+	0x22, 0xdc, 0x2c, 0xac, 0x2f, 0x82, 0x12, 0x3c, 0xc3, 0x8e, 0xe9, 0xe7,
+	0xb0, 0x57, 0xdd, 0x67, 0xe1, 0x31, 0xce, 0xb1, 0x39, 0xf6, 0x1c, 0x40,
+	0xf0, 0x31, 0xc0, 0x50, 0x82, 0xa3, 0x7a, 0xff, 0x26, 0x40, 0xc3, 0xec,
+	0x04, 0xe0, 0x95, 0x14, 0x86, 0x95, 0xed, 0x1a, 0x3c, 0x16, 0xc4, 0x51,
+	0xdd, 0x0a, 0xe3, 0xf5, 0x51, 0x85, 0x3c, 0xeb, 0x19, 0x96, 0xd9, 0x87,
+	0xf8, 0x65, 0xd0, 0x3f, 0x31, 0x41, 0xd3, 0x26, 0x69, 0x2a, 0xc2, 0x40,
+	0x61, 0x9c, 0xbf, 0x88, 0x18, 0xb4, 0x51, 0x82, 0x88, 0x2a, 0x2b, 0xc4,
+	0x51, 0x16, 0xea, 0xd9, 0x4e, 0x82, 0x08, 0x80, 0xa0, 0x6a, 0x03, 0x18,
+	0x0a, 0xff, 0x4c, 0xa1, 0xcd, 0x9d, 0xda, 0xf8, 0x11, 0x4d, 0xd8, 0x57,
+	0xab, 0x22, 0x47, 0xdd, 0x49, 0x42, 0xc4, 0xdc, 0xee, 0x69, 0x85, 0x85,
+	0xce, 0x9e, 0xd5, 0x3c, 0x1f, 0xf0, 0x7b, 0x43, 0x70, 0x19, 0x35, 0x04,
+	0xd9, 0x80, 0x96, 0xfb, 0x00, 0xe1, 0xbb, 0xff, 0x53, 0x21, 0xe7, 0xcf,
+	0x0f, 0x08, 0xdf, 0xf9, 0x9e, 0x3a, 0xc8, 0x3c, 0x57, 0xb0, 0x8e, 0x90,
+	0x8d, 0x96, 0x91, 0xcb, 0x2f, 0x63, 0x38, 0x84, 0xfd, 0x1b, 0x05, 0xe9,
+	0x80, 0xa9, 0x0e, 0x92, 0xec, 0xda, 0xbf, 0xa6, 0x1a, 0x14, 0xc7, 0x40,
+	0x37, 0x9c, 0x14, 0xbe, 0xfc, 0x71, 0x20, 0x77, 0xb6, 0x46, 0xd4, 0x19,
+	0xf6, 0x50, 0x4d, 0x29, 0x87, 0x2b, 0x43, 0xba, 0x50, 0xd9, 0x45, 0x16,
+	0x40, 0xc7, 0xc0, 0xaf, 0x32, 0x47, 0xcd, 0x8b, 0x36, 0x35, 0xd3, 0xb5,
+	0xe4, 0x6b, 0x32, 0x27, 0x62, 0x7f, 0x70, 0x7c, 0x3a, 0x71, 0x6a, 0x10,
+	0xbf, 0x8f, 0x06, 0x04, 0x7a, 0xf0, 0x00, 0xab, 0x85, 0x98, 0x04, 0x6f,
+	0x1b, 0xb9, 0x10, 0x5d, 0xc6, 0xec, 0x1f, 0x6c, 0xd0, 0xab, 0x99, 0xc7,
+	0xcb, 0xa8, 0xe8, 0xbf, 0xe3, 0x5d, 0x8f, 0xc2,
+};
+
+const struct rsa_public_key *rsa_key = (struct rsa_public_key *)rsa_data;
+BUILD_ASSERT(sizeof(*rsa_key) == sizeof(rsa_data));
+
+/* SHA-256 sum to verify:
+ * # sha256sum README.md | sed -e 's/\(..\)/0x\1, /mg'
+ */
+const uint8_t hash[] = {
+	0xb7, 0x3a, 0xa2, 0xf5, 0x38, 0xed, 0xc1, 0x4e, 0xe2, 0x97, 0xf9, 0x1e,
+	0x0e, 0x5f, 0xc0, 0xaa, 0xaa, 0x2d, 0x0f, 0x39, 0x8f, 0x2c, 0x5b, 0x6f,
+	0x01, 0x4e, 0x2c, 0xf6, 0x68, 0x09, 0x3c, 0xd8
+};
+
+/* Incorrect hash to test the negative case */
+const uint8_t hash_wrong[] = {
+	0x61, 0x1b, 0xd2, 0x44, 0xc7, 0x18, 0xa7, 0x2d, 0x0f, 0x2d, 0x3d, 0x0f,
+	0xe3, 0xb3, 0xc5, 0xe4, 0x12, 0xc2, 0x7b, 0x1e, 0x05, 0x2c, 0x6f, 0xad,
+	0xc4, 0xac, 0x71, 0x55, 0xe8, 0x80, 0x5c, 0x38
+};
+
+/* Generate signature:
+ * # openssl dgst -sha256 -sign key.pem README.md | xxd -i
+ */
+const uint8_t sig[] = {
+	0xc5, 0x28, 0x62, 0x40, 0x59, 0x95, 0x8c, 0x60, 0x73, 0x88, 0xc9, 0x0f,
+	0x73, 0x7d, 0xa9, 0xba, 0x13, 0x1c, 0xa8, 0xb0, 0xac, 0x29, 0x42, 0x93,
+	0x9e, 0xbb, 0x23, 0xc7, 0xce, 0x16, 0xd3, 0x71, 0x0c, 0xeb, 0xd2, 0xce,
+	0x05, 0x06, 0x2e, 0xa1, 0xec, 0xb0, 0x93, 0x08, 0x3b, 0x26, 0x2e, 0x1a,
+	0x9e, 0xbc, 0xe0, 0x66, 0x5f, 0x3c, 0x10, 0xeb, 0x29, 0x7a, 0x7b, 0xb0,
+	0xb6, 0x82, 0x9e, 0xe5, 0xe5, 0x0c, 0x28, 0xa2, 0x4a, 0x54, 0x18, 0x5f,
+	0x8c, 0x28, 0x86, 0x92, 0x6a, 0xc5, 0x6d, 0xda, 0xf9, 0x9d, 0xaf, 0x1d,
+	0x1f, 0x25, 0x02, 0x4e, 0x30, 0x1d, 0x63, 0x52, 0xc4, 0x25, 0xab, 0x5f,
+	0x61, 0x17, 0x94, 0xd9, 0x37, 0xc8, 0x9d, 0x11, 0xea, 0x96, 0x00, 0xe9,
+	0xf1, 0x65, 0xfb, 0xae, 0xdc, 0x11, 0x3f, 0x4b, 0x60, 0xc5, 0x4c, 0xa1,
+	0xc1, 0x1a, 0x73, 0x82, 0xa5, 0xab, 0x5f, 0xd0, 0x22, 0xdc, 0xae, 0xed,
+	0x74, 0xe3, 0x50, 0x35, 0xd1, 0x6d, 0x7e, 0x9e, 0x3e, 0x15, 0x17, 0xf6,
+	0x5a, 0x4c, 0xd3, 0xeb, 0x9a, 0x55, 0x54, 0x01, 0x95, 0xa3, 0x16, 0x73,
+	0x5f, 0x3c, 0x2b, 0x23, 0x71, 0x50, 0xd4, 0x9f, 0xc5, 0xae, 0x06, 0x73,
+	0xb1, 0x91, 0xd9, 0xb8, 0x88, 0xf5, 0x6d, 0xda, 0x32, 0x00, 0xb4, 0x6c,
+	0x38, 0xc0, 0xdd, 0x7a, 0xa0, 0xa5, 0xdb, 0x99, 0x25, 0xa4, 0xb6, 0x34,
+	0x6e, 0xe0, 0xea, 0x0e, 0x46, 0x8b, 0xd6, 0x1f, 0xd5, 0xc4, 0xec, 0xdb,
+	0x69, 0x85, 0x1c, 0x7a, 0xff, 0xac, 0x84, 0x2a, 0xa2, 0xe8, 0xde, 0x06,
+	0xf4, 0x4c, 0x22, 0xb6, 0x61, 0x49, 0xd0, 0x42, 0xa5, 0x96, 0xba, 0xfe,
+	0x13, 0x86, 0x65, 0xa4, 0x2b, 0x16, 0xf9, 0xa4, 0xba, 0x5e, 0x8a, 0x76,
+	0x5c, 0xbc, 0x1d, 0x9f, 0x7d, 0x1b, 0x01, 0xa7, 0x1c, 0x01, 0xec, 0x95,
+	0xd9, 0xc7, 0x87, 0x2a, 0x25, 0x7e, 0x29, 0x2a, 0x33, 0xdb, 0x11, 0x41,
+	0x8d, 0x15, 0xa5, 0x06, 0xe7, 0x04, 0x11, 0x75, 0x79, 0xe4, 0xee, 0x0d,
+	0x26, 0xed, 0xdd, 0x02, 0xab, 0xc4, 0x05, 0x72, 0x85, 0xb0, 0x24, 0xd8,
+	0x55, 0x23, 0x8f, 0x48, 0x4e, 0xc5, 0x17, 0x78, 0x85, 0x3e, 0x78, 0x52,
+	0x73, 0xdf, 0x61, 0x83, 0xdc, 0x3d, 0x94, 0xc4, 0xdf, 0xf4, 0x83, 0x21,
+	0x61, 0x2f, 0xf2, 0x7a, 0x67, 0xae, 0x2c, 0x55, 0xa6, 0xf1, 0xb7, 0x39,
+	0x20, 0x36, 0xf0, 0xfb, 0xd8, 0x68, 0xf5, 0xe9, 0x37, 0x2c, 0x79, 0xae,
+	0x3f, 0xac, 0x11, 0x77, 0x33, 0x8b, 0xed, 0x04, 0xfb, 0x5c, 0xbd, 0x19,
+	0x75, 0xac, 0xed, 0x99, 0xab, 0x09, 0x4c, 0x51, 0xf1, 0x74, 0x23, 0x36,
+	0x52, 0xf1, 0xa6, 0xce, 0xc4, 0x62, 0x00, 0x7d, 0x2a, 0x97, 0xce, 0xc7,
+	0x33, 0x65, 0xd2, 0x60, 0x95, 0xcf, 0x3f, 0x9f, 0x01, 0xd1, 0xca, 0x52,
+	/* Padding */
+	0x00
+};
@@ -0,0 +1,140 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * RSA 3072 with F4 exponent public key and verification.
+ * Private key in rsa3072-F4.pem.
+ */
+
+/* First generate a key:
+ * # openssl genrsa -out key.pem 3072
+ * # openssl rsa -in key.pem -pubout > key.pub
+ * Then dump the key:
+ * # dumpRSAPublicKey -pub key.pub | xxd -i
+ */
+const uint8_t rsa_data[] = {
+	0x60, 0x00, 0x00, 0x00, 0x23, 0x91, 0x37, 0x1d, 0x75, 0xd9, 0x5c, 0xc1,
+	0xa0, 0x13, 0x7f, 0x0e, 0x4e, 0x30, 0x6e, 0x49, 0xc6, 0x58, 0xf1, 0xed,
+	0x1f, 0x2d, 0x75, 0x41, 0x48, 0x51, 0xec, 0x10, 0x7a, 0x27, 0xa8, 0xb9,
+	0x54, 0x15, 0xf8, 0x60, 0x27, 0x76, 0x4b, 0x9f, 0x27, 0xcc, 0x2c, 0x3b,
+	0x3f, 0x37, 0xcc, 0x70, 0x2e, 0x19, 0x62, 0x6f, 0x1b, 0xf6, 0x62, 0xf6,
+	0xbb, 0xba, 0x27, 0x6a, 0x43, 0xed, 0x22, 0x3f, 0x89, 0x39, 0xdc, 0x7c,
+	0x6b, 0xd2, 0x07, 0x7a, 0x2b, 0xee, 0x87, 0xda, 0x2c, 0xc3, 0x1b, 0x32,
+	0xd6, 0x91, 0x36, 0xcb, 0xc4, 0x0e, 0x51, 0xad, 0x80, 0x4a, 0xb2, 0x63,
+	0xb3, 0xb4, 0x5e, 0xc6, 0xe3, 0xe7, 0xd1, 0x23, 0x0b, 0xf4, 0xa2, 0xcc,
+	0xc3, 0x82, 0x02, 0x6a, 0x88, 0xa0, 0x21, 0xd5, 0xff, 0x39, 0xfe, 0xfe,
+	0x39, 0x7f, 0x18, 0x2e, 0xd3, 0x85, 0x79, 0x9a, 0xa3, 0x4a, 0xac, 0xb4,
+	0x33, 0xe0, 0x1d, 0xb1, 0xc8, 0x58, 0x72, 0x2c, 0xe8, 0x6e, 0x18, 0x53,
+	0x91, 0x58, 0xd6, 0x6e, 0x7d, 0x76, 0x53, 0x35, 0x1d, 0x38, 0x0b, 0x3c,
+	0xb0, 0x4a, 0xec, 0xa5, 0x40, 0xde, 0xac, 0xb2, 0x63, 0x2a, 0xfb, 0x83,
+	0x6e, 0x1c, 0xe9, 0x2c, 0x4b, 0x07, 0x2e, 0x74, 0x91, 0x75, 0x5a, 0xa5,
+	0xf1, 0x8a, 0x39, 0x46, 0x90, 0x20, 0x34, 0x34, 0xae, 0xb8, 0x43, 0x7d,
+	0xdf, 0x00, 0x76, 0x15, 0x00, 0x07, 0x02, 0x9d, 0x25, 0x3c, 0xb3, 0x59,
+	0x8e, 0xba, 0xc5, 0xe9, 0x7e, 0x70, 0xa8, 0x51, 0x87, 0x6d, 0x86, 0xaa,
+	0x5c, 0x2f, 0xc4, 0xcd, 0x75, 0x08, 0x20, 0xff, 0xc1, 0xd7, 0xa6, 0x05,
+	0xbf, 0x4f, 0x37, 0x43, 0x93, 0x1a, 0x6d, 0xc0, 0x3f, 0xf0, 0xb8, 0x38,
+	0x29, 0xb2, 0xf5, 0x66, 0xce, 0x37, 0x6e, 0x49, 0x3a, 0xf0, 0xb8, 0x87,
+	0x1a, 0x25, 0xe3, 0x26, 0xf4, 0x23, 0x69, 0xb1, 0x8e, 0xdd, 0x23, 0xa9,
+	0x62, 0xb1, 0x8c, 0x9e, 0xdb, 0x5b, 0xe6, 0x13, 0x8c, 0x2b, 0xe6, 0xcc,
+	0xed, 0x50, 0x8d, 0x49, 0x10, 0x37, 0xd5, 0xa7, 0x46, 0xbf, 0xe0, 0x1e,
+	0x6f, 0x94, 0x01, 0x37, 0x34, 0x19, 0x6b, 0xcf, 0x11, 0x75, 0xdd, 0x92,
+	0x07, 0x69, 0x0c, 0xea, 0xbf, 0x27, 0x76, 0xa7, 0xd6, 0xe3, 0x17, 0xbe,
+	0x20, 0x03, 0x12, 0x7e, 0x18, 0x8c, 0xc8, 0xa5, 0xc2, 0x87, 0xa8, 0xb2,
+	0xbc, 0x2d, 0x0f, 0x3a, 0xe5, 0x8e, 0x56, 0x0a, 0x5d, 0x88, 0xea, 0xd6,
+	0xf4, 0xad, 0x36, 0x5b, 0x5d, 0x9a, 0xae, 0x0b, 0x65, 0x35, 0x94, 0x42,
+	0x03, 0xcd, 0x2e, 0xdb, 0x71, 0x69, 0xc0, 0x13, 0xef, 0x4f, 0x3a, 0xe3,
+	0xa0, 0x90, 0x57, 0x7a, 0x8f, 0x02, 0x5c, 0xc1, 0x18, 0xe3, 0x39, 0xdb,
+	0x1e, 0xe8, 0xbb, 0x51, 0xb4, 0x96, 0xc0, 0xd4, 0xa0, 0xfc, 0x41, 0xf3,
+	0x3e, 0xb3, 0x11, 0xa9, 0x38, 0xd5, 0x45, 0xc0, 0xa9, 0x3f, 0xae, 0xd0,
+	0xd6, 0x01, 0x0d, 0x41, 0x34, 0x07, 0xd8, 0x5f, 0xdd, 0x54, 0xe4, 0xcf,
+	0xab, 0x03, 0x98, 0x03, 0xd6, 0xf4, 0xe0, 0x5e, 0x68, 0x41, 0xa2, 0x8d,
+	0x29, 0x87, 0x18, 0x43, 0xca, 0xde, 0xa4, 0x36, 0x25, 0x87, 0xb9, 0x4d,
+	0xcb, 0x7f, 0x49, 0xfb, 0xda, 0xa2, 0x73, 0xc4, 0xe9, 0x78, 0x43, 0xf8,
+	0x61, 0x6e, 0x7d, 0x64, 0xb6, 0x93, 0xd7, 0x7f, 0x4c, 0x8e, 0xb1, 0x25,
+	0xff, 0xc8, 0x29, 0x04, 0x9a, 0x7d, 0xaf, 0x1d, 0xc1, 0xd4, 0x09, 0x9a,
+	0x97, 0x0b, 0x55, 0x10, 0xef, 0xca, 0x3b, 0x03, 0x0b, 0x65, 0x71, 0x77,
+	0x8f, 0x42, 0x14, 0xe8, 0xa2, 0x17, 0xb7, 0xd2, 0xa8, 0x65, 0xb6, 0x2c,
+	0xf0, 0x3b, 0x71, 0x98, 0x91, 0x1d, 0x87, 0xcf, 0xb8, 0xfb, 0xa9, 0x9c,
+	0x3d, 0x68, 0x18, 0xb0, 0x8a, 0xe8, 0xb0, 0x87, 0x2b, 0xd6, 0xd9, 0x5f,
+	0x6f, 0xc8, 0xa9, 0x3f, 0xc8, 0x5e, 0x8e, 0xa5, 0x24, 0x25, 0x3d, 0x71,
+	0x3e, 0xc7, 0x61, 0x19, 0x06, 0x82, 0xbb, 0x64, 0x6a, 0xe4, 0x42, 0x81,
+	0xb0, 0x13, 0x48, 0xe3, 0x26, 0x28, 0xd7, 0xa2, 0x26, 0xca, 0xca, 0x49,
+	0xbd, 0x56, 0xdb, 0x67, 0x1c, 0xac, 0xdf, 0x9a, 0x1f, 0x97, 0x7a, 0x89,
+	0x9e, 0xb3, 0xf8, 0x96, 0xfa, 0xd3, 0xba, 0x20, 0x71, 0xb2, 0xb4, 0xbd,
+	0x0d, 0x1b, 0x56, 0x70, 0x9a, 0x60, 0x2e, 0xcf, 0x7d, 0x1c, 0x61, 0x11,
+	0xa6, 0x65, 0xca, 0xa5, 0x7e, 0xa1, 0xfc, 0xcb, 0x15, 0xae, 0x14, 0x8d,
+	0x13, 0xae, 0x51, 0x04, 0x05, 0x24, 0x36, 0x1f, 0x50, 0x90, 0x30, 0xa5,
+	0xd1, 0x71, 0xd9, 0x87, 0xb8, 0x1e, 0xde, 0xd8, 0x4a, 0x99, 0x13, 0x27,
+	0x7a, 0x2e, 0xbd, 0x65, 0x93, 0xa2, 0xb8, 0x0c, 0x16, 0x5d, 0x37, 0x39,
+	0xef, 0x0e, 0x50, 0x2d, 0x41, 0x99, 0x03, 0x4b, 0xce, 0xd4, 0x76, 0xe3,
+	0xaf, 0xdf, 0x31, 0x51, 0xe7, 0x8d, 0x55, 0x3a, 0x6c, 0x37, 0x44, 0x42,
+	0x10, 0x1b, 0x32, 0xc3, 0xe2, 0xed, 0xef, 0x03, 0x45, 0x9e, 0xa9, 0xa9,
+	0xcc, 0xd2, 0xe4, 0x01, 0x54, 0x50, 0x28, 0xef, 0x5e, 0x00, 0x95, 0x6c,
+	0x6e, 0x37, 0xdc, 0x34, 0xe8, 0x3d, 0x09, 0xe0, 0x30, 0xe9, 0xce, 0x39,
+	0xa6, 0xd5, 0x3f, 0x15, 0x3e, 0x3b, 0xed, 0xba, 0x4d, 0xed, 0xbf, 0xe5,
+	0x81, 0x69, 0x79, 0x6b, 0xce, 0x1f, 0x2e, 0x8d, 0x81, 0xda, 0x8c, 0x5f,
+	0xdd, 0x59, 0x38, 0xd5, 0x69, 0x0a, 0x09, 0x63, 0xba, 0x2d, 0xb1, 0x8f,
+	0x24, 0xf4, 0x1d, 0xaf, 0xb8, 0x4b, 0x1d, 0x50, 0xbc, 0x22, 0x72, 0xe5,
+	0xf6, 0xa1, 0x4b, 0x5e, 0xce, 0x67, 0xb5, 0xee, 0xd7, 0x06, 0xa7, 0xec,
+	0x0a, 0x79, 0x90, 0xb3, 0x8d, 0x19, 0x0f, 0x1b, 0x95, 0xa2, 0x9f, 0x8c,
+	0x3c, 0xb8, 0xa4, 0xa9, 0x54, 0xbc, 0x86, 0x54,
+};
+
+const struct rsa_public_key *rsa_key = (struct rsa_public_key *)rsa_data;
+BUILD_ASSERT(sizeof(*rsa_key) == sizeof(rsa_data));
+
+/* SHA-256 sum to verify:
+ * # sha256sum README.md | sed -e 's/\(..\)/0x\1, /mg'
+ */
+const uint8_t hash[] = {
+	0xb7, 0x3a, 0xa2, 0xf5, 0x38, 0xed, 0xc1, 0x4e, 0xe2, 0x97, 0xf9, 0x1e,
+	0x0e, 0x5f, 0xc0, 0xaa, 0xaa, 0x2d, 0x0f, 0x39, 0x8f, 0x2c, 0x5b, 0x6f,
+	0x01, 0x4e, 0x2c, 0xf6, 0x68, 0x09, 0x3c, 0xd8
+};
+
+/* Incorrect hash to test the negative case */
+const uint8_t hash_wrong[] = {
+	0x61, 0x1b, 0xd2, 0x44, 0xc7, 0x18, 0xa7, 0x2d, 0x0f, 0x2d, 0x3d, 0x0f,
+	0xe3, 0xb3, 0xc5, 0xe4, 0x12, 0xc2, 0x7b, 0x1e, 0x05, 0x2c, 0x6f, 0xad,
+	0xc4, 0xac, 0x71, 0x55, 0xe8, 0x80, 0x5c, 0x38
+};
+
+/* Generate signature:
+ * # openssl dgst -sha256 -sign key.pem README.md | xxd -i
+ */
+const uint8_t sig[] = {
+	0x31, 0x79, 0x14, 0xeb, 0x80, 0xf1, 0xc9, 0x6b, 0x26, 0x1a, 0x3d, 0x83,
+	0x4d, 0xd0, 0xc2, 0xe4, 0xca, 0x4b, 0x5a, 0xbf, 0x78, 0x3e, 0xc7, 0x5f,
+	0x6f, 0x9f, 0x75, 0x27, 0xf5, 0x01, 0x9c, 0xa2, 0x17, 0xc4, 0xd8, 0xc4,
+	0xe0, 0x2b, 0xb6, 0x51, 0x9b, 0x54, 0x62, 0xed, 0x0f, 0x7d, 0xce, 0x24,
+	0xa8, 0x07, 0x5d, 0x35, 0x90, 0xc9, 0xec, 0xa0, 0x67, 0x62, 0x31, 0x46,
+	0x52, 0xd1, 0xcc, 0x30, 0xfb, 0x81, 0x0e, 0x8d, 0xaf, 0x0a, 0x0e, 0x1d,
+	0x84, 0x66, 0xc6, 0x54, 0xef, 0xe6, 0xf2, 0x38, 0x3c, 0x90, 0xde, 0xef,
+	0x37, 0x0f, 0x35, 0xf1, 0x35, 0xc7, 0xa7, 0x89, 0x13, 0x72, 0x70, 0x6e,
+	0x4a, 0x8b, 0x08, 0xc5, 0xea, 0x32, 0x00, 0x68, 0x0d, 0x06, 0x07, 0x4a,
+	0xb4, 0x15, 0x2d, 0x48, 0xa4, 0xa0, 0xea, 0x12, 0x1f, 0x0e, 0x4a, 0x6c,
+	0x66, 0x1b, 0x7d, 0x8f, 0x9c, 0x2c, 0x63, 0x9e, 0xc4, 0x77, 0xf3, 0xe2,
+	0xc5, 0x8c, 0x55, 0x9f, 0xf0, 0x91, 0x3f, 0xc6, 0x0e, 0x53, 0x61, 0x85,
+	0xa0, 0x4e, 0xa8, 0x35, 0x3b, 0x0d, 0x5c, 0x5b, 0xea, 0x7b, 0x2c, 0x31,
+	0x89, 0xfb, 0xd0, 0x7c, 0x57, 0xb5, 0x16, 0x04, 0xc0, 0x84, 0x7e, 0x93,
+	0xb4, 0xcb, 0xa1, 0x9b, 0x29, 0x69, 0x8e, 0x0a, 0xa3, 0xa7, 0xdf, 0x74,
+	0xb2, 0xa2, 0xe4, 0xf1, 0x0a, 0x91, 0x3a, 0xb8, 0x34, 0x76, 0x18, 0x9f,
+	0xa0, 0x77, 0x2c, 0x19, 0x85, 0xaa, 0x35, 0xbd, 0xd5, 0x7a, 0x4b, 0xe4,
+	0x00, 0x0d, 0xea, 0x4f, 0x23, 0x49, 0x27, 0x99, 0xca, 0x18, 0x87, 0x73,
+	0x30, 0xeb, 0xdd, 0x0a, 0x14, 0xbb, 0x2b, 0xa4, 0xa8, 0x3f, 0x5b, 0x31,
+	0xd6, 0xad, 0xfb, 0xf5, 0x1a, 0xd0, 0x22, 0x6a, 0xff, 0x04, 0xf8, 0x07,
+	0x9c, 0x52, 0x3d, 0xfb, 0x3b, 0xdb, 0x2e, 0xea, 0x0f, 0x1e, 0x40, 0x1a,
+	0xd5, 0xde, 0xe3, 0xa4, 0xfa, 0xfc, 0x4e, 0x4b, 0x04, 0x5f, 0x3b, 0xad,
+	0x5b, 0xc7, 0xc7, 0x66, 0xdf, 0x4e, 0xd3, 0x5d, 0x28, 0x61, 0x2d, 0x96,
+	0xd6, 0xf3, 0x9a, 0x3d, 0x9b, 0x21, 0x13, 0xea, 0xd3, 0x22, 0xf8, 0x1e,
+	0x4e, 0xa2, 0x6b, 0x4a, 0x95, 0x6a, 0x73, 0xb4, 0x78, 0x16, 0xa0, 0x97,
+	0xbb, 0xc8, 0x51, 0x90, 0x68, 0x76, 0x1a, 0x14, 0x4b, 0x7f, 0xbd, 0xfa,
+	0xf9, 0x7f, 0x7f, 0x83, 0xd0, 0xfe, 0x41, 0xa0, 0xe9, 0xea, 0xa6, 0x78,
+	0x44, 0x6d, 0xb2, 0x10, 0x7a, 0xa2, 0xa9, 0x89, 0xcc, 0x04, 0x15, 0x72,
+	0x63, 0xd6, 0x38, 0xc6, 0xf9, 0xe7, 0x42, 0xea, 0x12, 0x85, 0xd1, 0xa4,
+	0x19, 0xa8, 0xef, 0x46, 0xdc, 0xb8, 0xd1, 0xd0, 0xf9, 0xd2, 0x1b, 0xde,
+	0x6e, 0x87, 0x15, 0x09, 0x09, 0x9f, 0xc2, 0xde, 0x48, 0x20, 0x7a, 0x5c,
+	0x45, 0x7a, 0x81, 0xf4, 0xef, 0x91, 0x27, 0x36, 0xaf, 0x68, 0x69, 0x80,
+	/* Padding */
+	0x00
+};
@@ -0,0 +1,206 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test RW signature verification.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "rsa.h"
+#include "rwsig.h"
+#include "sha256.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+#include "vb21_struct.h"
+#include "rsa2048-F4.h"
+
+#define RW_DATA_SIZE (24 * 1024)
+
+/*
+ * Signature of the RW data set up by write_rw():
+ * # python3 -c "open('rw.bin', 'wb').write(bytes(((i * 7 + (i >> 8)) & 0xff)
+ *     for i in range(24 * 1024)))"
+ * # openssl dgst -sha256 -sign rsa2048-F4.pem rw.bin | xxd -i
+ */
+static const uint8_t rw_sig[RSANUMBYTES] = {
+	0x56, 0x46, 0x6e, 0xb1, 0x67, 0x81, 0x48, 0x0f, 0xe0, 0xc8, 0xb2, 0x8f,
+	0x47, 0xe1, 0xb3, 0x51, 0x43, 0xee, 0x2d, 0x08, 0x26, 0xf1, 0xf0, 0xfc,
+	0x3d, 0x8a, 0x6e, 0x4e, 0xd1, 0x5d, 0x3d, 0xd3, 0x7d, 0xd1, 0x10, 0xd6,
+	0x34, 0xf8, 0x17, 0x82, 0xd9, 0xbc, 0x7e, 0x0b, 0x12, 0x9a, 0xf7, 0x64,
+	0x9f, 0x99, 0xeb, 0x97, 0x17, 0xc5, 0x25, 0xb0, 0x00, 0x00, 0xb5, 0x45,
+	0xc8, 0x44, 0x29, 0x94, 0xb8, 0x45, 0x0c, 0x0b, 0x04, 0x7e, 0xc6, 0xa3,
+	0x14, 0xd3, 0xf9, 0x16, 0xc5, 0x17, 0x31, 0xfb, 0xd4, 0x1b, 0xd0, 0x29,
+	0x4d, 0xd1, 0x70, 0xfb, 0x76, 0x4c, 0x1f, 0x60, 0x9d, 0xd0, 0xf1, 0x83,
+	0xc7, 0x81, 0x92, 0xc3, 0x6e, 0x13, 0xa4, 0xe3, 0xe1, 0xa2, 0xd7, 0x81,
+	0xc4, 0xcf, 0xb1, 0x88, 0x1b, 0xad, 0xb0, 0x51, 0x68, 0xc5, 0x48, 0x85,
+	0x16, 0x31, 0xac, 0x14, 0x10, 0xd7, 0x3d, 0x35, 0xe7, 0xcc, 0xa2, 0xd3,
+	0xb8, 0xf6, 0x6f, 0x39, 0x8e, 0x88, 0x47, 0xc1, 0x36, 0x2d, 0x0e, 0x72,
+	0x32, 0x58, 0x50, 0xff, 0xbb, 0x57, 0x27, 0x4c, 0x69, 0xdc, 0xec, 0x23,
+	0xd5, 0x8c, 0xb6, 0xa5, 0x52, 0x4c, 0x27, 0xa7, 0x22, 0x67, 0x89, 0x11,
+	0x2c, 0xf5, 0xde, 0x03, 0xd6, 0x70, 0xa8, 0xff, 0x95, 0x2c, 0x83, 0x0a,
+	0x54, 0x64, 0xa0, 0x79, 0x8e, 0x83, 0xde, 0xac, 0xe7, 0x60, 0x93, 0x71,
+	0x65, 0x8e, 0x26, 0xb7, 0xf1, 0x69, 0xc2, 0x8e, 0x9a, 0x13, 0xe5, 0x3c,
+	0x8c, 0x39, 0x20, 0xc0, 0xd1, 0x5c, 0xa6, 0x61, 0x11, 0x77, 0x84, 0xfa,
+	0xdb, 0x43, 0x3d, 0xac, 0x3d, 0xd9, 0x6a, 0x04, 0x0b, 0x8a, 0x2d, 0xe0,
+	0xee, 0xac, 0x42, 0xb0, 0xbd, 0xd1, 0xe2, 0x41, 0x44, 0xf2, 0xbc, 0x81,
+	0x7b, 0xff, 0x53, 0xde, 0xf2, 0x2c, 0xbc, 0xd6, 0xa1, 0xc0, 0xb4, 0xc4,
+	0xbb, 0x9c, 0x39, 0x30
+};
+
+static uint8_t * const rw = (uint8_t *)CONFIG_PROGRAM_MEMORY_BASE +
+	CONFIG_RW_MEM_OFF;
+
+static void write_key(void)
+{
+	struct vb21_packed_key *k = (void *)CONFIG_RO_PUBKEY_ADDR;
+
+	memset(k, 0, sizeof(*k));
+	k->c.magic = VB21_MAGIC_PACKED_KEY;
+	k->key_offset = sizeof(*k);
+	k->key_size = sizeof(rsa_data);
+	memcpy((uint8_t *)k + k->key_offset, rsa_data, sizeof(rsa_data));
+}
+
+static void write_rw(void)
+{
+	struct vb21_signature *s = (void *)CONFIG_RW_SIG_ADDR;
+	int i;
+
+	memset(rw, 0xff, CONFIG_RW_SIZE);
+	for (i = 0; i < RW_DATA_SIZE; i++)
+		rw[i] = i * 7 + (i >> 8);
+
+	memset(s, 0, sizeof(*s));
+	s->c.magic = VB21_MAGIC_SIGNATURE;
+	s->sig_size = RSANUMBYTES;
+	s->sig_offset = sizeof(*s);
+	s->data_size = RW_DATA_SIZE;
+	memcpy((uint8_t *)s + s->sig_offset, rw_sig, sizeof(rw_sig));
+}
+
+/* Run the verification; return its time in us and the console output. */
+static int check(int *us, const char **log)
+{
+	uint64_t t;
+	int good;
+
+	test_capture_console(1);
+	t = test_bench_time_ns();
+	good = rwsig_check_signature();
+	*us = (test_bench_time_ns() - t) / 1000;
+	cflush();
+	test_capture_console(0);
+	*log = test_get_captured_console();
+
+	return good;
+}
+
+static int test_layout(void)
+{
+	/* The key, the image and its signature don't overlap */
+	TEST_ASSERT(CONFIG_RO_PUBKEY_ADDR + CONFIG_RO_PUBKEY_SIZE <=
+		    (uintptr_t)rw);
+	TEST_ASSERT(CONFIG_RW_SIG_ADDR == (uintptr_t)rw + RW_SIG_OFFSET);
+	TEST_ASSERT(RW_DATA_SIZE <= RW_SIG_OFFSET);
+
+	return EC_SUCCESS;
+}
+
+static int test_good(void)
+{
+	const char *log;
+	int us;
+
+	write_key();
+	write_rw();
+	TEST_ASSERT(check(&us, &log));
+	TEST_ASSERT(strstr(log, "RW verify OK") != NULL);
+
+	return EC_SUCCESS;
+}
+
+/* A bad signature fails before the image is hashed. */
+static int test_bad_signature(void)
+{
+	struct vb21_signature *s = (void *)CONFIG_RW_SIG_ADDR;
+	const char *log;
+	int us;
+
+	write_rw();
+	((uint8_t *)s + s->sig_offset)[RSANUMBYTES / 2] ^= 1;
+	TEST_ASSERT(!check(&us, &log));
+	TEST_ASSERT(strstr(log, "Invalid signature.") != NULL);
+	TEST_ASSERT(strstr(log, "hash") == NULL);
+
+	return EC_SUCCESS;
+}
+
+/* A bad image fails at the digest compare. */
+static int test_bad_image(void)
+{
+	const char *log;
+	int us;
+
+	write_rw();
+	rw[RW_DATA_SIZE - 1] ^= 1;
+	TEST_ASSERT(!check(&us, &log));
+	TEST_ASSERT(strstr(log, "hash") != NULL);
+	TEST_ASSERT(strstr(log, "RW verify FAILED") != NULL);
+
+	/* As does one with data past the signed size */
+	write_rw();
+	rw[RW_DATA_SIZE] = 0;
+	TEST_ASSERT(!check(&us, &log));
+	TEST_ASSERT(strstr(log, "Invalid padding.") != NULL);
+
+	return EC_SUCCESS;
+}
+
+/* Time each stage, and the verification of good and bad signatures. */
+static int test_timing(void)
+{
+	struct vb21_signature *s = (void *)CONFIG_RW_SIG_ADDR;
+	uint32_t workbuf[3 * RSANUMWORDS];
+	uint8_t digest[SHA256_DIGEST_SIZE];
+	struct sha256_ctx ctx;
+	const char *log;
+	uint64_t t;
+	int rsa_us, hash_us, good_us, bad_us;
+
+	write_rw();
+	t = test_bench_time_ns();
+	TEST_ASSERT(rsa_recover_digest((const void *)rsa_data,
+				       (uint8_t *)s + s->sig_offset, digest,
+				       workbuf));
+	rsa_us = (test_bench_time_ns() - t) / 1000;
+
+	t = test_bench_time_ns();
+	SHA256_init(&ctx);
+	SHA256_update(&ctx, rw, RW_DATA_SIZE);
+	TEST_ASSERT(!memcmp(SHA256_final(&ctx), digest, sizeof(digest)));
+	hash_us = (test_bench_time_ns() - t) / 1000;
+
+	TEST_ASSERT(check(&good_us, &log));
+	((uint8_t *)s + s->sig_offset)[0] ^= 1;
+	TEST_ASSERT(!check(&bad_us, &log));
+
+	ccprintf("RSA %d us, hash %d us; verify good %d us, bad signature "
+		 "%d us\n", rsa_us, hash_us, good_us, bad_us);
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_layout);
+	RUN_TEST(test_good);
+	RUN_TEST(test_bad_signature);
+	RUN_TEST(test_bad_image);
+	RUN_TEST(test_timing);
+
+	test_print_result();
+}
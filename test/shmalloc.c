@@ -15,6 +15,7 @@
 #include "link_defs.h"
 #include "shared_mem.h"
 #include "test_util.h"
+#include "util.h"
 
 /*
  * Total size of memory in the malloc pool (shared between free and allocated
@@ -46,73 +47,57 @@ static struct {
 } allocations[12];  /* Up to 12 buffers could be allocated concurrently. */
 
 /*
- * Verify that allocated and free buffers do not overlap, and that our and
- * malloc's ideas of the number of allocated buffers match.
+ * Verify that each buffer allocated by the test is a buffer allocated by
+ * malloc, and that our and malloc's ideas of the number of allocated buffers
+ * match.
  */
 
-static int check_for_overlaps(void)
+static int check_for_overlaps(int allocated_count)
 {
 	int i;
-	int allocation_match;
-	int allocations_count, allocated_count;
+	int allocations_count = 0;
 
-	allocations_count = allocated_count = 0;
 	for (i = 0; i < ARRAY_SIZE(allocations); i++) {
 		struct shm_buffer *allocced_buf;
+		int allocated_size, allocation_size;
 
 		if (!allocations[i].buf)
 			continue;
 
-		/*
-		 * Indication of finding the allocated buffer in internal
-		 * malloc structures.
-		 */
-		allocation_match = 0;
-
 		/* number of buffers allocated by the test program. */
 		allocations_count++;
 
-		/*
-		 * Number of allocated buffers malloc knows about, calculated
-		 * multiple times to keep things simple.
-		 */
-		allocated_count = 0;
-		for (allocced_buf = allocced_buf_chain;
-		     allocced_buf;
-		     allocced_buf = allocced_buf->next_buffer) {
-			int allocated_size, allocation_size;
-
-			allocated_count++;
-			if (allocations[i].buf != (allocced_buf + 1))
-				continue;
-
-			allocated_size = allocced_buf->buffer_size;
-			allocation_size = allocations[i].buffer_size;
+		/* Find the buffer in the heap */
+		for (allocced_buf = shm_start;
+		     allocced_buf < shm_end &&
+		     (void *)(allocced_buf + 1) != allocations[i].buf;
+		     allocced_buf = (struct shm_buffer *)
+			     ((uintptr_t)allocced_buf +
+			      (allocced_buf->buffer_size & ~SHM_BUF_FLAGS)))
+			;
+		if (allocced_buf >= shm_end ||
+		    !(allocced_buf->buffer_size & SHM_BUF_ALLOCATED)) {
+			ccprintf("missing match %pP!\n", allocations[i].buf);
+			return 0;
+		}
 
-			/*
-			 * Verify that size requested by the allocator matches
-			 * the value used by malloc, i.e. does not exceed the
-			 * allocated size and is no less than two buffer
-			 * structures lower (which can happen when the
-			 * requested size was rounded up to cover gaps smaller
-			 * than the buffer header structure size).
-			 */
-			if ((allocation_size > allocated_size) ||
-			    ((allocated_size - allocation_size) >=
-			     (2 * sizeof(struct shm_buffer) + sizeof(int)))) {
-				ccprintf("inconsistency: allocated (size %d)"
-					 " allocation %d(size %d)\n",
-					 allocated_size, i, allocation_size);
-				return 0;
-			}
+		allocated_size = allocced_buf->buffer_size & ~SHM_BUF_FLAGS;
+		allocation_size = allocations[i].buffer_size +
+			sizeof(struct shm_buffer);
 
-			if (allocation_match++) {
-				ccprintf("inconsistency: duplicated match\n");
-				return 0;
-			}
-		}
-		if (!allocation_match) {
-			ccprintf("missing match %pP!\n", allocations[i].buf);
+		/*
+		 * Verify that size requested by the allocator matches
+		 * the value used by malloc, i.e. does not exceed the
+		 * allocated size and is no more than a minimal free buffer
+		 * larger (which can happen when the requested size was
+		 * rounded up to cover gaps too small to be a free buffer).
+		 */
+		if ((allocation_size > allocated_size) ||
+		    ((allocated_size - allocation_size) >=
+		     (2 * sizeof(struct shm_buffer) + sizeof(size_t)))) {
+			ccprintf("inconsistency: allocated (size %d)"
+				 " allocation %d(size %d)\n",
+				 allocated_size, i, allocation_size);
 			return 0;
 		}
 	}
@@ -125,60 +110,100 @@ static int check_for_overlaps(void)
 }
 
 /*
- * Verify that shared memory is in a consistent state, i.e. that there is no
- * overlaps between allocated and free buffers, and that all memory is
- * accounted for (is either allocated or available).
+ * Verify that shared memory is in a consistent state: the buffers tile the
+ * whole memory, no free buffer is next to another, the flags and size tags
+ * agree with the buffers around them, and the free lists hold exactly the
+ * free buffers.
  */
 
 static int shmem_is_ok(int line)
 {
 	int count = 0;
+	int listed = 0;
+	int allocated_count = 0;
 	int running_size = 0;
-	struct shm_buffer *pbuf = free_buf_chain;
+	int prev_free = 0;
+	struct shm_buffer *pbuf;
+	int i;
+
+	for (pbuf = shm_start; pbuf < shm_end;
+	     pbuf = (struct shm_buffer *)((uintptr_t)pbuf + pbuf->buffer_size -
+					  (pbuf->buffer_size &
+					   SHM_BUF_FLAGS))) {
+		size_t size = pbuf->buffer_size & ~SHM_BUF_FLAGS;
+		int is_free = !(pbuf->buffer_size & SHM_BUF_ALLOCATED);
+
+		if (size < sizeof(struct shm_buffer) ||
+		    (size & (sizeof(size_t) - 1))) {
+			ccprintf("Bad buffer size at %pP\n", pbuf);
+			goto bailout;
+		}
+		if (!!(pbuf->buffer_size & SHM_BUF_PREV_FREE) != prev_free) {
+			ccprintf("Bad previous buffer flag at %pP\n", pbuf);
+			goto bailout;
+		}
+		if (is_free && prev_free) {
+			ccprintf("Free buffers not merged at %pP\n", pbuf);
+			goto bailout;
+		}
+		if (is_free &&
+		    *(size_t *)((uintptr_t)pbuf + size - sizeof(size_t)) !=
+		    size) {
+			ccprintf("Bad size tag at %pP\n", pbuf);
+			goto bailout;
+		}
 
-	if (pbuf && pbuf->prev_buffer) {
-		ccprintf("Bad free buffer list start %pP\n", pbuf);
+		running_size += size;
+		count += is_free;
+		allocated_count += !is_free;
+		prev_free = is_free;
+	}
+
+	if (pbuf != shm_end) {
+		ccprintf("Buffers overrun the memory end\n");
 		goto bailout;
 	}
 
-	while (pbuf) {
-		struct shm_buffer *top;
+	for (i = 0; i < SHM_SIZE_CLASSES; i++) {
+		if (!!free_lists[i] != !!(free_lists_map & BIT(i))) {
+			ccprintf("Bad free list map %x\n", free_lists_map);
+			goto bailout;
+		}
+		if (free_lists[i] && free_lists[i]->prev_buffer) {
+			ccprintf("Bad free buffer list start %pP\n",
+				 free_lists[i]);
+			goto bailout;
+		}
+		for (pbuf = free_lists[i]; pbuf; pbuf = pbuf->next_buffer) {
+			size_t size = pbuf->buffer_size & ~SHM_BUF_FLAGS;
 
-		running_size += pbuf->buffer_size;
-		if (count++ > 100)
-			goto bailout;  /* Is there a loop? */
+			if (listed++ > count)
+				goto bailout;  /* Is there a loop? */
 
-		top = (struct shm_buffer *)((uintptr_t)pbuf +
-					     pbuf->buffer_size);
-		if (pbuf->next_buffer) {
-			if (top >= pbuf->next_buffer) {
-				ccprintf("%s:%d"
-					 " - inconsistent buffer size at %pP\n",
+			if ((pbuf->buffer_size & SHM_BUF_ALLOCATED) ||
+			    MIN(__fls(size) - 4, SHM_SIZE_CLASSES - 1) != i) {
+				ccprintf("%s:%d - bad free buffer at %pP\n",
 					 __func__, __LINE__, pbuf);
 				goto bailout;
 			}
-			if (pbuf->next_buffer->prev_buffer != pbuf) {
+			if (pbuf->next_buffer &&
+			    pbuf->next_buffer->prev_buffer != pbuf) {
 				ccprintf("%s:%d"
 					 " - inconsistent next buffer at %pP\n",
 					 __func__, __LINE__, pbuf);
 				goto bailout;
 			}
 		}
-		pbuf = pbuf->next_buffer;
 	}
 
-	if (pbuf) { /* Must be a loop. */
-		ccprintf("Too many buffers in the chain\n");
+	if (listed != count) {
+		ccprintf("%d free buffers, %d in the lists\n", count, listed);
 		goto bailout;
 	}
 
-	/* Make sure there were at least 5 buffers allocated at one point. */
+	/* Make sure there were at least 5 free buffers at one point. */
 	if (count > 5)
-		set_map_bit(1 << 24);
-
-	/* Add allocated sizes. */
-	for (pbuf = allocced_buf_chain; pbuf; pbuf = pbuf->next_buffer)
-		running_size += pbuf->buffer_size;
+		set_map_bit(1 << MAX_MASK_BIT);
 
 	if (total_size) {
 		if (total_size != running_size)
@@ -188,7 +213,7 @@ static int shmem_is_ok(int line)
 		total_size = running_size;
 	}
 
-	if (!check_for_overlaps())
+	if (!check_for_overlaps(allocated_count))
 		goto bailout;
 
 	return 1;
@@ -200,6 +225,125 @@ static int shmem_is_ok(int line)
 	return 0;
 }
 
+/* Buffers held at once, and operations, in the randomized trace. */
+#define TRACE_SLOTS 32
+#define TRACE_OPS 100000
+
+/*
+ * Replay a randomized trace of allocations and releases, of sizes like those
+ * of real users: mostly small buffers, with some up to a good part of the
+ * memory. Report the time per operation, and the fragmentation the trace
+ * leaves. Everything released, the memory must be a single free buffer again.
+ */
+static int stress_test(void)
+{
+	static char *slots[TRACE_SLOTS];
+	uint64_t t_acquire = 0, t_release = 0, t;
+	int acquires = 0, releases = 0, failures = 0;
+	size_t free_size = 0, max_free = 0, size;
+	struct shm_buffer *pbuf;
+	uint32_t r_data;
+	int i, index, rv;
+
+	for (i = 0; i < TRACE_OPS; i++) {
+		r_data = myrand();
+		index = r_data % TRACE_SLOTS;
+
+		if (slots[index]) {
+			t = test_bench_time_ns();
+			shared_mem_release(slots[index]);
+			t_release += test_bench_time_ns() - t;
+			releases++;
+			slots[index] = NULL;
+			continue;
+		}
+
+		/* Three in four up to 128 bytes, the rest up to 1 kB */
+		size = (r_data & 0x300) ? myrand() % 128 : myrand() % 1024;
+		t = test_bench_time_ns();
+		rv = shared_mem_acquire(size, &slots[index]);
+		t_acquire += test_bench_time_ns() - t;
+		acquires++;
+		if (rv != EC_SUCCESS)
+			failures++;
+		else if (size)
+			slots[index][size - 1] = 0;
+	}
+
+	for (pbuf = shm_start; pbuf < shm_end;
+	     pbuf = (struct shm_buffer *)((uintptr_t)pbuf + size)) {
+		size = pbuf->buffer_size & ~SHM_BUF_FLAGS;
+		if (pbuf->buffer_size & SHM_BUF_ALLOCATED)
+			continue;
+		free_size += size;
+		max_free = MAX(max_free, size);
+	}
+
+	ccprintf("%d ops: acquire %d ns, release %d ns, %d failed, "
+		 "fragmentation %d%%\n", TRACE_OPS,
+		 (int)(t_acquire / MAX(acquires, 1)),
+		 (int)(t_release / MAX(releases, 1)), failures,
+		 free_size ? (int)(100 - max_free * 100 / free_size) : 0);
+
+	for (index = 0; index < TRACE_SLOTS; index++) {
+		shared_mem_release(slots[index]);
+		slots[index] = NULL;
+	}
+
+	if (!shmem_is_ok(__LINE__))
+		return EC_ERROR_UNKNOWN;
+	TEST_EQ(shared_mem_size(),
+		total_size - (int)sizeof(struct shm_buffer), "%d");
+
+	return EC_SUCCESS;
+}
+
+/*
+ * Releasing a buffer twice is ignored, even once it merged into another, and
+ * so is releasing a pointer into the middle of a buffer.
+ */
+static int double_release_test(void)
+{
+	char *a, *b, *c;
+	struct shm_buffer *fake;
+
+	TEST_ASSERT(shared_mem_acquire(100, &a) == EC_SUCCESS);
+	TEST_ASSERT(shared_mem_acquire(100, &b) == EC_SUCCESS);
+	TEST_ASSERT(shared_mem_acquire(100, &c) == EC_SUCCESS);
+
+	/* Data which looks like an allocated header, in the middle of a */
+	fake = (struct shm_buffer *)(a + 32);
+	fake->buffer_size = 32 | SHM_BUF_ALLOCATED;
+	shared_mem_release(fake + 1);
+	allocations[0].buf = a;
+	allocations[0].buffer_size = 100;
+	allocations[1].buf = b;
+	allocations[1].buffer_size = 100;
+	allocations[2].buf = c;
+	allocations[2].buffer_size = 100;
+	TEST_ASSERT(shmem_is_ok(__LINE__));
+	allocations[1].buf = allocations[2].buf = NULL;
+
+	/* Only c is left for shmem_is_ok() to match */
+	allocations[0].buf = c;
+	allocations[0].buffer_size = 100;
+
+	shared_mem_release(a);
+	/* b merges down into a */
+	shared_mem_release(b);
+	shared_mem_release(b);
+	TEST_ASSERT(shmem_is_ok(__LINE__));
+
+	allocations[0].buf = NULL;
+	shared_mem_release(c);
+	shared_mem_release(c);
+	TEST_ASSERT(shmem_is_ok(__LINE__));
+	TEST_EQ(shared_mem_size(),
+		total_size - (int)sizeof(struct shm_buffer), "%d");
+
+	return EC_SUCCESS;
+}
+
 /*
  * Bitmap used to keep track of branches taken by malloc/free routines. Once
  * all bits in the 0..(MAX_MASK_BIT - 1) range are set, consider the test
@@ -235,8 +379,7 @@ void run_test(int argc, char **argv)
 				return;
 			}
 			ccprintf("Done testing, counter at %d\n", counter);
-			test_pass();
-			return;
+			break;
 		}
 
 		/* Pick a random allocation entry. */
@@ -294,9 +437,22 @@ void run_test(int argc, char **argv)
 			}
 		}
 
-	ccprintf("Did not pass all paths, map %x != %x\n",
-		 test_map, ALL_PATHS_MASK);
-	test_fail();
+	if ((test_map & ALL_PATHS_MASK) != ALL_PATHS_MASK) {
+		ccprintf("Did not pass all paths, map %x != %x\n",
+			 test_map, ALL_PATHS_MASK);
+		test_fail();
+		return;
+	}
+
+	if (stress_test() != EC_SUCCESS) {
+		test_fail();
+		return;
+	}
+	if (double_release_test() != EC_SUCCESS) {
+		test_fail();
+		return;
+	}
+	test_pass();
 }
 
 void set_map_bit(uint32_t mask)
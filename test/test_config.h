@@ -40,6 +40,11 @@
 #define CONFIG_BACKLIGHT_REQ_GPIO GPIO_PCH_BKLTEN
 #endif
 
+#ifdef TEST_FLASH
+#define CONFIG_FLASH_BLOCK_HASH
+#define CONFIG_FLASH_WRITE_SESSION CONFIG_FLASH_BANK_SIZE
+#endif
+
 #ifdef TEST_FLASH_LOG
 #define CONFIG_CRC8
 #define CONFIG_FLASH_ERASED_VALUE32 (-1U)
@@ -229,6 +234,7 @@ enum sensor_id {
 #define CONFIG_RSA_KEY_SIZE 2048
 #undef CONFIG_RSA_EXPONENT_3
 #define CONFIG_RWSIG_TYPE_RWSIG
+#define CONFIG_RSA_OPTIMIZED
 #endif
 
 #ifdef TEST_RSA3
@@ -237,6 +243,25 @@ enum sensor_id {
 #define CONFIG_RSA_KEY_SIZE 2048
 #define CONFIG_RSA_EXPONENT_3
 #define CONFIG_RWSIG_TYPE_RWSIG
+#define CONFIG_RSA_OPTIMIZED
+#endif
+
+#ifdef TEST_RSA3072
+#define CONFIG_RSA
+#undef CONFIG_RSA_KEY_SIZE
+#define CONFIG_RSA_KEY_SIZE 3072
+#undef CONFIG_RSA_EXPONENT_3
+#define CONFIG_RWSIG_TYPE_RWSIG
+#define CONFIG_RSA_OPTIMIZED
+#endif
+
+#ifdef TEST_RSA3072_3
+#define CONFIG_RSA
+#undef CONFIG_RSA_KEY_SIZE
+#define CONFIG_RSA_KEY_SIZE 3072
+#define CONFIG_RSA_EXPONENT_3
+#define CONFIG_RWSIG_TYPE_RWSIG
+#define CONFIG_RSA_OPTIMIZED
 #endif
 
 #ifdef TEST_SHA256
@@ -308,6 +333,23 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #define CONFIG_CEC
 #endif
 
+#ifdef TEST_CONSOLE_BATCH
+#define CONFIG_CONSOLE_BATCH
+#define CONFIG_CMD_SYSLOCK
+#undef CONFIG_CONSOLE_BATCH_BUF_SIZE
+#define CONFIG_CONSOLE_BATCH_BUF_SIZE 256
+#endif
+
+#ifdef TEST_CONSOLE_BINLOG
+#define CONFIG_CONSOLE_BINLOG
+#endif
+
+#ifdef TEST_CONSOLE_CHANNEL
+#define CONFIG_CONSOLE_CHANNEL_RATE_LIMIT 10
+#undef CONFIG_CONSOLE_CHANNEL_RATE_BURST
+#define CONFIG_CONSOLE_CHANNEL_RATE_BURST 5
+#endif
+
 #ifdef TEST_LIGHTBAR
 #define CONFIG_I2C
 #define CONFIG_I2C_MASTER
@@ -315,6 +357,14 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #define CONFIG_ALS_LIGHTBAR_DIMMING 0
 #endif
 
+#ifdef TEST_PANIC_LOG
+#define CONFIG_PANIC_LOG 256
+#endif
+
+#ifdef TEST_UART
+#define CONFIG_CONSOLE_READ_CURSORS 2
+#endif
+
 #ifdef TEST_USB_COMMON
 #define CONFIG_USB_POWER_DELIVERY
 #define CONFIG_USB_PD_TCPMV1
@@ -409,6 +459,7 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #define CONFIG_USB_PD_DISCHARGE_GPIO
 #undef CONFIG_USB_PD_HOST_CMD
 #define CONFIG_USB_PD_ALT_MODE_DFP
+#define CONFIG_USB_PD_DISCOVERY_CACHE 2
 #define CONFIG_USBC_SS_MUX
 #endif
 
@@ -520,6 +571,10 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #ifdef TEST_USB_PD_GIVEBACK
 #define CONFIG_USB_PD_GIVE_BACK
 #endif
+/* usb_pd_giveback keeps the symbol-by-symbol 4b5b code for comparison */
+#ifndef TEST_USB_PD_GIVEBACK
+#define CONFIG_USB_PD_TCPC_FAST_PATH
+#endif
 #endif /* TEST_USB_PD || TEST_USB_PD_GIVEBACK || TEST_USB_PD_REV30 */
 
 #ifdef TEST_USB_PPC
@@ -534,7 +589,7 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #if defined(TEST_CHARGE_MANAGER) || defined(TEST_CHARGE_MANAGER_DRP_CHARGING)
 #define CONFIG_CHARGE_MANAGER
 #define CONFIG_USB_PD_DUAL_ROLE
-#define CONFIG_USB_PD_PORT_MAX_COUNT 2
+#define CONFIG_USB_PD_PORT_MAX_COUNT 4
 #define CONFIG_BATTERY
 #define CONFIG_BATTERY_SMART
 #define CONFIG_I2C
@@ -557,7 +612,7 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #define CONFIG_HOSTCMD_RTC
 #endif
 
-#ifdef TEST_VBOOT
+#if defined(TEST_VBOOT) || defined(TEST_RWSIG)
 #define CONFIG_RWSIG
 #define CONFIG_SHA256
 #define CONFIG_RSA
@@ -577,8 +632,14 @@ int ncp15wb_calculate_temp(uint16_t adc);
 					 CONFIG_RW_SIZE - CONFIG_RW_SIG_SIZE)
 #endif
 
+#ifdef TEST_VBOOT_HASH
+#define CONFIG_VBOOT_HASH
+#define CONFIG_VBOOT_HASH_TREE
+#endif
+
 #ifdef TEST_X25519
 #define CONFIG_CURVE25519
+#define CONFIG_CURVE25519_BASE_TABLE 8
 #endif /* TEST_X25519 */
 
 #ifdef TEST_I2C_BITBANG
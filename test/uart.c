@@ -0,0 +1,325 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test UART transmit buffering.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "printf.h"
+#include "test_util.h"
+#include "uart.h"
+#include "util.h"
+
+/* Lines per batch, so that a batch fits in the transmit buffer */
+#define BENCH_BATCH 8
+#define BENCH_BATCHES 32
+
+static const char * const bench_lines[] = {
+	"[12.345678 C0: PE_SNK_Ready]\n",
+	"[12.345912 charge_manager: port 0, supplier 1, 3000mA 20000mV]\n",
+	"[12.346001 AP wake mask 0x0000000000000000]\n",
+	"> ",
+	"[12.346530 hostcmd 0x0097 (16 bytes), result 0]\n",
+	"Running on host\n",
+	"[12.347000 PD TCPC p0 state SNK_READY (12 ms)]\n",
+	"[12.347812 Battery 87% (4186 mV, 1520 mA)]\n",
+};
+BUILD_ASSERT(ARRAY_SIZE(bench_lines) == BENCH_BATCH);
+
+static int captured_eq(const char *expected)
+{
+	return strncmp(test_get_captured_console(), expected,
+		       strlen(expected) + 1) == 0;
+}
+
+static int test_newlines(void)
+{
+	test_capture_console(1);
+	TEST_ASSERT(uart_puts("a\nb\n\nc") == EC_SUCCESS);
+	TEST_ASSERT(uart_put("d\ne", 3) == EC_SUCCESS);
+	TEST_ASSERT(uart_put_raw("\nf\n", 3) == EC_SUCCESS);
+	cflush();
+	test_capture_console(0);
+
+	TEST_ASSERT(captured_eq("a\r\nb\r\n\r\ncd\r\ne\nf\n"));
+
+	return EC_SUCCESS;
+}
+
+/* Lines of odd lengths land at every offset of the buffer, and wrap. */
+static int test_wrap(void)
+{
+	char expected[1800];
+	char line[64];
+	int len = 0;
+	int i;
+
+	test_capture_console(1);
+	for (i = 0; i < 40; i++) {
+		snprintf(line, sizeof(line), "line %d %.*s\n", i, i % 23,
+			 "abcdefghijklmnopqrstuvw");
+		TEST_ASSERT(uart_puts(line) == EC_SUCCESS);
+		cflush();
+
+		line[strlen(line) - 1] = '\0';
+		len += snprintf(expected + len, sizeof(expected) - len,
+				"%s\r\n", line);
+	}
+	test_capture_console(0);
+
+	TEST_ASSERT(len < sizeof(expected) - 1);
+	TEST_ASSERT(captured_eq(expected));
+
+	return EC_SUCCESS;
+}
+
+/* Output that doesn't fit is dropped, and reported. */
+static int test_overflow(void)
+{
+	char out[CONFIG_UART_TX_BUF_SIZE + 100];
+	const char *captured;
+	int i;
+
+	for (i = 0; i < sizeof(out); i++)
+		out[i] = 'A' + i % 26;
+
+	cflush();
+	test_hold_uart_output(1);
+	TEST_EQ(uart_put_raw(out, sizeof(out)), EC_ERROR_OVERFLOW, "%d");
+	TEST_ASSERT(uart_buffer_full());
+	TEST_EQ(uart_putc('x'), EC_ERROR_OVERFLOW, "%d");
+	test_hold_uart_output(0);
+
+	test_capture_console(1);
+	cflush();
+	test_capture_console(0);
+
+	captured = test_get_captured_console();
+	TEST_EQ((int)strlen(captured), CONFIG_UART_TX_BUF_SIZE - 1, "%d");
+	TEST_ASSERT(strncmp(captured, out, CONFIG_UART_TX_BUF_SIZE - 1) == 0);
+
+	return EC_SUCCESS;
+}
+
+static int read_recent(char *buf, int size)
+{
+	struct ec_params_console_read_v1 p = {
+		.subcmd = CONSOLE_READ_RECENT,
+	};
+
+	TEST_ASSERT(test_send_host_command(EC_CMD_CONSOLE_SNAPSHOT, 0, NULL, 0,
+					   NULL, 0) == EC_RES_SUCCESS);
+	TEST_ASSERT(test_send_host_command(EC_CMD_CONSOLE_READ, 1, &p,
+					   sizeof(p), buf, size) ==
+		    EC_RES_SUCCESS);
+	return EC_SUCCESS;
+}
+
+/* Reading the output since the last snapshot, including after a wrap. */
+static int test_console_read_recent(void)
+{
+	char buf[CONFIG_UART_TX_BUF_SIZE + 1];
+	char out[CONFIG_UART_TX_BUF_SIZE + 100];
+	int len;
+	int i;
+
+	TEST_ASSERT(read_recent(buf, sizeof(buf)) == EC_SUCCESS);
+	uart_puts("recent\n");
+	cflush();
+	TEST_ASSERT(read_recent(buf, sizeof(buf)) == EC_SUCCESS);
+	/* Host commands log themselves, so there is more than our line */
+	TEST_ASSERT(strstr(buf, "recent\r\n") != NULL);
+
+	/* More output than the buffer holds, so the buffer wraps past */
+	for (i = 0; i < sizeof(out) - 1; i++)
+		out[i] = 'a' + i % 26;
+	out[i] = '\0';
+	for (i = 0; i < sizeof(out) - 1; i += 100) {
+		uart_put(out + i, MIN(100, sizeof(out) - 1 - i));
+		cflush();
+	}
+	TEST_ASSERT(read_recent(buf, sizeof(buf)) == EC_SUCCESS);
+
+	/*
+	 * Only the newest output is left: the end of our output, intact,
+	 * then the host command log lines.
+	 */
+	TEST_ASSERT(strlen(buf) < CONFIG_UART_TX_BUF_SIZE);
+	for (len = 0; buf[len] >= 'a' && buf[len] <= 'z'; len++)
+		;
+	TEST_ASSERT(len > CONFIG_UART_TX_BUF_SIZE / 2);
+	TEST_ASSERT(strncmp(buf, out + sizeof(out) - 1 - len, len) == 0);
+
+	return EC_SUCCESS;
+}
+
+static int read_cursor(const char *reader, int flags, char *buf, int size,
+		       struct ec_response_console_read_v2 **resp)
+{
+	static uint8_t rbuf[sizeof(struct ec_response_console_read_v2) +
+			    CONFIG_UART_TX_BUF_SIZE];
+	struct ec_response_console_read_v2 *r = (void *)rbuf;
+	struct ec_params_console_read_v2 p = {
+		.flags = flags,
+	};
+	struct host_cmd_handler_args args = {
+		.command = EC_CMD_CONSOLE_READ,
+		.version = 2,
+		.params = &p,
+		.params_size = sizeof(p),
+		.response = r,
+		.response_max = sizeof(*r) + size - 1,
+	};
+	int n;
+
+	strncpy(p.reader, reader, sizeof(p.reader));
+	if (host_command_process(&args) != EC_RES_SUCCESS)
+		return -1;
+
+	n = args.response_size - sizeof(*r);
+	memcpy(buf, r->data, n);
+	buf[n] = '\0';
+	*resp = r;
+	return n;
+}
+
+/* Readers each get all the output once, and don't disturb each other. */
+static int test_read_cursors(void)
+{
+	struct ec_response_console_read_v2 *r;
+	char buf[CONFIG_UART_TX_BUF_SIZE + 1];
+
+	/* Both start at the oldest output */
+	TEST_ASSERT(read_cursor("kernel", 0, buf, sizeof(buf), &r) > 0);
+	TEST_ASSERT(read_cursor("ectool", 0, buf, sizeof(buf), &r) > 0);
+
+	uart_puts("first\n");
+	cflush();
+	TEST_ASSERT(read_cursor("kernel", 0, buf, sizeof(buf), &r) >= 0);
+	TEST_ASSERT(strstr(buf, "first\r\n") != NULL);
+	TEST_ASSERT(r->pending == 0);
+
+	uart_puts("second\n");
+	cflush();
+	/* ectool hasn't read "first" yet */
+	TEST_ASSERT(read_cursor("ectool", 0, buf, sizeof(buf), &r) >= 0);
+	TEST_ASSERT(strstr(buf, "first\r\n") != NULL);
+	TEST_ASSERT(strstr(buf, "second\r\n") != NULL);
+	TEST_ASSERT(r->lost == 0);
+
+	/* The kernel reader continues where it was */
+	TEST_ASSERT(read_cursor("kernel", 0, buf, sizeof(buf), &r) >= 0);
+	TEST_ASSERT(strstr(buf, "first") == NULL);
+	TEST_ASSERT(strstr(buf, "second\r\n") != NULL);
+
+	/* Small reads return the rest as pending */
+	uart_puts("0123456789\n");
+	cflush();
+	TEST_ASSERT(read_cursor("kernel", 0, buf, 5, &r) == 4);
+	TEST_ASSERT(strncmp(buf, "0123", 4) == 0);
+	TEST_ASSERT(r->pending >= 8);
+	TEST_ASSERT(read_cursor("kernel", 0, buf, sizeof(buf), &r) >= 0);
+	TEST_ASSERT(strncmp(buf, "456789\r\n", 8) == 0);
+
+	/* A third reader takes over the least recently used cursor */
+	TEST_ASSERT(read_cursor("other", EC_CONSOLE_READ_RELEASE, buf,
+				sizeof(buf), &r) > 0);
+
+	return EC_SUCCESS;
+}
+
+/* Output overwritten before a reader got to it is counted. */
+static int test_read_cursor_lost(void)
+{
+	struct ec_response_console_read_v2 *r;
+	char buf[CONFIG_UART_TX_BUF_SIZE + 1];
+	char out[101];
+	int i;
+
+	TEST_ASSERT(read_cursor("kernel", 0, buf, sizeof(buf), &r) >= 0);
+	TEST_ASSERT(r->lost == 0);
+
+	memset(out, 'x', sizeof(out) - 1);
+	out[sizeof(out) - 1] = '\0';
+	for (i = 0; i < CONFIG_UART_TX_BUF_SIZE / 100 + 2; i++) {
+		uart_puts(out);
+		cflush();
+	}
+
+	/* One read returns all of the buffer that is left */
+	TEST_ASSERT(read_cursor("kernel", 0, buf, sizeof(buf), &r) ==
+		    CONFIG_UART_TX_BUF_SIZE - 1);
+	TEST_ASSERT(r->pending == 0);
+	TEST_ASSERT(r->lost >= (CONFIG_UART_TX_BUF_SIZE / 100 + 2) * 100 -
+		    (CONFIG_UART_TX_BUF_SIZE - 1));
+
+	return EC_SUCCESS;
+}
+
+static void put_per_char(const char *s)
+{
+	while (*s)
+		uart_putc(*s++);
+}
+
+/* Time buffering of typical console lines, with the output held. */
+static uint64_t bench(void (*put)(const char *s), int *bytes)
+{
+	uint64_t total = 0;
+	uint64_t t;
+	int batch, i;
+
+	*bytes = 0;
+	for (batch = 0; batch < BENCH_BATCHES; batch++) {
+		test_hold_uart_output(1);
+		for (i = 0; i < BENCH_BATCH; i++) {
+			t = test_bench_time_ns();
+			put(bench_lines[i]);
+			total += test_bench_time_ns() - t;
+			*bytes += strlen(bench_lines[i]);
+		}
+		test_hold_uart_output(0);
+		cflush();
+	}
+	return total;
+}
+
+static void put_bulk(const char *s)
+{
+	uart_puts(s);
+}
+
+static int test_throughput(void)
+{
+	uint64_t t_bulk, t_char;
+	int bytes;
+
+	t_char = bench(put_per_char, &bytes);
+	t_bulk = bench(put_bulk, &bytes);
+
+	ccprintf("UART buffering, %d bytes: per char %lld bytes/us, "
+		 "bulk %lld bytes/us\n", bytes,
+		 (long long)(bytes * 1000ULL / MAX(t_char, 1)),
+		 (long long)(bytes * 1000ULL / MAX(t_bulk, 1)));
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_newlines);
+	RUN_TEST(test_wrap);
+	RUN_TEST(test_overflow);
+	RUN_TEST(test_console_read_recent);
+	RUN_TEST(test_read_cursors);
+	RUN_TEST(test_read_cursor_lost);
+	RUN_TEST(test_throughput);
+
+	test_print_result();
+}
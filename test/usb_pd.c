@@ -900,6 +900,48 @@ static int test_sink(void)
 	return EC_SUCCESS;
 }
 
+/*
+ * Round-trip messages through the 4b5b encoder and decoder of the TCPC and
+ * report the time spent on each side.
+ */
+static int test_encode_decode(void)
+{
+	static const uint32_t data[7] = {
+		0x0a01912c, 0x0002d0c8, 0x0003c096, 0x0004b064,
+		0x0006404b, 0xc8dc213c, 0x12345678,
+	};
+	uint32_t payload[7];
+	uint64_t t0, t_enc = 0, t_dec = 0;
+	int i, cnt, head;
+	uint16_t header;
+
+	for (i = 0; i < 1000; i++) {
+		/* Alternate between a control and a 7-object data message */
+		cnt = (i & 1) ? 7 : 0;
+		header = PD_HEADER(cnt ? PD_DATA_SOURCE_CAP : PD_CTRL_GOOD_CRC,
+				   PD_ROLE_SOURCE, PD_ROLE_DFP, i % 8, cnt,
+				   pd_port[PORT0].rev, 0);
+
+		pd_tx_done(PORT0, 0);
+		t0 = test_bench_time_ns();
+		prepare_message(PORT0, header, cnt, data);
+		t_enc += test_bench_time_ns() - t0;
+
+		pd_test_rx_msg_from_tx(PORT0);
+		t0 = test_bench_time_ns();
+		head = pd_analyze_rx(PORT0, payload);
+		t_dec += test_bench_time_ns() - t0;
+
+		TEST_ASSERT((head & 0xFFFF) == header);
+		TEST_ASSERT_ARRAY_EQ(payload, data, cnt);
+	}
+	pd_tx_done(PORT0, 0);
+
+	ccprintf("PD per message: encode %lld ns, decode %lld ns\n",
+		 (long long)(t_enc / 1000), (long long)(t_dec / 1000));
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, char **argv)
 {
 	test_reset();
@@ -907,6 +949,7 @@ void run_test(int argc, char **argv)
 	pd_set_dual_role(PORT0, PD_DRP_TOGGLE_ON);
 	pd_set_dual_role(PORT1, PD_DRP_TOGGLE_ON);
 
+	RUN_TEST(test_encode_decode);
 	RUN_TEST(test_request);
 	RUN_TEST(test_sink);
 	RUN_TEST(test_request_with_wait);
@@ -19,6 +19,7 @@ void pd_test_rx_msg_append_last_edge(int port);
 void pd_test_rx_msg_append_4b(int port, uint8_t val);
 void pd_test_rx_msg_append_short(int port, uint16_t val);
 void pd_test_rx_msg_append_word(int port, uint32_t val);
+void pd_test_rx_msg_from_tx(int port);
 void pd_simulate_rx(int port);
 
 /* Verify Tx message */
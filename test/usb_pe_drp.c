@@ -34,7 +34,7 @@ const struct usb_mux usb_muxes[CONFIG_USB_PD_PORT_MAX_COUNT] = {
 	}
 };
 
-void before_test(void)
+static void reset_port(void)
 {
 	mock_tc_port_reset();
 	mock_tcpc_reset();
@@ -49,6 +49,12 @@ void before_test(void)
 	task_wait_event(SECOND);
 }
 
+void before_test(void)
+{
+	pd_discovery_cache_clear();
+	reset_port();
+}
+
 test_static int test_send_caps_error(void)
 {
 	/* Enable PE as source, expect SOURCE_CAP. */
@@ -133,11 +139,145 @@ test_static int test_send_caps_error(void)
 	return EC_SUCCESS;
 }
 
+/* Discover Identity ACK of the partner used for discovery tests */
+static const uint32_t partner_identity[] = {
+	VDO_IDH(0, 1, IDH_PTYPE_HUB, 1, USB_VID_GOOGLE),
+	VDO_CSTAT(0x1234),
+	VDO_PRODUCT(0x5678, 0x0100),
+};
+
+static void rx_vdm_ack(int msg_id, uint16_t svid, int cmd,
+		       const uint32_t *vdos, int vdo_cnt)
+{
+	uint32_t *payload = (uint32_t *)rx_emsg[PORT0].buf;
+
+	rx_emsg[PORT0].header = PD_HEADER(PD_DATA_VENDOR_DEF, PD_ROLE_SINK,
+			PD_ROLE_UFP, msg_id, vdo_cnt + 1, PD_REV30, 0);
+	rx_emsg[PORT0].len = (vdo_cnt + 1) * sizeof(uint32_t);
+	payload[0] = VDO(svid, 1, VDO_SVDM_VERS(VDM_VER20) |
+			 VDO_CMDT(CMDT_RSP_ACK) | cmd);
+	memcpy(payload + 1, vdos, vdo_cnt * sizeof(uint32_t));
+	fake_prl_message_received(PORT0);
+}
+
+/*
+ * Attach as source to a partner supporting DisplayPort, answer everything
+ * the PE sends until it goes quiet, and count the messages exchanged.
+ */
+static int attach_and_discover(int *msg_count)
+{
+	const uint32_t svids[] = { VDO_SVID(USB_SID_DISPLAYPORT, 0) };
+	const uint32_t modes[] = {
+		VDO_MODE_DP(MODE_DP_PIN_C, 0, 1, CABLE_RECEPTACLE,
+			    MODE_DP_V13, MODE_DP_SNK),
+	};
+	int msg_id = 0;
+	int i;
+
+	*msg_count = 0;
+
+	mock_pd_port[PORT0].power_role = PD_ROLE_SOURCE;
+	mock_tc_port[PORT0].pd_enable = 1;
+	task_wait_event(10 * MSEC);
+	TEST_EQ(fake_prl_get_last_sent_data_msg_type(PORT0),
+		PD_DATA_SOURCE_CAP, "%d");
+	fake_prl_message_sent(PORT0);
+	task_wait_event(10 * MSEC);
+
+	rx_emsg[PORT0].header = PD_HEADER(PD_DATA_REQUEST, PD_ROLE_SINK,
+			PD_ROLE_UFP, msg_id++, 1, PD_REV30, 0);
+	rx_emsg[PORT0].len = 4;
+	*(uint32_t *)rx_emsg[PORT0].buf = RDO_FIXED(1, 500, 500, 0);
+	fake_prl_message_received(PORT0);
+	task_wait_event(10 * MSEC);
+	TEST_EQ(fake_prl_get_last_sent_ctrl_msg(PORT0),
+		PD_CTRL_ACCEPT, "%d");
+	fake_prl_message_sent(PORT0);
+	task_wait_event(10 * MSEC);
+	TEST_EQ(fake_prl_get_last_sent_ctrl_msg(PORT0),
+		PD_CTRL_PS_RDY, "%d");
+	fake_prl_message_sent(PORT0);
+	task_wait_event(30 * MSEC);
+
+	for (i = 0; i < 20; i++) {
+		const uint32_t *vdm = (const uint32_t *)tx_emsg[PORT0].buf;
+		enum pd_data_msg_type data;
+		enum pd_ctrl_msg_type ctrl;
+
+		data = fake_prl_get_last_sent_data_msg_type(PORT0);
+		ctrl = fake_prl_get_last_sent_ctrl_msg(PORT0);
+		if (!data && !ctrl) {
+			task_wait_event(100 * MSEC);
+			continue;
+		}
+
+		(*msg_count)++;
+		fake_prl_message_sent(PORT0);
+		task_wait_event(10 * MSEC);
+
+		if (data == PD_DATA_VENDOR_DEF &&
+		    PD_VDO_CMD(vdm[0]) == CMD_DISCOVER_IDENT) {
+			rx_vdm_ack(msg_id++, USB_SID_PD, CMD_DISCOVER_IDENT,
+				   partner_identity,
+				   ARRAY_SIZE(partner_identity));
+		} else if (data == PD_DATA_VENDOR_DEF &&
+			   PD_VDO_CMD(vdm[0]) == CMD_DISCOVER_SVID) {
+			rx_vdm_ack(msg_id++, USB_SID_PD, CMD_DISCOVER_SVID,
+				   svids, ARRAY_SIZE(svids));
+		} else if (data == PD_DATA_VENDOR_DEF &&
+			   PD_VDO_CMD(vdm[0]) == CMD_DISCOVER_MODES) {
+			rx_vdm_ack(msg_id++, USB_SID_DISPLAYPORT,
+				   CMD_DISCOVER_MODES, modes,
+				   ARRAY_SIZE(modes));
+		} else {
+			rx_emsg[PORT0].header = PD_HEADER(
+					PD_CTRL_NOT_SUPPORTED, PD_ROLE_SINK,
+					PD_ROLE_UFP, msg_id++, 0, PD_REV30, 0);
+			rx_emsg[PORT0].len = 0;
+			fake_prl_message_received(PORT0);
+		}
+		(*msg_count)++;
+		task_wait_event(30 * MSEC);
+	}
+
+	TEST_EQ(pd_get_identity_discovery(PORT0, TCPC_TX_SOP),
+		PD_DISC_COMPLETE, "%d");
+	TEST_EQ(pd_get_svids_discovery(PORT0, TCPC_TX_SOP),
+		PD_DISC_COMPLETE, "%d");
+	TEST_EQ(pd_get_modes_discovery(PORT0, TCPC_TX_SOP),
+		PD_DISC_COMPLETE, "%d");
+	TEST_EQ(pd_get_svid_count(PORT0, TCPC_TX_SOP), 1, "%d");
+	TEST_EQ(pd_get_svid(PORT0, 0, TCPC_TX_SOP), USB_SID_DISPLAYPORT,
+		"0x%x");
+	TEST_EQ(*pd_get_mode_vdo(PORT0, 0, TCPC_TX_SOP), modes[0], "0x%x");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_discovery_cache(void)
+{
+	int first_count, cached_count;
+
+	TEST_EQ(attach_and_discover(&first_count), EC_SUCCESS, "%d");
+
+	/* Detach, and attach the same partner again. */
+	reset_port();
+	TEST_EQ(attach_and_discover(&cached_count), EC_SUCCESS, "%d");
+
+	ccprints("Messages exchanged: %d on first attach, %d when cached",
+		 first_count, cached_count);
+	/* Discover SVIDs and Discover Modes, with their ACKs, are skipped. */
+	TEST_EQ(cached_count, first_count - 4, "%d");
+
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, char **argv)
 {
 	test_reset();
 
 	RUN_TEST(test_send_caps_error);
+	RUN_TEST(test_discovery_cache);
 
 	/* Do basic state machine validity checks last. */
 	RUN_TEST(test_pe_no_parent_cycles);
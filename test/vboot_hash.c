@@ -0,0 +1,269 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test the vboot hash.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "flash.h"
+#include "host_command.h"
+#include "sha256.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+#include "vboot_hash.h"
+
+/* A region of flash which is not a multiple of the chunk size */
+#define DATA_OFFSET (CONFIG_FLASH_SIZE / 2)
+#define DATA_SIZE (CONFIG_FLASH_SIZE / 2 - 0x123)
+
+extern char __host_flash[CONFIG_FLASH_SIZE];
+
+static const uint8_t nonce[] = { 0xde, 0xad, 0xbe, 0xef };
+
+static void expected_hash(uint8_t *digest, int nonce_size)
+{
+	struct sha256_ctx ctx;
+
+	SHA256_init(&ctx);
+	SHA256_update(&ctx, nonce, nonce_size);
+	SHA256_update(&ctx, (const uint8_t *)__host_flash + DATA_OFFSET,
+		      DATA_SIZE);
+	memcpy(digest, SHA256_final(&ctx), SHA256_DIGEST_SIZE);
+}
+
+/* SHA-256 of the digests of each block, after the nonce */
+static void expected_tree_hash(uint8_t *digest, int nonce_size)
+{
+	struct sha256_ctx ctx, block_ctx;
+	int i;
+
+	SHA256_init(&ctx);
+	SHA256_update(&ctx, nonce, nonce_size);
+	for (i = 0; i < DATA_SIZE; i += EC_VBOOT_HASH_TREE_BLOCK_SIZE) {
+		SHA256_init(&block_ctx);
+		SHA256_update(&block_ctx,
+			      (const uint8_t *)__host_flash + DATA_OFFSET + i,
+			      MIN(DATA_SIZE - i,
+				  EC_VBOOT_HASH_TREE_BLOCK_SIZE));
+		SHA256_update(&ctx, SHA256_final(&block_ctx),
+			      SHA256_DIGEST_SIZE);
+	}
+	memcpy(digest, SHA256_final(&ctx), SHA256_DIGEST_SIZE);
+}
+
+static int hash_cmd(int cmd, int type, int nonce_size,
+		    struct ec_response_vboot_hash *r)
+{
+	struct ec_params_vboot_hash p = {
+		.cmd = cmd,
+		.hash_type = type,
+		.nonce_size = nonce_size,
+		.offset = DATA_OFFSET,
+		.size = DATA_SIZE,
+	};
+
+	memcpy(p.nonce_data, nonce, nonce_size);
+	return test_send_host_command(EC_CMD_VBOOT_HASH, 0, &p, sizeof(p),
+				      r, sizeof(*r));
+}
+
+static int vboot_hash_cmd(int cmd, int nonce_size,
+			  struct ec_response_vboot_hash *r)
+{
+	return hash_cmd(cmd, EC_VBOOT_HASH_TYPE_SHA256, nonce_size, r);
+}
+
+/* Wait for the hash started by the caller; return the time it took. */
+static uint64_t wait_hash(void)
+{
+	uint64_t t = test_bench_time_ns();
+	int i;
+
+	for (i = 0; i < 10000 && vboot_hash_in_progress(); i++)
+		usleep(100);
+	return test_bench_time_ns() - t;
+}
+
+static int test_deferred(void)
+{
+	struct ec_response_vboot_hash r;
+	uint8_t digest[SHA256_DIGEST_SIZE];
+
+	TEST_ASSERT(vboot_hash_cmd(EC_VBOOT_HASH_START, sizeof(nonce), &r) ==
+		    EC_RES_SUCCESS);
+	TEST_EQ(r.status, EC_VBOOT_HASH_STATUS_BUSY, "%d");
+	wait_hash();
+
+	TEST_ASSERT(vboot_hash_cmd(EC_VBOOT_HASH_GET, 0, &r) ==
+		    EC_RES_SUCCESS);
+	TEST_EQ(r.status, EC_VBOOT_HASH_STATUS_DONE, "%d");
+	TEST_EQ(r.offset, DATA_OFFSET, "%d");
+	TEST_EQ(r.size, DATA_SIZE, "%d");
+	expected_hash(digest, sizeof(nonce));
+	TEST_ASSERT_ARRAY_EQ(r.hash_digest, digest, SHA256_DIGEST_SIZE);
+
+	return EC_SUCCESS;
+}
+
+static int test_recalc(void)
+{
+	struct ec_response_vboot_hash r;
+	uint8_t digest[SHA256_DIGEST_SIZE];
+
+	TEST_ASSERT(vboot_hash_cmd(EC_VBOOT_HASH_RECALC, 0, &r) ==
+		    EC_RES_SUCCESS);
+	TEST_EQ(r.status, EC_VBOOT_HASH_STATUS_DONE, "%d");
+	expected_hash(digest, 0);
+	TEST_ASSERT_ARRAY_EQ(r.hash_digest, digest, SHA256_DIGEST_SIZE);
+
+	return EC_SUCCESS;
+}
+
+static int test_abort(void)
+{
+	struct ec_response_vboot_hash r;
+
+	TEST_ASSERT(vboot_hash_cmd(EC_VBOOT_HASH_START, 0, &r) ==
+		    EC_RES_SUCCESS);
+	TEST_ASSERT(vboot_hash_cmd(EC_VBOOT_HASH_ABORT, 0, &r) ==
+		    EC_RES_SUCCESS);
+	wait_hash();
+
+	TEST_ASSERT(vboot_hash_cmd(EC_VBOOT_HASH_GET, 0, &r) ==
+		    EC_RES_SUCCESS);
+	TEST_EQ(r.status, EC_VBOOT_HASH_STATUS_NONE, "%d");
+
+	/* A new hash may start after an abort */
+	return test_recalc();
+}
+
+/* The deferred hash gets close to the speed of hashing in one go. */
+static int test_throughput(void)
+{
+	struct ec_response_vboot_hash r;
+	uint8_t digest[SHA256_DIGEST_SIZE];
+	uint64_t t_raw, t_hash;
+
+	t_raw = test_bench_time_ns();
+	expected_hash(digest, 0);
+	t_raw = test_bench_time_ns() - t_raw;
+
+	TEST_ASSERT(vboot_hash_cmd(EC_VBOOT_HASH_START, 0, &r) ==
+		    EC_RES_SUCCESS);
+	t_hash = wait_hash();
+
+	ccprintf("%d bytes: SHA-256 %lld bytes/us, vboot hash %lld bytes/us\n",
+		 DATA_SIZE, (long long)(DATA_SIZE * 1000ULL / MAX(t_raw, 1)),
+		 (long long)(DATA_SIZE * 1000ULL / MAX(t_hash, 1)));
+
+	TEST_ASSERT(vboot_hash_cmd(EC_VBOOT_HASH_GET, 0, &r) ==
+		    EC_RES_SUCCESS);
+	TEST_ASSERT_ARRAY_EQ(r.hash_digest, digest, SHA256_DIGEST_SIZE);
+
+	return EC_SUCCESS;
+}
+
+static int test_tree(void)
+{
+	struct ec_response_vboot_hash r;
+	uint8_t digest[SHA256_DIGEST_SIZE];
+
+	TEST_ASSERT(hash_cmd(EC_VBOOT_HASH_RECALC,
+			     EC_VBOOT_HASH_TYPE_SHA256_TREE, sizeof(nonce),
+			     &r) == EC_RES_SUCCESS);
+	TEST_EQ(r.status, EC_VBOOT_HASH_STATUS_DONE, "%d");
+	TEST_EQ(r.hash_type, EC_VBOOT_HASH_TYPE_SHA256_TREE, "%d");
+	TEST_EQ(r.size, DATA_SIZE, "%d");
+	expected_tree_hash(digest, sizeof(nonce));
+	TEST_ASSERT_ARRAY_EQ(r.hash_digest, digest, SHA256_DIGEST_SIZE);
+
+	/* Unknown types are rejected */
+	TEST_ASSERT(hash_cmd(EC_VBOOT_HASH_RECALC, 2, 0, &r) ==
+		    EC_RES_INVALID_PARAM);
+
+	return EC_SUCCESS;
+}
+
+/* After a write, only the blocks written are hashed again. */
+static int test_tree_write(void)
+{
+	struct ec_response_vboot_hash r;
+	uint8_t digest[SHA256_DIGEST_SIZE];
+	struct ec_params_vboot_hash p = {
+		.cmd = EC_VBOOT_HASH_RECALC,
+		.hash_type = EC_VBOOT_HASH_TYPE_SHA256_TREE,
+		.offset = DATA_OFFSET,
+		.size = EC_VBOOT_HASH_TREE_BLOCK_SIZE,
+	};
+	const char data[] = { 0x12, 0x34, 0x56, 0x78 };
+	uint64_t t_full, t_write;
+
+	/* A different nonce doesn't need the blocks hashed again */
+	TEST_ASSERT(hash_cmd(EC_VBOOT_HASH_RECALC,
+			     EC_VBOOT_HASH_TYPE_SHA256_TREE, 0, &r) ==
+		    EC_RES_SUCCESS);
+	expected_tree_hash(digest, 0);
+	TEST_ASSERT_ARRAY_EQ(r.hash_digest, digest, SHA256_DIGEST_SIZE);
+
+	/* Hashing another region first drops the block digests */
+	TEST_ASSERT(test_send_host_command(EC_CMD_VBOOT_HASH, 0, &p, sizeof(p),
+					   &r, sizeof(r)) == EC_RES_SUCCESS);
+	t_full = test_bench_time_ns();
+	TEST_ASSERT(hash_cmd(EC_VBOOT_HASH_RECALC,
+			     EC_VBOOT_HASH_TYPE_SHA256_TREE, 0, &r) ==
+		    EC_RES_SUCCESS);
+	t_full = test_bench_time_ns() - t_full;
+
+	/* A write straddling two blocks invalidates the hash */
+	TEST_ASSERT(flash_write(DATA_OFFSET + EC_VBOOT_HASH_TREE_BLOCK_SIZE * 3 -
+				2, sizeof(data), data) == EC_SUCCESS);
+	TEST_ASSERT(hash_cmd(EC_VBOOT_HASH_GET,
+			     EC_VBOOT_HASH_TYPE_SHA256_TREE, 0, &r) ==
+		    EC_RES_SUCCESS);
+	TEST_EQ(r.status, EC_VBOOT_HASH_STATUS_NONE, "%d");
+
+	t_write = test_bench_time_ns();
+	TEST_ASSERT(hash_cmd(EC_VBOOT_HASH_RECALC,
+			     EC_VBOOT_HASH_TYPE_SHA256_TREE, 0, &r) ==
+		    EC_RES_SUCCESS);
+	t_write = test_bench_time_ns() - t_write;
+	expected_tree_hash(digest, 0);
+	TEST_ASSERT_ARRAY_EQ(r.hash_digest, digest, SHA256_DIGEST_SIZE);
+
+	/* The plain SHA-256 of the new data is still there */
+	TEST_ASSERT(vboot_hash_cmd(EC_VBOOT_HASH_RECALC, 0, &r) ==
+		    EC_RES_SUCCESS);
+	expected_hash(digest, 0);
+	TEST_ASSERT_ARRAY_EQ(r.hash_digest, digest, SHA256_DIGEST_SIZE);
+
+	ccprintf("Tree hash: %lld us in full, %lld us after a write\n",
+		 (long long)t_full / 1000, (long long)t_write / 1000);
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	int i;
+
+	test_reset();
+
+	for (i = 0; i < DATA_SIZE; i++)
+		__host_flash[DATA_OFFSET + i] = i * 7 ^ i >> 8;
+
+	/* Let the hash started at boot finish */
+	wait_hash();
+
+	RUN_TEST(test_deferred);
+	RUN_TEST(test_recalc);
+	RUN_TEST(test_abort);
+	RUN_TEST(test_throughput);
+	RUN_TEST(test_tree);
+	RUN_TEST(test_tree_write);
+
+	test_print_result();
+}
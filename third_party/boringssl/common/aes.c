@@ -739,6 +739,132 @@ void aes_nohw_encrypt(const uint8_t *in, uint8_t *out,
   PUTU32(out + 12, s3);
 }
 
+// AES_CTR_LANES is the number of blocks aes_nohw_encrypt_lanes works on at
+// once.
+#define AES_CTR_LANES 4
+
+// aes_nohw_encrypt_lanes runs the rounds of AES_CTR_LANES blocks side by side,
+// from |s|, which already has the initial round key added, and writes them to
+// |out|. Each round key is loaded once for all the blocks, and the table
+// lookups of one block don't depend on those of the next, so they overlap.
+static void aes_nohw_encrypt_lanes(uint32_t s[4 * AES_CTR_LANES],
+                                   uint8_t out[16 * AES_CTR_LANES],
+                                   const AES_KEY *key) {
+  const uint32_t *rk = key->rd_key;
+  uint32_t t[4 * AES_CTR_LANES];
+  uint32_t k0, k1, k2, k3;
+  int r, b;
+
+  // Nr - 1 full rounds:
+  r = key->rounds >> 1;
+  for (;;) {
+    k0 = rk[4];
+    k1 = rk[5];
+    k2 = rk[6];
+    k3 = rk[7];
+    for (b = 0; b < 4 * AES_CTR_LANES; b += 4) {
+      t[b] = Te0[(s[b] >> 24)] ^ Te1[(s[b + 1] >> 16) & 0xff] ^
+             Te2[(s[b + 2] >> 8) & 0xff] ^ Te3[(s[b + 3]) & 0xff] ^ k0;
+      t[b + 1] = Te0[(s[b + 1] >> 24)] ^ Te1[(s[b + 2] >> 16) & 0xff] ^
+                 Te2[(s[b + 3] >> 8) & 0xff] ^ Te3[(s[b]) & 0xff] ^ k1;
+      t[b + 2] = Te0[(s[b + 2] >> 24)] ^ Te1[(s[b + 3] >> 16) & 0xff] ^
+                 Te2[(s[b] >> 8) & 0xff] ^ Te3[(s[b + 1]) & 0xff] ^ k2;
+      t[b + 3] = Te0[(s[b + 3] >> 24)] ^ Te1[(s[b] >> 16) & 0xff] ^
+                 Te2[(s[b + 1] >> 8) & 0xff] ^ Te3[(s[b + 2]) & 0xff] ^ k3;
+    }
+
+    rk += 8;
+    if (--r == 0) {
+      break;
+    }
+
+    k0 = rk[0];
+    k1 = rk[1];
+    k2 = rk[2];
+    k3 = rk[3];
+    for (b = 0; b < 4 * AES_CTR_LANES; b += 4) {
+      s[b] = Te0[(t[b] >> 24)] ^ Te1[(t[b + 1] >> 16) & 0xff] ^
+             Te2[(t[b + 2] >> 8) & 0xff] ^ Te3[(t[b + 3]) & 0xff] ^ k0;
+      s[b + 1] = Te0[(t[b + 1] >> 24)] ^ Te1[(t[b + 2] >> 16) & 0xff] ^
+                 Te2[(t[b + 3] >> 8) & 0xff] ^ Te3[(t[b]) & 0xff] ^ k1;
+      s[b + 2] = Te0[(t[b + 2] >> 24)] ^ Te1[(t[b + 3] >> 16) & 0xff] ^
+                 Te2[(t[b] >> 8) & 0xff] ^ Te3[(t[b + 1]) & 0xff] ^ k2;
+      s[b + 3] = Te0[(t[b + 3] >> 24)] ^ Te1[(t[b] >> 16) & 0xff] ^
+                 Te2[(t[b + 1] >> 8) & 0xff] ^ Te3[(t[b + 2]) & 0xff] ^ k3;
+    }
+  }
+
+  //  apply last round and map cipher state to byte array block:
+  k0 = rk[0];
+  k1 = rk[1];
+  k2 = rk[2];
+  k3 = rk[3];
+  for (b = 0; b < 4 * AES_CTR_LANES; b += 4) {
+    PUTU32(out + 4 * b,
+           (Te2[(t[b] >> 24)] & 0xff000000) ^
+           (Te3[(t[b + 1] >> 16) & 0xff] & 0x00ff0000) ^
+           (Te0[(t[b + 2] >> 8) & 0xff] & 0x0000ff00) ^
+           (Te1[(t[b + 3]) & 0xff] & 0x000000ff) ^ k0);
+    PUTU32(out + 4 * b + 4,
+           (Te2[(t[b + 1] >> 24)] & 0xff000000) ^
+           (Te3[(t[b + 2] >> 16) & 0xff] & 0x00ff0000) ^
+           (Te0[(t[b + 3] >> 8) & 0xff] & 0x0000ff00) ^
+           (Te1[(t[b]) & 0xff] & 0x000000ff) ^ k1);
+    PUTU32(out + 4 * b + 8,
+           (Te2[(t[b + 2] >> 24)] & 0xff000000) ^
+           (Te3[(t[b + 3] >> 16) & 0xff] & 0x00ff0000) ^
+           (Te0[(t[b] >> 8) & 0xff] & 0x0000ff00) ^
+           (Te1[(t[b + 1]) & 0xff] & 0x000000ff) ^ k2);
+    PUTU32(out + 4 * b + 12,
+           (Te2[(t[b + 3] >> 24)] & 0xff000000) ^
+           (Te3[(t[b] >> 16) & 0xff] & 0x00ff0000) ^
+           (Te0[(t[b + 1] >> 8) & 0xff] & 0x0000ff00) ^
+           (Te1[(t[b + 2]) & 0xff] & 0x000000ff) ^ k3);
+  }
+}
+
+void aes_nohw_ctr32_encrypt_blocks(const uint8_t *in, uint8_t *out,
+                                   size_t blocks, const AES_KEY *key,
+                                   const uint8_t ivec[16]) {
+  const uint32_t *rk = key->rd_key;
+  uint32_t s[4 * AES_CTR_LANES];
+  uint32_t ks[4 * AES_CTR_LANES];
+  uint32_t s0, s1, s2, ctr;
+  size_t n, i;
+  int b;
+
+  // Only the last word of the counter block changes, so the initial round
+  // key is added to the first three once, for all the blocks.
+  s0 = GETU32(ivec) ^ rk[0];
+  s1 = GETU32(ivec + 4) ^ rk[1];
+  s2 = GETU32(ivec + 8) ^ rk[2];
+  ctr = GETU32(ivec + 12);
+
+  while (blocks) {
+    for (b = 0; b < 4 * AES_CTR_LANES; b += 4) {
+      s[b] = s0;
+      s[b + 1] = s1;
+      s[b + 2] = s2;
+      s[b + 3] = ctr++ ^ rk[3];
+    }
+    aes_nohw_encrypt_lanes(s, (uint8_t *)ks, key);
+
+    n = blocks < AES_CTR_LANES ? blocks : AES_CTR_LANES;
+    if ((((uintptr_t)in | (uintptr_t)out) & 3) == 0) {
+      for (i = 0; i < 4 * n; i++) {
+        ((uint32_t *)out)[i] = ((const uint32_t *)in)[i] ^ ks[i];
+      }
+    } else {
+      for (i = 0; i < 16 * n; i++) {
+        out[i] = in[i] ^ ((const uint8_t *)ks)[i];
+      }
+    }
+    in += 16 * n;
+    out += 16 * n;
+    blocks -= n;
+  }
+}
+
 void aes_nohw_decrypt(const uint8_t *in, uint8_t *out,
 		      const AES_KEY *key) {
   const uint32_t *rk;
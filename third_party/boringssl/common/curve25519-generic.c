@@ -819,3 +819,257 @@ void x25519_scalar_mult(uint8_t out[32],
   fe_mul(x2, x2, z2);
   fe_tobytes(out, x2);
 }
+
+#ifdef CONFIG_CURVE25519_BASE_TABLE
+/*
+ * Fixed-base scalar multiplication, with a table of multiples of the base
+ * point. This works on the twisted Edwards form of the curve, where points can
+ * be added, and converts the result to the Montgomery u coordinate.
+ *
+ * The scalar is taken as 64 signed digits in [-8, 8], and the digits are split
+ * into CONFIG_CURVE25519_BASE_TABLE passes, interleaved: pass p takes digits
+ * p, p + passes, p + 2 * passes... Each table row holds 1 to 8 times
+ * 16^(passes * i) * B, so within a pass a digit is one addition from a table
+ * row, and passes are four doublings apart. More passes mean a smaller table
+ * and more doublings.
+ */
+
+#if CONFIG_CURVE25519_BASE_TABLE != 2 && CONFIG_CURVE25519_BASE_TABLE != 4 && \
+	CONFIG_CURVE25519_BASE_TABLE != 8 && CONFIG_CURVE25519_BASE_TABLE != 16
+#error "CONFIG_CURVE25519_BASE_TABLE must be 2, 4, 8 or 16"
+#endif
+
+/* ge means group element: (X:Y:Z:T) with x=X/Z, y=Y/Z, x*y=T/Z. */
+typedef struct {
+  fe X;
+  fe Y;
+  fe Z;
+} ge_p2;
+
+typedef struct {
+  fe X;
+  fe Y;
+  fe Z;
+  fe T;
+} ge_p3;
+
+/* ((X:Z),(Y:T)) with x=X/Z, y=Y/T */
+typedef struct {
+  fe X;
+  fe Y;
+  fe Z;
+  fe T;
+} ge_p1p1;
+
+typedef struct {
+  fe yplusx;
+  fe yminusx;
+  fe xy2d;
+} ge_precomp;
+
+#define CURVE25519_BASE_TABLE_STRIDE (CONFIG_CURVE25519_BASE_TABLE / 2)
+#define CURVE25519_BASE_TABLE_ROWS (64 / CONFIG_CURVE25519_BASE_TABLE)
+
+#include "curve25519-base-table.h"
+
+BUILD_ASSERT(ARRAY_SIZE(k25519BaseTable) == CURVE25519_BASE_TABLE_ROWS);
+
+/* h = -f */
+static void fe_neg(fe h, const fe f) {
+  unsigned i;
+  for (i = 0; i < 10; i++) {
+    h[i] = -f[i];
+  }
+}
+
+/* Replace f with g if b == 1; keep f if b == 0, in constant time.
+ *
+ * Preconditions: b in {0,1}. */
+static void fe_cmov(fe f, const fe g, unsigned int b) {
+  unsigned i;
+  b = 0-b;
+  for (i = 0; i < 10; i++) {
+    int32_t x = f[i] ^ g[i];
+    x &= b;
+    f[i] ^= x;
+  }
+}
+
+/* h = 2 * f * f
+ *
+ * Preconditions:
+ *    |f| bounded by 1.1*2^25,1.1*2^24,1.1*2^25,1.1*2^24,etc.
+ */
+static void fe_sq2(fe h, const fe f) {
+  fe f2;
+  fe_add(f2, f, f);
+  fe_mul(h, f2, f);
+}
+
+static void ge_p3_0(ge_p3 *h) {
+  fe_0(h->X);
+  fe_1(h->Y);
+  fe_1(h->Z);
+  fe_0(h->T);
+}
+
+static void ge_p3_to_p2(ge_p2 *r, const ge_p3 *p) {
+  fe_copy(r->X, p->X);
+  fe_copy(r->Y, p->Y);
+  fe_copy(r->Z, p->Z);
+}
+
+static void ge_p1p1_to_p2(ge_p2 *r, const ge_p1p1 *p) {
+  fe_mul(r->X, p->X, p->T);
+  fe_mul(r->Y, p->Y, p->Z);
+  fe_mul(r->Z, p->Z, p->T);
+}
+
+static void ge_p1p1_to_p3(ge_p3 *r, const ge_p1p1 *p) {
+  fe_mul(r->X, p->X, p->T);
+  fe_mul(r->Y, p->Y, p->Z);
+  fe_mul(r->Z, p->Z, p->T);
+  fe_mul(r->T, p->X, p->Y);
+}
+
+/* r = 2 * p */
+static void ge_p2_dbl(ge_p1p1 *r, const ge_p2 *p) {
+  fe t0;
+
+  fe_sq(r->X, p->X);
+  fe_sq(r->Z, p->Y);
+  fe_sq2(r->T, p->Z);
+  fe_add(r->Y, p->X, p->Y);
+  fe_sq(t0, r->Y);
+  fe_add(r->Y, r->Z, r->X);
+  fe_sub(r->Z, r->Z, r->X);
+  fe_sub(r->X, t0, r->Y);
+  fe_sub(r->T, r->T, r->Z);
+}
+
+/* r = p + q */
+static void ge_madd(ge_p1p1 *r, const ge_p3 *p, const ge_precomp *q) {
+  fe t0;
+
+  fe_add(r->X, p->Y, p->X);
+  fe_sub(r->Y, p->Y, p->X);
+  fe_mul(r->Z, r->X, q->yplusx);
+  fe_mul(r->Y, r->Y, q->yminusx);
+  fe_mul(r->T, q->xy2d, p->T);
+  fe_add(t0, p->Z, p->Z);
+  fe_sub(r->X, r->Z, r->Y);
+  fe_add(r->Y, r->Z, r->Y);
+  fe_add(r->Z, t0, r->T);
+  fe_sub(r->T, t0, r->T);
+}
+
+static void ge_precomp_0(ge_precomp *h) {
+  fe_1(h->yplusx);
+  fe_1(h->yminusx);
+  fe_0(h->xy2d);
+}
+
+static void cmov(ge_precomp *t, const ge_precomp *u, unsigned int b) {
+  fe_cmov(t->yplusx, u->yplusx, b);
+  fe_cmov(t->yminusx, u->yminusx, b);
+  fe_cmov(t->xy2d, u->xy2d, b);
+}
+
+/* Return 1 if b == c, 0 otherwise, without branches. */
+static unsigned int equal(int8_t b, int8_t c) {
+  uint8_t ub = b;
+  uint8_t uc = c;
+  uint8_t x = ub ^ uc;  /* 0: yes; 1..255: no */
+  uint32_t y = x;       /* 0: yes; 1..255: no */
+  y -= 1;               /* 4294967295: yes; 0..254: no */
+  y >>= 31;             /* 1: yes; 0: no */
+  return y;
+}
+
+/*
+ * Set t to b times row pos of the table, reading every entry of the row so
+ * that the time and memory accesses don't depend on b.
+ *
+ * Preconditions: b in [-8, 8].
+ */
+static void table_select(ge_precomp *t, int pos, int8_t b) {
+  ge_precomp minust;
+  unsigned int bnegative = (uint8_t)b >> 7;
+  int8_t babs = b - (((-bnegative) & b) << 1);
+  int i;
+
+  ge_precomp_0(t);
+  for (i = 0; i < 8; i++) {
+    cmov(t, &k25519BaseTable[pos][i], equal(babs, i + 1));
+  }
+  fe_copy(minust.yplusx, t->yminusx);
+  fe_copy(minust.yminusx, t->yplusx);
+  fe_neg(minust.xy2d, t->xy2d);
+  cmov(t, &minust, bnegative);
+}
+
+void x25519_scalar_mult_base(uint8_t out[32], const uint8_t scalar[32]) {
+  uint8_t a[32];
+  int8_t e[64];
+  int8_t carry;
+  ge_p1p1 r;
+  ge_p2 s;
+  ge_p3 h;
+  ge_precomp t;
+  fe zplusy, zminusy;
+  int i, pass;
+
+  memcpy(a, scalar, 32);
+  a[0] &= 248;
+  a[31] &= 127;
+  a[31] |= 64;
+
+  for (i = 0; i < 32; ++i) {
+    e[2 * i + 0] = (a[i] >> 0) & 15;
+    e[2 * i + 1] = (a[i] >> 4) & 15;
+  }
+  /* each e[i] is between 0 and 15 */
+  /* e[63] is between 0 and 7 */
+
+  carry = 0;
+  for (i = 0; i < 63; ++i) {
+    e[i] += carry;
+    carry = e[i] + 8;
+    carry >>= 4;
+    e[i] -= carry << 4;
+  }
+  e[63] += carry;
+  /* each e[i] is between -8 and 8 */
+
+  ge_p3_0(&h);
+  for (pass = CONFIG_CURVE25519_BASE_TABLE - 1; pass >= 0; pass--) {
+    if (pass != CONFIG_CURVE25519_BASE_TABLE - 1) {
+      /* h = 16 * h */
+      ge_p3_to_p2(&s, &h);
+      ge_p2_dbl(&r, &s);
+      ge_p1p1_to_p2(&s, &r);
+      ge_p2_dbl(&r, &s);
+      ge_p1p1_to_p2(&s, &r);
+      ge_p2_dbl(&r, &s);
+      ge_p1p1_to_p2(&s, &r);
+      ge_p2_dbl(&r, &s);
+      ge_p1p1_to_p3(&h, &r);
+    }
+    for (i = 0; i < CURVE25519_BASE_TABLE_ROWS; i++) {
+      table_select(&t, i, e[i * CONFIG_CURVE25519_BASE_TABLE + pass]);
+      ge_madd(&r, &h, &t);
+      ge_p1p1_to_p3(&h, &r);
+    }
+  }
+
+  /*
+   * The Montgomery u coordinate is (1 + y) / (1 - y) = (Z + Y) / (Z - Y).
+   * The identity, where Z = Y, gives 0, as the ladder does.
+   */
+  fe_add(zplusy, h.Z, h.Y);
+  fe_sub(zminusy, h.Z, h.Y);
+  fe_invert(zminusy, zminusy);
+  fe_mul(zplusy, zplusy, zminusy);
+  fe_tobytes(out, zplusy);
+}
+#endif  /* CONFIG_CURVE25519_BASE_TABLE */
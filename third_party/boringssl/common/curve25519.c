@@ -25,6 +25,10 @@
 #include "util.h"
 #define CRYPTO_memcmp safe_memcmp
 
+#if defined(CONFIG_CURVE25519_BASE_TABLE) && defined(CORE_CORTEX_M0)
+#error "CONFIG_CURVE25519_BASE_TABLE needs the generic curve25519 code"
+#endif
+
 #ifdef CONFIG_RNG
 void X25519_keypair(uint8_t out_public_value[32], uint8_t out_private_key[32]) {
   rand_bytes(out_private_key, 32);
@@ -60,6 +64,10 @@ int X25519(uint8_t out_shared_key[32], const uint8_t private_key[32],
 
 void X25519_public_from_private(uint8_t out_public_value[32],
                                 const uint8_t private_key[32]) {
+#ifdef CONFIG_CURVE25519_BASE_TABLE
+  x25519_scalar_mult_base(out_public_value, private_key);
+#else
   static const uint8_t kMongomeryBasePoint[32] = {9};
   x25519_scalar_mult(out_public_value, private_key, kMongomeryBasePoint);
+#endif
 }
@@ -49,6 +49,7 @@
 #ifndef __CROS_EC_AES_H
 #define __CROS_EC_AES_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #define AES_ENCRYPT 1
@@ -75,6 +76,9 @@ typedef struct aes_key_st AES_KEY;
  */
 void aes_nohw_encrypt(const uint8_t *in, uint8_t *out, const AES_KEY *key);
 void aes_nohw_decrypt(const uint8_t *in, uint8_t *out, const AES_KEY *key);
+void aes_nohw_ctr32_encrypt_blocks(const uint8_t *in, uint8_t *out,
+                                   size_t blocks, const AES_KEY *key,
+                                   const uint8_t ivec[16]);
 int aes_nohw_set_encrypt_key(const uint8_t *key, unsigned bits,
                              AES_KEY *aeskey);
 int aes_nohw_set_decrypt_key(const uint8_t *key, unsigned bits,
@@ -126,4 +130,18 @@ static inline void AES_decrypt(const uint8_t *in, uint8_t *out,
 	aes_nohw_decrypt(in, out, key);
 }
 
+/**
+ * AES_ctr32_encrypt_blocks encrypts (or decrypts, which is the same in CTR
+ * mode) |blocks| whole blocks from |in| to |out| with |key|, starting with the
+ * counter block |ivec|. Only the last 32 bits of the counter are incremented,
+ * big-endian, as GCM does; |ivec| is left unchanged. The |in| and |out|
+ * pointers may be equal, and need not be aligned.
+ */
+static inline void AES_ctr32_encrypt_blocks(const uint8_t *in, uint8_t *out,
+					    size_t blocks, const AES_KEY *key,
+					    const uint8_t ivec[16])
+{
+	aes_nohw_ctr32_encrypt_blocks(in, out, blocks, key, ivec);
+}
+
 #endif  /* __CROS_EC_AES_H */
@@ -67,4 +67,11 @@ void x25519_scalar_mult(uint8_t out[32],
 			const uint8_t scalar[32],
 			const uint8_t point[32]);
 
+/*
+ * Low-level fixed-base x25519 function: x25519_scalar_mult() with the base
+ * point, using a table of its multiples (CONFIG_CURVE25519_BASE_TABLE).
+ * Must not be called directly.
+ */
+void x25519_scalar_mult_base(uint8_t out[32], const uint8_t scalar[32]);
+
 #endif /* __CROS_EC_CURVE25519_H */
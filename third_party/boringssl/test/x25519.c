@@ -180,15 +180,133 @@ static void test_x25519_speed(void)
 	ccprintf("X25519 duration %lld us\n", (long long)(t1.val - t0.val));
 }
 
+static int test_x25519_public_from_private(void)
+{
+	/* Taken from https://tools.ietf.org/html/rfc7748#section-6.1 */
+	static const uint8_t alice_private[32] = {
+		0x77, 0x07, 0x6d, 0x0a, 0x73, 0x18, 0xa5, 0x7d,
+		0x3c, 0x16, 0xc1, 0x72, 0x51, 0xb2, 0x66, 0x45,
+		0xdf, 0x4c, 0x2f, 0x87, 0xeb, 0xc0, 0x99, 0x2a,
+		0xb1, 0x77, 0xfb, 0xa5, 0x1d, 0xb9, 0x2c, 0x2a,
+	};
+	static const uint8_t alice_public[32] = {
+		0x85, 0x20, 0xf0, 0x09, 0x89, 0x30, 0xa7, 0x54,
+		0x74, 0x8b, 0x7d, 0xdc, 0xb4, 0x3e, 0xf7, 0x5a,
+		0x0d, 0xbf, 0x3a, 0x0d, 0x26, 0x38, 0x1a, 0xf4,
+		0xeb, 0xa4, 0xa9, 0x8e, 0xaa, 0x9b, 0x4e, 0x6a,
+	};
+	static const uint8_t bob_private[32] = {
+		0x5d, 0xab, 0x08, 0x7e, 0x62, 0x4a, 0x8a, 0x4b,
+		0x79, 0xe1, 0x7f, 0x8b, 0x83, 0x80, 0x0e, 0xe6,
+		0x6f, 0x3b, 0xb1, 0x29, 0x26, 0x18, 0xb6, 0xfd,
+		0x1c, 0x2f, 0x8b, 0x27, 0xff, 0x88, 0xe0, 0xeb,
+	};
+	static const uint8_t bob_public[32] = {
+		0xde, 0x9e, 0xdb, 0x7d, 0x7b, 0x7d, 0xc1, 0xb4,
+		0xd3, 0x5b, 0x61, 0xc2, 0xec, 0xe4, 0x35, 0x37,
+		0x3f, 0x83, 0x43, 0xc8, 0x5b, 0x78, 0x67, 0x4d,
+		0xad, 0xfc, 0x7e, 0x14, 0x6f, 0x88, 0x2b, 0x4f,
+	};
+	static const uint8_t shared[32] = {
+		0x4a, 0x5d, 0x9d, 0x5b, 0xa4, 0xce, 0x2d, 0xe1,
+		0x72, 0x8e, 0x3b, 0xf4, 0x80, 0x35, 0x0f, 0x25,
+		0xe0, 0x7e, 0x21, 0xc9, 0x47, 0xd1, 0x9e, 0x33,
+		0x76, 0xf0, 0x9b, 0x3c, 0x1e, 0x16, 0x17, 0x42,
+	};
+	uint8_t out[32];
+
+	X25519_public_from_private(out, alice_private);
+	if (memcmp(alice_public, out, sizeof(out)) != 0) {
+		ccprintf("X25519 public key test one failed.\n");
+		return 0;
+	}
+
+	X25519_public_from_private(out, bob_private);
+	if (memcmp(bob_public, out, sizeof(out)) != 0) {
+		ccprintf("X25519 public key test two failed.\n");
+		return 0;
+	}
+
+	if (!X25519(out, alice_private, bob_public) ||
+	    memcmp(shared, out, sizeof(out)) != 0) {
+		ccprintf("X25519 shared key test failed.\n");
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * The fixed-base path gives the same result as the ladder on the base point,
+ * for scalars with all digits at their extremes and for chained ones.
+ */
+static int test_x25519_base_matches_ladder(void)
+{
+	static const uint8_t kBasePoint[32] = {9};
+	uint8_t scalar[32], out[32], expected[32];
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		memset(scalar, i == 0 ? 0x00 : i == 1 ? 0xff : 0x88,
+		       sizeof(scalar));
+		x25519_scalar_mult_base(out, scalar);
+		x25519_scalar_mult(expected, scalar, kBasePoint);
+		if (memcmp(expected, out, sizeof(out)) != 0) {
+			ccprintf("X25519 fixed-base test %d failed.\n", i);
+			return 0;
+		}
+	}
+
+	memset(scalar, 0x5a, sizeof(scalar));
+	for (i = 0; i < 50; i++) {
+		watchdog_reload();
+		x25519_scalar_mult_base(out, scalar);
+		x25519_scalar_mult(expected, scalar, kBasePoint);
+		if (memcmp(expected, out, sizeof(out)) != 0) {
+			ccprintf("X25519 fixed-base chained test %d failed.\n",
+				 i);
+			return 0;
+		}
+		memcpy(scalar, out, sizeof(scalar));
+	}
+
+	return 1;
+}
+
+static void test_x25519_base_speed(void)
+{
+	static const uint8_t kBasePoint[32] = {9};
+	static const uint8_t scalar1[32] = {
+		0xa5, 0x46, 0xe3, 0x6b, 0xf0, 0x52, 0x7c, 0x9d,
+		0x3b, 0x16, 0x15, 0x4b, 0x82, 0x46, 0x5e, 0xdd,
+		0x62, 0x14, 0x4c, 0x0a, 0xc1, 0xfc, 0x5a, 0x18,
+		0x50, 0x6a, 0x22, 0x44, 0xba, 0x44, 0x9a, 0xc4,
+	};
+	uint8_t out[32];
+	uint64_t t0, t1, t2;
+
+	t0 = test_bench_time_ns();
+	x25519_scalar_mult(out, scalar1, kBasePoint);
+	t1 = test_bench_time_ns();
+	x25519_scalar_mult_base(out, scalar1);
+	t2 = test_bench_time_ns();
+	ccprintf("X25519 public key: ladder %lld us, fixed-base %lld us "
+		 "(%d passes)\n", (long long)(t1 - t0) / 1000,
+		 (long long)(t2 - t1) / 1000, CONFIG_CURVE25519_BASE_TABLE);
+}
+
 void run_test(int argc, char **argv)
 {
 	watchdog_reload();
 	/* do not check speed, just as a benchmark */
 	test_x25519_speed();
+	test_x25519_base_speed();
 
 	watchdog_reload();
 	if (!test_x25519() || !test_x25519_iterated() ||
-	    !test_x25519_small_order()) {
+	    !test_x25519_small_order() ||
+	    !test_x25519_public_from_private() ||
+	    !test_x25519_base_matches_ladder()) {
 		test_fail();
 		return;
 	}
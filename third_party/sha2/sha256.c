@@ -86,6 +86,7 @@ static const uint32_t sha256_h0[8] = {
 	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
 	0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
 
+#ifndef CONFIG_SHA256_HW_ACCELERATE
 static const uint32_t sha256_k[64] = {
 	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
 	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
@@ -103,6 +104,7 @@ static const uint32_t sha256_k[64] = {
 	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
 	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
 	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+#endif
 
 void SHA256_init(struct sha256_ctx *ctx)
 {
@@ -115,6 +117,14 @@ void SHA256_init(struct sha256_ctx *ctx)
 	ctx->tot_len = 0;
 }
 
+#ifdef CONFIG_SHA256_HW_ACCELERATE
+/* The chip's SHA engine takes the blocks */
+static void SHA256_transform(struct sha256_ctx *ctx, const uint8_t *message,
+			     unsigned int block_nb)
+{
+	SHA256_hw_transform(ctx->h, message, block_nb);
+}
+#else
 static void SHA256_transform(struct sha256_ctx *ctx, const uint8_t *message,
 			     unsigned int block_nb)
 {
@@ -181,42 +191,45 @@ static void SHA256_transform(struct sha256_ctx *ctx, const uint8_t *message,
 			ctx->h[j] += wv[j];
 	}
 }
+#endif /* CONFIG_SHA256_HW_ACCELERATE */
 
 void SHA256_update(struct sha256_ctx *ctx, const uint8_t *data, uint32_t len)
 {
 	unsigned int block_nb;
-	unsigned int new_len, rem_len, tmp_len;
-	const uint8_t *shifted_data;
-
-	tmp_len = SHA256_BLOCK_SIZE - ctx->len;
-	rem_len = len < tmp_len ? len : tmp_len;
-
-	memcpy(&ctx->block[ctx->len], data, rem_len);
-
-	if (ctx->len + len < SHA256_BLOCK_SIZE) {
-		ctx->len += len;
-		return;
+	unsigned int rem_len;
+
+	/* Fill up a partial block first */
+	if (ctx->len) {
+		rem_len = MIN(len, SHA256_BLOCK_SIZE - ctx->len);
+		memcpy(&ctx->block[ctx->len], data, rem_len);
+		ctx->len += rem_len;
+		if (ctx->len < SHA256_BLOCK_SIZE)
+			return;
+
+		SHA256_transform(ctx, ctx->block, 1);
+		ctx->tot_len += SHA256_BLOCK_SIZE;
+		ctx->len = 0;
+		data += rem_len;
+		len -= rem_len;
 	}
 
-	new_len = len - rem_len;
-	block_nb = new_len / SHA256_BLOCK_SIZE;
-
-	shifted_data = data + rem_len;
-
-	SHA256_transform(ctx, ctx->block, 1);
-	SHA256_transform(ctx, shifted_data, block_nb);
-
-	rem_len = new_len % SHA256_BLOCK_SIZE;
-
-	memcpy(ctx->block, &shifted_data[block_nb << 6], rem_len);
+	/* Whole blocks are hashed in place, without a copy */
+	block_nb = len / SHA256_BLOCK_SIZE;
+	if (block_nb) {
+		SHA256_transform(ctx, data, block_nb);
+		ctx->tot_len += block_nb * SHA256_BLOCK_SIZE;
+	}
 
+	rem_len = len % SHA256_BLOCK_SIZE;
+	memcpy(ctx->block, data + block_nb * SHA256_BLOCK_SIZE, rem_len);
 	ctx->len = rem_len;
-	ctx->tot_len += (block_nb + 1) << 6;
 }
 
+#ifndef HOST_TOOLS_BUILD
 /*
  * Specialized SHA256_init + SHA256_update that takes the first data block of
- * size SHA256_BLOCK_SIZE as input.
+ * size SHA256_BLOCK_SIZE as input. Only HMAC uses it, and host tools, which
+ * only hash, leave HMAC out.
  */
 static void SHA256_init_1b(struct sha256_ctx *ctx, const uint8_t *data)
 {
@@ -230,6 +243,7 @@ static void SHA256_init_1b(struct sha256_ctx *ctx, const uint8_t *data)
 	ctx->len = 0;
 	ctx->tot_len = SHA256_BLOCK_SIZE;
 }
+#endif
 
 uint8_t *SHA256_final(struct sha256_ctx *ctx)
 {
@@ -256,6 +270,7 @@ uint8_t *SHA256_final(struct sha256_ctx *ctx)
 	return ctx->buf;
 }
 
+#ifndef HOST_TOOLS_BUILD
 static void hmac_SHA256_step(uint8_t *output, uint8_t mask,
 			const uint8_t *key, const int key_len,
 			const uint8_t *data, const int data_len) {
@@ -295,3 +310,4 @@ void hmac_SHA256(uint8_t *output, const uint8_t *key, const int key_len,
 	hmac_SHA256_step(output, 0x5c,
 			 key, key_len, output, SHA256_DIGEST_SIZE);
 }
+#endif /* !HOST_TOOLS_BUILD */
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+# Copyright 2021 The Chromium OS Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+"""Generate the table of multiples of the curve25519 base point.
+
+x25519_scalar_mult_base() (CONFIG_CURVE25519_BASE_TABLE) works on the twisted
+Edwards form of the curve. Row i of the table holds j * 256^i * B for j from 1
+to 8, where B is the base point, each as (y + x, y - x, 2 * d * x * y) in the
+field element representation of common/curve25519-generic.c. Smaller tables
+use every other, fourth or eighth row, so each row is guarded by #if.
+
+Usage: util/curve25519_base_table.py > \
+    third_party/boringssl/common/curve25519-base-table.h
+"""
+
+P = 2**255 - 19
+D = -121665 * pow(121666, P - 2, P) % P
+
+BASE_X = 15112221349535400772501151409588531511454012693041857206046113283949847762202
+BASE_Y = 46316835694926478169428394003475163141307993866256225615783033603165251855960
+
+ROWS = 32
+ENTRIES = 8
+
+# Bit offset of each limb of a field element
+LIMB_SHIFT = [0, 26, 51, 77, 102, 128, 153, 179, 204, 230, 255]
+
+HEADER = """/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Multiples of the curve25519 base point, for x25519_scalar_mult_base().
+ * Generated by util/curve25519_base_table.py; do not edit.
+ *
+ * k25519BaseTable[i][j] is (j + 1) * 256^(i * CURVE25519_BASE_TABLE_STRIDE)
+ * times the base point. Including this file needs ge_precomp and
+ * CURVE25519_BASE_TABLE_STRIDE.
+ */
+"""
+
+
+def inv(a):
+    return pow(a, P - 2, P)
+
+
+def add(p1, p2):
+    """Add two points in affine coordinates on -x^2 + y^2 = 1 + d x^2 y^2."""
+    x1, y1 = p1
+    x2, y2 = p2
+    t = D * x1 * x2 * y1 * y2
+    x3 = (x1 * y2 + y1 * x2) * inv(1 + t) % P
+    y3 = (y1 * y2 + x1 * x2) * inv(1 - t) % P
+    return x3, y3
+
+
+def limbs(v):
+    return [(v >> LIMB_SHIFT[i]) & ((1 << (LIMB_SHIFT[i + 1] -
+                                           LIMB_SHIFT[i])) - 1)
+            for i in range(10)]
+
+
+def fe_text(v):
+    l = [str(x) for x in limbs(v)]
+    return ('{' + ', '.join(l[:5]) + ',\n\t\t\t ' + ', '.join(l[5:]) +
+            '}')
+
+
+def main():
+    print(HEADER)
+    print('static const ge_precomp k25519BaseTable[][%d] = {' % ENTRIES)
+
+    row_base = (BASE_X, BASE_Y)
+    for row in range(ROWS):
+        print('#if %d %% CURVE25519_BASE_TABLE_STRIDE == 0' % row)
+        print('\t{')
+        point = row_base
+        for _ in range(ENTRIES):
+            x, y = point
+            print('\t\t{')
+            print('\t\t\t%s,' % fe_text((y + x) % P))
+            print('\t\t\t%s,' % fe_text((y - x) % P))
+            print('\t\t\t%s,' % fe_text(2 * D * x * y % P))
+            print('\t\t},')
+            point = add(point, row_base)
+        print('\t},')
+        print('#endif')
+        for _ in range(8):
+            row_base = add(row_base, row_base)
+
+    print('};')
+
+
+if __name__ == '__main__':
+    main()
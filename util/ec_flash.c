@@ -10,7 +10,9 @@
 #include <string.h>
 
 #include "comm-host.h"
+#include "ec_flash.h"
 #include "misc_util.h"
+#include "sha256.h"
 #include "timer.h"
 
 static const uint32_t ERASE_ASYNC_TIMEOUT = 10 * SECOND;
@@ -132,6 +134,59 @@ static int get_flash_write_size(void)
 	return write_size;
 }
 
+/*
+ * Write in a session (version 2 of EC_CMD_FLASH_WRITE): the EC checks the
+ * range once, and programs and verifies a buffer at a time.
+ */
+static int ec_flash_write_session(const uint8_t *buf, int offset, int size,
+				  int write_size)
+{
+	struct ec_params_flash_write_v2 *p =
+		(struct ec_params_flash_write_v2 *)ec_outbuf;
+	int step = ((int)(ec_max_outsize - sizeof(*p)) / write_size) *
+		write_size;
+	int rv;
+	int i;
+
+	if (!step) {
+		fprintf(stderr, "Write block size %d > max param size %d\n",
+			write_size, (int)(ec_max_outsize - sizeof(*p)));
+		return -1;
+	}
+
+	printf("Write size %d, in a session...\n", step);
+
+	p->offset = offset;
+	p->size = size;
+	p->flags = EC_FLASH_WRITE_BEGIN;
+	rv = ec_command(EC_CMD_FLASH_WRITE, EC_VER_FLASH_WRITE_SESSION, p,
+			sizeof(*p), NULL, 0);
+	if (rv < 0) {
+		fprintf(stderr, "Write session refused\n");
+		return rv;
+	}
+
+	/* An empty session still needs a commit */
+	i = 0;
+	do {
+		p->offset = offset + i;
+		p->size = MIN(size - i, step);
+		p->flags = i + p->size == size ? EC_FLASH_WRITE_COMMIT : 0;
+		memcpy(p + 1, buf + i, p->size);
+		rv = ec_command(EC_CMD_FLASH_WRITE, EC_VER_FLASH_WRITE_SESSION,
+				p, sizeof(*p) + p->size, NULL, 0);
+		if (rv < 0) {
+			/* The error may be for data sent earlier */
+			fprintf(stderr, "Write error at or before offset %d\n",
+				i);
+			return rv;
+		}
+		i += p->size;
+	} while (i < size);
+
+	return 0;
+}
+
 int ec_flash_write(const uint8_t *buf, int offset, int size)
 {
 	struct ec_params_flash_write *p =
@@ -168,6 +223,10 @@ int ec_flash_write(const uint8_t *buf, int offset, int size)
 		return -1;
 	}
 
+	if (ec_cmd_version_supported(EC_CMD_FLASH_WRITE,
+				     EC_VER_FLASH_WRITE_SESSION))
+		return ec_flash_write_session(buf, offset, size, write_size);
+
 	/* Write data in chunks */
 	printf("Write size %d...\n", step);
 
@@ -186,6 +245,199 @@ int ec_flash_write(const uint8_t *buf, int offset, int size)
 	return 0;
 }
 
+/**
+ * Get the erase block size and the value of erased bytes.
+ *
+ * With several regions, the largest erase size is used; sizes are powers of
+ * two, so its blocks are whole blocks of every region.
+ *
+ * @return Erase size on success, negative on failure
+ */
+static int get_flash_erase_size(uint8_t *erased_value)
+{
+	uint8_t buf[sizeof(struct ec_response_flash_info_2) +
+		    8 * sizeof(struct ec_flash_bank)];
+	struct ec_response_flash_info_2 *r2 =
+		(struct ec_response_flash_info_2 *)buf;
+	struct ec_params_flash_info_2 p = { .num_banks_desc = 8 };
+	struct ec_response_flash_info_1 r1;
+	int erase_size = 0;
+	int rv, i;
+
+	if (ec_cmd_version_supported(EC_CMD_FLASH_INFO, 2)) {
+		rv = ec_command(EC_CMD_FLASH_INFO, 2, &p, sizeof(p), buf,
+				sizeof(buf));
+		if (rv < 0)
+			return rv;
+		for (i = 0; i < r2->num_banks_desc && i < 8; i++)
+			erase_size = MAX(erase_size,
+					 1 << r2->banks[i].erase_size_exp);
+		*erased_value = r2->flags & EC_FLASH_INFO_ERASE_TO_0 ? 0 : 0xff;
+		return erase_size;
+	}
+
+	memset(&r1, 0, sizeof(r1));
+	rv = ec_command(EC_CMD_FLASH_INFO,
+			ec_cmd_version_supported(EC_CMD_FLASH_INFO, 1),
+			NULL, 0, &r1, sizeof(r1));
+	if (rv < 0)
+		return rv;
+
+	*erased_value = r1.flags & EC_FLASH_INFO_ERASE_TO_0 ? 0 : 0xff;
+	return r1.erase_block_size;
+}
+
+/* Block states for ec_flash_update() */
+#define BLOCK_ERASE BIT(0)	/* Flash holds data; erase it */
+#define BLOCK_WRITE BIT(1)	/* New data isn't all erased bytes */
+
+/*
+ * Find the blocks that differ from the new data, from the digests the EC
+ * computes, or else by reading flash back.
+ */
+static int diff_blocks(const uint8_t *buf, int offset, int blocks,
+		       int erase_size, uint8_t erased_value, uint8_t *state)
+{
+	struct ec_params_flash_block_hash p;
+	struct sha256_ctx ctx;
+	uint8_t *erased, *rbuf = NULL;
+	uint8_t erased_digest[SHA256_DIGEST_SIZE];
+	const uint8_t *digest;
+	int use_hash;
+	int i, n, rv;
+
+	/* As many blocks per command as the EC hashes */
+	n = MAX(1, EC_FLASH_BLOCK_HASH_MAX_SIZE / erase_size);
+	n = MIN(n, ec_max_insize / EC_FLASH_BLOCK_HASH_SIZE);
+	use_hash = n && erase_size <= EC_FLASH_BLOCK_HASH_MAX_BLOCK_SIZE &&
+		ec_cmd_version_supported(EC_CMD_FLASH_BLOCK_HASH, 0);
+
+	erased = malloc(erase_size);
+	if (!use_hash)
+		rbuf = malloc(erase_size);
+	if (!erased || (!use_hash && !rbuf)) {
+		fprintf(stderr, "Unable to allocate buffer.\n");
+		free(erased);
+		return -1;
+	}
+
+	memset(erased, erased_value, erase_size);
+	SHA256_init(&ctx);
+	SHA256_update(&ctx, erased, erase_size);
+	memcpy(erased_digest, SHA256_final(&ctx), SHA256_DIGEST_SIZE);
+
+	for (i = 0; i < blocks; i++) {
+		const uint8_t *data = buf + i * erase_size;
+
+		if (use_hash && i % n == 0) {
+			p.offset = offset + i * erase_size;
+			p.size = MIN(blocks - i, n) * erase_size;
+			p.block_size = erase_size;
+			rv = ec_command(EC_CMD_FLASH_BLOCK_HASH, 0, &p,
+					sizeof(p), ec_inbuf,
+					MIN(blocks - i, n) *
+					EC_FLASH_BLOCK_HASH_SIZE);
+			if (rv < (int)(MIN(blocks - i, n) *
+				       EC_FLASH_BLOCK_HASH_SIZE)) {
+				fprintf(stderr, "Hash error at offset %d\n",
+					i * erase_size);
+				break;
+			}
+		}
+
+		if (use_hash) {
+			digest = (const uint8_t *)ec_inbuf +
+				(i % n) * EC_FLASH_BLOCK_HASH_SIZE;
+			SHA256_init(&ctx);
+			SHA256_update(&ctx, data, erase_size);
+			if (!memcmp(digest, SHA256_final(&ctx),
+				    SHA256_DIGEST_SIZE))
+				continue;
+			if (memcmp(digest, erased_digest, SHA256_DIGEST_SIZE))
+				state[i] |= BLOCK_ERASE;
+		} else {
+			rv = ec_flash_read(rbuf, offset + i * erase_size,
+					   erase_size);
+			if (rv < 0)
+				break;
+			if (!memcmp(rbuf, data, erase_size))
+				continue;
+			if (memcmp(rbuf, erased, erase_size))
+				state[i] |= BLOCK_ERASE;
+		}
+
+		if (memcmp(data, erased, erase_size))
+			state[i] |= BLOCK_WRITE;
+	}
+
+	free(erased);
+	free(rbuf);
+	return i < blocks ? -1 : 0;
+}
+
+int ec_flash_update(const uint8_t *buf, int offset, int size)
+{
+	uint8_t erased_value;
+	uint8_t *state;
+	int erase_size;
+	int blocks, erased = 0, written = 0;
+	int rv = 0;
+	int i, j;
+
+	erase_size = get_flash_erase_size(&erased_value);
+	if (erase_size <= 0)
+		return -1;
+
+	if (offset % erase_size || size % erase_size) {
+		fprintf(stderr, "Offset and size must be multiples of the "
+			"erase size %d\n", erase_size);
+		return -1;
+	}
+
+	blocks = size / erase_size;
+	state = calloc(blocks, 1);
+	if (!state) {
+		fprintf(stderr, "Unable to allocate buffer.\n");
+		return -1;
+	}
+
+	rv = diff_blocks(buf, offset, blocks, erase_size, erased_value, state);
+
+	/* Erase, then write, each run of blocks that needs it */
+	for (i = 0; !rv && i < blocks; i = j) {
+		for (j = i; j < blocks && (state[j] & BLOCK_ERASE); j++)
+			;
+		if (j == i) {
+			j++;
+			continue;
+		}
+		rv = ec_flash_erase(offset + i * erase_size,
+				    (j - i) * erase_size);
+		erased += j - i;
+	}
+
+	for (i = 0; !rv && i < blocks; i = j) {
+		for (j = i; j < blocks && (state[j] & BLOCK_WRITE); j++)
+			;
+		if (j == i) {
+			j++;
+			continue;
+		}
+		rv = ec_flash_write(buf + i * erase_size,
+				    offset + i * erase_size,
+				    (j - i) * erase_size);
+		written += j - i;
+	}
+
+	free(state);
+	if (rv < 0)
+		return rv;
+
+	printf("%d of %d blocks of %d bytes erased, %d written\n", erased,
+	       blocks, erase_size, written);
+	return 0;
+}
+
 int ec_flash_erase(int offset, int size)
 {
 	struct ec_params_flash_erase p;
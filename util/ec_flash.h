@@ -39,6 +39,20 @@ int ec_flash_verify(const uint8_t *buf, int offset, int size);
  */
 int ec_flash_write(const uint8_t *buf, int offset, int size);
 
+/**
+ * Update EC flash memory, erasing and writing only the erase blocks that
+ * differ from the new data
+ *
+ * @param buf		Source buffer
+ * @param offset	Offset in EC flash to update
+ * @param size		Number of bytes to update
+ *
+ * Offset and size must be multiples of the erase block size.
+ *
+ * @return 0 if success, negative if error.
+ */
+int ec_flash_update(const uint8_t *buf, int offset, int size);
+
 /**
  * Erase EC flash memory
  *
@@ -5,6 +5,8 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "compile_time_macros.h"
 #include "ec_panicinfo.h"
 
@@ -124,3 +126,118 @@ int parse_panic_info(const struct panic_data *pdata)
 	}
 	return -1;
 }
+
+static int decompress(const uint8_t *in, int len, char *out, int out_size)
+{
+	const uint8_t *in_end = in + len;
+	int o = 0;
+	int n, dist;
+
+	while (in < in_end) {
+		if (*in < 0x80) {
+			n = *in++ + 1;
+			if (n > in_end - in || o + n > out_size)
+				return -1;
+			memcpy(out + o, in, n);
+			in += n;
+			o += n;
+		} else {
+			n = (*in++ & 0x7f) + PANIC_LOG_LZ_MIN_MATCH;
+			if (in == in_end)
+				return -1;
+			dist = *in++ + 1;
+			if (dist > o || o + n > out_size)
+				return -1;
+			for (; n; n--, o++)
+				out[o] = out[o - dist];
+		}
+	}
+	return o;
+}
+
+static void print_log_task(const struct panic_log_task *t, int size)
+{
+	int words = (size - (int)sizeof(*t)) / 4;
+	int i;
+
+	printf("Task %2d %-8.8s events %08x sp %08x\n", t->id, t->name,
+	       t->events, t->sp);
+	for (i = 0; i < words; i++)
+		printf("%s%08x", i % 8 ? " " : "  ", t->stack[i]);
+	if (words)
+		printf("\n");
+}
+
+static int print_log_console(const struct panic_log_console *c, int size)
+{
+	char *out = malloc(c->raw_size);
+	int n;
+
+	if (!out)
+		return -1;
+
+	n = decompress(c->data, size - sizeof(*c), out, c->raw_size);
+	if (n < 0) {
+		fprintf(stderr, "Bad console output in crash log.\n");
+		free(out);
+		return -1;
+	}
+	printf("Console output (%d bytes, %d compressed):\n", c->raw_size,
+	       size - (int)sizeof(*c));
+	fwrite(out, 1, n, stdout);
+	printf("\n");
+
+	free(out);
+	return 0;
+}
+
+int parse_panic_log(const uint8_t *log, int size)
+{
+	const struct panic_log_header *h = (const void *)log;
+	const struct panic_log_record *r;
+	const struct panic_log_time *t;
+	const uint8_t *p, *end;
+
+	if (size < sizeof(*h) || h->magic != PANIC_LOG_MAGIC) {
+		fprintf(stderr, "No crash log.\n");
+		return -1;
+	}
+	if (h->version != PANIC_LOG_VERSION)
+		fprintf(stderr,
+			"Unknown crash log version (%d). "
+			"Following data may be incorrect!\n", h->version);
+
+	end = log + size;
+	if (sizeof(*h) + h->size < size)
+		end = log + sizeof(*h) + h->size;
+	for (p = log + sizeof(*h); p + sizeof(*r) <= end;
+	     p += sizeof(*r) + PANIC_LOG_PADDED(r->size)) {
+		r = (const void *)p;
+		if (p + sizeof(*r) + r->size > end) {
+			fprintf(stderr, "Truncated crash log.\n");
+			return -1;
+		}
+
+		switch (r->type) {
+		case PANIC_LOG_TIME:
+			t = (const void *)(r + 1);
+			printf("Time %llu.%06llu, clock %08x\n",
+			       (unsigned long long)t->now / 1000000,
+			       (unsigned long long)t->now % 1000000,
+			       t->hw_clock);
+			break;
+		case PANIC_LOG_TASK:
+			print_log_task((const void *)(r + 1), r->size);
+			break;
+		case PANIC_LOG_CONSOLE:
+			if (print_log_console((const void *)(r + 1), r->size))
+				return -1;
+			break;
+		default:
+			printf("Unknown record type %d (%d bytes)\n", r->type,
+			       r->size);
+			break;
+		}
+	}
+	return 0;
+}
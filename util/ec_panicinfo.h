@@ -16,4 +16,13 @@
  */
 int parse_panic_info(const struct panic_data *pdata);
 
+/**
+ * Prints a crash log (CONFIG_PANIC_LOG) to stdout.
+ *
+ * @param log   Crash log, starting with struct panic_log_header
+ * @param size  Size of the log
+ * @return 0 if success or non-zero error code if error.
+ */
+int parse_panic_log(const uint8_t *log, int size);
+
 #endif /* EC_PANICINFO_H */
@@ -3,15 +3,25 @@
  * found in the LICENSE file.
  *
  * Standalone utility to parse EC panicinfo.
+ *
+ * With -l, parses a crash log (CONFIG_PANIC_LOG) instead.
  */
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include "ec_panicinfo.h"
 
 int main(int argc, char *argv[])
 {
 	struct panic_data pdata;
+	uint8_t log[0x10000];
+	size_t size;
+
+	if (argc > 1 && !strcmp(argv[1], "-l")) {
+		size = fread(log, 1, sizeof(log), stdin);
+		return parse_panic_log(log, size) ? 1 : 0;
+	}
 
 	if (fread(&pdata, sizeof(pdata), 1, stdin) != 1) {
 		fprintf(stderr, "Error reading panicinfo from stdin.\n");
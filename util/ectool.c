@@ -96,8 +96,13 @@ const char help_str[] =
 	"      Prints chip info\n"
 	"  cmdversions <cmd>\n"
 	"      Prints supported version mask for a command number\n"
-	"  console\n"
-	"      Prints the last output to the EC debug console\n"
+	"  console [reader]\n"
+	"      Prints the last output to the EC debug console, or the output\n"
+	"      since the named reader last read it\n"
+	"  consolebatch\n"
+	"      Runs the console command lines read from stdin in one batch\n"
+	"  consolestats\n"
+	"      Prints the rate limits and lost lines of console channels\n"
 	"  cec\n"
 	"      Read or write CEC messages and settings\n"
 	"  echash [CMDS]\n"
@@ -140,6 +145,8 @@ const char help_str[] =
 	"      Prints or sets EC flash protection state\n"
 	"  flashread <offset> <size> <outfile>\n"
 	"      Reads from EC flash to a file\n"
+	"  flashupdate <offset> <infile>\n"
+	"      Erases and writes the EC flash blocks that differ from a file\n"
 	"  flashwrite <offset> <infile>\n"
 	"      Writes to EC flash from a file\n"
 	"  forcelidopen <enable>\n"
@@ -208,6 +215,8 @@ const char help_str[] =
 	"      Various motion sense control commands\n"
 	"  panicinfo\n"
 	"      Prints saved panic info\n"
+	"  paniclog\n"
+	"      Prints the crash log of the last panic\n"
 	"  pause_in_s5 [on|off]\n"
 	"      Whether or not the AP should pause in S5 on shutdown\n"
 	"  pdcontrol [suspend|resume|reset|disable|on]\n"
@@ -1438,6 +1447,43 @@ int cmd_flash_write(int argc, char *argv[])
 	return 0;
 }
 
+int cmd_flash_update(int argc, char *argv[])
+{
+	int offset, size;
+	int rv;
+	char *e;
+	char *buf;
+
+	if (argc < 3) {
+		fprintf(stderr, "Usage: %s <offset> <filename>\n", argv[0]);
+		return -1;
+	}
+
+	offset = strtol(argv[1], &e, 0);
+	if ((e && *e) || offset < 0 || offset > MAX_FLASH_SIZE) {
+		fprintf(stderr, "Bad offset.\n");
+		return -1;
+	}
+
+	/* Read the input file */
+	buf = read_file(argv[2], &size);
+	if (!buf)
+		return -1;
+
+	printf("Updating %d bytes at offset %d...\n", size, offset);
+
+	/* Erase and write only the blocks that changed */
+	rv = ec_flash_update((const uint8_t *)buf, offset, size);
+
+	free(buf);
+
+	if (rv < 0)
+		return rv;
+
+	printf("done.\n");
+	return 0;
+}
+
 int cmd_flash_erase(int argc, char *argv[])
 {
 	int offset, size;
@@ -6380,6 +6426,36 @@ int cmd_panic_info(int argc, char *argv[])
 	return parse_panic_info(pdata);
 }
 
+int cmd_panic_log(int argc, char *argv[])
+{
+	struct ec_params_get_panic_log p = { 0 };
+	uint8_t *log = NULL;
+	int rv;
+
+	do {
+		log = realloc(log, p.offset + ec_max_insize);
+		if (!log) {
+			fprintf(stderr, "Out of memory.\n");
+			return -1;
+		}
+		rv = ec_command(EC_CMD_GET_PANIC_LOG, 0, &p, sizeof(p),
+				log + p.offset, ec_max_insize);
+		if (rv < 0) {
+			free(log);
+			return rv;
+		}
+		p.offset += rv;
+	} while (rv > 0);
+
+	if (p.offset == 0)
+		printf("No crash log.\n");
+	else
+		rv = parse_panic_log(log, p.offset);
+
+	free(log);
+	return rv;
+}
+
 
 int cmd_power_info(int argc, char *argv[])
 {
@@ -8253,11 +8329,16 @@ static int ec_hash_help(const char *cmd)
 	printf("Usage:\n");
 	printf("  %s                        - get last hash\n", cmd);
 	printf("  %s abort                  - abort hashing\n", cmd);
-	printf("  %s start [<offset> <size> [<nonce>]] - start hashing\n", cmd);
-	printf("  %s recalc [<offset> <size> [<nonce>]] - sync rehash\n", cmd);
+	printf("  %s start [tree] [<offset> <size> [<nonce>]] - start hashing\n",
+	       cmd);
+	printf("  %s recalc [tree] [<offset> <size> [<nonce>]] - sync rehash\n",
+	       cmd);
 	printf("\n"
 	       "If <offset> is RO or RW, offset and size are computed\n"
-	       "automatically for the EC-RO or EC-RW firmware image.\n");
+	       "automatically for the EC-RO or EC-RW firmware image.\n"
+	       "With tree, the hash is the SHA-256 of the SHA-256 of each\n"
+	       "%d-byte block, which the EC updates quicker after writes.\n",
+	       EC_VBOOT_HASH_TREE_BLOCK_SIZE);
 
 	return 0;
 }
@@ -8281,6 +8362,8 @@ static int ec_hash_print(const struct ec_response_vboot_hash *r)
 	printf("status:  done\n");
 	if (r->hash_type == EC_VBOOT_HASH_TYPE_SHA256)
 		printf("type:    SHA-256\n");
+	else if (r->hash_type == EC_VBOOT_HASH_TYPE_SHA256_TREE)
+		printf("type:    SHA-256 tree\n");
 	else
 		printf("type:    %d\n", r->hash_type);
 
@@ -8331,6 +8414,11 @@ int cmd_ec_hash(int argc, char *argv[])
 		return ec_hash_help(argv[0]);
 
 	p.hash_type = EC_VBOOT_HASH_TYPE_SHA256;
+	if (argc >= 3 && !strcasecmp(argv[2], "tree")) {
+		p.hash_type = EC_VBOOT_HASH_TYPE_SHA256_TREE;
+		argc--;
+		argv++;
+	}
 
 	if (argc < 3) {
 		fprintf(stderr, "Must specify offset\n");
@@ -8471,11 +8559,43 @@ int cmd_rtc_get_alarm(int argc, char *argv[])
 	return 0;
 }
 
+static int console_read_reader(const char *reader)
+{
+	struct ec_params_console_read_v2 p;
+	struct ec_response_console_read_v2 *r = ec_inbuf;
+	int rv;
+
+	if (!ec_cmd_version_supported(EC_CMD_CONSOLE_READ, 2)) {
+		fprintf(stderr, "EC does not support console readers\n");
+		return -1;
+	}
+
+	memset(&p, 0, sizeof(p));
+	memcpy(p.reader, reader, MIN(strlen(reader), sizeof(p.reader)));
+	do {
+		rv = ec_command(EC_CMD_CONSOLE_READ, 2, &p, sizeof(p),
+				ec_inbuf, ec_max_insize);
+		if (rv < 0)
+			return rv;
+		if (rv < sizeof(*r))
+			return -1;
+
+		if (r->lost)
+			printf("\n[%u bytes lost]\n", r->lost);
+		fwrite(r->data, 1, rv - sizeof(*r), stdout);
+	} while (r->pending);
+
+	return 0;
+}
+
 int cmd_console(int argc, char *argv[])
 {
 	char *out = (char *)ec_inbuf;
 	int rv;
 
+	if (argc > 1)
+		return console_read_reader(argv[1]);
+
 	/* Snapshot the EC console */
 	rv = ec_command(EC_CMD_CONSOLE_SNAPSHOT, 0, NULL, 0, NULL, 0);
 	if (rv < 0)
@@ -8499,6 +8619,98 @@ int cmd_console(int argc, char *argv[])
 	printf("\n");
 	return 0;
 }
+
+int cmd_console_batch(int argc, char *argv[])
+{
+	struct ec_params_console_batch *p = ec_outbuf;
+	struct ec_response_console_batch *r = ec_inbuf;
+	const int max_chunk = ec_max_outsize - sizeof(*p);
+	struct ec_console_batch_frame f;
+	static char in[65536];
+	uint8_t *out = NULL;
+	int in_len, out_len = 0, pos = 0, line = 0;
+	int rv, n, i;
+
+	in_len = fread(in, 1, sizeof(in), stdin);
+	if (in_len == sizeof(in)) {
+		fprintf(stderr, "Batch too large\n");
+		return -1;
+	}
+
+	/* Send the lines, and run them with the last chunk */
+	for (i = 0; i == 0 || i < in_len; i += n) {
+		n = MIN(in_len - i, max_chunk);
+		p->subcmd = i + n < in_len ? CONSOLE_BATCH_ADD :
+					     CONSOLE_BATCH_RUN;
+		memcpy(p->commands, in + i, n);
+		rv = ec_command(EC_CMD_CONSOLE_BATCH, 0, p, sizeof(*p) + n,
+				NULL, 0);
+		if (rv < 0)
+			return rv;
+	}
+
+	/* Read the frames, and print the complete ones */
+	p->subcmd = CONSOLE_BATCH_READ;
+	do {
+		rv = ec_command(EC_CMD_CONSOLE_BATCH, 0, p, sizeof(*p),
+				ec_inbuf, ec_max_insize);
+		if (rv < 0)
+			break;
+		n = rv - sizeof(*r);
+		if (n > 0) {
+			out = realloc(out, out_len + n);
+			if (!out) {
+				fprintf(stderr, "Out of memory\n");
+				return -1;
+			}
+			memcpy(out + out_len, r->data, n);
+			out_len += n;
+		} else if (!(r->flags & EC_CONSOLE_BATCH_DONE)) {
+			usleep(10000);
+		}
+
+		while (out_len - pos >= sizeof(f)) {
+			memcpy(&f, out + pos, sizeof(f));
+			if (out_len - pos < sizeof(f) + f.size)
+				break;
+			printf("=== line %d: result %d%s\n", line++, f.result,
+			       f.flags & EC_CONSOLE_BATCH_FRAME_TRUNCATED ?
+			       ", truncated" : "");
+			fwrite(out + pos + sizeof(f), 1, f.size, stdout);
+			pos += sizeof(f) + f.size;
+		}
+	} while (!(r->flags & EC_CONSOLE_BATCH_DONE));
+
+	if (rv >= 0 && r->flags & EC_CONSOLE_BATCH_OVERFLOW)
+		fprintf(stderr, "Out of output space after line %d\n", line);
+
+	free(out);
+	return rv < 0 ? rv : 0;
+}
+
+int cmd_console_stats(int argc, char *argv[])
+{
+	struct ec_params_console_channel_stats p;
+	struct ec_response_console_channel_stats r;
+	int rv;
+
+	printf(" # E Channel          Rate Burst Suppressed    Dropped\n");
+	p.channel = 0;
+	do {
+		rv = ec_command(EC_CMD_CONSOLE_CHANNEL_STATS, 0, &p, sizeof(p),
+				&r, sizeof(r));
+		if (rv < 0)
+			return rv;
+
+		r.name[sizeof(r.name) - 1] = '\0';
+		printf("%2d %c %-15s %5u %5u %10u %10u\n", p.channel,
+		       r.flags & EC_CONSOLE_CHANNEL_ENABLED ? '*' : ' ',
+		       r.name, r.rate, r.burst, r.suppressed, r.dropped);
+	} while (++p.channel < r.channel_count);
+
+	return 0;
+}
+
 struct param_info {
 	const char *name;	/* name of this parameter */
 	const char *help;	/* help message */
@@ -10044,6 +10256,8 @@ const struct command commands[] = {
 	{"chipinfo", cmd_chipinfo},
 	{"cmdversions", cmd_cmdversions},
 	{"console", cmd_console},
+	{"consolebatch", cmd_console_batch},
+	{"consolestats", cmd_console_stats},
 	{"cec", cmd_cec},
 	{"echash", cmd_ec_hash},
 	{"eventclear", cmd_host_event_clear},
@@ -10062,6 +10276,7 @@ const struct command commands[] = {
 	{"flasheraseasync", cmd_flash_erase},
 	{"flashprotect", cmd_flash_protect},
 	{"flashread", cmd_flash_read},
+	{"flashupdate", cmd_flash_update},
 	{"flashwrite", cmd_flash_write},
 	{"flashinfo", cmd_flash_info},
 	{"flashspiinfo", cmd_flash_spi_info},
@@ -10102,6 +10317,7 @@ const struct command commands[] = {
 	{"motionsense", cmd_motionsense},
 	{"nextevent", cmd_next_event},
 	{"panicinfo", cmd_panic_info},
+	{"paniclog", cmd_panic_log},
 	{"pause_in_s5", cmd_s5},
 	{"pdgetmode", cmd_pd_get_amode},
 	{"pdsetmode", cmd_pd_set_amode},